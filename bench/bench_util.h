@@ -0,0 +1,96 @@
+/**
+ * @file bench_util.h
+ * @brief Shared helpers for the benchmark executables
+ */
+
+#ifndef FFVMS_BENCH_UTIL_H
+#define FFVMS_BENCH_UTIL_H
+
+#include "interfaces/i_logger.h"
+#include "interfaces/i_storage.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace ffvms::bench {
+
+/// @brief Logger that discards everything so timings are not skewed by log I/O
+class NullLogger : public ILogger {
+private:
+    std::string empty_;
+
+public:
+    void log(const std::string&, LogLevel, int) override {}
+    const std::string& get_last_message() const override { return empty_; }
+    void set_information(const std::string&) override {}
+    const std::string& get_information() const override { return empty_; }
+};
+
+/// @brief Wall-clock stopwatch in seconds
+class Stopwatch {
+private:
+    std::chrono::steady_clock::time_point start_ = std::chrono::steady_clock::now();
+
+public:
+    void reset() { start_ = std::chrono::steady_clock::now(); }
+    double seconds() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    }
+};
+
+/**
+ * @brief Generate source-like text: identifiers, keywords and punctuation
+ *
+ * Deterministic for a given seed so runs are comparable.
+ */
+inline std::string make_text(std::size_t bytes, unsigned seed = 1) {
+    static const char* words[] = {
+        "int", "return", "const", "std::string", "for", "if", "else", "while", "auto",
+        "node", "content", "version", "counter", "storage", "manager", "->", "::",
+        "(", ")", "{", "}", ";", "=", "==", "+", "0", "1", "nullptr", "true", "false"};
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<std::size_t> pick(0, sizeof(words) / sizeof(words[0]) - 1);
+    std::string out;
+    out.reserve(bytes + 16);
+    while (out.size() < bytes) {
+        out += words[pick(gen)];
+        out.push_back(gen() % 9 == 0 ? '\n' : ' ');
+    }
+    out.resize(bytes);
+    return out;
+}
+
+/**
+ * @brief Build a FileManager-shaped table whose string payload totals @p bytes
+ */
+inline DataTable make_table(std::size_t bytes, std::size_t row_bytes = 64 * 1024) {
+    DataTable table;
+    std::size_t id = 1;
+    for (std::size_t done = 0; done < bytes; done += row_bytes, id++) {
+        std::size_t n = bytes - done < row_bytes ? bytes - done : row_bytes;
+        table.push_back({std::to_string(id), make_text(n, static_cast<unsigned>(id)), "1"});
+    }
+    return table;
+}
+
+/// @brief Parse "sizes in MB" from argv, falling back to @p defaults
+inline std::vector<std::size_t> sizes_from_args(int argc, char** argv, std::vector<std::size_t> defaults) {
+    if (argc <= 1) return defaults;
+    std::vector<std::size_t> sizes;
+    for (int i = 1; i < argc; i++) sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+    return sizes;
+}
+
+inline std::string temp_path(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+inline double mb(std::size_t bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); }
+
+}  // namespace ffvms::bench
+
+#endif // FFVMS_BENCH_UTIL_H
@@ -0,0 +1,59 @@
+/**
+ * @file cache_bench.cpp
+ * @brief Repeated table loads through Saver with and without CachedStorage
+ *
+ * Usage: ffvms_cache_bench [tables] [table KB] [cache MB ...]   (default: 64 256 0 4 16 64)
+ *
+ * Loads tables in a skewed order (a few tables get most of the loads, as
+ * the current version's node and content tables do) and reports loads per
+ * second and the cache hit rate. Cache size 0 is Saver alone.
+ */
+
+#include "bench_util.h"
+#include "saver.h"
+#include "storage/cached_storage.h"
+#include <cstdio>
+#include <random>
+
+using namespace ffvms;
+using namespace ffvms::bench;
+
+int main(int argc, char** argv) {
+    const std::size_t tables = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 64;
+    const std::size_t table_kb = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 256;
+    std::vector<std::size_t> capacities = {0, 4, 16, 64};
+    if (argc > 3) {
+        capacities.clear();
+        for (int i = 3; i < argc; i++) capacities.push_back(std::strtoull(argv[i], nullptr, 10));
+    }
+    const std::string path = temp_path("ffvms_bench_cache.chm");
+    std::remove(path.c_str());
+    NullLogger logger;
+    Saver saver(&logger, path);
+    for (std::size_t i = 0; i < tables; i++) saver.save("table" + std::to_string(i), make_table(table_kb << 10, 4096));
+
+    // Zipf-like: table i is picked with weight 1 / (i + 1)
+    std::vector<double> weights(tables);
+    for (std::size_t i = 0; i < tables; i++) weights[i] = 1.0 / static_cast<double>(i + 1);
+    const std::size_t loads = 2000;
+
+    std::printf("%zu tables of %zu KB, %zu loads\n", tables, table_kb, loads);
+    std::printf("%10s %12s %10s %12s\n", "cache MB", "loads/s", "hit rate", "cached MB");
+    for (std::size_t capacity_mb : capacities) {
+        storage::CachedStorageOptions options;
+        options.capacity_bytes = capacity_mb << 20;
+        storage::CachedStorage cache(&saver, options);
+        IStorage& storage = capacity_mb ? static_cast<IStorage&>(cache) : saver;
+        std::mt19937 gen(7);
+        std::discrete_distribution<std::size_t> pick(weights.begin(), weights.end());
+        DataTable loaded;
+        Stopwatch clock;
+        for (std::size_t i = 0; i < loads; i++) storage.load("table" + std::to_string(pick(gen)), loaded);
+        const double seconds = clock.seconds();
+        const auto stats = cache.stats();
+        std::printf("%10zu %12.0f %9.1f%% %12.1f\n", capacity_mb, loads / seconds,
+                    capacity_mb ? 100.0 * stats.hits / loads : 0.0, mb(cache.cached_bytes()));
+    }
+    std::remove(path.c_str());
+    return 0;
+}
@@ -0,0 +1,52 @@
+/**
+ * @file checksum_bench.cpp
+ * @brief Throughput of the record integrity checks
+ *
+ * Usage: ffvms_checksum_bench [record size in MB ...]   (default: 1 64)
+ *
+ * "polynomial" is storage::polynomial_hash, which Saver used before block checksums
+ * and still uses for older records. "crc32c-table" is the slicing-by-8
+ * fallback, "crc32c" the hardware path when the CPU has one, "blocks-1t"
+ * and "blocks" a BlockChecksums table without and with the shared pool.
+ * "xxhash64" is the content hash Saver compares to skip unchanged saves.
+ */
+
+#include "bench_util.h"
+#include "storage/block_checksums.h"
+#include "storage/crc32c.h"
+#include "storage/data_file_format.h"
+#include "storage/xxhash64.h"
+#include <cstdio>
+#include <functional>
+
+using namespace ffvms;
+using namespace ffvms::bench;
+
+namespace {
+
+// Keeps the result alive so the loop is not optimized away
+volatile unsigned long long sink;
+
+void run(const char* name, const std::string& data, const std::function<unsigned long long()>& body) {
+    const int rounds = data.size() >= (64u << 20) ? 2 : static_cast<int>((128u << 20) / (data.size() + 1)) + 1;
+    Stopwatch clock;
+    for (int i = 0; i < rounds; i++) sink = body();
+    std::printf("%-14s %8.1f %12.1f\n", name, mb(data.size()), mb(data.size()) * rounds / clock.seconds());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::printf("hardware crc32c: %s\n", storage::crc32c_hardware() ? "yes" : "no");
+    std::printf("%-14s %8s %12s\n", "check", "size MB", "MB/s");
+    for (std::size_t size_mb : sizes_from_args(argc, argv, {1, 64})) {
+        const std::string data = make_text(size_mb << 20);
+        run("polynomial", data, [&] { return storage::polynomial_hash(data); });
+        run("crc32c-table", data, [&] { return storage::crc32c_portable(data.data(), data.size()); });
+        run("crc32c", data, [&] { return storage::crc32c(data.data(), data.size()); });
+        run("blocks-1t", data, [&] { return storage::BlockChecksums::compute(data, nullptr).blocks(); });
+        run("blocks", data, [&] { return storage::BlockChecksums::compute(data).blocks(); });
+        run("xxhash64", data, [&] { return storage::xxhash64(data); });
+    }
+    return 0;
+}
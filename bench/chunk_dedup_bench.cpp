@@ -0,0 +1,82 @@
+/**
+ * @file chunk_dedup_bench.cpp
+ * @brief Storage amplification of FileManager across many edits of one large file
+ *
+ * Usage: ffvms_dedup_bench [file size in MB] [edits]   (default: 50 100)
+ *
+ * Every edit replaces a few lines at a random spot, and all versions stay
+ * referenced as they would be by version nodes. "whole copies" is what
+ * storing each version as its own string costs; "chunk store" is what the
+ * deduplicating store keeps. Amplification is stored bytes divided by the
+ * size of a single version.
+ */
+
+#include "bench_util.h"
+#include "file_manager.h"
+#include <cstdio>
+
+using namespace ffvms;
+using namespace ffvms::bench;
+
+namespace {
+
+/// FileManager only needs somewhere to load from and save to
+class DiscardStorage : public IStorage {
+public:
+    bool save(const std::string&, const DataTable&) override { return true; }
+    bool load(const std::string&, DataTable&, bool) override { return false; }
+};
+
+void edit(std::string& content, std::mt19937& gen) {
+    std::size_t pos = content.find('\n', gen() % content.size());
+    pos = pos == std::string::npos ? content.size() : pos + 1;
+    std::size_t end = pos;
+    for (int i = 0; i < 3 && end < content.size(); i++) {
+        std::size_t next = content.find('\n', end);
+        end = next == std::string::npos ? content.size() : next + 1;
+    }
+    content.replace(pos, end - pos, "edited line " + std::to_string(gen()) + "\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t size_mb = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 50;
+    const int edits = argc > 2 ? std::atoi(argv[2]) : 100;
+
+    NullLogger logger;
+    DiscardStorage storage;
+    FileManager fm(&storage, &logger);
+    std::string content = make_text(size_mb * 1024 * 1024);
+    std::mt19937 gen(42);
+
+    Stopwatch clock;
+    unsigned long long id = fm.create_file(content);
+    double create_s = clock.seconds();
+    unsigned long long whole_copies = content.size();
+
+    double update_s = 0;
+    for (int i = 0; i < edits; i++) {
+        edit(content, gen);
+        fm.increase_counter(id);  // the previous version stays referenced
+        unsigned long long new_id;
+        clock.reset();
+        fm.update_content(id, new_id, content);
+        update_s += clock.seconds();
+        id = new_id;
+        whole_copies += content.size();
+    }
+
+    auto stats = fm.chunk_stats();
+    std::printf("file size      %10.1f MB\n", mb(content.size()));
+    std::printf("versions       %10d\n", edits + 1);
+    std::printf("chunks         %10zu (avg %.1f KB)\n", stats.chunk_count,
+                stats.chunk_count ? stats.stored_bytes / 1024.0 / stats.chunk_count : 0.0);
+    std::printf("whole copies   %10.1f MB  amplification %6.2fx\n", mb(whole_copies),
+                static_cast<double>(whole_copies) / content.size());
+    std::printf("chunk store    %10.1f MB  amplification %6.2fx\n", mb(stats.stored_bytes),
+                static_cast<double>(stats.stored_bytes) / content.size());
+    std::printf("create         %10.1f MB/s\n", mb(content.size()) / create_s);
+    std::printf("update         %10.1f ms per edit\n", edits ? update_s * 1000 / edits : 0.0);
+    return 0;
+}
@@ -0,0 +1,50 @@
+/**
+ * @file cipher_bench.cpp
+ * @brief Encrypt/decrypt throughput and payload size of each record cipher
+ *
+ * Usage: ffvms_cipher_bench [record size in MB ...]   (default: 1 16)
+ *
+ * Throughput is reported in MB of plaintext per second. "expansion" is
+ * payload size divided by plaintext size. "fft-1t" is the FFT cipher
+ * without a thread pool, for comparison with the block-parallel default.
+ */
+
+#include "bench_util.h"
+#include "storage/fft_cipher.h"
+#include "storage/record_cipher.h"
+#include <cstdio>
+#include <memory>
+
+using namespace ffvms;
+using namespace ffvms::bench;
+
+int main(int argc, char** argv) {
+    const storage::CipherKey key = storage::derive_key("benchmark");
+    std::printf("%-10s %8s %12s %12s %10s\n", "cipher", "size MB", "enc MB/s", "dec MB/s", "expansion");
+    for (std::size_t size_mb : sizes_from_args(argc, argv, {1, 16})) {
+        const std::string plain = make_text(size_mb * 1024 * 1024);
+        std::vector<std::unique_ptr<storage::IRecordCipher>> ciphers;
+        ciphers.push_back(std::make_unique<storage::FftCipher>(nullptr));
+        for (auto id : {storage::CipherId::FFT, storage::CipherId::FFT_PACKED, storage::CipherId::NTT,
+                        storage::CipherId::IDENTITY, storage::CipherId::CHACHA20}) {
+            ciphers.push_back(storage::make_cipher(id, key));
+        }
+        for (std::size_t c = 0; c < ciphers.size(); c++) {
+            auto& cipher = ciphers[c];
+            const char* name = c == 0 ? "fft-1t" : cipher->name();
+            std::string payload, restored;
+            // Repeat small inputs so each measurement runs for a while
+            const int rounds = size_mb >= 16 ? 1 : static_cast<int>(16 / (size_mb ? size_mb : 1));
+            Stopwatch clock;
+            for (int i = 0; i < rounds; i++) cipher->encrypt(plain, payload);
+            double enc_s = clock.seconds() / rounds;
+            clock.reset();
+            for (int i = 0; i < rounds; i++) cipher->decrypt(payload, restored);
+            double dec_s = clock.seconds() / rounds;
+            std::printf("%-10s %8.1f %12.1f %12.1f %9.2fx%s\n", name, mb(plain.size()),
+                        mb(plain.size()) / enc_s, mb(plain.size()) / dec_s,
+                        static_cast<double>(payload.size()) / plain.size(), restored == plain ? "" : "  (mismatch)");
+        }
+    }
+    return 0;
+}
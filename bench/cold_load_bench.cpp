@@ -0,0 +1,88 @@
+/**
+ * @file cold_load_bench.cpp
+ * @brief Cold-start load of an ObjectStorage repository, with and without io_uring
+ *
+ * Usage: ffvms_cold_load_bench [repository MB] [threads] [queue depth]   (default: 256 hardware 64)
+ *
+ * Writes a repository of 8 KB rows once, then for each I/O backend drops
+ * the repository from the page cache (posix_fadvise) and times opening it
+ * and loading the table. Numbers only mean "cold" on a real disk; on
+ * tmpfs the eviction is a no-op. Without io_uring support the second row
+ * falls back to threads.
+ */
+
+#include "bench_util.h"
+#include "storage/async_io.h"
+#include "storage/object_storage.h"
+#include <cstdio>
+#include <filesystem>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace ffvms;
+using namespace ffvms::bench;
+using namespace ffvms::storage;
+
+namespace {
+
+void evict(const std::string& dir) {
+#ifdef __linux__
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(dir)) {
+        if (!entry.is_regular_file()) continue;
+        int fd = ::open(entry.path().c_str(), O_RDONLY);
+        if (fd < 0) continue;
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        ::close(fd);
+    }
+#else
+    (void)dir;
+#endif
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t repo_mb = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 256;
+    const std::size_t threads = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 0;
+    const unsigned depth = argc > 3 ? static_cast<unsigned>(std::strtoul(argv[3], nullptr, 10)) : 64;
+    const std::string dir = temp_path("ffvms_cold_load_bench");
+    std::filesystem::remove_all(dir);
+
+    NullLogger logger;
+    ThreadPool pool(threads);
+    ObjectStorageOptions options;
+    options.pool = &pool;
+    DataTable table = make_table(repo_mb * 1024 * 1024, 8 * 1024);
+    {
+        ObjectStorage storage(&logger, dir, options);
+        storage.save("FileManager::chunks", table);
+    }
+
+    std::printf("repository %zu MB, %zu pool threads, queue depth %u, io_uring %s\n\n", repo_mb, pool.size(), depth,
+                io_uring_available() ? "available" : "unavailable");
+    std::printf("%-10s %10s %10s %10s\n", "backend", "best s", "MB/s", "runs");
+    const int runs = 3;
+    for (IoBackend backend : {IoBackend::THREADS, IoBackend::IO_URING}) {
+        options.io = backend;
+        double best = 1e30;
+        const char* name = "";
+        for (int run = 0; run < runs; run++) {
+            evict(dir);
+            Stopwatch clock;
+            ObjectStorage storage(&logger, dir, options);
+            DataTable loaded;
+            if (!storage.load("FileManager::chunks", loaded) || loaded.size() != table.size()) {
+                std::printf("load failed\n");
+                return 1;
+            }
+            best = std::min(best, clock.seconds());
+            name = storage.io_backend();
+        }
+        std::printf("%-10s %10.3f %10.1f %10d\n", name, best, repo_mb / best, runs);
+    }
+    std::filesystem::remove_all(dir);
+    return 0;
+}
@@ -0,0 +1,112 @@
+/**
+ * @file compression_bench.cpp
+ * @brief Effect of the record codec on Saver file size and save/load time
+ *
+ * Usage: ffvms_compression_bench [file or directory ...]
+ *
+ * Each argument becomes one corpus (a directory contributes every regular
+ * file under it). Without arguments the repository's own sources and a
+ * generated source-like text are used. For every codec the table shows the
+ * codec alone, then a full Saver save (compression plus FFT encryption)
+ * and load of the corpus stored as a single file version. The FFT cipher
+ * is used because its cost grows fastest with the payload.
+ */
+
+#include "bench_util.h"
+#include "saver.h"
+#include "storage/codec.h"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+using namespace ffvms;
+using namespace ffvms::bench;
+
+namespace {
+
+struct Corpus {
+    std::string name;
+    std::string text;
+};
+
+void append_file(const std::filesystem::path& file, std::string& out) {
+    std::ifstream in(file, std::ios::binary);
+    out.append(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+Corpus load_corpus(const std::string& path) {
+    Corpus corpus{path, ""};
+    if (std::filesystem::is_directory(path)) {
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(path)) {
+            if (entry.is_regular_file()) append_file(entry.path(), corpus.text);
+        }
+    } else {
+        append_file(path, corpus.text);
+    }
+    return corpus;
+}
+
+void run(const Corpus& corpus, storage::CodecId codec_id) {
+    const storage::ICodec& codec = *storage::find_codec(codec_id);
+    NullLogger logger;
+    Stopwatch clock;
+
+    std::string compressed, restored;
+    codec.compress(corpus.text, compressed);
+    double compress_s = clock.seconds();
+    clock.reset();
+    codec.decompress(compressed, restored);
+    double decompress_s = clock.seconds();
+
+    SaverOptions options;
+    options.mode = SaverOptions::Mode::SNAPSHOT;
+    options.durability = storage::Durability::NONE;
+    options.codec = codec_id;
+    options.cipher = storage::CipherId::FFT_PACKED;  // The transform whose work compression saves most
+    const std::string path = temp_path("ffvms_bench_codec.chm");
+    std::remove(path.c_str());
+    DataTable table = {{"1", corpus.text, "1"}};
+    clock.reset();
+    auto* saver = new Saver(&logger, path, options);
+    saver->save("FileManager::map_relation", table);
+    delete saver;
+    double save_s = clock.seconds();
+    std::size_t file_size = std::filesystem::file_size(path);
+
+    clock.reset();
+    saver = new Saver(&logger, path, options);
+    DataTable loaded;
+    bool ok = saver->load("FileManager::map_relation", loaded) && loaded == table;
+    double load_s = clock.seconds();
+    delete saver;
+    std::remove(path.c_str());
+
+    std::printf("%-5s %8.2f %7.2fx %9.0f %9.0f %10.2f %9.1f %9.1f %s\n", codec.name(), mb(corpus.text.size()),
+                static_cast<double>(corpus.text.size()) / compressed.size(), mb(corpus.text.size()) / compress_s,
+                mb(corpus.text.size()) / decompress_s, mb(file_size), save_s * 1000, load_s * 1000,
+                ok ? "" : "(load failed)");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::vector<Corpus> corpora;
+    for (int i = 1; i < argc; i++) corpora.push_back(load_corpus(argv[i]));
+    if (corpora.empty()) {
+        Corpus sources{"repository sources", ""};
+        for (const char* dir : {"lib", "tests", "docs"}) {
+            sources.text += load_corpus(std::string(FFVMS_SOURCE_DIR) + "/" + dir).text;
+        }
+        corpora.push_back(sources);
+        corpora.push_back(Corpus{"generated text", make_text(8 * 1024 * 1024)});
+    }
+
+    for (const auto& corpus : corpora) {
+        std::printf("\n%s\n", corpus.name.c_str());
+        std::printf("%-5s %8s %8s %9s %9s %10s %9s %9s\n", "codec", "size MB", "ratio", "comp MB/s",
+                    "dec MB/s", "file MB", "save ms", "load ms");
+        run(corpus, storage::CodecId::NONE);
+        run(corpus, storage::CodecId::LZ4);
+    }
+    return 0;
+}
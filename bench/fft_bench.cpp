@@ -0,0 +1,49 @@
+/**
+ * @file fft_bench.cpp
+ * @brief Recursive versus iterative FFT kernel
+ *
+ * Usage: ffvms_fft_bench [transform size ...]   (default: 64 1024 4096)
+ *
+ * Reports transforms per second for the original recursive kernel and for
+ * FftPlan, plus the largest difference between their outputs.
+ */
+
+#include "bench_util.h"
+#include "core/fft.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+using namespace ffvms;
+using namespace ffvms::bench;
+
+int main(int argc, char** argv) {
+    std::printf("kernel: %s\n", FftPlan::kernel_name());
+    std::printf("%8s %14s %14s %8s %12s\n", "size", "recursive/s", "iterative/s", "speedup", "max diff");
+    for (std::size_t n : sizes_from_args(argc, argv, {64, 1024, 4096})) {
+        std::vector<double> input(2 * n, 0.0), ref(2 * n), out(2 * n), scratch(2 * n);
+        for (std::size_t i = 0; i < n; i++) input[2 * i] = static_cast<double>((i * 131) % 256);
+        const FftPlan& plan = FftPlan::get(n);
+        // Enough rounds for about 64M butterflies per kernel
+        const std::size_t rounds = std::max<std::size_t>(1, (std::size_t(64) << 20) / (n * 8));
+
+        Stopwatch clock;
+        for (std::size_t r = 0; r < rounds; r++) {
+            ref = input;
+            fft_recursive(ref.data(), scratch.data(), n, 1);
+        }
+        double recursive_s = clock.seconds();
+        clock.reset();
+        for (std::size_t r = 0; r < rounds; r++) {
+            out = input;
+            plan.transform(out.data(), 1);
+        }
+        double iterative_s = clock.seconds();
+
+        double diff = 0;
+        for (std::size_t i = 0; i < 2 * n; i++) diff = std::max(diff, std::abs(ref[i] - out[i]));
+        std::printf("%8zu %14.0f %14.0f %7.2fx %12.3g\n", n, rounds / recursive_s, rounds / iterative_s,
+                    recursive_s / iterative_s, diff);
+    }
+    return 0;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file object_bench.cpp
+ * @brief ObjectStorage save, incremental save and load throughput
+ *
+ * Usage: ffvms_object_bench [repository MB] [threads] [sync 0/1]   (default: 256 hardware 1)
+ *
+ * Saves a chunk-table-shaped repository of 8 KB rows, edits and inserts a
+ * few rows per save, then reloads it. An incremental save should write a
+ * handful of objects whatever the repository size.
+ */
+
+#include "bench_util.h"
+#include "core/thread_pool.h"
+#include "storage/object_storage.h"
+#include <cstdio>
+#include <filesystem>
+
+using namespace ffvms;
+using namespace ffvms::bench;
+using namespace ffvms::storage;
+
+int main(int argc, char** argv) {
+    const std::size_t repo_mb = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 256;
+    const std::size_t threads = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 0;
+    const bool sync = argc > 3 ? std::atoi(argv[3]) != 0 : true;
+    const std::string dir = temp_path("ffvms_object_bench");
+    std::filesystem::remove_all(dir);
+
+    NullLogger logger;
+    ThreadPool pool(threads);
+    ObjectStorageOptions options;
+    options.pool = &pool;
+    options.sync = sync;
+    DataTable table = make_table(repo_mb * 1024 * 1024, 8 * 1024);
+
+    std::printf("repository %zu MB in %zu rows, %zu writer threads, sync %s\n\n", repo_mb, table.size(),
+                pool.size(), sync ? "on" : "off");
+    std::printf("%-10s %10s %10s %10s %12s\n", "phase", "seconds", "MB/s", "objects", "MB written");
+    ObjectStorage storage(&logger, dir, options);
+    Stopwatch clock;
+    storage.save("FileManager::chunks", table);
+    auto stats = storage.stats();
+    std::printf("%-10s %10.2f %10.1f %10llu %12.1f\n", "save", clock.seconds(), repo_mb / clock.seconds(),
+                stats.objects_written, mb(stats.bytes_written));
+
+    const int edits = 20;
+    auto before = storage.stats();
+    clock.reset();
+    for (int i = 0; i < edits; i++) {
+        table[(i * 7919) % table.size()][1] = "edited " + std::to_string(i);
+        if (i % 4 == 0) table.insert(table.begin() + (i * 104729) % table.size(), {"inserted", std::to_string(i)});
+        storage.save("FileManager::chunks", table);
+    }
+    stats = storage.stats();
+    std::printf("%-10s %10.3f %10s %10.1f %12.2f   per save\n", "edit", clock.seconds() / edits, "-",
+                static_cast<double>(stats.objects_written - before.objects_written) / edits,
+                mb(stats.bytes_written - before.bytes_written) / edits);
+
+    ObjectStorage reopened(&logger, dir, options);
+    DataTable loaded;
+    clock.reset();
+    reopened.load("FileManager::chunks", loaded);
+    std::printf("%-10s %10.2f %10.1f\n", "load", clock.seconds(), repo_mb / clock.seconds());
+
+    std::printf("\nremoved %zu unreferenced objects\n", reopened.remove_unreferenced());
+    std::filesystem::remove_all(dir);
+    return loaded == table ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+/**
+ * @file record_stream_bench.cpp
+ * @brief Loading a FileManager-sized table as a DataTable versus streaming it
+ *
+ * Usage: ffvms_record_bench [sizes in MB...]   (default: 10 100)
+ *
+ * Saves a relation-shaped table (key, count and two hex chunk ids per row)
+ * of each size, then times loading it back both ways and counts the heap
+ * allocations each load makes. Records are stored unencrypted and
+ * uncompressed so the numbers are the parsing alone. The last row decodes
+ * the same rows from the binary encoding a storage::Schema generates.
+ */
+
+#include "bench_util.h"
+#include "saver.h"
+#include "storage/record_schema.h"
+#include <atomic>
+#include <cstdio>
+#include <new>
+
+using namespace ffvms;
+using namespace ffvms::bench;
+
+namespace {
+
+std::atomic<unsigned long long> allocations{0};
+
+const std::string TABLE = "FileManager::map_relation";
+const std::size_t ROW_BYTES = 2 * 20 + 2 * 64;
+
+struct RelationRow {
+    std::uint64_t key = 0;
+    std::uint64_t cnt = 0;
+    std::string_view first;
+    std::string_view second;
+};
+
+constexpr auto RELATION_SCHEMA = storage::make_schema(
+    storage::field("key", &RelationRow::key), storage::field("cnt", &RelationRow::cnt),
+    storage::field("first", &RelationRow::first), storage::field("second", &RelationRow::second));
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+int main(int argc, char** argv) {
+    const std::vector<std::size_t> sizes = sizes_from_args(argc, argv, {10, 100});
+    const std::string path = temp_path("ffvms_record_bench.chm");
+    const std::string id(64, 'a');
+
+    std::printf("%8s %10s %-14s %10s %10s %14s\n", "MB", "rows", "load", "seconds", "MB/s", "allocations");
+    for (std::size_t size_mb : sizes) {
+        std::remove(path.c_str());
+        std::remove((path + ".wal").c_str());
+        NullLogger logger;
+        SaverOptions options;
+        options.codec = storage::CodecId::NONE;
+        options.cipher = storage::CipherId::IDENTITY;
+        Saver saver(&logger, path, options);
+
+        const std::size_t rows = size_mb * 1024 * 1024 / ROW_BYTES;
+        saver.save_records(TABLE, [&](IRecordWriter& out) {
+            out.begin_table(rows);
+            for (std::size_t i = 0; i < rows; i++) {
+                out.begin_row(4);
+                out.u64(i * 2654435761ULL);
+                out.u64(2);
+                out.str(id);
+                out.str(id);
+            }
+        });
+
+        Stopwatch watch;
+        unsigned long long before = allocations.load();
+        {
+            DataTable table;
+            saver.load(TABLE, table);
+        }
+        double seconds = watch.seconds();
+        std::printf("%8zu %10zu %-14s %10.3f %10.1f %14llu\n", size_mb, rows, "DataTable", seconds,
+                    static_cast<double>(size_mb) / seconds, allocations.load() - before);
+
+        watch.reset();
+        before = allocations.load();
+        std::uint64_t checksum = 0;
+        saver.load_records(TABLE, [&](IRecordReader& in) {
+            std::size_t fields = 0;
+            std::uint64_t key = 0;
+            std::uint64_t count = 0;
+            std::string_view chunk;
+            while (in.next_row(fields)) {
+                if (!in.u64(key) || !in.u64(count)) return false;
+                checksum += key + count;
+                for (std::uint64_t j = 0; j < count; j++) {
+                    if (!in.str(chunk)) return false;
+                    checksum += chunk.size();
+                }
+            }
+            return in.ok();
+        });
+        seconds = watch.seconds();
+        std::printf("%8zu %10zu %-14s %10.3f %10.1f %14llu\n", size_mb, rows, "records", seconds,
+                    static_cast<double>(size_mb) / seconds, allocations.load() - before);
+
+        std::string binary;
+        binary.reserve(rows * ROW_BYTES);
+        for (std::size_t i = 0; i < rows; i++) RELATION_SCHEMA.write_binary(binary, {i * 2654435761ULL, 2, id, id});
+        watch.reset();
+        before = allocations.load();
+        storage::ByteReader in(binary.data(), binary.size());
+        RelationRow row;
+        for (std::size_t i = 0; i < rows && RELATION_SCHEMA.read_binary(in, row); i++) {
+            checksum += row.key + row.cnt + row.first.size() + row.second.size();
+        }
+        seconds = watch.seconds();
+        std::printf("%8zu %10zu %-14s %10.3f %10.1f %14llu\n", size_mb, rows, "schema binary", seconds,
+                    mb(binary.size()) / seconds, allocations.load() - before);
+        if (checksum == 0) std::printf("empty table\n");
+    }
+    std::remove(path.c_str());
+    std::remove((path + ".wal").c_str());
+    return 0;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file saver_format_bench.cpp
+ * @brief Load/save throughput and file size of data.chm: legacy text vs binary
+ *
+ * Usage: ffvms_format_bench [content size in MB ...]   (default: 10 100 1024)
+ *
+ * "save" is the time to write the data file once records are encrypted,
+ * "load" is the time for a Saver to open the file and decode one table.
+ * Throughput is reported in MB of table content per second.
+ */
+
+#include "bench_util.h"
+#include "encryptor.h"
+#include "saver.h"
+#include "storage/data_file_format.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+using namespace ffvms;
+using namespace ffvms::bench;
+
+namespace {
+
+const std::string TABLE_NAME = "FileManager::map_relation";
+
+/// Reproduces the record encoding and text writer Saver used before the binary format
+class LegacyTextFormat : protected Encryptor {
+private:
+    unsigned long long name_hash_ = 0, data_hash_ = 0;
+    std::vector<std::pair<double, double>> data_;
+
+    static unsigned long long hash(const std::string& s) {
+        return storage::polynomial_hash(s);
+    }
+
+public:
+    void encode(const std::string& name, const DataTable& content) {
+        std::string data = std::to_string(content.size());
+        for (const auto& row : content) {
+            data += " " + std::to_string(row.size());
+            for (const auto& dt : row) data += " " + std::to_string(dt.size()) + " " + dt;
+        }
+        std::vector<int> sequence(data.begin(), data.end());
+        encrypt_sequence(sequence, data_);
+        name_hash_ = hash(name);
+        data_hash_ = hash(data);
+    }
+
+    void write(const std::string& path) {
+        std::ofstream out(path);
+        out << name_hash_ << ' ' << data_hash_ << ' ' << data_.size() / N;
+        for (auto& pr : data_) out << ' ' << pr.first << ' ' << pr.second;
+        out << '\n';
+    }
+};
+
+void report(const char* format, std::size_t content, double save_s, double load_s, std::size_t file_size) {
+    std::printf("%-8s %10.1f %12.1f %12.1f %14.1f\n", format, mb(content), mb(content) / save_s,
+                mb(content) / load_s, mb(file_size));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    NullLogger logger;
+    std::printf("%-8s %10s %12s %12s %14s\n", "format", "content MB", "save MB/s", "load MB/s", "file size MB");
+    for (std::size_t size_mb : sizes_from_args(argc, argv, {10, 100, 1024})) {
+        const std::size_t bytes = size_mb * 1024 * 1024;
+        DataTable table = make_table(bytes);
+        const std::string text_path = temp_path("ffvms_bench_text.chm");
+        const std::string binary_path = temp_path("ffvms_bench_binary.chm");
+        Stopwatch clock;
+
+        {
+            LegacyTextFormat legacy;
+            legacy.encode(TABLE_NAME, table);
+            clock.reset();
+            legacy.write(text_path);
+            double save_s = clock.seconds();
+            std::size_t file_size = std::filesystem::file_size(text_path);
+            clock.reset();
+            auto* saver = new Saver(&logger, text_path);
+            DataTable loaded;
+            if (!saver->load(TABLE_NAME, loaded)) std::cerr << "text load failed: 6-digit doubles lost too much precision\n";
+            double load_s = clock.seconds();
+            delete saver;
+            report("text", bytes, save_s, load_s, file_size);
+        }
+
+        {
+            // Snapshot mode so the whole file is written in one timed pass
+            SaverOptions options;
+            options.mode = SaverOptions::Mode::SNAPSHOT;
+            std::remove(binary_path.c_str());
+            auto* saver = new Saver(&logger, binary_path, options);
+            saver->save(TABLE_NAME, table);
+            clock.reset();
+            delete saver;
+            double save_s = clock.seconds();
+            clock.reset();
+            saver = new Saver(&logger, binary_path, options);
+            DataTable loaded;
+            if (!saver->load(TABLE_NAME, loaded)) std::cerr << "binary load failed\n";
+            double load_s = clock.seconds();
+            report("binary", bytes, save_s, load_s, std::filesystem::file_size(binary_path));
+            delete saver;
+        }
+
+        std::remove(text_path.c_str());
+        std::remove(binary_path.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,125 @@
+/**
+ * @file saver_rss_bench.cpp
+ * @brief Resident memory of a session that loads and re-saves a whole repository
+ *
+ * Usage: ffvms_rss_bench [repository MB] [cipher]   (default: 1024 chacha20)
+ *
+ * Writes a repository of tables of up to 64 MB, then runs one child process per
+ * Saver mode. Each child loads every table and keeps it, as the managers
+ * do, then saves each table again with one row changed. Resident memory
+ * is read from /proc/self/status, so it is only reported on Linux;
+ * "trimmed" is after returning the heap that malloc kept from the saves.
+ */
+
+#include "bench_util.h"
+#include "saver.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+using namespace ffvms;
+using namespace ffvms::bench;
+
+namespace {
+
+constexpr std::size_t TABLE_MB = 64;
+
+/// @brief A field of /proc/self/status in MB, or -1 where there is none
+double status_mb(const char* field) {
+    std::ifstream in("/proc/self/status");
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, std::strlen(field), field) == 0) {
+            return std::strtod(line.c_str() + std::strlen(field) + 1, nullptr) / 1024.0;
+        }
+    }
+    return -1;
+}
+
+bool find_cipher(const std::string& name, storage::CipherId& id) {
+    for (unsigned int i = 0; i <= static_cast<unsigned int>(storage::CipherId::NTT); i++) {
+        auto cipher = storage::make_cipher(static_cast<storage::CipherId>(i), storage::CipherKey{});
+        if (cipher && name == cipher->name()) {
+            id = cipher->id();
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string table_name(std::size_t i) {
+    return "table" + std::to_string(i);
+}
+
+int run_session(const std::string& path, std::size_t tables, const SaverOptions& options, const char* mode) {
+    NullLogger logger;
+    Saver saver(&logger, path, options);
+    std::vector<DataTable> loaded(tables);
+    std::size_t decoded = 0;
+    for (std::size_t i = 0; i < tables; i++) {
+        if (!saver.load(table_name(i), loaded[i])) {
+            std::fprintf(stderr, "load of %s failed\n", table_name(i).c_str());
+            return 1;
+        }
+        for (auto& row : loaded[i]) {
+            for (auto& field : row) decoded += field.size();
+        }
+    }
+    const double after_load = status_mb("VmRSS:");
+    for (std::size_t i = 0; i < tables; i++) {
+        loaded[i][0][2] = mode;   // Differs per session, so every save is written
+        saver.save(table_name(i), loaded[i]);
+    }
+    const double after_save = status_mb("VmRSS:");
+#ifdef __GLIBC__
+    // Heap the saves freed but malloc kept; shows what is still live
+    malloc_trim(0);
+#endif
+    std::printf("%-8s %12.1f %12.1f %12.1f %12.1f %12.1f %12.1f\n", mode, mb(decoded), after_load, after_save,
+                status_mb("VmRSS:"), status_mb("VmHWM:"), mb(saver.resident_bytes()));
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t repository_mb = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1024;
+    SaverOptions options;
+    if (argc > 2 && !find_cipher(argv[2], options.cipher)) {
+        std::fprintf(stderr, "unknown cipher %s\n", argv[2]);
+        return 2;
+    }
+    const std::size_t table_mb = repository_mb < TABLE_MB ? repository_mb : TABLE_MB;
+    const std::size_t tables = (repository_mb + table_mb - 1) / table_mb;
+    const std::string path = temp_path("ffvms_bench_rss.chm");
+
+    // Child: argv = repository MB, cipher, mode
+    if (argc > 3) {
+        options.drop_payloads = std::string(argv[3]) == "drop";
+        return run_session(path, tables, options, argv[3]);
+    }
+
+    std::remove(path.c_str());
+    {
+        NullLogger logger;
+        Saver saver(&logger, path, options);
+        for (std::size_t i = 0; i < tables; i++) saver.save(table_name(i), make_table(table_mb << 20));
+    }
+    std::printf("repository: %zu tables of %zu MB, %.1f MB on disk\n", tables, table_mb,
+                mb(std::filesystem::file_size(path)));
+    std::printf("%-8s %12s %12s %12s %12s %12s %12s\n", "mode", "decoded MB", "RSS load", "RSS save",
+                "RSS trimmed", "peak RSS", "payloads MB");
+    const std::string cipher = argc > 2 ? argv[2] : "chacha20";
+    for (const char* mode : {"keep", "drop"}) {
+        const std::string command = std::string("\"") + argv[0] + "\" " + std::to_string(repository_mb) + " " +
+                                    cipher + " " + mode;
+        std::fflush(stdout);
+        if (std::system(command.c_str()) != 0) std::fprintf(stderr, "%s session failed\n", mode);
+    }
+    std::remove(path.c_str());
+    return 0;
+}
@@ -0,0 +1,138 @@
+/**
+ * @file tree_bench.cpp
+ * @brief Saving and loading the version tree node table
+ *
+ * Usage: ffvms_tree_bench [node counts in millions...]   (default: 1 10)
+ *
+ * Builds a directory tree with 16 entries per directory as an old
+ * row-per-node table, then times VersionManager loading it, saving it in
+ * the columnar encoding, and loading that back. Tables live in memory in
+ * Saver's text serialization, so the numbers leave out encryption and
+ * disk I/O.
+ */
+
+#include "bench_util.h"
+#include "storage/table_text.h"
+#include "version_manager.h"
+#include <map>
+#include <random>
+
+using namespace ffvms;
+using namespace ffvms::bench;
+
+namespace {
+
+const std::string TREE = "VersionManager::DATA_TREENODE_INFO";
+const std::string VERSIONS = "VersionManager::DATA_VERSION_INFO";
+constexpr unsigned long long NULL_NODE = 0x3f3f3f3f3f3fULL;
+constexpr std::size_t FANOUT = 16;
+
+// Holds each table as the bytes Saver would encrypt
+class TextStorage : public IStorage {
+public:
+    std::map<std::string, std::string> tables;
+
+    bool save(const std::string& name, const DataTable& content) override {
+        return save_records(name, [&](IRecordWriter& out) {
+            out.begin_table(content.size());
+            for (auto& row : content) {
+                out.begin_row(row.size());
+                for (auto& field : row) out.str(field);
+            }
+        });
+    }
+
+    bool save_records(const std::string& name, const RecordSource& source) override {
+        std::string& text = tables[name];
+        text.clear();
+        storage::TextTableWriter writer(text);
+        source(writer);
+        return true;
+    }
+
+    bool load(const std::string& name, DataTable& content, bool) override {
+        return load_records(name, [&](IRecordReader& in) {
+            DataTableWriter out(content);
+            std::size_t fields;
+            std::string_view field;
+            out.begin_table(in.rows());
+            while (in.next_row(fields)) {
+                out.begin_row(fields);
+                for (std::size_t i = 0; i < fields; i++) {
+                    if (!in.str(field)) return false;
+                    out.str(field);
+                }
+            }
+            return in.ok();
+        });
+    }
+
+    bool load_records(const std::string& name, const RecordSink& sink, bool = false) override {
+        auto it = tables.find(name);
+        if (it == tables.end()) return false;
+        storage::TextTableReader reader(it->second);
+        return sink(reader);
+    }
+};
+
+// Node i's entries are nodes i * FANOUT + 1 ... i * FANOUT + FANOUT; node 0 is the version head
+void write_row_tree(TextStorage& storage, std::size_t nodes) {
+    std::mt19937_64 gen(1);
+    storage.save_records(TREE, [&](IRecordWriter& out) {
+        out.begin_table(nodes);
+        for (std::size_t i = 0; i < nodes; i++) {
+            std::size_t son = i * FANOUT + 1;
+            bool last = i == 0 || i % FANOUT == 0 || i + 1 >= nodes;
+            out.begin_row(6);
+            out.u64(i);
+            out.u64(i == 0 ? 2 : (son < nodes ? 1 : 0));
+            out.u64(1);
+            out.u64(gen());
+            out.u64(last ? NULL_NODE : i + 1);
+            out.u64(son < nodes ? son : NULL_NODE);
+        }
+    });
+    storage.save_records(VERSIONS, [](IRecordWriter& out) {
+        out.begin_table(1);
+        out.begin_row(3);
+        out.u64(1);
+        out.str("bench");
+        out.u64(0);
+    });
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::printf("%10s %-14s %10s %10s %10s\n", "nodes", "phase", "table MB", "seconds", "MB/s");
+    for (std::size_t millions : sizes_from_args(argc, argv, {1, 10})) {
+        const std::size_t nodes = millions * 1000000;
+        NullLogger logger;
+        TextStorage storage;
+        write_row_tree(storage, nodes);
+        const double rows_mb = mb(storage.tables[TREE].size());
+        auto report = [&](const char* phase, double table_mb, double seconds) {
+            std::printf("%10zu %-14s %10.1f %10.3f %10.1f\n", nodes, phase, table_mb, seconds, table_mb / seconds);
+        };
+
+        // Nodes are owned by the trees and never freed by VersionManager; the bench leaves them be
+        Stopwatch watch;
+        auto vm = std::make_unique<VersionManager>(&logger, nullptr, &storage);
+        report("rows load", rows_mb, watch.seconds());
+
+        vm->mark_tree_dirty();
+        watch.reset();
+        vm.reset();
+        const double columns_mb = mb(storage.tables[TREE].size());
+        report("columns save", columns_mb, watch.seconds());
+
+        watch.reset();
+        vm = std::make_unique<VersionManager>(&logger, nullptr, &storage);
+        report("columns load", columns_mb, watch.seconds());
+        treeNode* head = nullptr;
+        if (!vm->get_version_pointer(1, head)) std::printf("load failed\n");
+        storage.tables.clear();
+        vm.reset();
+    }
+    return 0;
+}
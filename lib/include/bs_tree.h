@@ -14,6 +14,7 @@
 #include "interfaces/i_node_manager.h"
 #include "interfaces/i_logger.h"
 #include "core/types.h"
+#include <cstdint>
 #include <vector>
 #include <string>
 
@@ -33,9 +34,14 @@ struct treeNode {
     unsigned long long link;  ///< Link to NodeManager for metadata
     treeNode* next_brother;
     treeNode* first_son;
+    /// 1 + the node's label in the saved node table, 0 until VersionManager::capture() gives it one
+    std::uint32_t save_label = 0;
 
     treeNode();
     explicit treeNode(TYPE type);
+    /// A copy is another node: it gets no label, and assigning keeps the target's
+    treeNode(const treeNode& other);
+    treeNode& operator=(const treeNode& other);
 };
 
 // Forward declarations
@@ -0,0 +1,103 @@
+/**
+ * @file checkpointer.h
+ * @brief Background checkpoints of the in-memory state
+ */
+
+#ifndef CHECKPOINTER_H
+#define CHECKPOINTER_H
+
+#include "interfaces/i_checkpointable.h"
+#include "interfaces/i_logger.h"
+#include "interfaces/i_storage.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ffvms {
+
+/**
+ * @brief When background checkpoints run
+ *
+ * A checkpoint starts once @c interval has passed since the last one and
+ * something changed, or as soon as @c bytes_threshold bytes have changed.
+ */
+struct CheckpointOptions {
+    std::chrono::milliseconds interval{30000};
+    unsigned long long bytes_threshold = 1ULL << 20;
+};
+
+/// @brief Timing of the checkpoints taken so far
+struct CheckpointStats {
+    unsigned long long checkpoints = 0;
+    unsigned long long failures = 0;
+    unsigned long long last_bytes = 0;          ///< changed_bytes() captured by the last checkpoint
+    std::chrono::microseconds last_capture{0};  ///< Time the state lock was held for the last capture
+    std::chrono::microseconds last_write{0};    ///< Time spent writing the last checkpoint
+    std::chrono::microseconds total_write{0};
+};
+
+/**
+ * @brief Writes the changed tables of its sources from a background thread
+ *
+ * The owner of the sources takes lock_state() around every change. A
+ * checkpoint holds that lock only while the sources capture their changed
+ * tables; building and saving them happens afterwards, so the owner is
+ * never blocked on compression, encryption or disk I/O. Sources are
+ * written in the order they were added, one checkpoint at a time.
+ */
+class Checkpointer {
+private:
+    IStorage* storage_;
+    ILogger* logger_;
+    CheckpointOptions options_;
+    std::vector<ICheckpointable*> sources_;
+
+    std::mutex state_mutex_;     ///< Excludes the sources' owner during capture
+    std::mutex write_mutex_;     ///< Keeps checkpoints in capture order
+    std::mutex mutex_;           ///< Guards the fields below
+    std::condition_variable wake_;
+    std::thread thread_;
+    bool stopping_ = false;
+    bool poked_ = false;
+    CheckpointStats stats_;
+    std::chrono::steady_clock::time_point last_checkpoint_;
+
+    void run();
+    bool checkpoint(bool force);
+
+public:
+    Checkpointer(IStorage* storage, ILogger* logger, const CheckpointOptions& options = CheckpointOptions());
+    ~Checkpointer();
+
+    Checkpointer(const Checkpointer&) = delete;
+    Checkpointer& operator=(const Checkpointer&) = delete;
+
+    /// @brief Add a source; must be called before start()
+    void add_source(ICheckpointable* source);
+
+    /// @brief Lock to hold while changing the state of any source
+    std::unique_lock<std::mutex> lock_state() { return std::unique_lock<std::mutex>(state_mutex_); }
+
+    /// @brief Start the background thread
+    void start();
+
+    /// @brief Stop the background thread, waiting for a running checkpoint
+    void stop();
+
+    /// @brief Tell the background thread that the state changed, to check the threshold
+    void poke();
+
+    /**
+     * @brief Checkpoint on the calling thread, whatever the interval and threshold
+     * @return false if a table could not be saved
+     */
+    bool checkpoint_now();
+
+    CheckpointStats stats();
+};
+
+}  // namespace ffvms
+
+#endif // CHECKPOINTER_H
@@ -0,0 +1,42 @@
+/**
+ * @file cow.h
+ * @brief Copy-on-write holder for state a checkpoint shares with its writer
+ */
+
+#ifndef FFVMS_CORE_COW_H
+#define FFVMS_CORE_COW_H
+
+#include <memory>
+
+namespace ffvms {
+
+/**
+ * @brief A value handed to other threads in O(1) and copied only if changed meanwhile
+ *
+ * share() returns a read-only pointer to the current value. The next edit()
+ * while such a pointer is alive copies the value first, so the pointer
+ * keeps seeing the value as it was when it was shared; copies of a Cow
+ * share the value the same way. Each Cow is used from one thread at a
+ * time, while shared pointers may be dropped on any thread.
+ */
+template <typename T>
+class Cow {
+private:
+    std::shared_ptr<T> value_ = std::make_shared<T>();
+
+public:
+    const T& get() const { return *value_; }
+
+    /// @brief The value, for changing; copies it first if it is shared
+    T& edit() {
+        // Another thread dropping its pointer can only make the count read too high, costing a needless copy
+        if (value_.use_count() > 1) value_ = std::make_shared<T>(*value_);
+        return *value_;
+    }
+
+    std::shared_ptr<const T> share() const { return value_; }
+};
+
+}  // namespace ffvms
+
+#endif // FFVMS_CORE_COW_H
@@ -0,0 +1,59 @@
+/**
+ * @file fft.h
+ * @brief Iterative radix-2 FFT with precomputed tables
+ */
+
+#ifndef FFVMS_CORE_FFT_H
+#define FFVMS_CORE_FFT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ffvms {
+
+/**
+ * @brief Bit-reversal and twiddle tables for transforms of one size
+ *
+ * Data is n complex values stored as interleaved (real, imaginary)
+ * doubles. A transform with @c sign = 1 evaluates at e^(2*pi*i*k/n),
+ * -1 at the conjugate roots; neither direction scales the result.
+ * Butterflies use AVX2 or SSE2 when available and plain C++ otherwise;
+ * every path performs the same operations, so results do not depend on
+ * the machine.
+ */
+class FftPlan {
+private:
+    std::size_t n_;
+    std::vector<std::uint32_t> bitrev_;
+    /// Twiddles of the stage with half-size h at [2h, 4h), per direction
+    std::vector<double> forward_, inverse_;
+    /// Butterflies for this size; 16 to 1024 points have their own instantiation
+    void (*kernel_)(double* data, std::size_t n, const double* twiddles);
+
+public:
+    /// @param n Transform size, a power of two
+    explicit FftPlan(std::size_t n);
+
+    std::size_t size() const { return n_; }
+
+    /// @brief In-place transform of size() complex values
+    void transform(double* data, int sign) const;
+
+    /// @brief Shared plan for size @p n, built on first use
+    static const FftPlan& get(std::size_t n);
+
+    /// @brief Butterfly implementation picked for this machine: "avx2", "sse2" or "scalar"
+    static const char* kernel_name();
+};
+
+/**
+ * @brief The original recursive kernel, kept as a reference for tests and benchmarks
+ *
+ * @p scratch must hold 2 * @p n doubles.
+ */
+void fft_recursive(double* data, double* scratch, std::size_t n, int sign);
+
+}  // namespace ffvms
+
+#endif // FFVMS_CORE_FFT_H
@@ -0,0 +1,59 @@
+/**
+ * @file ntt.h
+ * @brief Iterative number-theoretic transform over a 30-bit prime
+ */
+
+#ifndef FFVMS_CORE_NTT_H
+#define FFVMS_CORE_NTT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ffvms {
+
+/**
+ * @brief Bit-reversal and twiddle tables for number-theoretic transforms of one size
+ *
+ * The NTT is the FFT with complex roots of unity replaced by roots of unity
+ * modulo MODULUS, so it runs in exact integer arithmetic. Data is size()
+ * residues in [0, MODULUS). transform(data, -1) undoes transform(data, 1)
+ * exactly; the inverse includes the 1/n scaling.
+ *
+ * Multiplications by a twiddle use Shoup's method: each twiddle w is
+ * stored with floor(w * 2^32 / MODULUS), which replaces the division by a
+ * multiply-high. Stages of 8 or more butterflies run eight lanes at a
+ * time with AVX2 when the CPU has it; results are identical either way.
+ */
+class NttPlan {
+public:
+    /// 119 * 2^23 + 1: supports transforms of up to 2^23 points
+    static constexpr std::uint32_t MODULUS = 998244353;
+    /// Primitive root modulo MODULUS
+    static constexpr std::uint32_t ROOT = 3;
+
+private:
+    std::size_t n_;
+    std::vector<std::uint32_t> bitrev_;
+    /// Twiddles of the stage with half-size h at [h, 2h), with their Shoup quotients
+    std::vector<std::uint32_t> forward_, forward_shoup_, inverse_, inverse_shoup_;
+    std::uint32_t n_inv_, n_inv_shoup_;
+    /// Butterflies for this size; 16 to 1024 points have their own instantiation
+    void (*kernel_)(std::uint32_t* data, std::size_t n, const std::uint32_t* w, const std::uint32_t* ws);
+
+public:
+    /// @param n Transform size, a power of two no larger than 2^23
+    explicit NttPlan(std::size_t n);
+
+    std::size_t size() const { return n_; }
+
+    /// @brief In-place transform of size() residues; @p sign 1 forward, -1 inverse
+    void transform(std::uint32_t* data, int sign) const;
+
+    /// @brief Shared plan for size @p n, built on first use
+    static const NttPlan& get(std::size_t n);
+};
+
+}  // namespace ffvms
+
+#endif // FFVMS_CORE_NTT_H
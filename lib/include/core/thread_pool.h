@@ -0,0 +1,73 @@
+/**
+ * @file thread_pool.h
+ * @brief Fixed-size worker pool for CPU-bound parallel loops
+ */
+
+#ifndef FFVMS_CORE_THREAD_POOL_H
+#define FFVMS_CORE_THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ffvms {
+
+/**
+ * @brief Pool of worker threads fed from one task queue
+ *
+ * parallel_for() also runs work on the calling thread, so it finishes
+ * even when every worker is busy, including when it is called from a
+ * task already running on the pool.
+ */
+class ThreadPool {
+private:
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+
+    void worker_loop();
+
+public:
+    /// @param threads Number of workers; 0 means one per hardware thread
+    explicit ThreadPool(std::size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t size() const { return workers_.size(); }
+
+    /// @brief Queue a task to run on a worker
+    void submit(std::function<void()> task);
+
+    /**
+     * @brief Call @p body(begin, end) over [0, @p count) in chunks of @p grain
+     *
+     * Chunks run concurrently and in no particular order; the call returns
+     * once all of them have finished.
+     */
+    void parallel_for(std::size_t count, std::size_t grain,
+                      const std::function<void(std::size_t, std::size_t)>& body);
+
+    /// @brief Process-wide pool sized to the hardware
+    static ThreadPool& shared();
+};
+
+/**
+ * @brief Call @p body(first, last) over @p blocks blocks, on @p pool when there are at least @p min_blocks
+ *
+ * With no pool, or too few blocks to be worth splitting, @p body runs once
+ * on the calling thread.
+ */
+void for_blocks(ThreadPool* pool, std::size_t blocks, std::size_t min_blocks,
+                const std::function<void(std::size_t, std::size_t)>& body);
+
+}  // namespace ffvms
+
+#endif // FFVMS_CORE_THREAD_POOL_H
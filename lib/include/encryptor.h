@@ -11,6 +11,8 @@
 #ifndef ENCRYPTOR_H
 #define ENCRYPTOR_H
 
+#include "core/thread_pool.h"
+#include <cstddef>
 #include <vector>
 #include <utility>
 
@@ -32,23 +34,58 @@ struct Complex {
  * @brief Encryptor class using FFT for encryption/decryption
  * 
  * Converts polynomial coefficient representation to point-value representation
- * using discrete Fourier transform accelerated by FFT.
+ * using discrete Fourier transform accelerated by FFT (see core/fft.h).
+ *
+ * The packed variants put two consecutive symbols into the real and
+ * imaginary part of each point, so a block carries 2N symbols and a
+ * sequence needs half the transforms and half the stored doubles. A
+ * packed sequence that fits in less than one block is transformed as a
+ * single smaller block of a power-of-two size between MIN_N and N, so
+ * small records do not pay for 1024 points. The original variants are
+ * kept to read data written with them.
+ *
+ * Transform scratch space lives in a per-thread Context, so one instance
+ * can be used from several threads. With a thread pool set, the blocks of
+ * a long sequence are transformed in parallel; output order is unchanged.
  */
 class Encryptor {
 public:
     static const int N = 1 << 10;
+    /// Smallest block of the packed variants
+    static const int MIN_N = 1 << 4;
 
 private:
     static const char PLACEHOLDER = '\0';
-    Complex buf[N << 1], block[N];
 
-    void fft(Complex a[], int n, int type);
-    bool encrypt_block(std::vector<std::pair<double, double>>& res);
-    bool decrypt_block(std::vector<int>& res);
+    /// Blocks below which a sequence is not worth splitting across threads
+    static const size_t PARALLEL_MIN_BLOCKS = 8;
+
+    /// Scratch space for one transform
+    struct Context {
+        Complex block[N];
+    };
+
+    ffvms::ThreadPool* pool_ = nullptr;
+
+    static Context& thread_context();
+    static void fft(Complex a[], int n, int type);
+    static void encrypt_block(Context& ctx, std::pair<double, double>* res, int n);
+    static void decrypt_block(Context& ctx, int* res);
+    static void decrypt_block_packed(Context& ctx, int* res, int n);
+
+    /// Points per block for a packed sequence of @p symbols symbols
+    static int packed_block_size(size_t symbols);
 
 protected:
+    /// Transform blocks on @p pool (nullptr: on the calling thread only)
+    void set_thread_pool(ffvms::ThreadPool* pool) { pool_ = pool; }
+
     bool encrypt_sequence(std::vector<int>& sequence, std::vector<std::pair<double, double>>& res);
     bool decrypt_sequence(std::vector<std::pair<double, double>>& sequence, std::vector<int>& res);
+
+    /// Like encrypt_sequence, with two symbols per point; pads to a whole number of blocks
+    bool encrypt_sequence_packed(std::vector<int>& sequence, std::vector<std::pair<double, double>>& res);
+    bool decrypt_sequence_packed(std::vector<std::pair<double, double>>& sequence, std::vector<int>& res);
 };
 
 #endif // ENCRYPTOR_H
@@ -11,11 +11,15 @@
 #ifndef FILE_MANAGER_H
 #define FILE_MANAGER_H
 
+#include "core/cow.h"
+#include "interfaces/i_checkpointable.h"
 #include "interfaces/i_file_manager.h"
 #include "interfaces/i_logger.h"
 #include "interfaces/i_storage.h"
+#include "storage/chunk_store.h"
 #include <string>
 #include <map>
+#include <vector>
 
 // Forward declaration
 class Saver;
@@ -23,13 +27,16 @@ class Logger;
 
 /**
  * @brief File node structure for content storage
+ *
+ * The content itself lives in the FileManager's chunk store; a node only
+ * lists the chunks that make it up.
  */
 struct fileNode {
-    std::string content;
+    std::vector<ffvms::storage::ChunkId> chunks;
     unsigned long long cnt;
 
     fileNode() = default;
-    fileNode(std::string content);
+    fileNode(std::vector<ffvms::storage::ChunkId> chunks);
 };
 
 /**
@@ -37,11 +44,27 @@ struct fileNode {
  * 
  * Implements IFileManager interface for file content management.
  * Ensures files with same content are stored only once via reference counting.
+ *
+ * Contents are split into content-defined chunks keyed by their SHA-256,
+ * so versions of a large file share every chunk an edit did not touch.
+ *
+ * save() only rewrites the tables that changed since they were loaded or
+ * last saved, so a session that only reads files writes nothing. A
+ * checkpoint shares the relation and chunk maps with its writer; a command
+ * changing one while the write runs copies it.
  */
-class FileManager : public ffvms::IFileManager {
+class FileManager : public ffvms::IFileManager, public ffvms::ICheckpointable {
 private:
     std::string DATA_STORAGE_NAME = "FileManager::map_relation";
-    std::map<unsigned long long, fileNode> mp;
+    std::string CHUNK_STORAGE_NAME = "FileManager::chunks";
+    static constexpr unsigned long long ROW_BYTES = 64;    ///< Rough size of one relation row, for changed_bytes()
+    ffvms::Cow<std::map<unsigned long long, fileNode>> mp;
+    ffvms::storage::ChunkStore chunks_;
+
+    // Dirty tracking; both start dirty so a store that failed to load is written out
+    bool relation_dirty_ = true;
+    unsigned long long saved_chunk_generation_ = ~0ULL;
+    unsigned long long changed_bytes_ = 0;
     
     // Dependencies (can be injected or use singletons)
     ffvms::IStorage* storage_ = nullptr;
@@ -56,6 +79,10 @@ private:
     bool check_file(unsigned long long fid);
     bool save();
     bool load();
+    bool load_chunks(ffvms::IRecordReader& in);
+    bool load_relation(ffvms::IRecordReader& in);
+    bool load_legacy(ffvms::IRecordReader& in);
+    bool corrupted();
 
 public:
     /// Default constructor (uses global singletons)
@@ -76,6 +103,17 @@ public:
     bool decrease_counter(unsigned long long fid) override;
     bool update_content(unsigned long long fid, unsigned long long& new_id, 
                         const std::string& content) override;
+
+    /// Size and count of the distinct chunks currently stored
+    ffvms::storage::ChunkStore::Stats chunk_stats() const;
+
+    /// Whether any table differs from its stored copy
+    bool dirty() const;
+
+    // ICheckpointable interface implementation
+    unsigned long long changed_bytes() const override;
+    void capture(std::vector<ffvms::TableWrite>& writes) override;
+    void capture_failed() override;
 };
 
 #endif // FILE_MANAGER_H
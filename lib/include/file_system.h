@@ -89,6 +89,9 @@ public:
               std::vector<std::pair<std::string, std::vector<std::string>>>& res);
     int get_current_version();
     bool navigate_to_path(const std::vector<std::string>& path);
+
+    /// Version tables, for background checkpoints
+    ffvms::ICheckpointable& checkpoint_source() { return version_manager_; }
 };
 
 #endif // FILE_SYSTEM_H
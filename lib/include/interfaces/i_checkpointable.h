@@ -0,0 +1,71 @@
+/**
+ * @file i_checkpointable.h
+ * @brief Interface for state that can be checkpointed in the background
+ *
+ * A checkpoint captures the changed tables of a component on the thread
+ * that owns it and writes them out later from another thread, so the
+ * owner only pauses for the capture.
+ */
+
+#ifndef FFVMS_INTERFACES_I_CHECKPOINTABLE_H
+#define FFVMS_INTERFACES_I_CHECKPOINTABLE_H
+
+#include "interfaces/i_storage.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace ffvms {
+
+/**
+ * @brief One table captured for a checkpoint
+ *
+ * @c write streams the table from data captured with it; it runs on the
+ * writing thread and must not touch the component that captured it.
+ */
+struct TableWrite {
+    std::string name;
+    IStorage::RecordSource write;
+
+    /// @brief Stream the table into @p storage under @c name
+    bool write_to(IStorage& storage) const {
+        return storage.save_records(name, write);
+    }
+};
+
+/**
+ * @brief Component whose tables can be captured for a checkpoint
+ *
+ * All three calls are made with the component's owner excluded, e.g.
+ * while holding the lock that command execution takes.
+ */
+class ICheckpointable {
+public:
+    virtual ~ICheckpointable() = default;
+
+    /**
+     * @brief Estimate of the bytes changed since the last capture
+     * @return 0 if nothing needs saving
+     */
+    virtual unsigned long long changed_bytes() const = 0;
+
+    /**
+     * @brief Append the tables that changed since the last capture
+     * @param writes Receives one entry per table to save
+     *
+     * The component treats the captured tables as saved from here on.
+     */
+    virtual void capture(std::vector<TableWrite>& writes) = 0;
+
+    /**
+     * @brief The tables of the last capture did not all reach storage
+     *
+     * The component marks its tables changed again so the next capture,
+     * or the save on shutdown, writes them.
+     */
+    virtual void capture_failed() = 0;
+};
+
+}  // namespace ffvms
+
+#endif // FFVMS_INTERFACES_I_CHECKPOINTABLE_H
@@ -0,0 +1,166 @@
+/**
+ * @file i_record_stream.h
+ * @brief Typed, streaming access to stored tables
+ *
+ * A table is a sequence of rows, each a sequence of fields. Components
+ * write their state field by field into an IRecordWriter and read it back
+ * from an IRecordReader, so a storage backend can serialize straight from
+ * the component's own structures and hand out views into its buffer
+ * instead of building a DataTable of string copies.
+ */
+
+#ifndef FFVMS_INTERFACES_I_RECORD_STREAM_H
+#define FFVMS_INTERFACES_I_RECORD_STREAM_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ffvms {
+
+// Type alias for 2D string vector (used for structured data storage)
+using DataTable = std::vector<std::vector<std::string>>;
+
+/**
+ * @brief Receives one table
+ *
+ * Call begin_table() once, then for each row begin_row() followed by
+ * exactly as many fields as announced. Numbers are stored as decimal
+ * text, so a u64 field reads back as the same string a DataTable cell
+ * would hold.
+ */
+class IRecordWriter {
+public:
+    virtual ~IRecordWriter() = default;
+
+    virtual void begin_table(std::size_t rows) = 0;
+    virtual void begin_row(std::size_t fields) = 0;
+    virtual void u64(std::uint64_t value) = 0;
+    virtual void str(std::string_view value) = 0;
+
+    /// @brief Arbitrary binary data; stored length-prefixed like str()
+    virtual void bytes(const void* data, std::size_t size) = 0;
+};
+
+/**
+ * @brief Yields one table
+ *
+ * Views returned by str() and bytes() point into the reader's buffer and
+ * stay valid until the load call that supplied the reader returns. Any
+ * failed read (a missing field, a malformed or non-numeric u64) returns
+ * false and leaves ok() false.
+ */
+class IRecordReader {
+public:
+    virtual ~IRecordReader() = default;
+
+    virtual std::size_t rows() const = 0;
+
+    /// @brief Move to the next row; false past the last row
+    virtual bool next_row(std::size_t& fields) = 0;
+
+    virtual bool u64(std::uint64_t& value) = 0;
+    virtual bool str(std::string_view& value) = 0;
+    virtual bool bytes(std::string_view& value) = 0;
+
+    virtual bool ok() const = 0;
+};
+
+/// @brief Parse a decimal field; false on an empty string, a non-digit or overflow
+inline bool parse_u64(std::string_view text, std::uint64_t& value) {
+    if (text.empty()) return false;
+    std::uint64_t v = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9') return false;
+        std::uint64_t digit = static_cast<std::uint64_t>(c - '0');
+        if (v > (UINT64_MAX - digit) / 10) return false;
+        v = v * 10 + digit;
+    }
+    value = v;
+    return true;
+}
+
+/**
+ * @brief IRecordWriter that fills a DataTable
+ *
+ * Lets backends that only implement the DataTable calls accept streamed
+ * tables.
+ */
+class DataTableWriter : public IRecordWriter {
+private:
+    DataTable& table_;
+
+public:
+    explicit DataTableWriter(DataTable& table) : table_(table) {}
+
+    void begin_table(std::size_t rows) override {
+        table_.clear();
+        table_.reserve(rows);
+    }
+    void begin_row(std::size_t fields) override {
+        table_.emplace_back();
+        table_.back().reserve(fields);
+    }
+    void u64(std::uint64_t value) override { table_.back().push_back(std::to_string(value)); }
+    void str(std::string_view value) override { table_.back().emplace_back(value); }
+    void bytes(const void* data, std::size_t size) override {
+        table_.back().emplace_back(static_cast<const char*>(data), size);
+    }
+};
+
+/**
+ * @brief IRecordReader over a DataTable
+ */
+class DataTableReader : public IRecordReader {
+private:
+    const DataTable& table_;
+    std::size_t row_ = 0;
+    std::size_t field_ = 0;
+    bool started_ = false;
+    bool ok_ = true;
+
+    const std::string* next_field() {
+        if (!ok_ || !started_ || row_ >= table_.size() || field_ >= table_[row_].size()) {
+            ok_ = false;
+            return nullptr;
+        }
+        return &table_[row_][field_++];
+    }
+
+public:
+    explicit DataTableReader(const DataTable& table) : table_(table) {}
+
+    std::size_t rows() const override { return table_.size(); }
+
+    bool next_row(std::size_t& fields) override {
+        if (started_) row_++;
+        started_ = true;
+        field_ = 0;
+        if (!ok_ || row_ >= table_.size()) return false;
+        fields = table_[row_].size();
+        return true;
+    }
+
+    bool u64(std::uint64_t& value) override {
+        const std::string* field = next_field();
+        if (field && parse_u64(*field, value)) return true;
+        ok_ = false;
+        return false;
+    }
+
+    bool str(std::string_view& value) override {
+        const std::string* field = next_field();
+        if (!field) return false;
+        value = *field;
+        return true;
+    }
+
+    bool bytes(std::string_view& value) override { return str(value); }
+
+    bool ok() const override { return ok_; }
+};
+
+}  // namespace ffvms
+
+#endif // FFVMS_INTERFACES_I_RECORD_STREAM_H
@@ -9,14 +9,13 @@
 #ifndef FFVMS_INTERFACES_I_STORAGE_H
 #define FFVMS_INTERFACES_I_STORAGE_H
 
+#include "interfaces/i_record_stream.h"
+#include <functional>
 #include <string>
 #include <vector>
 
 namespace ffvms {
 
-// Type alias for 2D string vector (used for structured data storage)
-using DataTable = std::vector<std::vector<std::string>>;
-
 /**
  * @brief Abstract interface for data persistence
  * 
@@ -45,6 +44,37 @@ public:
     virtual bool load(const std::string& name, DataTable& content, 
                       bool mandatory_access = false) = 0;
 
+    /// Writes a whole table into the writer it is given
+    using RecordSource = std::function<void(IRecordWriter&)>;
+
+    /// Consumes a loaded table; returning false rejects it
+    using RecordSink = std::function<bool(IRecordReader&)>;
+
+    /**
+     * @brief Save a table streamed field by field
+     *
+     * The default collects a DataTable and calls save(); backends with a
+     * serialized format override it to write the fields directly.
+     */
+    virtual bool save_records(const std::string& name, const RecordSource& write) {
+        DataTable table;
+        DataTableWriter writer(table);
+        write(writer);
+        return save(name, table);
+    }
+
+    /**
+     * @brief Load a table and stream it to @p read
+     * @return false if the table could not be loaded or @p read rejected it
+     */
+    virtual bool load_records(const std::string& name, const RecordSink& read,
+                              bool mandatory_access = false) {
+        DataTable table;
+        if (!load(name, table, mandatory_access)) return false;
+        DataTableReader reader(table);
+        return read(reader);
+    }
+
     /**
      * @brief Check if a string contains only digits
      * @param s The string to check
@@ -11,6 +11,8 @@
 #ifndef NODE_MANAGER_H
 #define NODE_MANAGER_H
 
+#include "core/cow.h"
+#include "interfaces/i_checkpointable.h"
 #include "interfaces/i_node_manager.h"
 #include "interfaces/i_file_manager.h"
 #include "interfaces/i_storage.h"
@@ -48,11 +50,17 @@ public:
  * @brief NodeManager class for managing file/folder nodes
  * 
  * Implements INodeManager interface for node metadata management.
+ * The node table is only written back when a node was added, removed or
+ * shared since it was loaded. A checkpoint shares the node map with its
+ * writer; a command changing the map while the write runs copies it.
  */
-class NodeManager : public ffvms::INodeManager {
+class NodeManager : public ffvms::INodeManager, public ffvms::ICheckpointable {
 private:
-    std::map<unsigned long long, std::pair<unsigned long long, Node>> mp;
+    ffvms::Cow<std::map<unsigned long long, std::pair<unsigned long long, Node>>> mp;
     std::string DATA_STORAGE_NAME = "NodeManager::map_relation";
+    bool dirty_ = true;     ///< Table differs from the stored copy; cleared by load() and save()
+    unsigned long long changed_bytes_ = 0;
+    static constexpr unsigned long long ROW_BYTES = 96;    ///< Rough size of one node row, for changed_bytes()
     
     // Dependencies
     ffvms::IFileManager* file_manager_ = nullptr;
@@ -94,6 +102,14 @@ public:
     
     // Additional non-interface methods
     unsigned long long _get_counter(unsigned long long idx);
+
+    /// Whether the node table differs from its stored copy
+    bool dirty() const { return dirty_; }
+
+    // ICheckpointable interface implementation
+    unsigned long long changed_bytes() const override { return changed_bytes_; }
+    void capture(std::vector<ffvms::TableWrite>& writes) override;
+    void capture_failed() override { dirty_ = true; }
 };
 
 #endif // NODE_MANAGER_H
@@ -11,54 +11,181 @@
 #ifndef SAVER_H
 #define SAVER_H
 
-#include "encryptor.h"
 #include "interfaces/i_storage.h"
 #include "interfaces/i_logger.h"
+#include "storage/codec.h"
+#include "storage/journal.h"
+#include "storage/mapped_file.h"
+#include "storage/record_cipher.h"
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
 #include <memory>
+#include <istream>
+#include <mutex>
 
 // Type alias for 2D string vector (same as ffvms::DataTable)
 typedef std::vector<std::vector<std::string>> vvs;
 
 /**
  * @brief Data node structure for encrypted storage
+ *
+ * A node is either resident (its encrypted payload lives in @c payload) or
+ * mapped, in which case only the location of the record in the mapped
+ * data file is kept and the payload is read from the mapping on demand.
+ * @c file_size is non-zero whenever the record has a copy in the data file.
  */
 struct dataNode {
     unsigned long long name_hash, data_hash;
-    int len;
-    std::vector<std::pair<double, double>> data;
+    std::string payload;
+    unsigned int codec = 0;             ///< storage::CodecId applied before encryption
+    unsigned int cipher = 0;            ///< storage::CipherId that produced the payload
+    unsigned int checksum = 0;          ///< storage::ChecksumKind of data_hash
+    bool mapped = false;
+    bool damaged = false;               ///< A load found the stored record unreadable
+    unsigned long long file_offset = 0, file_size = 0;
 
     dataNode();
-    dataNode(unsigned long long name_hash, unsigned long long data_hash, 
-             std::vector<std::pair<double, double>>& data, int n);
+    dataNode(unsigned long long name_hash, unsigned long long data_hash, std::string payload,
+             unsigned int codec, unsigned int cipher, unsigned int checksum);
+};
+
+/**
+ * @brief Persistence settings for Saver
+ */
+struct SaverOptions {
+    enum class Mode {
+        SNAPSHOT,    ///< Keep saves in memory and rewrite the whole data file on shutdown
+        APPEND_LOG   ///< Append every save to the data file as it happens
+    };
+
+    Mode mode = Mode::APPEND_LOG;
+
+    /// Share of dead bytes in the log above which a background compaction starts
+    double compaction_threshold = 0.5;
+
+    /// Logs smaller than this are never compacted
+    unsigned long long compaction_min_bytes = 1ULL << 20;
+
+    /// When saves reach stable storage
+    ffvms::storage::Durability durability = ffvms::storage::Durability::BATCHED;
+
+    /// Sync interval used with Durability::BATCHED
+    unsigned int sync_interval_ms = 50;
+
+    /// Compression applied to new records; records that do not shrink are stored as-is
+    ffvms::storage::CodecId codec = ffvms::storage::CodecId::LZ4;
+
+    /// Cipher for new records; existing records are read with the cipher that wrote them
+    ffvms::storage::CipherId cipher = ffvms::storage::CipherId::CHACHA20;
+
+    /// Key material for keyed ciphers (see storage::derive_key)
+    std::string passphrase;
+
+    /**
+     * Hold no encrypted payloads in memory, only where each record is in the
+     * data file: saved records are read back from the file, and the pages of
+     * a record are released once it is decoded. Applies to APPEND_LOG mode,
+     * which writes every save through; a text data file is converted on open.
+     */
+    bool drop_payloads = true;
 };
 
 /**
  * @brief Saver class for persistent data storage with encryption
  * 
  * Implements IStorage interface for data persistence.
- * Uses FFT-based encryption for data security.
+ * Records are encrypted with a storage::IRecordCipher (ChaCha20 by default;
+ * the exact NTT transform or the packed FFT transform can be selected, and
+ * the original FFT layout is still used to read older records) and
+ * written in the binary container format described in
+ * storage/data_file_format.h; files in the legacy text format are still read.
+ *
+ * Binary data files are memory-mapped and only their record index is read
+ * at startup. A record is decoded the first time load() asks for it, and
+ * records that are never touched are copied verbatim on shutdown.
+ *
+ * In APPEND_LOG mode every save() appends the new record version to the
+ * data file immediately, and shutdown only appends a fresh index. Once
+ * superseded versions make up more than the configured share of the file,
+ * a background thread copies the live records into a new file, which is
+ * swapped in by the next call that finds the copy finished.
+ *
+ * Every save goes through a storage::Journal before save() returns: the
+ * data file itself in APPEND_LOG mode, or data.chm.wal in SNAPSHOT mode,
+ * which is replayed on startup and removed after the next full write.
+ * SaverOptions::durability decides whether save() waits for an fsync, and
+ * concurrent saves share one. save() and load() are thread-safe.
+ *
+ * The serialized table is compressed with SaverOptions::codec before it is
+ * encrypted, which shrinks both the file and the FFT work. Each record
+ * keeps its codec id, so files mixing codecs load fine.
+ *
+ * New records carry a CRC-32C per 64 KiB block of the serialized table
+ * (storage::BlockChecksums), so a failed load names the damaged block.
+ * Records from older files keep their polynomial hash and are checked
+ * with it.
+ *
+ * With SaverOptions::drop_payloads (the default) an APPEND_LOG Saver keeps
+ * only the location and hashes of each record, so its memory use does not
+ * grow with the repository; the decoded tables live with their owners.
  */
-class Saver : public ffvms::IStorage, private Encryptor {
+class Saver : public ffvms::IStorage {
 private:
+    struct CompactionJob;
+
     std::string data_file = "data.chm";
+    SaverOptions options_;
     std::map<unsigned long long, dataNode> mp;
+    ffvms::storage::MappedFile mapped_file_;
+    ffvms::storage::CipherKey key_;
+    std::map<unsigned int, std::unique_ptr<ffvms::storage::IRecordCipher>> ciphers_;
+
+    mutable std::mutex mutex_;
+
+    // Append-log state
+    ffvms::storage::Journal journal_;
+    bool binary_file_ = false;          ///< data_file is a binary container that can be appended to
+    bool log_dirty_ = false;            ///< Records were appended since the index was last written
+    unsigned long long log_end_ = 0;    ///< Offset just past the last valid record
+    std::unique_ptr<CompactionJob> compaction_;
     
     // Logger can be injected or use global singleton
     ffvms::ILogger* logger_ = nullptr;
     
-    // Helper to get logger
+    // Helper to get logger reference
     ffvms::ILogger& get_logger_ref();
 
     template <class T>
     unsigned long long get_hash(T& s);
 
+    std::string journal_file() const;
+    void init();   ///< Constructor body shared by every constructor
     bool load_file();
-    void save_data(unsigned long long name_hash, unsigned long long data_hash, 
-                   std::vector<std::pair<double, double>> data);
-    int read(std::string& s);
+    bool load_text_file();
+    bool load_binary_file();
+    bool dropping_payloads() const;
+    void cover_record(const dataNode& node);
+    std::string_view record_payload(const dataNode& node) const;
+    ffvms::storage::IRecordCipher* cipher(unsigned int id);
+    unsigned long long write_record(std::ostream& out, const dataNode& node);
+    bool write_file();
+    void save_data(unsigned long long name_hash, unsigned long long data_hash, std::string payload,
+                   unsigned int codec, unsigned int cipher, unsigned int checksum);
+    bool store_table(std::unique_lock<std::mutex>& lock, const std::string& name, const std::string& data);
+    bool decode_table(const std::string& name, std::string& data, bool mandatory_access);
+
+    // Append-log helpers
+    bool open_log();
+    bool append_record(dataNode& node, unsigned long long& end);
+    bool stored_intact(const dataNode& node) const;
+    void replay_journal();
+    bool write_log_index();
+    double dead_ratio() const;
+    void maybe_start_compaction();
+    void poll_compaction(bool shutting_down = false);
+    bool finish_compaction();
 
 public:
     /// Default constructor (uses global Logger singleton)
@@ -66,6 +193,10 @@ public:
     
     /// Constructor with injected logger
     explicit Saver(ffvms::ILogger* logger);
+
+    /// Constructor with injected logger and data file location
+    Saver(ffvms::ILogger* logger, const std::string& data_file,
+          const SaverOptions& options = SaverOptions());
     
     ~Saver() override;
 
@@ -73,6 +204,16 @@ public:
     bool save(const std::string& name, const ffvms::DataTable& content) override;
     bool load(const std::string& name, ffvms::DataTable& content, 
               bool mandatory_access = false) override;
+
+    /// Serializes the fields straight into the record, without a DataTable
+    bool save_records(const std::string& name, const RecordSource& write) override;
+
+    /// Reads the decoded record in place; @p read gets views into it
+    bool load_records(const std::string& name, const RecordSink& read,
+                      bool mandatory_access = false) override;
+
+    /// Bytes of encrypted payload held in memory rather than in the data file
+    unsigned long long resident_bytes() const;
     
     // Static utility functions
     static bool is_all_digits(const std::string& s);
@@ -80,6 +221,16 @@ public:
     
     /// Get global singleton instance (legacy access pattern)
     static Saver& get_saver();
+
+    /**
+     * @brief Storage the managers use when none is injected
+     *
+     * The Saver singleton unless set_default_storage() chose another
+     * backend, which must happen before the managers are first used and
+     * outlive them.
+     */
+    static ffvms::IStorage& get_default_storage();
+    static void set_default_storage(ffvms::IStorage* storage);
 };
 
 #endif // SAVER_H
@@ -0,0 +1,74 @@
+/**
+ * @file async_io.h
+ * @brief Batched whole-file reads and writes for the storage backends
+ *
+ * On Linux the batch goes through io_uring when the build and the kernel
+ * allow it: one thread keeps up to queue_depth requests in flight and
+ * hands each finished buffer to the pool, so parsing overlaps the reads
+ * still outstanding. Elsewhere, or when io_uring is refused, a thread pool
+ * runs ordinary blocking I/O.
+ */
+
+#ifndef FFVMS_STORAGE_ASYNC_IO_H
+#define FFVMS_STORAGE_ASYNC_IO_H
+
+#include "core/thread_pool.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ffvms::storage {
+
+enum class IoBackend {
+    AUTO,       ///< io_uring if available, threads otherwise
+    THREADS,    ///< Blocking I/O spread over the thread pool
+    IO_URING,   ///< Linux io_uring; falls back to THREADS if unavailable
+};
+
+struct FileWrite {
+    std::string path;
+    std::string_view bytes;
+};
+
+/**
+ * @brief Reads and writes batches of whole files
+ *
+ * Each call returns only after the whole batch has finished. Calls on one
+ * instance may come from several threads.
+ */
+class IAsyncIo {
+public:
+    /**
+     * @brief Consumes the contents of file @p index of a read batch
+     *
+     * Runs as soon as that file is in memory, on any pool thread and
+     * concurrently with other calls. Returning false fails the batch.
+     */
+    using ReadDone = std::function<bool(std::size_t index, std::string&& bytes)>;
+
+    virtual ~IAsyncIo() = default;
+
+    virtual const char* name() const = 0;
+
+    /// @return false if a file could not be read or @p done returned false
+    virtual bool read_files(const std::vector<std::string>& paths, const ReadDone& done) = 0;
+
+    /// @brief Create or truncate each file with its bytes; fsync each one when @p sync
+    virtual bool write_files(const std::vector<FileWrite>& files, bool sync) = 0;
+};
+
+/// @brief True if this build has io_uring support and the running kernel accepts it
+bool io_uring_available();
+
+/**
+ * @brief Create an I/O backend running its work on @p pool
+ * @param queue_depth Requests io_uring keeps in flight at once
+ */
+std::unique_ptr<IAsyncIo> make_async_io(IoBackend backend, ffvms::ThreadPool& pool,
+                                        unsigned queue_depth = 64);
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_ASYNC_IO_H
@@ -0,0 +1,64 @@
+/**
+ * @file block_checksums.h
+ * @brief Per-block CRC-32C of a record's serialized table
+ *
+ * Saver stores the table in front of the record's data, inside the
+ * encryption. A mismatch points at the block that is damaged and blocks
+ * can be checked in parallel or as they arrive. The CRCs only detect
+ * damage; whether a table changed is decided by its xxHash64
+ * (storage/xxhash64.h), since 32 bits collide too often for that.
+ *
+ * @code
+ * varint data size | varint block size | u32 CRC-32C per block
+ * @endcode
+ */
+
+#ifndef FFVMS_STORAGE_BLOCK_CHECKSUMS_H
+#define FFVMS_STORAGE_BLOCK_CHECKSUMS_H
+
+#include "core/thread_pool.h"
+#include "storage/byte_io.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ffvms::storage {
+
+class BlockChecksums {
+private:
+    std::uint64_t size_ = 0;
+    std::uint64_t block_size_ = 0;
+    std::vector<std::uint32_t> crcs_;
+
+public:
+    static constexpr std::size_t BLOCK_SIZE = 64 * 1024;
+
+    /// No block mismatches
+    static constexpr std::size_t NONE = static_cast<std::size_t>(-1);
+
+    /// @brief Checksum @p data in blocks of @p block_size, spread over @p pool when it is large
+    static BlockChecksums compute(std::string_view data, ThreadPool* pool = &ThreadPool::shared(),
+                                  std::size_t block_size = BLOCK_SIZE);
+
+    std::uint64_t size() const { return size_; }
+    std::uint64_t block_size() const { return block_size_; }
+    std::size_t blocks() const { return crcs_.size(); }
+
+    /// @brief Append the encoded table to @p out
+    void encode(std::string& out) const;
+
+    /// @brief Read a table written by encode(); false if it is malformed
+    bool decode(ByteReader& in);
+
+    /**
+     * @brief Index of the first block of @p data that does not match
+     * @return NONE if all match; 0 if @p data has the wrong size
+     */
+    std::size_t first_mismatch(std::string_view data, ThreadPool* pool = &ThreadPool::shared()) const;
+};
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_BLOCK_CHECKSUMS_H
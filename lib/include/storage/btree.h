@@ -0,0 +1,137 @@
+/**
+ * @file btree.h
+ * @brief Single-file paged B+tree
+ *
+ * Layout (all fields little-endian, pages of storage::PAGE_SIZE bytes):
+ * @code
+ * Page 0       magic "FFVMSBPT" | u32 version | u32 page size | u64 root | u64 free list head
+ * Node page    u8 type | 3 unused | u32 entry count | u64 link | entries
+ *   leaf       entries: u64 key hi | u64 key lo | u32 value size | u8 flags
+ *                       | value bytes, or when flags & 1:
+ *                         u64 first overflow page | u64 FNV-1a digest of the value
+ *              link: next leaf in key order (0 for the last)
+ *   internal   entries: u64 key hi | u64 key lo | u64 child holding keys >= key
+ *              link: child holding keys below the first entry
+ * Overflow     u8 type | 3 unused | u32 bytes used | u64 next overflow page | bytes
+ * Free page    u8 type 0 | 7 unused | u64 next free page
+ * @endcode
+ * Values longer than BTree::INLINE_MAX are kept in a chain of overflow
+ * pages so leaves keep a useful fan-out; their digest lets put() skip an
+ * unchanged value without reading the chain.
+ */
+
+#ifndef FFVMS_STORAGE_BTREE_H
+#define FFVMS_STORAGE_BTREE_H
+
+#include "storage/buffer_pool.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ffvms::storage {
+
+struct BTreeKey {
+    std::uint64_t hi = 0;
+    std::uint64_t lo = 0;
+
+    bool operator<(const BTreeKey& o) const { return hi != o.hi ? hi < o.hi : lo < o.lo; }
+    bool operator==(const BTreeKey& o) const { return hi == o.hi && lo == o.lo; }
+    bool operator<=(const BTreeKey& o) const { return !(o < *this); }
+};
+
+/**
+ * @brief B+tree from 128-bit keys to byte strings, paged through a BufferPool
+ *
+ * Only the pages on the path of an operation are pinned, so the tree can
+ * be far larger than the pool. Erasing does not merge underfull nodes;
+ * pages freed by overflow chains are reused through a free list.
+ * Changes reach the file when their pages are evicted or on flush(); the
+ * file is not crash-atomic between flushes.
+ */
+class BTree {
+public:
+    static constexpr std::size_t INLINE_MAX = 1024;
+
+    explicit BTree(std::size_t pool_pages = 1024);
+    ~BTree();
+
+    BTree(const BTree&) = delete;
+    BTree& operator=(const BTree&) = delete;
+
+    /// @brief Open or create the tree file
+    bool open(const std::string& path);
+    bool close();
+    bool flush();
+
+    bool get(const BTreeKey& key, std::string& value);
+
+    /// @brief Insert or replace; a value equal to the stored one leaves the pages clean
+    bool put(const BTreeKey& key, std::string_view value);
+
+    /// @return false if the key was not present or a page could not be read
+    bool erase(const BTreeKey& key);
+
+    /**
+     * @brief Visit keys in [@p from, @p to] in order
+     *
+     * @p visit returns false to stop early.
+     * @return false if a page could not be read
+     */
+    bool scan(const BTreeKey& from, const BTreeKey& to,
+              const std::function<bool(const BTreeKey&, std::string&&)>& visit);
+
+    BufferPool::Stats pool_stats() const { return pool_.stats(); }
+    PageId page_count() const { return pool_.page_count(); }
+
+private:
+    struct LeafEntry {
+        BTreeKey key;
+        std::uint32_t size = 0;
+        bool overflow = false;
+        std::string bytes;          ///< Value when inline
+        PageId first_page = 0;      ///< First overflow page otherwise
+        std::uint64_t digest = 0;   ///< Digest of an overflow value
+    };
+
+    struct Node {
+        bool leaf = true;
+        PageId link = 0;
+        std::vector<LeafEntry> entries;
+        std::vector<std::pair<BTreeKey, PageId>> children;
+    };
+
+    struct Split {
+        bool happened = false;
+        BTreeKey key;
+        PageId right = 0;
+    };
+
+    BufferPool pool_;
+    PageId root_ = 0;
+    PageId free_head_ = 0;
+
+    static std::size_t encoded_size(const Node& node);
+    static void decode(const char* page, Node& node);
+    static void encode(const Node& node, char* page);
+
+    bool read_node(PageId id, Node& node);
+    bool write_node(PageId id, const Node& node);
+    BufferPool::Page new_page();
+    void free_page(PageId id);
+    bool write_header();
+
+    bool make_entry(const BTreeKey& key, std::string_view value, LeafEntry& entry);
+    bool read_value(const LeafEntry& entry, std::string& value);
+    bool holds(const BTreeKey& key, std::string_view value);
+    void free_chain(PageId first);
+    bool find_leaf(const BTreeKey& key, PageId& leaf);
+    bool insert(PageId page, LeafEntry& entry, Split& split);
+    bool split_leaf(Node& node, PageId id, Split& split);
+    bool split_internal(Node& node, PageId id, Split& split);
+};
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_BTREE_H
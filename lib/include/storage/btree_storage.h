@@ -0,0 +1,71 @@
+/**
+ * @file btree_storage.h
+ * @brief IStorage backend on a paged B+tree
+ */
+
+#ifndef FFVMS_STORAGE_BTREE_STORAGE_H
+#define FFVMS_STORAGE_BTREE_STORAGE_H
+
+#include "interfaces/i_logger.h"
+#include "interfaces/i_storage.h"
+#include "storage/btree.h"
+#include <mutex>
+#include <string>
+
+namespace ffvms::storage {
+
+/**
+ * @brief Settings for BTreeStorage
+ */
+struct BTreeStorageOptions {
+    /// Buffer pool size in pages of storage::PAGE_SIZE bytes; bounds the memory used for data
+    std::size_t pool_pages = 1024;
+
+    /// fsync the file after every save
+    bool sync = false;
+};
+
+/**
+ * @brief Stores each table row under its own B+tree key
+ *
+ * A table named N is kept as rows (hash(N), 0..count-1) plus a meta entry
+ * (hash(N), 2^64-1) holding the row count and N itself, which catches hash
+ * collisions. Saving a table rewrites only rows whose bytes changed and
+ * erases rows past the new end, so memory and I/O follow the rows touched
+ * rather than the size of the repository. Pages live in a fixed-size
+ * buffer pool, and dirty pages are written back at the end of every save.
+ *
+ * Rows are stored unencrypted, and the file is not crash-atomic: a crash
+ * in the middle of a save can leave that table partly updated.
+ * save() and load() are thread-safe.
+ */
+class BTreeStorage : public ffvms::IStorage {
+private:
+    std::string path_;
+    BTreeStorageOptions options_;
+    BTree tree_;
+    bool open_ = false;
+    std::mutex mutex_;
+    ffvms::ILogger* logger_ = nullptr;
+
+    ffvms::ILogger& get_logger_ref();
+    bool read_meta(const std::string& name, std::uint64_t table, std::uint64_t& rows, bool& exists);
+
+public:
+    BTreeStorage(ffvms::ILogger* logger, const std::string& path,
+                 const BTreeStorageOptions& options = BTreeStorageOptions());
+    ~BTreeStorage() override;
+
+    bool is_open() const { return open_; }
+
+    bool save(const std::string& name, const ffvms::DataTable& content) override;
+    bool load(const std::string& name, ffvms::DataTable& content,
+              bool mandatory_access = false) override;
+
+    BufferPool::Stats pool_stats();
+    PageId page_count();
+};
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_BTREE_STORAGE_H
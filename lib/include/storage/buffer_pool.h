@@ -0,0 +1,126 @@
+/**
+ * @file buffer_pool.h
+ * @brief Fixed-size page cache over a single file
+ */
+
+#ifndef FFVMS_STORAGE_BUFFER_POOL_H
+#define FFVMS_STORAGE_BUFFER_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ffvms::storage {
+
+using PageId = std::uint64_t;
+
+constexpr std::size_t PAGE_SIZE = 4096;
+
+/**
+ * @brief Caches pages of one file in a fixed number of frames
+ *
+ * Pages are read on first use and written back when their frame is
+ * reclaimed or on flush(). Frames are reclaimed with the clock algorithm:
+ * every use sets a frame's reference bit and the hand clears bits until it
+ * finds an unpinned frame whose bit is clear. Memory use is therefore
+ * bounded by the frame count whatever the size of the file; the pool only
+ * grows past it when every frame is pinned at once.
+ */
+class BufferPool {
+public:
+    struct Stats {
+        unsigned long long hits = 0;
+        unsigned long long misses = 0;       ///< Pages read from the file
+        unsigned long long evictions = 0;
+        unsigned long long writes = 0;       ///< Pages written to the file
+    };
+
+    /// @brief Pinned page; the frame cannot be reclaimed while a handle exists
+    class Page {
+    private:
+        BufferPool* pool_ = nullptr;
+        std::size_t frame_ = 0;
+        char* data_ = nullptr;
+        PageId id_ = 0;
+
+        friend class BufferPool;
+        Page(BufferPool* pool, std::size_t frame, char* data, PageId id)
+            : pool_(pool), frame_(frame), data_(data), id_(id) {}
+
+    public:
+        Page() = default;
+        ~Page() { reset(); }
+        Page(Page&& other) noexcept { *this = std::move(other); }
+        Page& operator=(Page&& other) noexcept;
+        Page(const Page&) = delete;
+        Page& operator=(const Page&) = delete;
+
+        explicit operator bool() const { return data_ != nullptr; }
+        PageId id() const { return id_; }
+        const char* data() const { return data_; }
+
+        /// @brief Writable bytes; marks the page dirty
+        char* mutable_data();
+
+        /// @brief Unpin early
+        void reset();
+    };
+
+    explicit BufferPool(std::size_t frames);
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    /// @brief Open @p path, creating an empty file if it does not exist
+    bool open(const std::string& path);
+
+    /// @brief Write back dirty pages and close the file
+    bool close();
+
+    bool is_open() const { return file_.is_open(); }
+
+    /// @brief Pages in the file, including ones not written back yet
+    PageId page_count() const { return page_count_; }
+
+    /// @brief Pin page @p id; an empty handle if it cannot be read
+    Page fetch(PageId id);
+
+    /// @brief Pin a new zero-filled page at the end of the file
+    Page allocate();
+
+    /// @brief Write back every dirty page
+    bool flush();
+
+    Stats stats() const { return stats_; }
+    std::size_t frame_count() const { return frames_.size(); }
+
+private:
+    struct Frame {
+        PageId id = 0;
+        bool used = false;
+        bool dirty = false;
+        bool referenced = false;
+        int pins = 0;
+        std::unique_ptr<char[]> data;
+    };
+
+    std::vector<Frame> frames_;
+    std::unordered_map<PageId, std::size_t> table_;
+    std::size_t hand_ = 0;
+    std::fstream file_;
+    PageId page_count_ = 0;
+    Stats stats_;
+
+    bool claim_frame(std::size_t& index);
+    bool write_frame(Frame& frame);
+    Page pin(std::size_t index);
+};
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_BUFFER_POOL_H
@@ -0,0 +1,164 @@
+/**
+ * @file byte_io.h
+ * @brief Little-endian encoding helpers for the binary storage formats
+ *
+ * All on-disk integers and doubles are stored little-endian regardless of
+ * the host, so files can be moved between machines.
+ */
+
+#ifndef FFVMS_STORAGE_BYTE_IO_H
+#define FFVMS_STORAGE_BYTE_IO_H
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+
+namespace ffvms::storage {
+
+static_assert(std::numeric_limits<double>::is_iec559, "IEEE 754 doubles are required");
+
+inline void put_u32(std::string& out, std::uint32_t v) {
+    for (int i = 0; i < 4; i++) out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+}
+
+inline void put_u64(std::string& out, std::uint64_t v) {
+    for (int i = 0; i < 8; i++) out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+}
+
+/// @brief Write @p v at @p p, which must have room for 4 bytes
+inline void store_u32(char* p, std::uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = static_cast<char>((v >> (8 * i)) & 0xff);
+}
+
+/// @brief Write @p v at @p p, which must have room for 8 bytes
+inline void store_u64(char* p, std::uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = static_cast<char>((v >> (8 * i)) & 0xff);
+}
+
+/// @brief Write @p v at @p p, which must have room for 8 bytes
+inline void store_f64(char* p, double v) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    store_u64(p, bits);
+}
+
+inline void put_f64(std::string& out, double v) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    put_u64(out, bits);
+}
+
+/// @brief Append @p v as an LEB128 varint: 7 bits per byte, low bits first
+inline void put_varint(std::string& out, std::uint64_t v) {
+    char bytes[10];
+    std::size_t n = 0;
+    while (v >= 0x80) {
+        bytes[n++] = static_cast<char>((v & 0x7f) | 0x80);
+        v >>= 7;
+    }
+    bytes[n++] = static_cast<char>(v);
+    out.append(bytes, n);
+}
+
+/// @brief Bytes put_varint() writes for @p v
+inline std::size_t varint_size(std::uint64_t v) {
+    std::size_t n = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        n++;
+    }
+    return n;
+}
+
+inline std::uint32_t load_u32(const char* p) {
+    std::uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) v = (v << 8) | static_cast<unsigned char>(p[i]);
+    return v;
+}
+
+inline std::uint64_t load_u64(const char* p) {
+    std::uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = (v << 8) | static_cast<unsigned char>(p[i]);
+    return v;
+}
+
+inline double load_f64(const char* p) {
+    std::uint64_t bits = load_u64(p);
+    double v;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+/**
+ * @brief Bounds-checked cursor over a byte buffer
+ *
+ * Every read fails softly: once the cursor runs past the end, ok() turns
+ * false and all further reads return zero.
+ */
+class ByteReader {
+private:
+    const char* cur_;
+    const char* end_;
+    bool ok_ = true;
+
+    bool need(std::size_t n) {
+        if (!ok_ || static_cast<std::size_t>(end_ - cur_) < n) {
+            ok_ = false;
+            return false;
+        }
+        return true;
+    }
+
+public:
+    ByteReader(const char* data, std::size_t size) : cur_(data), end_(data + size) {}
+
+    bool ok() const { return ok_; }
+    std::size_t remaining() const { return static_cast<std::size_t>(end_ - cur_); }
+    const char* position() const { return cur_; }
+
+    std::uint32_t u32() {
+        if (!need(4)) return 0;
+        std::uint32_t v = load_u32(cur_);
+        cur_ += 4;
+        return v;
+    }
+
+    std::uint64_t u64() {
+        if (!need(8)) return 0;
+        std::uint64_t v = load_u64(cur_);
+        cur_ += 8;
+        return v;
+    }
+
+    double f64() {
+        if (!need(8)) return 0.0;
+        double v = load_f64(cur_);
+        cur_ += 8;
+        return v;
+    }
+
+    /// @brief Read a put_varint() value; fails on truncation or more than 64 bits
+    std::uint64_t varint() {
+        std::uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (!need(1)) return 0;
+            std::uint64_t byte = static_cast<unsigned char>(*cur_++);
+            if (shift == 63 && byte > 1) break;
+            v |= (byte & 0x7f) << shift;
+            if (byte < 0x80) return v;
+        }
+        ok_ = false;
+        return 0;
+    }
+
+    bool skip(std::size_t n) {
+        if (!need(n)) return false;
+        cur_ += n;
+        return true;
+    }
+};
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_BYTE_IO_H
@@ -0,0 +1,103 @@
+/**
+ * @file cached_storage.h
+ * @brief Size-bounded LRU cache of decoded tables in front of an IStorage
+ */
+
+#ifndef FFVMS_STORAGE_CACHED_STORAGE_H
+#define FFVMS_STORAGE_CACHED_STORAGE_H
+
+#include "interfaces/i_storage.h"
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace ffvms::storage {
+
+/**
+ * @brief Settings for CachedStorage
+ */
+struct CachedStorageOptions {
+    /// Decoded tables kept, in bytes of strings and row vectors; 0 caches nothing
+    std::size_t capacity_bytes = 64 * 1024 * 1024;
+};
+
+/**
+ * @brief Serves repeated loads of a table without decoding it again
+ *
+ * A load that misses goes to the backend (for Saver: decrypt, verify,
+ * decompress and parse) and keeps the decoded table; later loads of the
+ * same name copy it out, or stream it to load_records() from the cache.
+ * When the tables kept exceed capacity_bytes, the least recently used
+ * ones are dropped; a table larger than the whole capacity is not kept.
+ *
+ * Saving a table drops its cached copy before and after the backend
+ * writes it, so no load returns an older version once save() returns.
+ * Loads with mandatory_access are served from the cache but never fill
+ * it, since the backend may hand back a table that failed verification.
+ *
+ * The backend is not owned. All calls are thread-safe if the backend's
+ * are; the backend is called without the cache's lock held.
+ */
+class CachedStorage : public ffvms::IStorage {
+public:
+    struct Stats {
+        unsigned long long hits = 0;
+        unsigned long long misses = 0;        ///< Loads passed to the backend
+        unsigned long long evictions = 0;     ///< Tables dropped to stay within capacity
+        unsigned long long invalidations = 0; ///< Cached tables dropped by a save
+    };
+
+private:
+    using Table = std::shared_ptr<const ffvms::DataTable>;
+
+    struct Entry {
+        std::string name;
+        Table table;
+        std::size_t bytes = 0;
+    };
+
+    ffvms::IStorage* backend_;
+    std::size_t capacity_;
+    std::size_t bytes_ = 0;
+    std::list<Entry> lru_;   ///< Most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    unsigned long long generation_ = 0;   ///< Bumped by every save, so a load racing one is not kept
+    Stats stats_;
+    mutable std::mutex mutex_;
+
+    Table find(const std::string& name);
+    Table fetch(const std::string& name, bool mandatory_access);
+    void invalidate(const std::string& name);
+    void evict_to(std::size_t capacity);
+
+public:
+    explicit CachedStorage(ffvms::IStorage* backend, const CachedStorageOptions& options = CachedStorageOptions());
+
+    bool save(const std::string& name, const ffvms::DataTable& content) override;
+    bool load(const std::string& name, ffvms::DataTable& content,
+              bool mandatory_access = false) override;
+    bool save_records(const std::string& name, const RecordSource& write) override;
+    bool load_records(const std::string& name, const RecordSink& read,
+                      bool mandatory_access = false) override;
+
+    /// @brief Change the capacity, dropping tables until the cache fits it
+    void set_capacity(std::size_t bytes);
+
+    /// @brief Drop every cached table
+    void clear();
+
+    /// @brief Bytes of the tables currently cached
+    std::size_t cached_bytes() const;
+
+    Stats stats() const;
+
+    /// @brief Memory a decoded table is charged against the capacity
+    static std::size_t table_bytes(const ffvms::DataTable& table);
+};
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_CACHED_STORAGE_H
@@ -0,0 +1,106 @@
+/**
+ * @file chunk_store.h
+ * @brief Reference-counted, content-addressed chunk storage
+ */
+
+#ifndef FFVMS_STORAGE_CHUNK_STORE_H
+#define FFVMS_STORAGE_CHUNK_STORE_H
+
+#include "core/cow.h"
+#include "storage/chunker.h"
+#include "storage/sha256.h"
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ffvms::storage {
+
+/// Chunks are identified by the SHA-256 of their bytes
+using ChunkId = Sha256::Digest;
+
+struct ChunkIdHash {
+    std::size_t operator()(const ChunkId& id) const {
+        std::size_t h;
+        std::memcpy(&h, id.data(), sizeof(h));
+        return h;
+    }
+};
+
+/**
+ * @brief Deduplicating store for file contents
+ *
+ * put() splits content into content-defined chunks and keeps one copy of
+ * each distinct chunk. Every chunk list handed out by put() or passed to
+ * add_ref() holds one reference to each of its chunks; release() drops
+ * them again and frees chunks nobody references.
+ *
+ * Chunk bytes never change once stored. snapshot() hands the current set
+ * to another thread without copying it; the store copies its chunk map
+ * (not the bytes) if a chunk is added or freed while a snapshot is alive.
+ * Reference counts are kept apart, so taking and dropping references never
+ * copies it.
+ */
+class ChunkStore {
+public:
+    struct Stats {
+        std::size_t chunk_count = 0;
+        unsigned long long stored_bytes = 0;   ///< Bytes of distinct chunks actually kept
+    };
+
+    explicit ChunkStore(const ChunkerParams& params = ChunkerParams()) : params_(params) {}
+
+    /// @brief Store @p content and return its chunk list
+    std::vector<ChunkId> put(std::string_view content);
+
+    /// @brief Take another reference to every chunk of @p chunks
+    bool add_ref(const std::vector<ChunkId>& chunks);
+
+    /// @brief Drop one reference to every chunk of @p chunks
+    void release(const std::vector<ChunkId>& chunks);
+
+    /// @brief Concatenate the chunks of @p chunks into @p content
+    bool assemble(const std::vector<ChunkId>& chunks, std::string& content) const;
+
+    /**
+     * @brief Insert a chunk read back from storage, without a reference
+     * @return false if @p data does not hash to @p id
+     */
+    bool insert(const ChunkId& id, std::string data);
+
+    /// @brief Free chunks with no references, e.g. after loading
+    void drop_unreferenced();
+
+    void clear() {
+        if (!chunks_.get().empty()) generation_++;
+        chunks_.edit().clear();
+        refs_.clear();
+    }
+
+    Stats stats() const;
+
+    /// @brief Counter that changes whenever a chunk is added or freed
+    unsigned long long generation() const { return generation_; }
+
+    template <class F>
+    void for_each(F&& f) const {
+        for (const auto& it : chunks_.get()) f(it.first, *it.second);
+    }
+
+    using Snapshot = std::shared_ptr<const std::unordered_map<ChunkId, std::shared_ptr<const std::string>, ChunkIdHash>>;
+
+    /// @brief The stored chunks; later changes to the store do not affect it
+    Snapshot snapshot() const { return chunks_.share(); }
+
+private:
+    ChunkerParams params_;
+    ffvms::Cow<std::unordered_map<ChunkId, std::shared_ptr<const std::string>, ChunkIdHash>> chunks_;
+    std::unordered_map<ChunkId, unsigned long long, ChunkIdHash> refs_;   ///< Missing for chunks nobody references
+    unsigned long long generation_ = 0;
+};
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_CHUNK_STORE_H
@@ -0,0 +1,39 @@
+/**
+ * @file chunker.h
+ * @brief Content-defined chunking (FastCDC)
+ *
+ * Chunk boundaries are picked from the bytes themselves with a rolling
+ * gear hash, so an edit only moves the boundaries next to it and every
+ * other chunk of the file comes out byte-for-byte the same.
+ */
+
+#ifndef FFVMS_STORAGE_CHUNKER_H
+#define FFVMS_STORAGE_CHUNKER_H
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace ffvms::storage {
+
+/// @brief Chunk size bounds; avg_size must be a power of two
+struct ChunkerParams {
+    std::size_t min_size = 2 * 1024;
+    std::size_t avg_size = 8 * 1024;
+    std::size_t max_size = 64 * 1024;
+};
+
+/**
+ * @brief Length of the chunk starting at @p data
+ *
+ * Uses normalized chunking: a stricter mask before the average size and a
+ * looser one after it, which keeps chunk sizes close to the average.
+ */
+std::size_t next_chunk_size(const char* data, std::size_t size, const ChunkerParams& params = ChunkerParams());
+
+/// @brief Split @p data into consecutive content-defined chunks
+std::vector<std::string_view> split_chunks(std::string_view data, const ChunkerParams& params = ChunkerParams());
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_CHUNKER_H
@@ -0,0 +1,49 @@
+/**
+ * @file codec.h
+ * @brief Compression codecs applied to records before encryption
+ *
+ * Every record stores the id of the codec its payload went through, so
+ * codecs can be added or changed without rewriting existing data.
+ */
+
+#ifndef FFVMS_STORAGE_CODEC_H
+#define FFVMS_STORAGE_CODEC_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace ffvms::storage {
+
+/// Codec ids as stored on disk; never renumber
+enum class CodecId : std::uint32_t {
+    NONE = 0,
+    LZ4 = 1
+};
+
+/**
+ * @brief Stateless byte-level compressor
+ */
+class ICodec {
+public:
+    virtual ~ICodec() = default;
+
+    virtual CodecId id() const = 0;
+    virtual const char* name() const = 0;
+
+    /// @brief Replace @p out with the encoded form of @p in
+    virtual void compress(std::string_view in, std::string& out) const = 0;
+
+    /**
+     * @brief Replace @p out with the decoded form of @p in
+     * @return false if @p in is not valid output of compress()
+     */
+    virtual bool decompress(std::string_view in, std::string& out) const = 0;
+};
+
+/// @brief Codec registered under @p id, or nullptr if unknown
+const ICodec* find_codec(CodecId id);
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_CODEC_H
@@ -0,0 +1,28 @@
+/**
+ * @file crc32c.h
+ * @brief CRC-32C (Castagnoli) checksums
+ *
+ * On x86-64 CPUs with SSE4.2 the crc32 instruction is used, eight bytes at
+ * a time; elsewhere a slicing-by-8 table. Both give the same values.
+ */
+
+#ifndef FFVMS_STORAGE_CRC32C_H
+#define FFVMS_STORAGE_CRC32C_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ffvms::storage {
+
+/// @brief CRC-32C of @p size bytes at @p data, continuing from the CRC @p crc of preceding bytes
+std::uint32_t crc32c(const char* data, std::size_t size, std::uint32_t crc = 0);
+
+/// @brief crc32c() without the hardware path, to check it against
+std::uint32_t crc32c_portable(const char* data, std::size_t size, std::uint32_t crc = 0);
+
+/// @brief Whether crc32c() uses the SSE4.2 instruction on this machine
+bool crc32c_hardware();
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_CRC32C_H
@@ -0,0 +1,105 @@
+/**
+ * @file data_file_format.h
+ * @brief Versioned binary container layout of data.chm
+ *
+ * Layout (all fields little-endian):
+ * @code
+ * FileHeader   magic "FFVMSCHM" | u32 version | u32 header size
+ *              | u64 record count | u64 index offset
+ * Record ...   u64 body size | u64 name hash | u64 data hash
+ *              | u32 block count | u8 codec id | u8 checksum kind
+ *              | u16 cipher id | payload
+ * Index        record count x (u64 name hash | u64 offset | u64 size)
+ * @endcode
+ * The index lets a reader find any record without parsing the ones in
+ * front of it. The codec id (storage/codec.h) names the compression the
+ * record went through before encryption and the cipher id
+ * (storage/record_cipher.h) the cipher that produced the payload. Version 1
+ * files hold 0 in both, version 2 files 0 in the cipher id; 0 is the FFT
+ * cipher, whose payload is raw IEEE doubles in blocks of block count.
+ * The checksum kind says what the data hash is: files before version 4
+ * hold 0, the polynomial hash of the table; CRC32C_BLOCKS records carry a
+ * BlockChecksums table (storage/block_checksums.h) in front of their data,
+ * inside the encryption, and the data hash is the xxHash64 of the table.
+ * Files that do not start with the magic are treated as the legacy text
+ * format.
+ */
+
+#ifndef FFVMS_STORAGE_DATA_FILE_FORMAT_H
+#define FFVMS_STORAGE_DATA_FILE_FORMAT_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace ffvms::storage {
+
+/// Magic bytes at offset 0 of every binary data file
+constexpr char FILE_MAGIC[8] = {'F', 'F', 'V', 'M', 'S', 'C', 'H', 'M'};
+
+/// Current container format version (2 added codec ids, 3 cipher ids, 4 checksum kinds)
+constexpr std::uint32_t FORMAT_VERSION = 4;
+
+constexpr std::size_t FILE_HEADER_SIZE = 32;
+constexpr std::size_t RECORD_HEADER_SIZE = 32;
+constexpr std::size_t INDEX_ENTRY_SIZE = 24;
+
+/// @brief What a record's data hash was computed with
+enum class ChecksumKind : std::uint8_t {
+    POLYNOMIAL = 0,     ///< polynomial_hash() of the serialized table
+    CRC32C_BLOCKS = 1,  ///< xxhash64() of the table; BlockChecksums stored with the data
+};
+
+struct FileHeader {
+    std::uint32_t version = FORMAT_VERSION;
+    std::uint64_t record_count = 0;
+    std::uint64_t index_offset = 0;
+};
+
+/// @brief Fixed-size part of a record, followed by the payload
+struct RecordHeader {
+    std::uint64_t body_size = 0;   ///< Bytes after the body_size field itself
+    std::uint64_t name_hash = 0;
+    std::uint64_t data_hash = 0;
+    std::uint32_t block_count = 0; ///< FFT blocks in the payload; 0 for non-FFT ciphers
+    std::uint8_t codec = 0;        ///< storage::CodecId applied before encryption
+    std::uint8_t checksum = 0;     ///< storage::ChecksumKind of data_hash
+    std::uint16_t cipher = 0;      ///< storage::CipherId that produced the payload
+};
+
+struct IndexEntry {
+    std::uint64_t name_hash = 0;
+    std::uint64_t offset = 0;      ///< Offset of the record from the start of the file
+    std::uint64_t size = 0;        ///< Total size of the record including its header
+};
+
+/**
+ * @brief The hash Saver keeps for names and for POLYNOMIAL records
+ *
+ * Text data files and ChecksumKind::POLYNOMIAL records store it as their
+ * data hash; changing it makes them fail verification.
+ */
+inline std::uint64_t polynomial_hash(std::string_view s) {
+    std::uint64_t hash = 0;
+    for (char ch : s) hash = hash * 13331 + ch;
+    return hash;
+}
+
+/// @brief Check whether a buffer starts with the binary file magic
+inline bool has_file_magic(const char* data, std::size_t size) {
+    return size >= sizeof(FILE_MAGIC) && std::memcmp(data, FILE_MAGIC, sizeof(FILE_MAGIC)) == 0;
+}
+
+void encode_file_header(std::string& out, const FileHeader& header);
+bool decode_file_header(const char* data, std::size_t size, FileHeader& header);
+
+void encode_record_header(std::string& out, const RecordHeader& header);
+bool decode_record_header(const char* data, std::size_t size, RecordHeader& header);
+
+void encode_index_entry(std::string& out, const IndexEntry& entry);
+bool decode_index_entry(const char* data, std::size_t size, IndexEntry& entry);
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_DATA_FILE_FORMAT_H
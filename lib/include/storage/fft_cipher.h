@@ -0,0 +1,62 @@
+/**
+ * @file fft_cipher.h
+ * @brief The original FFT Encryptor as a record cipher
+ */
+
+#ifndef FFVMS_STORAGE_FFT_CIPHER_H
+#define FFVMS_STORAGE_FFT_CIPHER_H
+
+#include "encryptor.h"
+#include "storage/record_cipher.h"
+
+namespace ffvms::storage {
+
+/**
+ * @brief Legacy FFT transform; payloads are raw little-endian double pairs
+ *
+ * Each input byte becomes 16 bytes of payload, in blocks of Encryptor::N
+ * pairs. Kept so files written before the cipher interface stay readable.
+ * Long payloads are transformed block-parallel on the given pool.
+ */
+class FftCipher : public IRecordCipher, private Encryptor {
+public:
+    explicit FftCipher(ThreadPool* pool = &ThreadPool::shared()) { set_thread_pool(pool); }
+
+    CipherId id() const override { return CipherId::FFT; }
+    const char* name() const override { return "fft"; }
+
+    void encrypt(std::string_view plain, std::string& payload) override;
+    bool decrypt(std::string_view payload, std::string& plain) override;
+
+    /// Payload bytes per FFT block
+    static constexpr unsigned long long BLOCK_BYTES = static_cast<unsigned long long>(N) * 16;
+};
+
+/**
+ * @brief FFT transform with two input bytes per point
+ *
+ * Same payload layout and block size as FftCipher, but each block holds
+ * 2 * Encryptor::N bytes, so payloads are half the size and take half the
+ * transforms. Inputs shorter than a block use one smaller block of
+ * Encryptor::MIN_N points or more, so a payload of a few bytes is 256
+ * bytes instead of 16 KB; its size gives the block size.
+ */
+class PackedFftCipher : public IRecordCipher, private Encryptor {
+public:
+    explicit PackedFftCipher(ThreadPool* pool = &ThreadPool::shared()) { set_thread_pool(pool); }
+
+    CipherId id() const override { return CipherId::FFT_PACKED; }
+    const char* name() const override { return "fft-packed"; }
+
+    void encrypt(std::string_view plain, std::string& payload) override;
+    bool decrypt(std::string_view payload, std::string& plain) override;
+
+    static constexpr unsigned long long BLOCK_BYTES = FftCipher::BLOCK_BYTES;
+
+    /// @brief Whether @p size bytes is a whole number of full blocks or one smaller block
+    static bool valid_payload_size(unsigned long long size);
+};
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_FFT_CIPHER_H
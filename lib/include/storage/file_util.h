@@ -0,0 +1,43 @@
+/**
+ * @file file_util.h
+ * @brief Small filesystem helpers shared by the storage backends
+ */
+
+#ifndef FFVMS_STORAGE_FILE_UTIL_H
+#define FFVMS_STORAGE_FILE_UTIL_H
+
+#include <string>
+#include <string_view>
+
+namespace ffvms::storage {
+
+/**
+ * @brief Move a fully written file over its destination
+ *
+ * Atomic on POSIX systems: readers see either the old or the new file.
+ * @return true if the destination now holds the new file
+ */
+bool replace_file(const std::string& from, const std::string& to);
+
+/// @brief Force an open file descriptor's data to stable storage
+bool sync_fd(int fd);
+
+/// @brief Force a closed file's data to stable storage
+bool sync_file(const std::string& path);
+
+/**
+ * @brief Persist the directory entry of @p path after a create or rename
+ *
+ * A no-op on Windows, where renames are journaled by the filesystem.
+ */
+bool sync_parent_directory(const std::string& path);
+
+/// @brief Read a whole file into @p bytes
+bool read_whole_file(const std::string& path, std::string& bytes);
+
+/// @brief Create or truncate @p path with @p bytes; fsync it when @p sync
+bool write_whole_file(const std::string& path, std::string_view bytes, bool sync);
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_FILE_UTIL_H
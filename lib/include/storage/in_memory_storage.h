@@ -0,0 +1,79 @@
+/**
+ * @file in_memory_storage.h
+ * @brief IStorage backend that keeps every table in memory
+ */
+
+#ifndef FFVMS_STORAGE_IN_MEMORY_STORAGE_H
+#define FFVMS_STORAGE_IN_MEMORY_STORAGE_H
+
+#include "interfaces/i_logger.h"
+#include "interfaces/i_storage.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ffvms::storage {
+
+/**
+ * @brief Settings for InMemoryStorage
+ */
+struct InMemoryStorageOptions {
+    /// Data file the tables are written to by a Saver on destruction; empty keeps nothing
+    std::string dump_path;
+};
+
+/**
+ * @brief Holds each saved table as a DataTable, with no encoding or I/O
+ *
+ * For scratch repositories and for measuring the managers without
+ * encryption and disk I/O. A load copies the table out, or streams it to
+ * load_records() straight from the stored rows.
+ *
+ * With InMemoryStorageOptions::dump_path set, the destructor saves every
+ * table into that data file through a default Saver, so a scratch session
+ * can be reopened later as an ordinary repository. Tables already in the
+ * file under other names are left as they are.
+ *
+ * save() and load() are thread-safe.
+ */
+class InMemoryStorage : public ffvms::IStorage {
+private:
+    using Table = std::shared_ptr<const ffvms::DataTable>;
+
+    std::map<std::string, Table> tables_;
+    InMemoryStorageOptions options_;
+    ffvms::ILogger* logger_ = nullptr;
+    mutable std::mutex mutex_;
+
+    ffvms::ILogger& get_logger_ref();
+    Table find(const std::string& name) const;
+
+public:
+    explicit InMemoryStorage(ffvms::ILogger* logger = nullptr,
+                             const InMemoryStorageOptions& options = InMemoryStorageOptions());
+    ~InMemoryStorage() override;
+
+    InMemoryStorage(const InMemoryStorage&) = delete;
+    InMemoryStorage& operator=(const InMemoryStorage&) = delete;
+
+    bool save(const std::string& name, const ffvms::DataTable& content) override;
+    bool load(const std::string& name, ffvms::DataTable& content,
+              bool mandatory_access = false) override;
+    bool load_records(const std::string& name, const RecordSink& read,
+                      bool mandatory_access = false) override;
+
+    /// @brief Names of the tables held, in order
+    std::vector<std::string> names() const;
+
+    /**
+     * @brief Save every table into @p target
+     * @return false if any save failed
+     */
+    bool dump(ffvms::IStorage& target) const;
+};
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_IN_MEMORY_STORAGE_H
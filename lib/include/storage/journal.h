@@ -0,0 +1,104 @@
+/**
+ * @file journal.h
+ * @brief Append-only file with group commit and selectable durability
+ */
+
+#ifndef FFVMS_STORAGE_JOURNAL_H
+#define FFVMS_STORAGE_JOURNAL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace ffvms::storage {
+
+/// @brief When appended bytes are forced to stable storage
+enum class Durability {
+    NONE,     ///< Never fsync; data survives a process crash but not a power loss
+    BATCHED,  ///< A background thread fsyncs at a fixed interval
+    ALWAYS    ///< commit() returns only after the bytes are on disk
+};
+
+/**
+ * @brief Append-only journal file
+ *
+ * Writers call append() and then commit() with the position append()
+ * returned. Commits that overlap share a single fsync: the first waiter
+ * syncs everything written so far while the others wait for it, so a
+ * burst of saves costs one fsync instead of one per save.
+ *
+ * All methods are thread-safe.
+ */
+class Journal {
+private:
+    int fd_ = -1;
+    Durability durability_ = Durability::BATCHED;
+    std::chrono::milliseconds interval_{50};
+
+    mutable std::mutex mutex_;
+    std::condition_variable synced_cv_;
+    std::condition_variable flusher_cv_;
+    unsigned long long written_ = 0;   ///< Bytes in the file, including those not yet synced
+    unsigned long long synced_ = 0;    ///< Bytes known to be on stable storage
+    unsigned long long sync_count_ = 0;
+    bool syncing_ = false;
+    bool failed_ = false;
+    bool stop_ = false;
+    std::thread flusher_;
+
+    bool sync_locked(std::unique_lock<std::mutex>& lock, unsigned long long end);
+    void flusher_loop();
+
+public:
+    Journal() = default;
+    ~Journal();
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    /**
+     * @brief Open (creating if needed) @p path for appending
+     * @param interval Sync interval used with Durability::BATCHED
+     */
+    bool open(const std::string& path, Durability durability,
+              std::chrono::milliseconds interval = std::chrono::milliseconds(50));
+
+    /// @brief Flush according to the durability level and close the file
+    bool close();
+
+    bool is_open() const;
+
+    /// @brief Current size of the journal in bytes
+    unsigned long long size() const;
+
+    /**
+     * @brief Append bytes at the end of the journal
+     * @param end Output: journal position just past the appended bytes
+     * @return false if the write failed
+     */
+    bool append(const char* data, std::size_t size, unsigned long long& end);
+
+    bool append(const std::string& bytes, unsigned long long& end) {
+        return append(bytes.data(), bytes.size(), end);
+    }
+
+    /**
+     * @brief Make bytes up to @p end durable according to the durability level
+     *
+     * With ALWAYS this blocks until they are synced; with BATCHED and NONE
+     * it returns immediately.
+     */
+    bool commit(unsigned long long end);
+
+    /// @brief Sync everything written so far, regardless of the durability level
+    bool sync();
+
+    /// @brief Number of fsync calls issued, for diagnostics and tests
+    unsigned long long sync_count() const;
+};
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_JOURNAL_H
@@ -0,0 +1,54 @@
+/**
+ * @file legacy_migration.h
+ * @brief Streaming conversion of a legacy text data.chm to the binary container
+ */
+
+#ifndef FFVMS_STORAGE_LEGACY_MIGRATION_H
+#define FFVMS_STORAGE_LEGACY_MIGRATION_H
+
+#include "interfaces/i_logger.h"
+#include "storage/codec.h"
+#include "storage/record_cipher.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace ffvms::storage {
+
+struct MigrationOptions {
+    /// Cipher for the new records; CipherId::FFT copies the old payloads without decrypting them
+    CipherId cipher = CipherId::CHACHA20;
+
+    /// Compression applied before encryption, as in SaverOptions
+    CodecId codec = CodecId::LZ4;
+
+    /// Key material for keyed ciphers (see derive_key)
+    std::string passphrase;
+};
+
+struct MigrationStats {
+    std::uint64_t records = 0;
+    std::uint64_t kept = 0;            ///< Records copied as FFT payloads because they failed their hash check
+    std::uint64_t bytes_read = 0;      ///< Text parsed from the source file
+    std::uint64_t bytes_written = 0;   ///< Size of the new file
+};
+
+/**
+ * @brief Rewrite the legacy text data file @p source as a binary data file at @p target
+ *
+ * Records are parsed from a mapping of @p source and written out one at a
+ * time, so memory use is bounded by the largest record plus one index
+ * entry per record. A record whose decrypted text does not match its hash
+ * is copied in its original form, so nothing is lost that a load of the
+ * old file would have returned. The new file is written next to @p target
+ * and renamed over it at the end; @p target may be @p source itself.
+ *
+ * @param progress Called after every record with the stats so far; may be empty
+ */
+bool migrate_legacy_text(ffvms::ILogger& logger, const std::string& source, const std::string& target,
+                         const MigrationOptions& options, MigrationStats& stats,
+                         const std::function<void(const MigrationStats&)>& progress = {});
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_LEGACY_MIGRATION_H
@@ -0,0 +1,63 @@
+/**
+ * @file legacy_text_file.h
+ * @brief Reader for data.chm files written before the binary container
+ *
+ * A legacy file is a sequence of whitespace-separated records:
+ * @code
+ * name_hash data_hash block_count  then block_count * Encryptor::N pairs of doubles
+ * @endcode
+ * The doubles are the FFT cipher's output as printed by iostream.
+ */
+
+#ifndef FFVMS_STORAGE_LEGACY_TEXT_FILE_H
+#define FFVMS_STORAGE_LEGACY_TEXT_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ffvms::storage {
+
+/// @brief One record of a legacy text file
+struct LegacyTextRecord {
+    std::uint64_t name_hash = 0;
+    std::uint64_t data_hash = 0;
+    std::string payload;   ///< The doubles as little-endian f64s, i.e. a CipherId::FFT payload
+};
+
+/**
+ * @brief Single-pass parser over the bytes of a legacy text file
+ *
+ * Numbers are parsed in place with std::from_chars, and each payload is
+ * sized once from its block count before it is filled.
+ */
+class LegacyTextReader {
+private:
+    const char* begin_;
+    const char* pos_;
+    const char* end_;
+    bool ok_ = true;
+
+    void skip_space();
+    bool read_u64(std::uint64_t& value);
+    bool read_f64(double& value);
+
+public:
+    /// @param data File contents; must outlive the reader
+    LegacyTextReader(const char* data, std::size_t size);
+
+    /**
+     * @brief Parse the next record into @p record
+     * @return false at the end of the file or on a malformed record; ok() tells them apart
+     */
+    bool next(LegacyTextRecord& record);
+
+    bool ok() const { return ok_; }
+
+    /// @brief Bytes parsed so far
+    std::size_t position() const { return static_cast<std::size_t>(pos_ - begin_); }
+};
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_LEGACY_TEXT_FILE_H
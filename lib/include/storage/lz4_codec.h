@@ -0,0 +1,32 @@
+/**
+ * @file lz4_codec.h
+ * @brief In-tree LZ4 block codec
+ */
+
+#ifndef FFVMS_STORAGE_LZ4_CODEC_H
+#define FFVMS_STORAGE_LZ4_CODEC_H
+
+#include "storage/codec.h"
+
+namespace ffvms::storage {
+
+/**
+ * @brief LZ4 block format with a u64 little-endian size prefix
+ *
+ * Greedy single-probe matcher over a 64 KB window: fast on the way in
+ * and very fast on the way out, which suits a store whose reads dominate.
+ * The decoder checks every length and offset, so damaged input fails
+ * instead of reading or writing out of bounds.
+ */
+class Lz4Codec : public ICodec {
+public:
+    CodecId id() const override { return CodecId::LZ4; }
+    const char* name() const override { return "lz4"; }
+
+    void compress(std::string_view in, std::string& out) const override;
+    bool decompress(std::string_view in, std::string& out) const override;
+};
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_LZ4_CODEC_H
@@ -0,0 +1,67 @@
+/**
+ * @file mapped_file.h
+ * @brief Read-only memory mapping of a whole file
+ */
+
+#ifndef FFVMS_STORAGE_MAPPED_FILE_H
+#define FFVMS_STORAGE_MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+namespace ffvms::storage {
+
+/**
+ * @brief RAII read-only view of a file's contents
+ *
+ * Pages are brought in by the OS on first access, so opening a large file
+ * costs almost nothing until its bytes are actually touched.
+ */
+class MappedFile {
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+#ifdef _WIN32
+    void* file_handle_ = nullptr;
+    void* mapping_handle_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief Map @p path, replacing any previous mapping
+     * @return false if the file does not exist or cannot be mapped
+     */
+    bool open(const std::string& path);
+
+    /// @brief Drop the mapping; required on Windows before the file is replaced
+    void close();
+
+    /**
+     * @brief Drop the pages holding bytes [@p offset, @p offset + @p size) from the resident set
+     *
+     * For bytes that will not be read again soon, such as text already
+     * parsed or a record already decoded. The bytes stay readable and are
+     * faulted in again from the file if touched. Does nothing on Windows.
+     */
+    void release(std::size_t offset, std::size_t size);
+
+#ifdef _WIN32
+    bool is_open() const { return file_handle_ != nullptr; }
+#else
+    bool is_open() const { return fd_ >= 0; }
+#endif
+    const char* data() const { return data_; }
+    std::size_t size() const { return size_; }
+};
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_MAPPED_FILE_H
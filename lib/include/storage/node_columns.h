@@ -0,0 +1,148 @@
+/**
+ * @file node_columns.h
+ * @brief Columnar encoding of the version tree node table
+ *
+ * Node i of a table has label i. VersionManager keeps a node's label from
+ * one save to the next, so labels can point either way and a label whose
+ * node was deleted stays free (type FREE) until a new node takes it. A
+ * decoder creates every node before linking them.
+ *
+ * @code
+ * magic "FFVMTREE" | u32 version | varint node count
+ * then five columns, each varint byte size | bytes:
+ *   type          one byte per node
+ *   cnt           varint per node
+ *   link          zigzag varint of the difference from the previous node's link
+ *   next_brother  varint per node: 0 for none, else zigzag(node label - brother label)
+ *   first_son     as next_brother
+ * @endcode
+ *
+ * Version 1 tables, written before labels were kept, store
+ * node label - brother label unzigzagged and only point at smaller labels.
+ */
+
+#ifndef FFVMS_STORAGE_NODE_COLUMNS_H
+#define FFVMS_STORAGE_NODE_COLUMNS_H
+
+#include "core/cow.h"
+#include "storage/byte_io.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ffvms::storage {
+
+/**
+ * @brief One node of the table, with labels for its brother and son
+ */
+struct NodeColumn {
+    static constexpr std::uint64_t NONE = ~0ULL;
+    static constexpr std::uint8_t FREE = 0xff;   ///< Type of a label with no node
+
+    std::uint8_t type = 0;
+    std::uint32_t cnt = 0;
+    std::uint64_t link = 0;
+    std::uint64_t next_brother = NONE;
+    std::uint64_t first_son = NONE;
+};
+
+/**
+ * @brief Builds a node table one node at a time, in label order
+ *
+ * A node must not point at its own label.
+ */
+class NodeColumnsWriter {
+private:
+    std::string types_;
+    std::string counts_;
+    std::string links_;
+    std::string brothers_;
+    std::string sons_;
+    std::uint64_t nodes_ = 0;
+    std::uint64_t last_link_ = 0;
+
+public:
+    void reserve(std::size_t nodes);
+
+    /// @brief Append the node with the next label
+    void add(const NodeColumn& node);
+
+    std::uint64_t size() const { return nodes_; }
+
+    /// @brief Append the encoded table to @p out
+    void finish(std::string& out) const;
+};
+
+/**
+ * @brief Decodes a node table front to back
+ *
+ * open() checks the header and the column sizes; next() then yields the
+ * nodes in label order and fails on a reference to a label outside the
+ * table, or in a version 1 table to a label not smaller than the node's.
+ * It does not check that referenced labels are in use or that the links
+ * are free of cycles.
+ */
+class NodeColumnsReader {
+private:
+    std::uint32_t version_ = 0;
+    std::uint64_t nodes_ = 0;
+    std::uint64_t label_ = 0;
+    std::uint64_t last_link_ = 0;
+    const char* types_ = nullptr;
+    ByteReader counts_{nullptr, 0};
+    ByteReader links_{nullptr, 0};
+    ByteReader brothers_{nullptr, 0};
+    ByteReader sons_{nullptr, 0};
+
+    bool reference(ByteReader& column, std::uint64_t& label);
+
+public:
+    /// @brief True if @p bytes start like an encoded node table
+    static bool is_node_columns(std::string_view bytes);
+
+    /// @param bytes Encoded table; must outlive the reader
+    bool open(std::string_view bytes);
+
+    std::uint64_t size() const { return nodes_; }
+
+    /// @brief Decode the next node; false past the end or on malformed data
+    bool next(NodeColumn& node);
+};
+
+/**
+ * @brief Node table kept in memory between saves, indexed by label
+ *
+ * The columns are held in blocks that copies of the table share, so a
+ * copy handed to a writer costs a pointer per block, and a later set()
+ * copies only the block it changes while the writer still holds it.
+ */
+class NodeColumnTable {
+private:
+    static constexpr std::size_t BLOCK = 4096;
+
+    std::vector<ffvms::Cow<std::vector<NodeColumn>>> blocks_;
+    std::uint64_t size_ = 0;
+
+public:
+    std::uint64_t size() const { return size_; }
+
+    const NodeColumn& operator[](std::uint64_t label) const { return blocks_[label / BLOCK].get()[label % BLOCK]; }
+
+    void set(std::uint64_t label, const NodeColumn& node) { blocks_[label / BLOCK].edit()[label % BLOCK] = node; }
+
+    /// @brief Add a column with the next label
+    void push_back(const NodeColumn& node);
+
+    void clear() {
+        blocks_.clear();
+        size_ = 0;
+    }
+
+    /// @brief Append the encoded table to @p out
+    void encode(std::string& out) const;
+};
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_NODE_COLUMNS_H
@@ -0,0 +1,57 @@
+/**
+ * @file ntt_cipher.h
+ * @brief Number-theoretic transform as a record cipher
+ */
+
+#ifndef FFVMS_STORAGE_NTT_CIPHER_H
+#define FFVMS_STORAGE_NTT_CIPHER_H
+
+#include "core/thread_pool.h"
+#include "storage/record_cipher.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace ffvms::storage {
+
+/**
+ * @brief The FFT cipher's transform in exact integer arithmetic
+ *
+ * Payload: u64 plain size, then one block of little-endian u32 residues
+ * (see core/ntt.h) per block of input bytes, the last block zero-padded.
+ * That is 4 bytes per input byte against 16 for FftCipher. Blocks hold
+ * BLOCK_SIZE bytes; an input shorter than that is one block of the
+ * smallest power of two from MIN_BLOCK_SIZE up that fits it, so the plain
+ * size alone determines the layout.
+ * Decoding involves no rounding; a residue that does not transform back
+ * to a byte marks the payload as damaged. Like the FFT transform it hides
+ * content from a casual look only. Long payloads are transformed
+ * block-parallel on the given pool.
+ */
+class NttCipher : public IRecordCipher {
+private:
+    ThreadPool* pool_;
+
+public:
+    static constexpr std::size_t BLOCK_SIZE = 1024;
+    static constexpr std::size_t MIN_BLOCK_SIZE = 16;
+    static constexpr std::size_t BLOCK_BYTES = BLOCK_SIZE * 4;
+    static constexpr std::size_t HEADER_BYTES = 8;
+
+    explicit NttCipher(ThreadPool* pool = &ThreadPool::shared()) : pool_(pool) {}
+
+    CipherId id() const override { return CipherId::NTT; }
+    const char* name() const override { return "ntt"; }
+
+    void encrypt(std::string_view plain, std::string& payload) override;
+    bool decrypt(std::string_view payload, std::string& plain) override;
+
+    /// @brief Points per block for an input of @p plain_size bytes
+    static std::size_t block_size(std::uint64_t plain_size);
+
+    /// @brief Whether @p size bytes can be a payload of some input
+    static bool valid_payload_size(unsigned long long size);
+};
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_NTT_CIPHER_H
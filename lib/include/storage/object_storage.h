@@ -0,0 +1,126 @@
+/**
+ * @file object_storage.h
+ * @brief IStorage backend keeping tables as content-addressed object files
+ *
+ * Layout of the repository directory:
+ * @code
+ * MANIFEST            magic "FFVMSOBJ" | u32 version | u32 table count
+ *                     | per table: u32 name size | name | u64 rows
+ *                                  | u32 object count | 32-byte object ids
+ *                     | SHA-256 of everything before it
+ * objects/ab/cdef...  one object: u32 row count | rows (storage/table_rows.h)
+ * @endcode
+ * An object's id is the SHA-256 of its bytes; the first two hex digits
+ * name its fan-out directory, as in git's loose objects.
+ */
+
+#ifndef FFVMS_STORAGE_OBJECT_STORAGE_H
+#define FFVMS_STORAGE_OBJECT_STORAGE_H
+
+#include "core/thread_pool.h"
+#include "interfaces/i_logger.h"
+#include "interfaces/i_storage.h"
+#include "storage/async_io.h"
+#include "storage/sha256.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace ffvms::storage {
+
+/**
+ * @brief Settings for ObjectStorage
+ */
+struct ObjectStorageOptions {
+    /// Rows are grouped into objects of about this many bytes; a larger row gets its own object
+    std::size_t object_bytes = 64 * 1024;
+
+    /// fsync new objects and the manifest before each save returns
+    bool sync = true;
+
+    /// Pool writing and reading objects; nullptr uses ThreadPool::shared()
+    ffvms::ThreadPool* pool = nullptr;
+
+    /// How object files are read and written
+    IoBackend io = IoBackend::AUTO;
+};
+
+/**
+ * @brief Stores each table as a list of immutable, content-addressed objects
+ *
+ * Saving a table cuts its rows into objects, writes the ones the
+ * directory does not hold yet in parallel, then swaps in a new manifest
+ * with a rename, so a crash leaves either the old or the new version of
+ * every table. Objects are cut where a row's hash hits a fixed pattern
+ * (or at object_bytes), so inserting or changing a row only changes the
+ * objects around it; a save writes those and nothing else. Object files
+ * are read and written in batches through IAsyncIo, so a load parses
+ * objects while later ones are still being read.
+ *
+ * Because objects never change once written, copying the directory with
+ * rsync or similar only transfers new objects and the manifest. Objects
+ * no longer referenced stay on disk until remove_unreferenced().
+ *
+ * Rows are stored unencrypted. save() and load() are thread-safe.
+ */
+class ObjectStorage : public ffvms::IStorage {
+public:
+    struct Stats {
+        unsigned long long objects_written = 0;
+        unsigned long long objects_reused = 0;
+        unsigned long long bytes_written = 0;
+    };
+
+private:
+    struct Table {
+        std::uint64_t rows = 0;
+        std::vector<Sha256::Digest> objects;
+    };
+
+    std::string directory_;
+    ObjectStorageOptions options_;
+    std::map<std::string, Table> tables_;
+    std::set<Sha256::Digest> present_;   ///< Objects known to be on disk
+    Stats stats_;
+    bool open_ = false;
+    std::mutex mutex_;
+    std::unique_ptr<IAsyncIo> io_;
+    ffvms::ILogger* logger_ = nullptr;
+
+    ffvms::ILogger& get_logger_ref();
+    ffvms::ThreadPool& pool();
+    std::string object_path(const Sha256::Digest& id) const;
+    std::string manifest_path() const;
+
+    bool read_manifest();
+    bool write_manifest();
+    bool write_objects(const std::vector<std::pair<Sha256::Digest, std::string>>& objects);
+
+public:
+    ObjectStorage(ffvms::ILogger* logger, const std::string& directory,
+                  const ObjectStorageOptions& options = ObjectStorageOptions());
+
+    bool is_open() const { return open_; }
+
+    /// @brief Name of the I/O backend in use ("io_uring" or "threads")
+    const char* io_backend() const { return io_->name(); }
+
+    bool save(const std::string& name, const ffvms::DataTable& content) override;
+    bool load(const std::string& name, ffvms::DataTable& content,
+              bool mandatory_access = false) override;
+
+    /**
+     * @brief Delete objects no table refers to, and leftover temporary files
+     * @return Number of files removed
+     */
+    std::size_t remove_unreferenced();
+
+    Stats stats();
+};
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_OBJECT_STORAGE_H
@@ -0,0 +1,71 @@
+/**
+ * @file record_cipher.h
+ * @brief Ciphers that turn a record's bytes into its stored payload
+ *
+ * Every record stores the id of the cipher that wrote it, so a data file
+ * can hold records from several ciphers and migrate one save at a time.
+ */
+
+#ifndef FFVMS_STORAGE_RECORD_CIPHER_H
+#define FFVMS_STORAGE_RECORD_CIPHER_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace ffvms::storage {
+
+/// Cipher ids as stored on disk; never renumber
+enum class CipherId : std::uint16_t {
+    FFT = 0,        ///< Legacy FFT transform; every file before format version 3 uses it
+    IDENTITY = 1,   ///< Stores bytes as they are
+    CHACHA20 = 2,   ///< ChaCha20 stream cipher with a random nonce per record
+    FFT_PACKED = 3, ///< FFT transform with two bytes per point; half the size of FFT
+    NTT = 4         ///< Number-theoretic transform with u32 residues; a quarter the size of FFT
+};
+
+using CipherKey = std::array<std::uint8_t, 32>;
+
+/**
+ * @brief Reversible transform applied to a record before it is stored
+ *
+ * Instances may keep scratch state, so one instance must not be used by
+ * two threads at once.
+ */
+class IRecordCipher {
+public:
+    virtual ~IRecordCipher() = default;
+
+    virtual CipherId id() const = 0;
+    virtual const char* name() const = 0;
+
+    /// @brief Replace @p payload with the stored form of @p plain
+    virtual void encrypt(std::string_view plain, std::string& payload) = 0;
+
+    /**
+     * @brief Replace @p plain with the bytes @p payload was made from
+     * @return false if @p payload is malformed
+     */
+    virtual bool decrypt(std::string_view payload, std::string& plain) = 0;
+};
+
+/// @brief Create the cipher registered under @p id, or nullptr if unknown
+std::unique_ptr<IRecordCipher> make_cipher(CipherId id, const CipherKey& key);
+
+/// @brief Whether a payload of @p size bytes can have been written by cipher @p id
+bool is_valid_payload_size(CipherId id, unsigned long long size);
+
+/**
+ * @brief Derive a cipher key from a passphrase
+ *
+ * An empty passphrase yields a fixed key, which hides the content from a
+ * casual look at the file just as the FFT transform does, but is not
+ * protection against anyone who has the source.
+ */
+CipherKey derive_key(const std::string& passphrase);
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_RECORD_CIPHER_H
@@ -0,0 +1,250 @@
+/**
+ * @file record_schema.h
+ * @brief Compile-time field lists that generate a record's encoders and decoders
+ *
+ * A record struct names its fields once:
+ * @code
+ * struct NodeRow { std::uint64_t id = 0; std::string_view name; };
+ * constexpr auto NODE_SCHEMA = make_schema(field("id", &NodeRow::id),
+ *                                          field("name", &NodeRow::name));
+ * @endcode
+ * and the schema writes and reads it in two encodings:
+ *  - as a row of an IRecordWriter/IRecordReader table, one field per
+ *    member in declaration order, which is the DataTable layout every
+ *    existing table uses;
+ *  - as a binary record: varint payload size, then per field a varint
+ *    (integers) or varint size | bytes (strings).
+ *
+ * Fields are unsigned integers, std::string or std::string_view. A
+ * string_view member reads as a view into the reader's buffer, so a row of
+ * views decodes without allocating.
+ *
+ * A field added after the first version of a table gives the schema
+ * version that introduced it and goes after all existing fields. Rows
+ * written before it existed then read with the member's default value,
+ * and readers built before it existed skip it.
+ */
+
+#ifndef FFVMS_STORAGE_RECORD_SCHEMA_H
+#define FFVMS_STORAGE_RECORD_SCHEMA_H
+
+#include "interfaces/i_record_stream.h"
+#include "storage/byte_io.h"
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace ffvms::storage {
+
+template <typename T>
+constexpr bool is_schema_integer = std::is_integral_v<T> && std::is_unsigned_v<T> && !std::is_same_v<T, bool>;
+
+template <typename T>
+constexpr bool is_schema_string = std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>;
+
+/**
+ * @brief One member of a record
+ */
+template <typename Record, typename T>
+struct Field {
+    static_assert(is_schema_integer<T> || is_schema_string<T>,
+                  "Schema fields are unsigned integers, std::string or std::string_view");
+
+    const char* name;
+    T Record::*member;
+    std::uint32_t since;   ///< Schema version that added the field; 1 for the original fields
+};
+
+template <typename Record, typename T>
+constexpr Field<Record, T> field(const char* name, T Record::*member, std::uint32_t since = 1) {
+    return {name, member, since};
+}
+
+/**
+ * @brief An ordered list of fields of @p Record
+ *
+ * Build one with make_schema() as a constexpr constant; every call below
+ * expands to straight-line code over the members.
+ */
+template <typename Record, typename... T>
+class Schema {
+private:
+    std::tuple<Field<Record, T>...> fields_;
+
+    using Indices = std::index_sequence_for<T...>;
+
+    template <typename U>
+    static void write_field(ffvms::IRecordWriter& out, const U& value) {
+        if constexpr (is_schema_integer<U>) {
+            out.u64(value);
+        } else {
+            out.str(value);
+        }
+    }
+
+    template <typename U>
+    static bool read_field(ffvms::IRecordReader& in, U& value) {
+        if constexpr (is_schema_integer<U>) {
+            std::uint64_t v;
+            if (!in.u64(v) || v > std::numeric_limits<U>::max()) return false;
+            value = static_cast<U>(v);
+            return true;
+        } else {
+            std::string_view v;
+            if (!in.str(v)) return false;
+            value = v;
+            return true;
+        }
+    }
+
+    template <typename U>
+    static std::size_t binary_size(const U& value) {
+        if constexpr (is_schema_integer<U>) {
+            return varint_size(value);
+        } else {
+            return varint_size(value.size()) + value.size();
+        }
+    }
+
+    template <typename U>
+    static void write_binary_field(std::string& out, const U& value) {
+        if constexpr (is_schema_integer<U>) {
+            put_varint(out, value);
+        } else {
+            put_varint(out, value.size());
+            out.append(value.data(), value.size());
+        }
+    }
+
+    template <typename U>
+    static bool read_binary_field(ByteReader& in, U& value) {
+        if constexpr (is_schema_integer<U>) {
+            std::uint64_t v = in.varint();
+            if (!in.ok() || v > std::numeric_limits<U>::max()) return false;
+            value = static_cast<U>(v);
+            return true;
+        } else {
+            std::uint64_t size = in.varint();
+            const char* data = in.position();
+            if (!in.ok() || !in.skip(size)) return false;
+            value = std::string_view(data, size);
+            return true;
+        }
+    }
+
+    template <std::size_t... I>
+    void write_row(ffvms::IRecordWriter& out, const Record& record, std::index_sequence<I...>) const {
+        (write_field(out, record.*std::get<I>(fields_).member), ...);
+    }
+
+    template <std::size_t... I>
+    bool read_row(ffvms::IRecordReader& in, std::size_t count, Record& record, std::index_sequence<I...>) const {
+        return ((I >= count || read_field(in, record.*std::get<I>(fields_).member)) && ...);
+    }
+
+    template <std::size_t... I>
+    void write_record(std::string& out, const Record& record, std::index_sequence<I...>) const {
+        put_varint(out, (binary_size(record.*std::get<I>(fields_).member) + ...));
+        (write_binary_field(out, record.*std::get<I>(fields_).member), ...);
+    }
+
+    template <std::size_t... I>
+    bool read_record(ByteReader& in, Record& record, std::index_sequence<I...>) const {
+        return (((I >= required() && in.remaining() == 0) ||
+                 read_binary_field(in, record.*std::get<I>(fields_).member)) && ...);
+    }
+
+public:
+    static constexpr std::size_t size = sizeof...(T);
+
+    constexpr explicit Schema(Field<Record, T>... fields) : fields_(fields...) {}
+
+    /// @brief Fields every row must have: those of the first version
+    constexpr std::size_t required() const {
+        std::size_t n = 0;
+        std::apply([&](const auto&... f) { ((n += f.since <= 1), ...); }, fields_);
+        return n;
+    }
+
+    /// @brief Newest version among the fields
+    constexpr std::uint32_t version() const {
+        std::uint32_t v = 1;
+        std::apply([&](const auto&... f) { ((v = f.since > v ? f.since : v), ...); }, fields_);
+        return v;
+    }
+
+    /// @brief True if fields appear in the order they were added, so old rows are a prefix
+    constexpr bool valid() const {
+        bool ok = true;
+        std::uint32_t last = 1;
+        std::apply([&](const auto&... f) { ((ok = ok && f.since >= last, last = f.since), ...); }, fields_);
+        return ok;
+    }
+
+    template <std::size_t I>
+    constexpr const char* name() const { return std::get<I>(fields_).name; }
+
+    /// @brief Write @p record as one row: begin_row() and every field
+    void write(ffvms::IRecordWriter& out, const Record& record) const {
+        out.begin_row(size);
+        write_row(out, record, Indices());
+    }
+
+    /**
+     * @brief Read the row next_row() just reported @p count fields for
+     *
+     * Fields the row does not have keep their value in @p record; fields
+     * past the schema are left for next_row() to skip.
+     * @return false if the row lacks a required field or a field does not convert
+     */
+    bool read(ffvms::IRecordReader& in, std::size_t count, Record& record) const {
+        return count >= required() && read_row(in, count, record, Indices());
+    }
+
+    /**
+     * @brief Read every remaining row into a default-constructed Record and hand it to @p fn
+     * @param fn bool(Record&); returning false stops and fails the read
+     */
+    template <typename Fn>
+    bool read_table(ffvms::IRecordReader& in, Fn&& fn) const {
+        std::size_t count;
+        while (in.next_row(count)) {
+            Record record{};
+            if (!read(in, count, record) || !fn(record)) return false;
+        }
+        return in.ok();
+    }
+
+    /// @brief Append @p record in the binary encoding
+    void write_binary(std::string& out, const Record& record) const {
+        write_record(out, record, Indices());
+    }
+
+    /**
+     * @brief Decode one binary record at the cursor
+     *
+     * string_view members point into the reader's buffer. Fields missing
+     * from an older record keep their value in @p record; bytes of newer
+     * fields are skipped.
+     */
+    bool read_binary(ByteReader& in, Record& record) const {
+        std::uint64_t payload = in.varint();
+        const char* data = in.position();
+        if (!in.ok() || !in.skip(payload)) return false;
+        ByteReader fields(data, payload);
+        return read_record(fields, record, Indices());
+    }
+};
+
+template <typename Record, typename... T>
+constexpr Schema<Record, T...> make_schema(Field<Record, T>... fields) {
+    return Schema<Record, T...>(fields...);
+}
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_RECORD_SCHEMA_H
@@ -0,0 +1,52 @@
+/**
+ * @file sha256.h
+ * @brief SHA-256 digest used to key content chunks
+ */
+
+#ifndef FFVMS_STORAGE_SHA256_H
+#define FFVMS_STORAGE_SHA256_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace ffvms::storage {
+
+/**
+ * @brief Incremental SHA-256 (FIPS 180-4)
+ */
+class Sha256 {
+public:
+    using Digest = std::array<std::uint8_t, 32>;
+
+    Sha256();
+
+    void update(const void* data, std::size_t size);
+    Digest finish();
+
+    /// @brief Digest of a whole buffer in one call
+    static Digest hash(const void* data, std::size_t size);
+
+private:
+    std::uint32_t state_[8];
+    std::uint8_t buffer_[64];
+    std::size_t buffered_ = 0;
+    std::uint64_t total_ = 0;
+
+    void compress(const std::uint8_t* block);
+};
+
+/// @brief Lower-case hexadecimal form of a digest
+std::string to_hex(const Sha256::Digest& digest);
+
+/// @brief Write the 64 characters of to_hex() to @p out, without allocating
+void to_hex(const Sha256::Digest& digest, char* out);
+
+/// @brief Parse the form produced by to_hex()
+bool from_hex(std::string_view hex, Sha256::Digest& digest);
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_SHA256_H
@@ -0,0 +1,25 @@
+/**
+ * @file table_rows.h
+ * @brief Length-prefixed row encoding shared by the per-row storage backends
+ *
+ * A row is stored as u32 cell count, then u32 length | bytes per cell.
+ */
+
+#ifndef FFVMS_STORAGE_TABLE_ROWS_H
+#define FFVMS_STORAGE_TABLE_ROWS_H
+
+#include "storage/byte_io.h"
+#include <string>
+#include <vector>
+
+namespace ffvms::storage {
+
+/// @brief Append the encoding of @p row to @p out
+void append_row(std::string& out, const std::vector<std::string>& row);
+
+/// @brief Decode one row at the cursor; false if the bytes are malformed
+bool read_row(ByteReader& in, std::vector<std::string>& row);
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_TABLE_ROWS_H
@@ -0,0 +1,72 @@
+/**
+ * @file table_text.h
+ * @brief The table serialization that Saver records hold
+ *
+ * @code
+ * <rows> then per row " <fields>" then per field " <size> <bytes>"
+ * @endcode
+ * Counts and sizes are decimal; a u64 field's bytes are its decimal
+ * digits. The record's data hash covers exactly these bytes.
+ */
+
+#ifndef FFVMS_STORAGE_TABLE_TEXT_H
+#define FFVMS_STORAGE_TABLE_TEXT_H
+
+#include "interfaces/i_record_stream.h"
+#include <string>
+#include <string_view>
+
+namespace ffvms::storage {
+
+/**
+ * @brief Appends a table to a string, with no per-field allocation
+ */
+class TextTableWriter : public ffvms::IRecordWriter {
+private:
+    std::string& out_;
+
+    void number(std::uint64_t value);
+    void field(const char* data, std::size_t size);
+
+public:
+    explicit TextTableWriter(std::string& out) : out_(out) {}
+
+    void begin_table(std::size_t rows) override;
+    void begin_row(std::size_t fields) override;
+    void u64(std::uint64_t value) override;
+    void str(std::string_view value) override { field(value.data(), value.size()); }
+    void bytes(const void* data, std::size_t size) override { field(static_cast<const char*>(data), size); }
+};
+
+/**
+ * @brief Reads a table in one forward pass over its text
+ *
+ * Fields are returned as views into @p text, which must outlive the
+ * reader. Fields a caller does not read are skipped by next_row().
+ */
+class TextTableReader : public ffvms::IRecordReader {
+private:
+    std::string_view text_;
+    std::size_t pos_ = 0;
+    std::size_t rows_ = 0;
+    std::size_t rows_left_ = 0;
+    std::size_t fields_left_ = 0;
+    bool ok_ = true;
+
+    bool number(std::uint64_t& value);
+    bool field(std::string_view& value);
+
+public:
+    explicit TextTableReader(std::string_view text);
+
+    std::size_t rows() const override { return rows_; }
+    bool next_row(std::size_t& fields) override;
+    bool u64(std::uint64_t& value) override;
+    bool str(std::string_view& value) override { return field(value); }
+    bool bytes(std::string_view& value) override { return field(value); }
+    bool ok() const override { return ok_; }
+};
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_TABLE_TEXT_H
@@ -0,0 +1,23 @@
+/**
+ * @file xxhash64.h
+ * @brief xxHash64 content hash
+ *
+ * A fast 64-bit non-cryptographic hash with good dispersion. Saver keys its
+ * "table unchanged" check on it, where a collision would silently drop a
+ * save, so the 32-bit CRCs used for damage checks are not enough.
+ */
+
+#ifndef FFVMS_STORAGE_XXHASH64_H
+#define FFVMS_STORAGE_XXHASH64_H
+
+#include <cstdint>
+#include <string_view>
+
+namespace ffvms::storage {
+
+/// @brief xxHash64 of @p data, matching the reference implementation
+std::uint64_t xxhash64(std::string_view data, std::uint64_t seed = 0);
+
+}  // namespace ffvms::storage
+
+#endif // FFVMS_STORAGE_XXHASH64_H
@@ -11,6 +11,7 @@
 #ifndef TERMINAL_H
 #define TERMINAL_H
 
+#include "checkpointer.h"
 #include "command_interpreter.h"
 #include "command_registry.h"
 #include "file_system.h"
@@ -26,12 +27,14 @@ private:
   CommandInterpreter interpreter_;
   ffvms::CommandRegistry registry_;
   ffvms::ILogger *logger_ = nullptr;
+  ffvms::Checkpointer checkpointer_; ///< Declared last so it stops before anything it saves
 
   ffvms::ILogger &get_logger_ref();
   void register_commands();
 
 public:
-  Terminal();
+  explicit Terminal(
+      const ffvms::CheckpointOptions &checkpoint = ffvms::CheckpointOptions());
   int run();
 };
 
@@ -13,11 +13,15 @@
 
 #include "bs_tree.h"
 #include "bs_tree.h"
+#include "interfaces/i_checkpointable.h"
 #include "interfaces/i_node_manager.h"
 #include "interfaces/i_logger.h"
 #include "interfaces/i_storage.h"
 #include "saver.h" // Needed for default constructor in cpp, or forward declare? Keep it for now.
+#include "storage/node_columns.h"
 #include <string>
+#include <string_view>
+#include <unordered_set>
 #include <vector>
 #include <map>
 
@@ -32,7 +36,7 @@ struct versionNode {
     versionNode(std::string info, treeNode* p) : info(info), p(p) {}
 };
 
-class VersionManager {
+class VersionManager : public ffvms::ICheckpointable {
 private:
     std::map<unsigned long long, versionNode> version;
     ffvms::INodeManager* node_manager_ = nullptr;
@@ -46,16 +50,33 @@ private:
     static constexpr unsigned long long NULL_NODE = 0x3f3f3f3f3f3fULL;
     std::string DATA_TREENODE_INFO = "VersionManager::DATA_TREENODE_INFO";
     std::string DATA_VERSION_INFO = "VersionManager::DATA_VERSION_INFO";
+    bool dirty_ = true;     ///< Tree or version tables differ from the stored copy
+    unsigned long long changed_bytes_ = 0;
+    static constexpr unsigned long long ROW_BYTES = 48;    ///< Rough size of one tree node row, for changed_bytes()
+
+    // A node keeps its label (treeNode::save_label) from one capture to the next, so a capture
+    // only encodes nodes that have none yet and nodes changed in place since the last one
+    ffvms::storage::NodeColumnTable columns_;   ///< Column of every label as of the last capture
+    std::vector<std::uint64_t> free_labels_;    ///< Labels of deleted nodes, given out before new ones
+    std::unordered_set<treeNode*> changed_;     ///< Labelled nodes changed since the last capture
 
     bool load();
     bool save();
-    void dfs(treeNode* cur, std::map<treeNode*, unsigned long long>& label);
+    /// Create the nodes of a columnar tree table; nodes[label] is the node with that label, null if free
+    static bool read_node_columns(std::string_view bytes, std::vector<treeNode*>& nodes,
+                                  ffvms::storage::NodeColumnTable& columns);
+    /// Label the loaded nodes the versions reach and delete the rest; false if the links form a cycle
+    bool adopt_nodes(std::vector<treeNode*>& nodes);
+    std::uint64_t take_label();
+    /// Create the nodes of a row-per-node tree table whose first row has @p fields fields
+    static bool read_legacy_nodes(ffvms::IRecordReader& in, std::size_t fields,
+                                  std::map<unsigned long long, treeNode*>& label_to_ptr);
     bool recursive_increase_counter(treeNode* p, bool modify_brother = false);
 
 public:
     VersionManager();
     VersionManager(ffvms::ILogger* logger, ffvms::INodeManager* node_manager, ffvms::IStorage* storage);
-    ~VersionManager();
+    ~VersionManager() override;
     bool init_version(treeNode* p, treeNode* vp);
     bool create_version(unsigned long long model_version = NO_MODEL_VERSION, std::string info = "");
     bool version_exist(unsigned long long id);
@@ -63,6 +84,22 @@ public:
     bool get_latest_version(unsigned long long& id);
     bool get_version_log(std::vector<std::pair<unsigned long long, versionNode>>& version_log);
     bool empty();
+
+    /// Record that a version tree was edited, so both tables are written on save
+    void mark_tree_dirty() {
+        dirty_ = true;
+        changed_bytes_ += ROW_BYTES;
+    }
+    /// Record that @p p changed in place (its count or links), so the next capture encodes it again
+    void mark_node_changed(treeNode* p);
+    /// Record that @p p is about to be deleted, freeing its label
+    void mark_node_deleted(treeNode* p);
+    bool dirty() const { return dirty_; }
+
+    // ICheckpointable interface implementation
+    unsigned long long changed_bytes() const override { return changed_bytes_; }
+    void capture(std::vector<ffvms::TableWrite>& writes) override;
+    void capture_failed() override { dirty_ = true; }
 };
 
 #endif // VERSION_MANAGER_H
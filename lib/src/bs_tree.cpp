@@ -34,6 +34,19 @@ treeNode::treeNode(TYPE type) {
   }
 }
 
+treeNode::treeNode(const treeNode &other)
+    : type(other.type), cnt(other.cnt), link(other.link),
+      next_brother(other.next_brother), first_son(other.first_son) {}
+
+treeNode &treeNode::operator=(const treeNode &other) {
+  type = other.type;
+  cnt = other.cnt;
+  link = other.link;
+  next_brother = other.next_brother;
+  first_son = other.first_son;
+  return *this;
+}
+
 // BSTree helper methods
 ffvms::ILogger &BSTree::get_logger_ref() {
   if (logger_)
@@ -0,0 +1,145 @@
+/**
+ * @file checkpointer.cpp
+ * @brief Implementation of the background checkpoint thread
+ */
+
+#include "checkpointer.h"
+#include "logger.h"
+#include <cstdio>
+#include <string>
+
+namespace ffvms {
+
+namespace {
+
+std::chrono::microseconds since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+}
+
+std::string milliseconds(std::chrono::microseconds us) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.2f ms", us.count() / 1000.0);
+    return buf;
+}
+
+}  // namespace
+
+Checkpointer::Checkpointer(IStorage* storage, ILogger* logger, const CheckpointOptions& options)
+    : storage_(storage), logger_(logger), options_(options),
+      last_checkpoint_(std::chrono::steady_clock::now()) {}
+
+Checkpointer::~Checkpointer() {
+    stop();
+}
+
+void Checkpointer::add_source(ICheckpointable* source) {
+    sources_.push_back(source);
+}
+
+void Checkpointer::start() {
+    if (thread_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = false;
+    }
+    thread_ = std::thread(&Checkpointer::run, this);
+}
+
+void Checkpointer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+void Checkpointer::poke() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        poked_ = true;
+    }
+    wake_.notify_all();
+}
+
+bool Checkpointer::checkpoint_now() {
+    return checkpoint(true);
+}
+
+CheckpointStats Checkpointer::stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void Checkpointer::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        wake_.wait_for(lock, options_.interval, [this]() { return stopping_ || poked_; });
+        if (stopping_) break;
+        poked_ = false;
+        lock.unlock();
+        checkpoint(false);
+        lock.lock();
+    }
+}
+
+bool Checkpointer::checkpoint(bool force) {
+    std::lock_guard<std::mutex> order(write_mutex_);
+    std::vector<TableWrite> writes;
+    unsigned long long changed = 0;
+    auto capture_start = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> state(state_mutex_);
+        for (auto* source : sources_) changed += source->changed_bytes();
+        bool due;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            due = capture_start - last_checkpoint_ >= options_.interval;
+        }
+        if (!force && changed < options_.bytes_threshold && !(due && changed > 0)) return true;
+        for (auto* source : sources_) source->capture(writes);
+    }
+    if (writes.empty()) return true;
+    auto capture_time = since(capture_start);
+
+    // The state lock is released: tables are built, encrypted and written while commands run
+    auto write_start = std::chrono::steady_clock::now();
+    bool ok = true;
+    for (auto& write : writes) {
+        if (!write.write_to(*storage_)) {
+            ok = false;
+            break;
+        }
+    }
+    auto write_time = since(write_start);
+
+    {
+        std::lock_guard<std::mutex> state(state_mutex_);
+        if (!ok) {
+            for (auto* source : sources_) source->capture_failed();
+        }
+        ILogger& logger = logger_ ? *logger_ : Logger::get_logger();
+        if (ok) {
+            logger.log("Checkpoint wrote " + std::to_string(writes.size()) + " tables (" +
+                       std::to_string(changed) + " bytes changed) in " + milliseconds(write_time) +
+                       ", capture " + milliseconds(capture_time) + ".", LogLevel::INFO, __LINE__);
+        } else {
+            logger.log("Checkpoint failed; the changes will be saved again.", LogLevel::WARNING, __LINE__);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    last_checkpoint_ = std::chrono::steady_clock::now();
+    stats_.last_bytes = changed;
+    stats_.last_capture = capture_time;
+    stats_.last_write = write_time;
+    stats_.total_write += write_time;
+    if (ok) {
+        stats_.checkpoints++;
+    } else {
+        stats_.failures++;
+    }
+    return ok;
+}
+
+}  // namespace ffvms
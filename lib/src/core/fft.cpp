@@ -0,0 +1,261 @@
+/**
+ * @file fft.cpp
+ * @brief FFT plans and butterfly kernels
+ */
+
+#include "core/fft.h"
+
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FFVMS_FFT_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(FFVMS_FFT_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FFVMS_FFT_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace ffvms {
+
+namespace {
+
+using Kernel = void (*)(double* a, std::size_t n, const double* tw);
+
+// Each implementation is a template over the size type: std::size_t for
+// the generic kernel, std::integral_constant for the block sizes the
+// ciphers use (16 to 1024 points), whose loop bounds are then known at
+// compile time.
+
+#ifndef FFVMS_FFT_SSE2
+
+struct ScalarButterflies {
+    static constexpr const char* NAME = "scalar";
+
+    template <class Size>
+    static void run(double* a, Size n, const double* tw) {
+        for (std::size_t h = 1; h < n; h <<= 1) {
+            const double* w = tw + 2 * h;
+            for (std::size_t k = 0; k < n; k += 2 * h) {
+                double* x = a + 2 * k;
+                double* y = x + 2 * h;
+                for (std::size_t j = 0; j < 2 * h; j += 2) {
+                    double tr = w[j] * y[j] - w[j + 1] * y[j + 1];
+                    double ti = w[j + 1] * y[j] + w[j] * y[j + 1];
+                    y[j] = x[j] - tr;
+                    y[j + 1] = x[j + 1] - ti;
+                    x[j] += tr;
+                    x[j + 1] += ti;
+                }
+            }
+        }
+    }
+};
+
+#else
+
+/// (wr*yr - wi*yi, wi*yr + wr*yi) for one complex per register
+inline __m128d cmul_sse2(__m128d w, __m128d y) {
+    __m128d re = _mm_mul_pd(w, _mm_unpacklo_pd(y, y));
+    __m128d im = _mm_mul_pd(_mm_shuffle_pd(w, w, 1), _mm_unpackhi_pd(y, y));
+    return _mm_add_pd(re, _mm_xor_pd(im, _mm_set_pd(0.0, -0.0)));
+}
+
+struct Sse2Butterflies {
+    static constexpr const char* NAME = "sse2";
+
+    template <class Size>
+    static void run(double* a, Size n, const double* tw) {
+        for (std::size_t h = 1; h < n; h <<= 1) {
+            const double* w = tw + 2 * h;
+            for (std::size_t k = 0; k < n; k += 2 * h) {
+                double* x = a + 2 * k;
+                double* y = x + 2 * h;
+                for (std::size_t j = 0; j < 2 * h; j += 2) {
+                    __m128d t = cmul_sse2(_mm_loadu_pd(w + j), _mm_loadu_pd(y + j));
+                    __m128d u = _mm_loadu_pd(x + j);
+                    _mm_storeu_pd(x + j, _mm_add_pd(u, t));
+                    _mm_storeu_pd(y + j, _mm_sub_pd(u, t));
+                }
+            }
+        }
+    }
+};
+
+#endif
+
+#ifdef FFVMS_FFT_AVX2
+
+/// Two complex values per register from the stage with h = 2 on
+struct Avx2Butterflies {
+    static constexpr const char* NAME = "avx2";
+
+    template <class Size>
+    __attribute__((target("avx2"))) static void run(double* a, Size n, const double* tw) {
+        if (n < 4) {
+            Sse2Butterflies::run(a, n, tw);
+            return;
+        }
+        // h = 1 has one butterfly per group, too narrow for a 256-bit register
+        for (std::size_t k = 0; k < n; k += 2) {
+            __m128d t = cmul_sse2(_mm_loadu_pd(tw + 2), _mm_loadu_pd(a + 2 * k + 2));
+            __m128d u = _mm_loadu_pd(a + 2 * k);
+            _mm_storeu_pd(a + 2 * k, _mm_add_pd(u, t));
+            _mm_storeu_pd(a + 2 * k + 2, _mm_sub_pd(u, t));
+        }
+        for (std::size_t h = 2; h < n; h <<= 1) {
+            const double* w = tw + 2 * h;
+            for (std::size_t k = 0; k < n; k += 2 * h) {
+                double* x = a + 2 * k;
+                double* y = x + 2 * h;
+                for (std::size_t j = 0; j < 2 * h; j += 4) {
+                    __m256d wv = _mm256_loadu_pd(w + j);
+                    __m256d yv = _mm256_loadu_pd(y + j);
+                    __m256d re = _mm256_mul_pd(wv, _mm256_movedup_pd(yv));
+                    __m256d im = _mm256_mul_pd(_mm256_permute_pd(wv, 0x5), _mm256_permute_pd(yv, 0xf));
+                    __m256d t = _mm256_addsub_pd(re, im);
+                    __m256d u = _mm256_loadu_pd(x + j);
+                    _mm256_storeu_pd(x + j, _mm256_add_pd(u, t));
+                    _mm256_storeu_pd(y + j, _mm256_sub_pd(u, t));
+                }
+            }
+        }
+    }
+};
+
+#endif
+
+template <class Butterflies, std::size_t N>
+void fixed_size(double* a, std::size_t, const double* tw) {
+    Butterflies::run(a, std::integral_constant<std::size_t, N>(), tw);
+}
+
+template <class Butterflies>
+void any_size(double* a, std::size_t n, const double* tw) {
+    Butterflies::run(a, n, tw);
+}
+
+template <class Butterflies>
+Kernel select(std::size_t n) {
+    switch (n) {
+        case 16: return fixed_size<Butterflies, 16>;
+        case 32: return fixed_size<Butterflies, 32>;
+        case 64: return fixed_size<Butterflies, 64>;
+        case 128: return fixed_size<Butterflies, 128>;
+        case 256: return fixed_size<Butterflies, 256>;
+        case 512: return fixed_size<Butterflies, 512>;
+        case 1024: return fixed_size<Butterflies, 1024>;
+        default: return any_size<Butterflies>;
+    }
+}
+
+struct Isa {
+    Kernel (*select)(std::size_t n);
+    const char* name;
+};
+
+template <class Butterflies>
+Isa isa() {
+    return {select<Butterflies>, Butterflies::NAME};
+}
+
+Isa choose_isa() {
+#ifdef FFVMS_FFT_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return isa<Avx2Butterflies>();
+#endif
+#ifdef FFVMS_FFT_SSE2
+    return isa<Sse2Butterflies>();
+#else
+    return isa<ScalarButterflies>();
+#endif
+}
+
+const Isa& machine_isa() {
+    static const Isa chosen = choose_isa();
+    return chosen;
+}
+
+}  // namespace
+
+FftPlan::FftPlan(std::size_t n)
+    : n_(n), bitrev_(n), forward_(2 * n), inverse_(2 * n), kernel_(machine_isa().select(n)) {
+    const double pi = std::acos(-1.0);
+    int bits = 0;
+    while ((std::size_t(1) << bits) < n) bits++;
+    for (std::size_t i = 0; i < n; i++) {
+        std::uint32_t r = 0;
+        for (int b = 0; b < bits; b++) r |= ((i >> b) & 1u) << (bits - 1 - b);
+        bitrev_[i] = r;
+    }
+    for (std::size_t h = 1; h < n; h <<= 1) {
+        for (std::size_t j = 0; j < h; j++) {
+            double angle = pi * static_cast<double>(j) / static_cast<double>(h);
+            double c = std::cos(angle), s = std::sin(angle);
+            forward_[2 * (h + j)] = inverse_[2 * (h + j)] = c;
+            forward_[2 * (h + j) + 1] = s;
+            inverse_[2 * (h + j) + 1] = -s;
+        }
+    }
+}
+
+void FftPlan::transform(double* data, int sign) const {
+    for (std::size_t i = 0; i < n_; i++) {
+        std::size_t j = bitrev_[i];
+        if (i < j) {
+            std::swap(data[2 * i], data[2 * j]);
+            std::swap(data[2 * i + 1], data[2 * j + 1]);
+        }
+    }
+    kernel_(data, n_, sign >= 0 ? forward_.data() : inverse_.data());
+}
+
+const FftPlan& FftPlan::get(std::size_t n) {
+    static std::mutex mutex;
+    static std::map<std::size_t, std::unique_ptr<FftPlan>> plans;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& plan = plans[n];
+    if (!plan) plan = std::make_unique<FftPlan>(n);
+    return *plan;
+}
+
+const char* FftPlan::kernel_name() {
+    return machine_isa().name;
+}
+
+void fft_recursive(double* a, double* buf, std::size_t n, int sign) {
+    const static double Pi = std::acos(-1.0);
+    if (n == 1) return;
+    std::size_t m = n >> 1;
+    for (std::size_t i = 0; i < m; i++) {
+        buf[2 * i] = a[4 * i];
+        buf[2 * i + 1] = a[4 * i + 1];
+        buf[2 * (i + m)] = a[4 * i + 2];
+        buf[2 * (i + m) + 1] = a[4 * i + 3];
+    }
+    std::memcpy(a, buf, sizeof(double) * 2 * n);
+    fft_recursive(a, buf, m, sign);
+    fft_recursive(a + 2 * m, buf, m, sign);
+    double wr = 1, wi = 0, ur = std::cos(2 * Pi / n), ui = sign * std::sin(2 * Pi / n);
+    for (std::size_t i = 0; i < m; i++) {
+        double yr = a[2 * (m + i)], yi = a[2 * (m + i) + 1];
+        double tr = wr * yr - wi * yi, ti = wr * yi + wi * yr;
+        double nr = wr * ur - wi * ui, ni = wr * ui + wi * ur;
+        wr = nr;
+        wi = ni;
+        buf[2 * i] = a[2 * i] + tr;
+        buf[2 * i + 1] = a[2 * i + 1] + ti;
+        buf[2 * (i + m)] = a[2 * i] - tr;
+        buf[2 * (i + m) + 1] = a[2 * i + 1] - ti;
+    }
+    std::memcpy(a, buf, sizeof(double) * 2 * n);
+}
+
+}  // namespace ffvms
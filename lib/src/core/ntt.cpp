@@ -0,0 +1,206 @@
+/**
+ * @file ntt.cpp
+ * @brief NTT plans and butterflies
+ */
+
+#include "core/ntt.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#endif
+
+namespace ffvms {
+
+namespace {
+
+constexpr std::uint32_t P = NttPlan::MODULUS;
+
+std::uint32_t pow_mod(std::uint64_t base, std::uint64_t exp) {
+    std::uint64_t result = 1;
+    base %= P;
+    for (; exp; exp >>= 1) {
+        if (exp & 1) result = result * base % P;
+        base = base * base % P;
+    }
+    return static_cast<std::uint32_t>(result);
+}
+
+/// floor(w * 2^32 / P), the precomputed quotient for Shoup multiplication
+std::uint32_t shoup(std::uint32_t w) {
+    return static_cast<std::uint32_t>((static_cast<std::uint64_t>(w) << 32) / P);
+}
+
+/// a * w mod P for a < P, using ws = shoup(w)
+inline std::uint32_t mul_shoup(std::uint32_t a, std::uint32_t w, std::uint32_t ws) {
+    std::uint32_t q = static_cast<std::uint32_t>((static_cast<std::uint64_t>(a) * ws) >> 32);
+    // Exact modulo 2^32, and the true value is below 2P
+    std::uint32_t r = a * w - q * P;
+    return r >= P ? r - P : r;
+}
+
+using Kernel = void (*)(std::uint32_t* a, std::size_t n, const std::uint32_t* w, const std::uint32_t* ws);
+
+// As in fft.cpp, each implementation is a template over the size type so
+// the block sizes the ciphers use get their own compile-time instantiation.
+
+struct ScalarButterflies {
+    /// The stages whose half-size is below @p h_end
+    template <class Size>
+    static void stages(std::uint32_t* a, Size n, const std::uint32_t* w, const std::uint32_t* ws,
+                       std::size_t h_end) {
+        for (std::size_t h = 1; h < n && h < h_end; h <<= 1) {
+            const std::uint32_t* wh = w + h;
+            const std::uint32_t* wsh = ws + h;
+            for (std::size_t k = 0; k < n; k += 2 * h) {
+                std::uint32_t* x = a + k;
+                std::uint32_t* y = x + h;
+                for (std::size_t j = 0; j < h; j++) {
+                    std::uint32_t t = mul_shoup(y[j], wh[j], wsh[j]);
+                    std::uint32_t u = x[j];
+                    std::uint32_t sum = u + t, diff = u + P - t;
+                    x[j] = sum >= P ? sum - P : sum;
+                    y[j] = diff >= P ? diff - P : diff;
+                }
+            }
+        }
+    }
+
+    template <class Size>
+    static void run(std::uint32_t* a, Size n, const std::uint32_t* w, const std::uint32_t* ws) {
+        stages(a, n, w, ws, n);
+    }
+};
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FFVMS_NTT_AVX2 1
+
+/// v - P where that does not wrap, v otherwise; valid for v < 2P
+__attribute__((target("avx2"))) inline __m256i reduce_once(__m256i v, __m256i p) {
+    return _mm256_min_epu32(v, _mm256_sub_epi32(v, p));
+}
+
+struct Avx2Butterflies {
+    template <class Size>
+    __attribute__((target("avx2"))) static void run(std::uint32_t* a, Size n, const std::uint32_t* w,
+                                                    const std::uint32_t* ws) {
+        // Stages narrower than a register stay scalar
+        ScalarButterflies::stages(a, n, w, ws, 8);
+        const __m256i p = _mm256_set1_epi32(static_cast<int>(P));
+        for (std::size_t h = 8; h < n; h <<= 1) {
+            for (std::size_t k = 0; k < n; k += 2 * h) {
+                std::uint32_t* x = a + k;
+                std::uint32_t* y = x + h;
+                for (std::size_t j = 0; j < h; j += 8) {
+                    __m256i yv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(y + j));
+                    __m256i wv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w + h + j));
+                    __m256i wsv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ws + h + j));
+                    // High halves of the eight 32x32-bit products y * ws
+                    __m256i even = _mm256_srli_epi64(_mm256_mul_epu32(yv, wsv), 32);
+                    __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(yv, 32), _mm256_srli_epi64(wsv, 32));
+                    __m256i q = _mm256_blend_epi32(even, odd, 0xaa);
+                    __m256i t = _mm256_sub_epi32(_mm256_mullo_epi32(yv, wv), _mm256_mullo_epi32(q, p));
+                    t = reduce_once(t, p);
+                    __m256i u = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + j));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(x + j), reduce_once(_mm256_add_epi32(u, t), p));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(y + j),
+                                        reduce_once(_mm256_sub_epi32(_mm256_add_epi32(u, p), t), p));
+                }
+            }
+        }
+    }
+};
+
+#endif
+
+template <class Butterflies, std::size_t N>
+void fixed_size(std::uint32_t* a, std::size_t, const std::uint32_t* w, const std::uint32_t* ws) {
+    Butterflies::run(a, std::integral_constant<std::size_t, N>(), w, ws);
+}
+
+template <class Butterflies>
+void any_size(std::uint32_t* a, std::size_t n, const std::uint32_t* w, const std::uint32_t* ws) {
+    Butterflies::run(a, n, w, ws);
+}
+
+template <class Butterflies>
+Kernel select(std::size_t n) {
+    switch (n) {
+        case 16: return fixed_size<Butterflies, 16>;
+        case 32: return fixed_size<Butterflies, 32>;
+        case 64: return fixed_size<Butterflies, 64>;
+        case 128: return fixed_size<Butterflies, 128>;
+        case 256: return fixed_size<Butterflies, 256>;
+        case 512: return fixed_size<Butterflies, 512>;
+        case 1024: return fixed_size<Butterflies, 1024>;
+        default: return any_size<Butterflies>;
+    }
+}
+
+Kernel select_for_machine(std::size_t n) {
+#ifdef FFVMS_NTT_AVX2
+    static const bool avx2 = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+    if (avx2) return select<Avx2Butterflies>(n);
+#endif
+    return select<ScalarButterflies>(n);
+}
+
+}  // namespace
+
+NttPlan::NttPlan(std::size_t n)
+    : n_(n), bitrev_(n), forward_(n), forward_shoup_(n), inverse_(n), inverse_shoup_(n),
+      kernel_(select_for_machine(n)) {
+    int bits = 0;
+    while ((std::size_t(1) << bits) < n) bits++;
+    for (std::size_t i = 0; i < n; i++) {
+        std::uint32_t r = 0;
+        for (int b = 0; b < bits; b++) r |= ((i >> b) & 1u) << (bits - 1 - b);
+        bitrev_[i] = r;
+    }
+    const std::uint32_t root_inv = pow_mod(ROOT, P - 2);
+    for (std::size_t h = 1; h < n; h <<= 1) {
+        // Primitive (2h)-th roots of unity and their inverses
+        std::uint32_t step = pow_mod(ROOT, (P - 1) / (2 * h));
+        std::uint32_t step_inv = pow_mod(root_inv, (P - 1) / (2 * h));
+        std::uint64_t w = 1, w_inv = 1;
+        for (std::size_t j = 0; j < h; j++) {
+            forward_[h + j] = static_cast<std::uint32_t>(w);
+            forward_shoup_[h + j] = shoup(forward_[h + j]);
+            inverse_[h + j] = static_cast<std::uint32_t>(w_inv);
+            inverse_shoup_[h + j] = shoup(inverse_[h + j]);
+            w = w * step % P;
+            w_inv = w_inv * step_inv % P;
+        }
+    }
+    n_inv_ = pow_mod(n, P - 2);
+    n_inv_shoup_ = shoup(n_inv_);
+}
+
+void NttPlan::transform(std::uint32_t* data, int sign) const {
+    for (std::size_t i = 0; i < n_; i++) {
+        std::size_t j = bitrev_[i];
+        if (i < j) std::swap(data[i], data[j]);
+    }
+    if (sign >= 0) {
+        kernel_(data, n_, forward_.data(), forward_shoup_.data());
+    } else {
+        kernel_(data, n_, inverse_.data(), inverse_shoup_.data());
+        for (std::size_t i = 0; i < n_; i++) data[i] = mul_shoup(data[i], n_inv_, n_inv_shoup_);
+    }
+}
+
+const NttPlan& NttPlan::get(std::size_t n) {
+    static std::mutex mutex;
+    static std::map<std::size_t, std::unique_ptr<NttPlan>> plans;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& plan = plans[n];
+    if (!plan) plan = std::make_unique<NttPlan>(n);
+    return *plan;
+}
+
+}  // namespace ffvms
@@ -0,0 +1,116 @@
+/**
+ * @file thread_pool.cpp
+ * @brief Implementation of the worker pool
+ */
+
+#include "core/thread_pool.h"
+
+#include <algorithm>
+#include <memory>
+
+namespace ffvms {
+
+ThreadPool::ThreadPool(std::size_t threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    for (std::size_t i = 0; i < threads; i++) {
+        workers_.emplace_back(&ThreadPool::worker_loop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) worker.join();
+}
+
+void ThreadPool::worker_loop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+            if (tasks_.empty()) return;
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    cv_.notify_one();
+}
+
+void ThreadPool::parallel_for(std::size_t count, std::size_t grain,
+                              const std::function<void(std::size_t, std::size_t)>& body) {
+    if (grain == 0) grain = 1;
+    const std::size_t chunks = (count + grain - 1) / grain;
+    if (chunks <= 1 || workers_.empty()) {
+        if (count > 0) body(0, count);
+        return;
+    }
+
+    // Helpers that start after the caller is done must not touch body, which may be gone by then
+    struct State {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::size_t next = 0;
+        int active = 0;
+        bool closed = false;
+    };
+    auto state = std::make_shared<State>();
+    auto run = [state, count, grain, &body] {
+        while (true) {
+            std::size_t begin;
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (state->next >= count) return;
+                begin = state->next;
+                state->next += grain;
+            }
+            body(begin, std::min(count, begin + grain));
+        }
+    };
+
+    const std::size_t helpers = std::min(workers_.size(), chunks - 1);
+    for (std::size_t i = 0; i < helpers; i++) {
+        submit([state, run] {
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (state->closed) return;
+                state->active++;
+            }
+            run();
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (--state->active == 0) state->cv.notify_all();
+        });
+    }
+    run();
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->closed = true;
+    state->cv.wait(lock, [&state] { return state->active == 0; });
+}
+
+void for_blocks(ThreadPool* pool, std::size_t blocks, std::size_t min_blocks,
+                const std::function<void(std::size_t, std::size_t)>& body) {
+    if (pool && blocks >= min_blocks) {
+        // A few chunks per worker keeps threads busy when blocks finish unevenly
+        pool->parallel_for(blocks, std::max<std::size_t>(1, blocks / (pool->size() * 4 + 1)), body);
+    } else if (blocks > 0) {
+        body(0, blocks);
+    }
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+}  // namespace ffvms
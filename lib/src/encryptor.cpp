@@ -9,7 +9,7 @@
 */
 
 #include "encryptor.h"
-#include <cstring>
+#include "core/fft.h"
 #include <cmath>
 #include <algorithm>
 
@@ -30,90 +30,123 @@ Complex Complex::operator*(const Complex& r) const {
 }
 
 // Encryptor class implementation
+Encryptor::Context& Encryptor::thread_context() {
+    static thread_local Context ctx;
+    return ctx;
+}
+
 void Encryptor::fft(Complex a[], int n, int type) {
-    const static double Pi = acos(-1.0);
-    if (n == 1) return;
-    int m = n >> 1;
-    for (int i = 0; i < m; i++) {
-        buf[i] = a[i << 1];
-        buf[i + m] = a[i << 1 | 1];
-    }
-    memcpy(a, buf, sizeof(Complex) * n);
-    fft(a, m, type);
-    fft(a + m, m, type);
-    Complex wn = Complex(1, 0), u = Complex(cos(2 * Pi / n), type * sin(2 * Pi / n));
-    for (int i = 0; i < m; i++) {
-        Complex t = wn * a[m + i];
-        wn = wn * u;
-        buf[i] = a[i] + t;
-        buf[i + m] = a[i] - t;
+    static_assert(sizeof(Complex) == 2 * sizeof(double), "Complex must be two packed doubles");
+    static const ffvms::FftPlan& full = ffvms::FftPlan::get(N);
+    const ffvms::FftPlan& plan = n == N ? full : ffvms::FftPlan::get(n);
+    plan.transform(reinterpret_cast<double*>(a), type);
+}
+
+void Encryptor::encrypt_block(Context& ctx, std::pair<double, double>* res, int n) {
+    fft(ctx.block, n, 1);
+    for (int i = 0; i < n; i++) {
+        res[i] = std::make_pair(ctx.block[i].a, ctx.block[i].b);
     }
-    memcpy(a, buf, sizeof(Complex) * n);
 }
 
-bool Encryptor::encrypt_block(std::vector<std::pair<double, double>>& res) {
-    fft(block, N, 1);
-    res.clear();
+void Encryptor::decrypt_block(Context& ctx, int* res) {
+    fft(ctx.block, N, -1);
     for (int i = 0; i < N; i++) {
-        res.push_back(std::make_pair(block[i].a, block[i].b));
+        res[i] = static_cast<int>(ctx.block[i].a / N + 0.5);
+        if (ctx.block[i].a < 0.0 && std::abs(ctx.block[i].a) > 1e-2) res[i]--;
     }
-    return true;
 }
 
-bool Encryptor::decrypt_block(std::vector<int>& res) {
-    fft(block, N, -1);
-    res.clear();
-    for (int i = 0; i < N; i++) {
-        res.push_back(static_cast<int>(block[i].a / N + 0.5));
-        if (block[i].a < 0.0 && std::abs(block[i].a) > 1e-2) res.back()--;
+void Encryptor::decrypt_block_packed(Context& ctx, int* res, int n) {
+    fft(ctx.block, n, -1);
+    for (int i = 0; i < n; i++) {
+        res[2 * i] = static_cast<int>(std::lround(ctx.block[i].a / n));
+        res[2 * i + 1] = static_cast<int>(std::lround(ctx.block[i].b / n));
     }
-    return true;
+}
+
+int Encryptor::packed_block_size(size_t symbols) {
+    size_t points = (symbols + 1) / 2;
+    if (points >= static_cast<size_t>(N)) return N;
+    int n = MIN_N;
+    while (static_cast<size_t>(n) < points) n <<= 1;
+    return n;
 }
 
 bool Encryptor::encrypt_sequence(std::vector<int>& sequence, std::vector<std::pair<double, double>>& res) {
     int len = static_cast<int>(sequence.size());
-    int idx = 1;
     while ((sequence.size() + 1) % N != 0) sequence.push_back(PLACEHOLDER);
-    std::fill(block, block + N, Complex(0, 0));
-    block[0].a = len;
-    res.clear();
-    std::vector<std::pair<double, double>> tmp;
-    for (auto& it : sequence) {
-        block[idx++].a = it;
-        if (idx == N) {
-            encrypt_block(tmp);
-            res.insert(res.end(), tmp.begin(), tmp.end());
-            idx = 0;
-            std::fill(block, block + N, Complex(0, 0));
-            tmp.clear();
+    // The length is the first symbol of the first block, followed by the sequence
+    const size_t blocks = (sequence.size() + 1) / N;
+    res.resize(blocks * N);
+    ffvms::for_blocks(pool_, blocks, PARALLEL_MIN_BLOCKS, [&](size_t first, size_t last) {
+        Context& ctx = thread_context();
+        for (size_t b = first; b < last; b++) {
+            for (int i = 0; i < N; i++) {
+                size_t pos = b * N + i;
+                ctx.block[i] = Complex(pos == 0 ? len : sequence[pos - 1], 0);
+            }
+            encrypt_block(ctx, &res[b * N], N);
         }
-    }
+    });
     return true;
 }
 
 bool Encryptor::decrypt_sequence(std::vector<std::pair<double, double>>& sequence, std::vector<int>& res) {
-    if (sequence.size() % N != 0) return false;
-    std::fill(block, block + N, Complex(0, 0));
-    int idx = 0;
-    res.clear();
-    int len = -1;
-    std::vector<int> tmp;
-    for (auto& it : sequence) {
-        block[idx].a = it.first;
-        block[idx++].b = it.second;
-        if (idx == N) {
-            decrypt_block(tmp);
-            if (len != -1) {
-                res.insert(res.end(), tmp.begin(), tmp.end());
-            } else {
-                len = tmp.front();
-                res.insert(res.end(), tmp.begin() + 1, tmp.end());
+    if (sequence.size() % N != 0 || sequence.empty()) return false;
+    const size_t blocks = sequence.size() / N;
+    std::vector<int> symbols(sequence.size());
+    ffvms::for_blocks(pool_, blocks, PARALLEL_MIN_BLOCKS, [&](size_t first, size_t last) {
+        Context& ctx = thread_context();
+        for (size_t b = first; b < last; b++) {
+            for (int i = 0; i < N; i++) {
+                ctx.block[i] = Complex(sequence[b * N + i].first, sequence[b * N + i].second);
             }
-            idx = 0;
-            std::fill(block, block + N, Complex(0, 0));
-            tmp.clear();
+            decrypt_block(ctx, &symbols[b * N]);
         }
-    }
-    res.erase(res.begin() + len, res.end());
+    });
+    int len = symbols.front();
+    if (len < 0 || static_cast<size_t>(len) >= symbols.size()) return false;
+    res.assign(symbols.begin() + 1, symbols.begin() + 1 + len);
+    return true;
+}
+
+bool Encryptor::encrypt_sequence_packed(std::vector<int>& sequence, std::vector<std::pair<double, double>>& res) {
+    int len = static_cast<int>(sequence.size());
+    const int n = packed_block_size(sequence.size() + 1);
+    while ((sequence.size() + 1) % (2 * n) != 0) sequence.push_back(PLACEHOLDER);
+    const size_t blocks = (sequence.size() + 1) / (2 * n);
+    res.resize(blocks * n);
+    ffvms::for_blocks(pool_, blocks, PARALLEL_MIN_BLOCKS, [&](size_t first, size_t last) {
+        Context& ctx = thread_context();
+        for (size_t b = first; b < last; b++) {
+            for (int i = 0; i < n; i++) {
+                size_t pos = b * 2 * n + 2 * i;
+                ctx.block[i] = Complex(pos == 0 ? len : sequence[pos - 1], sequence[pos]);
+            }
+            encrypt_block(ctx, &res[b * n], n);
+        }
+    });
+    return true;
+}
+
+bool Encryptor::decrypt_sequence_packed(std::vector<std::pair<double, double>>& sequence, std::vector<int>& res) {
+    // Anything shorter than a full block is a single right-sized block
+    const int n = sequence.size() < static_cast<size_t>(N) ? static_cast<int>(sequence.size()) : N;
+    if (n < MIN_N || (n & (n - 1)) != 0 || sequence.size() % n != 0) return false;
+    const size_t blocks = sequence.size() / n;
+    std::vector<int> symbols(sequence.size() * 2);
+    ffvms::for_blocks(pool_, blocks, PARALLEL_MIN_BLOCKS, [&](size_t first, size_t last) {
+        Context& ctx = thread_context();
+        for (size_t b = first; b < last; b++) {
+            for (int i = 0; i < n; i++) {
+                ctx.block[i] = Complex(sequence[b * n + i].first, sequence[b * n + i].second);
+            }
+            decrypt_block_packed(ctx, &symbols[b * 2 * n], n);
+        }
+    });
+    int len = symbols.front();
+    if (len < 0 || static_cast<size_t>(len) >= symbols.size()) return false;
+    res.assign(symbols.begin() + 1, symbols.begin() + 1 + len);
     return true;
 }
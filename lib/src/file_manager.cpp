@@ -11,15 +11,53 @@
 #include "file_manager.h"
 #include "saver.h"
 #include "logger.h"
+#include "storage/record_schema.h"
 #include <random>
 
+namespace {
+
+struct ChunkRow {
+    std::string_view id;     ///< Hex chunk id
+    std::string_view bytes;
+};
+
+// Leading fields of a relation row; the hex ids of the file's chunks follow
+struct RelationRow {
+    std::uint64_t id = 0;
+    std::uint64_t cnt = 0;
+};
+
+// A relation row written before chunking
+struct LegacyRow {
+    std::uint64_t id = 0;
+    std::string_view content;
+    std::uint64_t cnt = 0;
+};
+
+constexpr auto CHUNK_SCHEMA = ffvms::storage::make_schema(
+    ffvms::storage::field("id", &ChunkRow::id),
+    ffvms::storage::field("bytes", &ChunkRow::bytes));
+static_assert(CHUNK_SCHEMA.valid(), "Chunk fields must be listed in the order they were added");
+
+constexpr auto RELATION_SCHEMA = ffvms::storage::make_schema(
+    ffvms::storage::field("id", &RelationRow::id),
+    ffvms::storage::field("cnt", &RelationRow::cnt));
+static_assert(RELATION_SCHEMA.valid(), "Relation fields must be listed in the order they were added");
+
+constexpr auto LEGACY_SCHEMA = ffvms::storage::make_schema(
+    ffvms::storage::field("id", &LegacyRow::id),
+    ffvms::storage::field("content", &LegacyRow::content),
+    ffvms::storage::field("cnt", &LegacyRow::cnt));
+
+}  // namespace
+
 // fileNode implementation
-fileNode::fileNode(std::string content) : content(std::move(content)), cnt(1) {}
+fileNode::fileNode(std::vector<ffvms::storage::ChunkId> chunks) : chunks(std::move(chunks)), cnt(1) {}
 
 // Helper to get storage reference
 ffvms::IStorage& FileManager::get_storage_ref() {
     if (storage_) return *storage_;
-    return Saver::get_saver();
+    return Saver::get_default_storage();
 }
 
 // Helper to get logger reference
@@ -37,12 +75,12 @@ unsigned long long FileManager::get_new_id() {
     unsigned long long id;
     do {
         id = dis(gen);
-    } while (mp.count(id));
+    } while (mp.get().count(id));
     return id;
 }
 
 bool FileManager::file_exist(unsigned long long fid) {
-    if (!mp.count(fid)) {
+    if (!mp.get().count(fid)) {
         get_logger_ref().log("File id " + std::to_string(fid) + " does not exists. This is not normal.", 
                              ffvms::LogLevel::FATAL, __LINE__);
         return false;
@@ -52,7 +90,7 @@ bool FileManager::file_exist(unsigned long long fid) {
 
 bool FileManager::check_file(unsigned long long fid) {
     if (!file_exist(fid)) return false;
-    if (mp[fid].cnt <= 0) {
+    if (mp.get().at(fid).cnt <= 0) {
         get_logger_ref().log("File ID " + std::to_string(fid) + " counter is <= 0, abnormal state.", 
                              ffvms::LogLevel::FATAL, __LINE__);
         return false;
@@ -61,44 +99,137 @@ bool FileManager::check_file(unsigned long long fid) {
 }
 
 bool FileManager::save() {
-    ffvms::DataTable data;
-    for (auto& it : mp) {
-        data.push_back(std::vector<std::string>());
-        data.back().push_back(std::to_string(it.first));
-        data.back().push_back(it.second.content);
-        data.back().push_back(std::to_string(it.second.cnt));
+    std::vector<ffvms::TableWrite> writes;
+    capture(writes);
+    for (auto& write : writes) {
+        if (!write.write_to(get_storage_ref())) {
+            capture_failed();
+            return false;
+        }
     }
-    if (!get_storage_ref().save(DATA_STORAGE_NAME, data)) return false;
     return true;
 }
 
+unsigned long long FileManager::changed_bytes() const {
+    return changed_bytes_;
+}
+
+void FileManager::capture(std::vector<ffvms::TableWrite>& writes) {
+    // Chunks go first so a saved relation never refers to chunks that were not saved
+    if (chunks_.generation() != saved_chunk_generation_) {
+        writes.push_back({CHUNK_STORAGE_NAME, [chunks = chunks_.snapshot()](ffvms::IRecordWriter& out) {
+            char hex[64];
+            out.begin_table(chunks->size());
+            for (auto& it : *chunks) {
+                ffvms::storage::to_hex(it.first, hex);
+                CHUNK_SCHEMA.write(out, {std::string_view(hex, sizeof(hex)), *it.second});
+            }
+        }});
+        saved_chunk_generation_ = chunks_.generation();
+    }
+    if (relation_dirty_) {
+        writes.push_back({DATA_STORAGE_NAME, [relation = mp.share()](ffvms::IRecordWriter& out) {
+            char hex[64];
+            out.begin_table(relation->size());
+            for (auto& it : *relation) {
+                // The row is the schema's fields followed by the chunk ids
+                out.begin_row(RELATION_SCHEMA.size + it.second.chunks.size());
+                out.u64(it.first);
+                out.u64(it.second.cnt);
+                for (auto& id : it.second.chunks) {
+                    ffvms::storage::to_hex(id, hex);
+                    out.str(std::string_view(hex, sizeof(hex)));
+                }
+            }
+        }});
+        relation_dirty_ = false;
+    }
+    changed_bytes_ = 0;
+}
+
+void FileManager::capture_failed() {
+    relation_dirty_ = true;
+    saved_chunk_generation_ = ~0ULL;
+}
+
 bool FileManager::load() {
-    ffvms::DataTable data;
-    if (!get_storage_ref().load(DATA_STORAGE_NAME, data)) return false;
-    mp.clear();
-    for (auto& it : data) {
-        if (it.size() != 3) {
-            get_logger_ref().log("FileSystem: File is corrupted and cannot be read.", 
-                                 ffvms::LogLevel::WARNING, __LINE__);
-            mp.clear();
-            return false;
-        }
-        if (!ffvms::IStorage::is_all_digits(it[0])) {
-            get_logger_ref().log("FileSystem: File is corrupted and cannot be read.", 
-                                 ffvms::LogLevel::WARNING, __LINE__);
-            mp.clear();
-            return false;
-        }
-        unsigned long long key = ffvms::IStorage::str_to_ull(it[0]);
-        unsigned long long cnt = ffvms::IStorage::str_to_ull(it[2]);
-        std::string& content = it[1];
-        auto t = std::make_pair(key, fileNode(content));
-        t.second.cnt = cnt;
-        mp.insert(t);
+    mp.edit().clear();
+    chunks_.clear();
+    // Data written before chunking keeps whole contents in the relation table. Without a readable chunk
+    // table the relation rows must be in that format; chunked rows there mean the chunk table is damaged
+    bool has_chunks = false;
+    bool chunks_ok = get_storage_ref().load_records(CHUNK_STORAGE_NAME, [&](ffvms::IRecordReader& in) {
+        has_chunks = true;
+        return load_chunks(in);
+    });
+    if (has_chunks && !chunks_ok) return corrupted();
+    bool loaded = get_storage_ref().load_records(DATA_STORAGE_NAME, [&](ffvms::IRecordReader& in) {
+        return has_chunks ? load_relation(in) : load_legacy(in);
+    });
+    if (!loaded) {
+        mp.edit().clear();
+        chunks_.clear();
+        return false;
+    }
+    if (has_chunks) {
+        chunks_.drop_unreferenced();
+        relation_dirty_ = false;
+        saved_chunk_generation_ = chunks_.generation();
     }
     return true;
 }
 
+bool FileManager::corrupted() {
+    get_logger_ref().log("FileSystem: File is corrupted and cannot be read.", 
+                         ffvms::LogLevel::WARNING, __LINE__);
+    mp.edit().clear();
+    chunks_.clear();
+    // Leave the stored tables as they are unless this session changes something
+    relation_dirty_ = false;
+    saved_chunk_generation_ = chunks_.generation();
+    return false;
+}
+
+bool FileManager::load_chunks(ffvms::IRecordReader& in) {
+    ffvms::storage::ChunkId id;
+    return CHUNK_SCHEMA.read_table(in, [&](const ChunkRow& row) {
+        return ffvms::storage::from_hex(row.id, id) && chunks_.insert(id, std::string(row.bytes));
+    });
+}
+
+bool FileManager::load_relation(ffvms::IRecordReader& in) {
+    ffvms::storage::ChunkId id;
+    std::size_t fields;
+    std::string_view hex;
+    RelationRow row;
+    while (in.next_row(fields)) {
+        if (!RELATION_SCHEMA.read(in, fields, row)) return corrupted();
+        fileNode node;
+        node.cnt = row.cnt;
+        node.chunks.reserve(fields - RELATION_SCHEMA.size);
+        for (size_t i = RELATION_SCHEMA.size; i < fields; i++) {
+            if (!in.str(hex) || !ffvms::storage::from_hex(hex, id)) return corrupted();
+            node.chunks.push_back(id);
+        }
+        if (!chunks_.add_ref(node.chunks)) return corrupted();
+        mp.edit()[row.id] = std::move(node);
+    }
+    return in.ok() || corrupted();
+}
+
+bool FileManager::load_legacy(ffvms::IRecordReader& in) {
+    // A chunked row is id, cnt and one 64-character hex id per chunk: never three fields ending in a count
+    std::size_t fields;
+    LegacyRow row;
+    while (in.next_row(fields)) {
+        if (fields != LEGACY_SCHEMA.size || !LEGACY_SCHEMA.read(in, fields, row)) return corrupted();
+        auto t = std::make_pair(row.id, fileNode(chunks_.put(row.content)));
+        t.second.cnt = row.cnt;
+        mp.edit().insert(t);
+    }
+    return in.ok() || corrupted();
+}
+
 FileManager::FileManager() : storage_(nullptr), logger_(nullptr) {
     if (!load()) return;
 }
@@ -119,44 +250,65 @@ FileManager& FileManager::get_file_manager() {
 
 unsigned long long FileManager::create_file(const std::string& content) {
     unsigned long long id = get_new_id();
-    mp[id] = fileNode(content);
+    mp.edit()[id] = fileNode(chunks_.put(content));
+    relation_dirty_ = true;
+    changed_bytes_ += ROW_BYTES + content.size();
     return id;
 }
 
 bool FileManager::increase_counter(unsigned long long fid) {
-    if (!mp.count(fid)) {
+    if (!mp.get().count(fid)) {
         get_logger_ref().log("File id does not exists.", ffvms::LogLevel::FATAL, __LINE__);
         return false;
     }
     if (!check_file(fid)) return false;
-    mp[fid].cnt++;
+    mp.edit()[fid].cnt++;
+    relation_dirty_ = true;
+    changed_bytes_ += ROW_BYTES;
     return true;
 }
 
 bool FileManager::decrease_counter(unsigned long long fid) {
-    if (!mp.count(fid)) {
+    if (!mp.get().count(fid)) {
         get_logger_ref().log("File id does not exists.", ffvms::LogLevel::FATAL, __LINE__);
         return false;
     }
     if (!check_file(fid)) return false;
-    if (--mp[fid].cnt <= 0) {
-        mp.erase(mp.find(fid));
+    auto& relation = mp.edit();
+    if (--relation[fid].cnt <= 0) {
+        chunks_.release(relation[fid].chunks);
+        relation.erase(relation.find(fid));
     }
+    relation_dirty_ = true;
+    changed_bytes_ += ROW_BYTES;
     return true;
 }
 
 bool FileManager::update_content(unsigned long long fid, unsigned long long& new_id, 
                                  const std::string& content) {
-    if (!file_exist(fid)) return false;
-    if (!decrease_counter(fid)) return false;
+    if (!check_file(fid)) return false;
+    // Store the new content before releasing the old one so shared chunks are never freed
     new_id = get_new_id();
-    mp[new_id].content = content;
-    mp[new_id].cnt = 1;
-    return true;
+    mp.edit()[new_id] = fileNode(chunks_.put(content));
+    relation_dirty_ = true;
+    changed_bytes_ += ROW_BYTES + content.size();
+    return decrease_counter(fid);
 }
 
 bool FileManager::get_content(unsigned long long fid, std::string& content) {
     if (!file_exist(fid)) return false;
-    content = mp[fid].content;
+    if (!chunks_.assemble(mp.get().at(fid).chunks, content)) {
+        get_logger_ref().log("File ID " + std::to_string(fid) + " refers to missing content chunks.", 
+                             ffvms::LogLevel::FATAL, __LINE__);
+        return false;
+    }
     return true;
 }
+
+ffvms::storage::ChunkStore::Stats FileManager::chunk_stats() const {
+    return chunks_.stats();
+}
+
+bool FileManager::dirty() const {
+    return relation_dirty_ || chunks_.generation() != saved_chunk_generation_;
+}
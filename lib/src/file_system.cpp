@@ -52,10 +52,12 @@ FileSystem::FileSystem(ffvms::ILogger* logger, ffvms::INodeManager* node_manager
 
 bool FileSystem::decrease_counter(treeNode* p) {
     if (!tree_->check_node(p, __LINE__)) return false;
+    version_manager_.mark_node_changed(p);
     if (--p->cnt == 0) {
         get_logger_ref().log("Node " + get_node_manager_ref().get_name(p->link) + " will be deleted...", 
                              ffvms::LogLevel::INFO, __LINE__);
         get_node_manager_ref().delete_node(p->link);
+        version_manager_.mark_node_deleted(p);
         delete p;
         get_logger_ref().log("Deleting completed.", ffvms::LogLevel::INFO, __LINE__);
     }
@@ -86,12 +88,14 @@ bool FileSystem::delete_node() {
 
 bool FileSystem::rebuild_nodes(treeNode* p) {
     if (!tree_->check_path()) return false;
+    version_manager_.mark_tree_dirty();
     int relation = 0;
     std::stack<treeNode*> stk;
     stk.push(p);
     for (; tree_->check_node(tree_->path.back(), __LINE__) && tree_->path.back()->cnt > 1; tree_->path.pop_back()) {
         treeNode* t = new treeNode();
         (*t) = (*tree_->path.back());
+        t->cnt = 1;  // the copy is in this version only; the other versions keep the original
         get_node_manager_ref().increase_counter(t->link);
         if (relation == 1) t->first_son = stk.top();
         else t->next_brother = stk.top();
@@ -101,6 +105,7 @@ bool FileSystem::rebuild_nodes(treeNode* p) {
     }
     if (!tree_->check_node(tree_->path.back(), __LINE__)) return false;
     (relation ? tree_->path.back()->first_son : tree_->path.back()->next_brother) = stk.top();
+    version_manager_.mark_node_changed(tree_->path.back());
     for (; !stk.empty(); stk.pop()) {
         tree_->path.push_back(stk.top());
     }
@@ -12,11 +12,35 @@
 #include "file_manager.h"
 #include "saver.h"
 #include "logger.h"
+#include "storage/record_schema.h"
 #include <random>
 #include <ctime>
 #include <sstream>
 #include <iomanip>
 
+namespace {
+
+// One row of the node table; the text fields view either the node map or the loaded record
+struct NodeRow {
+    std::uint64_t id = 0;
+    std::uint64_t cnt = 0;
+    std::string_view name;
+    std::string_view create_time;
+    std::string_view update_time;
+    std::uint64_t fid = 0;
+};
+
+constexpr auto NODE_SCHEMA = ffvms::storage::make_schema(
+    ffvms::storage::field("id", &NodeRow::id),
+    ffvms::storage::field("cnt", &NodeRow::cnt),
+    ffvms::storage::field("name", &NodeRow::name),
+    ffvms::storage::field("create_time", &NodeRow::create_time),
+    ffvms::storage::field("update_time", &NodeRow::update_time),
+    ffvms::storage::field("fid", &NodeRow::fid));
+static_assert(NODE_SCHEMA.valid(), "Node table fields must be listed in the order they were added");
+
+}  // namespace
+
 // Node implementation
 ffvms::IFileManager& Node::get_file_manager_ref() {
     if (file_manager_) return *file_manager_;
@@ -60,7 +84,7 @@ ffvms::IFileManager& NodeManager::get_file_manager_ref() {
 
 ffvms::IStorage& NodeManager::get_storage_ref() {
     if (storage_) return *storage_;
-    return Saver::get_saver();
+    return Saver::get_default_storage();
 }
 
 ffvms::ILogger& NodeManager::get_logger_ref() {
@@ -70,7 +94,7 @@ ffvms::ILogger& NodeManager::get_logger_ref() {
 
 // NodeManager implementation
 bool NodeManager::node_exist(unsigned long long id) {
-    return mp.count(id);
+    return mp.get().count(id);
 }
 
 unsigned long long NodeManager::get_new_id() {
@@ -86,55 +110,54 @@ unsigned long long NodeManager::get_new_id() {
 }
 
 bool NodeManager::save() {
-    ffvms::DataTable data;
-    for (auto& it : mp) {
-        data.push_back(std::vector<std::string>());
-        data.back().push_back(std::to_string(it.first));
-        data.back().push_back(std::to_string(it.second.first));
-        data.back().push_back(it.second.second.name);
-        data.back().push_back(it.second.second.create_time);
-        data.back().push_back(it.second.second.update_time);
-        data.back().push_back(std::to_string(it.second.second.fid));
+    std::vector<ffvms::TableWrite> writes;
+    capture(writes);
+    for (auto& write : writes) {
+        if (!write.write_to(get_storage_ref())) {
+            capture_failed();
+            return false;
+        }
     }
-    if (!get_storage_ref().save(DATA_STORAGE_NAME, data)) return false;
     return true;
 }
 
-bool NodeManager::load() {
-    ffvms::DataTable data;
-    if (!get_storage_ref().load(DATA_STORAGE_NAME, data)) return false;
-    mp.clear();
-    for (auto& it : data) {
-        if (it.size() != 6) {
-            get_logger_ref().log("NodeManager: File is corrupted and cannot be read.", 
-                                 ffvms::LogLevel::WARNING, __LINE__);
-            mp.clear();
-            return false;
+void NodeManager::capture(std::vector<ffvms::TableWrite>& writes) {
+    changed_bytes_ = 0;
+    if (!dirty_) return;
+    writes.push_back({DATA_STORAGE_NAME, [nodes = mp.share()](ffvms::IRecordWriter& out) {
+        out.begin_table(nodes->size());
+        for (auto& it : *nodes) {
+            const Node& node = it.second.second;
+            NODE_SCHEMA.write(out, {it.first, it.second.first, node.name, node.create_time,
+                                    node.update_time, node.fid});
         }
-        bool flag = true;
-        if (!ffvms::IStorage::is_all_digits(it[0])) flag = false;
-        if (!ffvms::IStorage::is_all_digits(it[1])) flag = false;
-        if (!ffvms::IStorage::is_all_digits(it[5])) flag = false;
-        if (!flag) {
-            mp.clear();
+    }});
+    dirty_ = false;
+}
+
+bool NodeManager::load() {
+    mp.edit().clear();
+    bool loaded = get_storage_ref().load_records(DATA_STORAGE_NAME, [this](ffvms::IRecordReader& in) {
+        bool rows_ok = NODE_SCHEMA.read_table(in, [this](const NodeRow& row) {
+            Node t_node = Node();
+            t_node.name = row.name;
+            t_node.create_time = row.create_time;
+            t_node.update_time = row.update_time;
+            t_node.fid = row.fid;
+            mp.edit().insert(std::make_pair(row.id, std::make_pair(row.cnt, std::move(t_node))));
+            return true;
+        });
+        if (!rows_ok) {
             get_logger_ref().log("NodeManager: File is corrupted and cannot be read.", 
                                  ffvms::LogLevel::WARNING, __LINE__);
-            return false;
         }
-        unsigned long long key = ffvms::IStorage::str_to_ull(it[0]);
-        unsigned long long cnt = ffvms::IStorage::str_to_ull(it[1]);
-        unsigned long long fid = ffvms::IStorage::str_to_ull(it[5]);
-        std::string& name = it[2];
-        std::string& create_time = it[3];
-        std::string& update_time = it[4];
-        Node t_node = Node();
-        t_node.name = name;
-        t_node.create_time = create_time;
-        t_node.update_time = update_time;
-        t_node.fid = fid;
-        auto t_pair = std::make_pair(cnt, t_node);
-        mp.insert(std::make_pair(key, t_pair));
+        return rows_ok;
+    });
+    if (!loaded) {
+        mp.edit().clear();
+        return false;
     }
+    dirty_ = false;
     return true;
 }
 
@@ -156,15 +179,20 @@ NodeManager::~NodeManager() {
 unsigned long long NodeManager::get_new_node(const std::string& name) {
     unsigned long long new_id = get_new_id();
     auto t = std::make_pair(1ULL, Node(name, file_manager_));
-    mp.insert(std::make_pair(new_id, t));
+    mp.edit().insert(std::make_pair(new_id, t));
+    dirty_ = true;
+    changed_bytes_ += ROW_BYTES + name.size();
     return new_id;
 }
 
 void NodeManager::delete_node(unsigned long long idx) {
     if (!node_exist(idx)) return;
-    if (--mp[idx].first == 0) {
-        get_file_manager_ref().decrease_counter(mp[idx].second.fid);
-        mp.erase(mp.find(idx));
+    dirty_ = true;
+    changed_bytes_ += ROW_BYTES;
+    auto& nodes = mp.edit();
+    if (--nodes[idx].first == 0) {
+        get_file_manager_ref().decrease_counter(nodes[idx].second.fid);
+        nodes.erase(nodes.find(idx));
     }
 }
 
@@ -174,23 +202,23 @@ unsigned long long NodeManager::update_content(unsigned long long idx, const std
     std::string create_time = get_create_time(idx);
     delete_node(idx);
     idx = get_new_node(name);
-    mp[idx].second.create_time = create_time;
+    mp.edit()[idx].second.create_time = create_time;
 
-    unsigned long long fid = mp[idx].second.fid;
-    get_file_manager_ref().update_content(mp[idx].second.fid, fid, content);
+    unsigned long long fid = mp.get().at(idx).second.fid;
+    get_file_manager_ref().update_content(mp.get().at(idx).second.fid, fid, content);
     return idx;
 }
 
 unsigned long long NodeManager::update_name(unsigned long long idx, const std::string& name) {
     if (!node_exist(idx)) return static_cast<unsigned long long>(-1);
     std::string create_time = get_create_time(idx);
-    unsigned long long fid = mp[idx].second.fid;
+    unsigned long long fid = mp.get().at(idx).second.fid;
     unsigned long long old_idx = idx;
     get_file_manager_ref().increase_counter(fid);
     idx = get_new_node(name);
-    mp[idx].second.create_time = create_time;
-    get_file_manager_ref().decrease_counter(mp[idx].second.fid);
-    mp[idx].second.fid = fid;
+    mp.edit()[idx].second.create_time = create_time;
+    get_file_manager_ref().decrease_counter(mp.get().at(idx).second.fid);
+    mp.edit()[idx].second.fid = fid;
     delete_node(old_idx);
     return idx;
 }
@@ -198,33 +226,35 @@ unsigned long long NodeManager::update_name(unsigned long long idx, const std::s
 std::string NodeManager::get_content(unsigned long long idx) {
     if (!node_exist(idx)) return "-1";
     std::string content;
-    get_file_manager_ref().get_content(mp[idx].second.fid, content);
+    get_file_manager_ref().get_content(mp.get().at(idx).second.fid, content);
     return content;
 }
 
 std::string NodeManager::get_name(unsigned long long idx) {
     if (!node_exist(idx)) return "";
-    return mp[idx].second.name;
+    return mp.get().at(idx).second.name;
 }
 
 std::string NodeManager::get_update_time(unsigned long long idx) {
     if (!node_exist(idx)) return "";
-    return mp[idx].second.update_time;
+    return mp.get().at(idx).second.update_time;
 }
 
 std::string NodeManager::get_create_time(unsigned long long idx) {
     if (!node_exist(idx)) return "";
-    return mp[idx].second.create_time;
+    return mp.get().at(idx).second.create_time;
 }
 
 void NodeManager::increase_counter(unsigned long long idx) {
     if (!node_exist(idx)) return;
-    mp[idx].first++;
+    mp.edit()[idx].first++;
+    dirty_ = true;
+    changed_bytes_ += ROW_BYTES;
 }
 
 unsigned long long NodeManager::_get_counter(unsigned long long idx) {
     if (!node_exist(idx)) return static_cast<unsigned long long>(-1);
-    return mp[idx].first;
+    return mp.get().at(idx).first;
 }
 
 NodeManager& NodeManager::get_node_manager() {
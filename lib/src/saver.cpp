@@ -10,20 +10,127 @@
 
 #include "saver.h"
 #include "logger.h"
+#include "storage/block_checksums.h"
+#include "storage/byte_io.h"
+#include "storage/data_file_format.h"
+#include "storage/fft_cipher.h"
+#include "storage/file_util.h"
+#include "storage/legacy_text_file.h"
+#include "storage/table_text.h"
+#include "storage/xxhash64.h"
+#include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <cstdio>
+#include <filesystem>
 #include <fstream>
-#include <sstream>
+#include <functional>
+#include <thread>
+
+namespace {
+
+using ffvms::storage::RecordHeader;
+
+/// @brief Whether a record of @p size bytes, at least RECORD_HEADER_SIZE, has a payload its cipher could produce
+bool payload_matches(const RecordHeader& record, unsigned long long size) {
+    return ffvms::storage::is_valid_payload_size(static_cast<ffvms::storage::CipherId>(record.cipher),
+                                                 size - ffvms::storage::RECORD_HEADER_SIZE);
+}
+
+/**
+ * @brief Walk consecutive records starting at @p pos
+ * @return Offset of the first byte that is not part of a complete record
+ */
+unsigned long long scan_records(const char* file, unsigned long long file_size, unsigned long long pos,
+                                const std::function<void(const RecordHeader&, unsigned long long,
+                                                         unsigned long long)>& on_record) {
+    while (pos < file_size && file_size - pos >= ffvms::storage::RECORD_HEADER_SIZE) {
+        // body_size comes from the file: compare without adding to it, so a damaged value cannot wrap
+        RecordHeader record;
+        if (!ffvms::storage::decode_record_header(file + pos, file_size - pos, record) ||
+            record.body_size > file_size - pos - 8 || !payload_matches(record, record.body_size + 8)) {
+            break;
+        }
+        on_record(record, pos, record.body_size + 8);
+        pos += record.body_size + 8;
+    }
+    return pos;
+}
+
+/// @brief Encoded header of a resident record
+std::string record_header(const dataNode& node) {
+    using namespace ffvms::storage;
+    RecordHeader record;
+    record.body_size = RECORD_HEADER_SIZE - 8 + node.payload.size();
+    record.name_hash = node.name_hash;
+    record.data_hash = node.data_hash;
+    if (node.cipher == static_cast<unsigned int>(CipherId::FFT) ||
+        node.cipher == static_cast<unsigned int>(CipherId::FFT_PACKED)) {
+        // A short packed payload is one right-sized block
+        record.block_count = static_cast<uint32_t>((node.payload.size() + FftCipher::BLOCK_BYTES - 1) /
+                                                   FftCipher::BLOCK_BYTES);
+    }
+    record.codec = static_cast<uint8_t>(node.codec);
+    record.checksum = static_cast<uint8_t>(node.checksum);
+    record.cipher = static_cast<uint16_t>(node.cipher);
+    std::string buffer;
+    encode_record_header(buffer, record);
+    return buffer;
+}
+
+}  // namespace
 
 // dataNode implementation
 dataNode::dataNode() = default;
 
-dataNode::dataNode(unsigned long long name_hash, unsigned long long data_hash,
-                   std::vector<std::pair<double, double>>& data, int n) {
-    this->name_hash = name_hash;
-    this->data_hash = data_hash;
-    this->len = static_cast<int>(data.size()) / n;
-    this->data = data;
-}
+dataNode::dataNode(unsigned long long name_hash, unsigned long long data_hash, std::string payload,
+                   unsigned int codec, unsigned int cipher, unsigned int checksum)
+    : name_hash(name_hash), data_hash(data_hash), payload(std::move(payload)), codec(codec), cipher(cipher),
+      checksum(checksum) {}
+
+/**
+ * @brief A background copy of the live log records into a fresh file
+ *
+ * The worker only reads byte ranges that existed when the job started;
+ * those are never modified because the log is append-only. Records
+ * appended while it runs are carried over by finish_compaction().
+ */
+struct Saver::CompactionJob {
+    std::thread worker;
+    std::atomic<bool> done{false};
+    std::atomic<bool> cancel{false};
+    bool ok = false;
+    std::string tmp_file;
+    std::vector<ffvms::storage::IndexEntry> live;    ///< Records as they were located when the job started
+    std::vector<unsigned long long> new_offsets;     ///< Their offsets in tmp_file
+    unsigned long long end = 0;                      ///< Size of tmp_file when the worker finished
+
+    void run(const std::string& source) {
+        using namespace ffvms::storage;
+        std::ifstream in(source, std::ios::binary);
+        std::ofstream out(tmp_file, std::ios::binary | std::ios::trunc);
+        std::string buffer;
+        encode_file_header(buffer, FileHeader());
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        end = FILE_HEADER_SIZE;
+        buffer.resize(1 << 20);
+        for (auto& entry : live) {
+            if (cancel) break;
+            new_offsets.push_back(end);
+            in.seekg(static_cast<std::streamoff>(entry.offset));
+            for (unsigned long long left = entry.size; left > 0 && in && out;) {
+                std::streamsize n = static_cast<std::streamsize>(std::min<unsigned long long>(left, buffer.size()));
+                in.read(&buffer[0], n);
+                out.write(buffer.data(), n);
+                left -= static_cast<unsigned long long>(n);
+            }
+            end += entry.size;
+        }
+        out.close();
+        ok = !cancel && in.good() && out.good();
+        done = true;
+    }
+};
 
 // Helper to get logger reference
 ffvms::ILogger& Saver::get_logger_ref() {
@@ -34,135 +141,619 @@ ffvms::ILogger& Saver::get_logger_ref() {
 // Saver implementation
 template <class T>
 unsigned long long Saver::get_hash(T& s) {
-    unsigned long long seed = 13331, hash = 0;
-    for (auto& ch : s) {
-        hash = hash * seed + ch;
-    }
-    return hash;
+    return ffvms::storage::polynomial_hash(s);
+}
+
+std::string Saver::journal_file() const {
+    return options_.mode == SaverOptions::Mode::APPEND_LOG ? data_file : data_file + ".wal";
 }
 
 bool Saver::load_file() {
-    std::ifstream in(data_file);
-    if (!in.good()) {
+    mp.clear();
+    binary_file_ = false;
+    log_end_ = 0;
+    if (!mapped_file_.open(data_file)) {
         get_logger_ref().log("load_file: No data file.", ffvms::LogLevel::WARNING, __LINE__);
         return false;
     }
-    mp.clear();
-    unsigned long long name_hash, data_hash, len;
-    std::vector<std::pair<double, double>> data;
-    while (in >> name_hash) {
-        data.clear();
-        in >> data_hash >> len;
-        if (in.eof()) {
+    if (ffvms::storage::has_file_magic(mapped_file_.data(), mapped_file_.size())) {
+        return load_binary_file();
+    }
+    bool ok = load_text_file();
+    mapped_file_.close();
+    return ok;
+}
+
+bool Saver::load_text_file() {
+    // Text records are parsed straight from the mapping and kept resident, since the file is rewritten on save
+    ffvms::storage::LegacyTextReader reader(mapped_file_.data(), mapped_file_.size());
+    ffvms::storage::LegacyTextRecord record;
+    while (reader.next(record)) {
+        // Text records were written by the FFT cipher; keep its doubles in payload form
+        save_data(record.name_hash, record.data_hash, std::move(record.payload), 0,
+                  static_cast<unsigned int>(ffvms::storage::CipherId::FFT),
+                  static_cast<unsigned int>(ffvms::storage::ChecksumKind::POLYNOMIAL));
+    }
+    if (!reader.ok()) {
+        mp.clear();
+        get_logger_ref().log("Read interrupted, please check data integrity.", ffvms::LogLevel::WARNING, __LINE__);
+        return false;
+    }
+    return true;
+}
+
+bool Saver::load_binary_file() {
+    using namespace ffvms::storage;
+    const char* file = mapped_file_.data();
+    const unsigned long long file_size = mapped_file_.size();
+
+    FileHeader header;
+    if (!decode_file_header(file, file_size, header) ||
+        header.index_offset > file_size ||
+        header.record_count > (file_size - header.index_offset) / INDEX_ENTRY_SIZE) {
+        mapped_file_.close();
+        get_logger_ref().log("Data file header is damaged, please check data integrity.", ffvms::LogLevel::WARNING, __LINE__);
+        return false;
+    }
+
+    auto map_record = [&](const RecordHeader& record, unsigned long long offset, unsigned long long size) {
+        dataNode& dn = mp[record.name_hash];
+        dn.name_hash = record.name_hash;
+        dn.data_hash = record.data_hash;
+        dn.codec = record.codec;
+        dn.cipher = record.cipher;
+        dn.checksum = record.checksum;
+        dn.payload.clear();
+        dn.mapped = true;
+        dn.file_offset = offset;
+        dn.file_size = size;
+    };
+
+    // Only the index and the fixed-size record headers are read here
+    for (unsigned long long i = 0; i < header.record_count; i++) {
+        IndexEntry entry;
+        RecordHeader record;
+        decode_index_entry(file + header.index_offset + i * INDEX_ENTRY_SIZE, INDEX_ENTRY_SIZE, entry);
+        bool intact = entry.offset >= FILE_HEADER_SIZE && entry.size >= RECORD_HEADER_SIZE &&
+                      entry.offset <= header.index_offset && entry.size <= header.index_offset - entry.offset &&
+                      decode_record_header(file + entry.offset, entry.size, record) &&
+                      record.name_hash == entry.name_hash && record.body_size == entry.size - 8 &&
+                      payload_matches(record, entry.size);
+        if (!intact) {
             mp.clear();
+            mapped_file_.close();
             get_logger_ref().log("Read interrupted, please check data integrity.", ffvms::LogLevel::WARNING, __LINE__);
             return false;
         }
-        for (unsigned long long i = 0; i < len * N; i++) {
-            double a, b;
-            in >> a >> b;
-            data.push_back(std::make_pair(a, b));
-        }
-        save_data(name_hash, data_hash, data);
+        map_record(record, entry.offset, entry.size);
+    }
+
+    // Records appended after the index was written supersede the indexed versions
+    log_end_ = scan_records(file, file_size, header.index_offset + header.record_count * INDEX_ENTRY_SIZE,
+                            map_record);
+    if (log_end_ < file_size) {
+        get_logger_ref().log("Ignoring " + std::to_string(file_size - log_end_) +
+                             " bytes of incomplete data at the end of " + data_file + ".",
+                             ffvms::LogLevel::WARNING, __LINE__);
     }
+    binary_file_ = true;
     return true;
 }
 
-void Saver::save_data(unsigned long long name_hash, unsigned long long data_hash,
-                      std::vector<std::pair<double, double>> data) {
-    if (mp.count(name_hash)) {
-        mp.erase(mp.find(name_hash));
+bool Saver::dropping_payloads() const {
+    return options_.drop_payloads && options_.mode == SaverOptions::Mode::APPEND_LOG;
+}
+
+void Saver::cover_record(const dataNode& node) {
+    // Records appended since the file was mapped lie past the end of the mapping
+    if (node.mapped && node.file_offset + node.file_size > mapped_file_.size()) mapped_file_.open(data_file);
+}
+
+std::string_view Saver::record_payload(const dataNode& node) const {
+    if (!node.mapped) return node.payload;
+    return std::string_view(mapped_file_.data() + node.file_offset + ffvms::storage::RECORD_HEADER_SIZE,
+                            node.file_size - ffvms::storage::RECORD_HEADER_SIZE);
+}
+
+ffvms::storage::IRecordCipher* Saver::cipher(unsigned int id) {
+    auto it = ciphers_.find(id);
+    if (it == ciphers_.end()) {
+        it = ciphers_.emplace(id, ffvms::storage::make_cipher(static_cast<ffvms::storage::CipherId>(id), key_)).first;
     }
-    mp[name_hash] = dataNode(name_hash, data_hash, data, N);
+    return it->second.get();
 }
 
-int Saver::read(std::string& s) {
-    size_t cur = 0;
-    int d = 0;
-    for (; cur < s.size() && !isdigit(s[cur]); cur++);
-    for (; cur < s.size() && isdigit(s[cur]); cur++) {
-        d = d * 10 + s[cur] - '0';
+void Saver::replay_journal() {
+    using namespace ffvms::storage;
+    const std::string wal = journal_file();
+    MappedFile journal;
+    if (!journal.open(wal)) return;
+    FileHeader header;
+    unsigned long long end = 0;
+    size_t recovered = 0;
+    if (decode_file_header(journal.data(), journal.size(), header) && header.index_offset <= journal.size()) {
+        end = scan_records(journal.data(), journal.size(), header.index_offset,
+                           [&](const RecordHeader& record, unsigned long long offset, unsigned long long size) {
+                               save_data(record.name_hash, record.data_hash,
+                                         std::string(journal.data() + offset + RECORD_HEADER_SIZE,
+                                                     size - RECORD_HEADER_SIZE),
+                                         record.codec, record.cipher, record.checksum);
+                               recovered++;
+                           });
+    }
+    const unsigned long long journal_size = journal.size();
+    journal.close();
+
+    // Cut a torn tail so that new entries are not appended behind it
+    std::error_code ec;
+    if (end == 0) {
+        std::filesystem::remove(wal, ec);
+    } else if (end < journal_size) {
+        std::filesystem::resize_file(wal, end, ec);
+    }
+    if (recovered > 0) {
+        get_logger_ref().log("Recovered " + std::to_string(recovered) + " unsaved records from " + wal + ".",
+                             ffvms::LogLevel::INFO, __LINE__);
     }
-    s.erase(s.begin(), s.begin() + cur + 1);
-    return d;
 }
 
-Saver::Saver() : logger_(nullptr) {
-    load_file();
+unsigned long long Saver::write_record(std::ostream& out, const dataNode& node) {
+    if (node.mapped) {
+        // Untouched records are already encoded; copy their bytes as they are
+        cover_record(node);
+        out.write(mapped_file_.data() + node.file_offset, static_cast<std::streamsize>(node.file_size));
+        return node.file_size;
+    }
+    const std::string header = record_header(node);
+    out.write(header.data(), static_cast<std::streamsize>(header.size()));
+    out.write(node.payload.data(), static_cast<std::streamsize>(node.payload.size()));
+    return header.size() + node.payload.size();
 }
 
-Saver::Saver(ffvms::ILogger* logger) : logger_(logger) {
-    load_file();
+bool Saver::write_file() {
+    using namespace ffvms::storage;
+    const std::string tmp_file = data_file + ".tmp";
+    std::ofstream out(tmp_file, std::ios::binary | std::ios::trunc);
+    if (!out.good()) {
+        get_logger_ref().log("Unable to open " + tmp_file + " for writing.", ffvms::LogLevel::FATAL, __LINE__);
+        return false;
+    }
+
+    FileHeader header;
+    header.record_count = mp.size();
+    std::string buffer;
+    encode_file_header(buffer, header);
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+
+    unsigned long long offset = FILE_HEADER_SIZE;
+    std::string index;
+    for (auto& data : mp) {
+        unsigned long long size = write_record(out, data.second);
+        encode_index_entry(index, IndexEntry{data.first, offset, size});
+        offset += size;
+    }
+    header.index_offset = offset;
+    out.write(index.data(), static_cast<std::streamsize>(index.size()));
+    buffer.clear();
+    encode_file_header(buffer, header);
+    out.seekp(0);
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    out.close();
+    mapped_file_.close();
+
+    const bool durable = options_.durability != Durability::NONE;
+    if (out.fail() || (durable && !sync_file(tmp_file)) || !replace_file(tmp_file, data_file)) {
+        std::remove(tmp_file.c_str());
+        get_logger_ref().log("Failed to write " + data_file + ".", ffvms::LogLevel::FATAL, __LINE__);
+        return false;
+    }
+    if (durable) sync_parent_directory(data_file);
+    return true;
 }
 
-Saver::~Saver() {
-    std::ofstream out(data_file);
+bool Saver::open_log() {
+    using namespace ffvms::storage;
+    if (journal_.is_open()) return true;
+    if (options_.mode == SaverOptions::Mode::APPEND_LOG) {
+        // Text files, and binary files with a damaged tail, are rewritten once so appends land on a clean log
+        bool clean = binary_file_ && log_end_ == mapped_file_.size();
+        if (!clean && (!write_file() || !load_file())) return false;
+    }
+    const std::string path = journal_file();
+    if (!journal_.open(path, options_.durability, std::chrono::milliseconds(options_.sync_interval_ms))) {
+        get_logger_ref().log("Unable to open " + path + " for appending.", ffvms::LogLevel::FATAL, __LINE__);
+        return false;
+    }
+    if (journal_.size() == 0) {
+        // A fresh write-ahead journal is a data file with an empty index followed by records
+        std::string header;
+        unsigned long long end;
+        encode_file_header(header, FileHeader{FORMAT_VERSION, 0, FILE_HEADER_SIZE});
+        if (!journal_.append(header, end)) return false;
+    }
+    return true;
+}
+
+bool Saver::append_record(dataNode& node, unsigned long long& end) {
+    // Two writes rather than one copy of the payload; the Saver lock keeps them adjacent
+    const std::string header = record_header(node);
+    const unsigned long long size = header.size() + node.payload.size();
+    const unsigned long long start = journal_.size();
+    if (!journal_.append(header, end) || !journal_.append(node.payload, end)) {
+        get_logger_ref().log("Failed to append to " + journal_file() + ".", ffvms::LogLevel::FATAL, __LINE__);
+        // Cut the partial record and reopen on the next save, so a retry appends after the last whole record
+        journal_.close();
+        std::error_code ec;
+        std::filesystem::resize_file(journal_file(), start, ec);
+        return false;
+    }
+    if (options_.mode == SaverOptions::Mode::APPEND_LOG) {
+        node.file_offset = end - size;
+        node.file_size = size;
+        log_end_ = end;
+    }
+    log_dirty_ = true;
+    return true;
+}
+
+bool Saver::write_log_index() {
+    using namespace ffvms::storage;
+    if (!log_dirty_ || !journal_.is_open()) return true;
+    FileHeader header;
+    std::string buffer;
+    for (auto& data : mp) {
+        if (data.second.file_size == 0) continue;
+        encode_index_entry(buffer, IndexEntry{data.first, data.second.file_offset, data.second.file_size});
+        header.record_count++;
+    }
+    header.index_offset = log_end_;
+    unsigned long long end;
+    // Closing the journal syncs the index before the header starts pointing at it
+    bool appended = journal_.append(buffer, end);
+    if (!journal_.close() || !appended) {
+        get_logger_ref().log("Failed to append the index of " + data_file + ".", ffvms::LogLevel::WARNING, __LINE__);
+        return false;
+    }
+
+    // Readers fall back to scanning the tail until the header points at the new index
+    std::fstream file(data_file, std::ios::binary | std::ios::in | std::ios::out);
+    buffer.clear();
+    encode_file_header(buffer, header);
+    file.seekp(0);
+    file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    file.close();
+    if (file.fail() || (options_.durability != Durability::NONE && !sync_file(data_file))) {
+        get_logger_ref().log("Failed to update the index of " + data_file + ".", ffvms::LogLevel::WARNING, __LINE__);
+        return false;
+    }
+    log_end_ = end;
+    log_dirty_ = false;
+    return true;
+}
+
+bool Saver::stored_intact(const dataNode& node) const {
+    // SNAPSHOT keeps every node for the next full write; APPEND_LOG only has what reached the file
+    if (node.damaged) return false;
+    return options_.mode == SaverOptions::Mode::SNAPSHOT || node.file_size != 0;
+}
+
+double Saver::dead_ratio() const {
+    if (log_end_ == 0) return 0.0;
+    unsigned long long live = ffvms::storage::FILE_HEADER_SIZE;
+    for (auto& data : mp) {
+        live += data.second.file_size + ffvms::storage::INDEX_ENTRY_SIZE;
+    }
+    return live >= log_end_ ? 0.0 : 1.0 - static_cast<double>(live) / static_cast<double>(log_end_);
+}
+
+void Saver::maybe_start_compaction() {
+    if (options_.mode != SaverOptions::Mode::APPEND_LOG || compaction_ || !binary_file_) return;
+    if (log_end_ < options_.compaction_min_bytes || dead_ratio() <= options_.compaction_threshold) return;
+    compaction_ = std::make_unique<CompactionJob>();
+    compaction_->tmp_file = data_file + ".compact";
+    for (auto& data : mp) {
+        if (data.second.file_size == 0) continue;
+        compaction_->live.push_back({data.first, data.second.file_offset, data.second.file_size});
+    }
+    CompactionJob* job = compaction_.get();
+    std::string source = data_file;
+    job->worker = std::thread([job, source] { job->run(source); });
+}
+
+void Saver::poll_compaction(bool shutting_down) {
+    if (!compaction_) return;
+    if (!compaction_->done && !shutting_down) return;
+    if (!compaction_->done) compaction_->cancel = true;
+    compaction_->worker.join();
+    if (!compaction_->ok || !finish_compaction()) {
+        std::remove(compaction_->tmp_file.c_str());
+    }
+    compaction_.reset();
+}
+
+bool Saver::finish_compaction() {
+    using namespace ffvms::storage;
+    CompactionJob& job = *compaction_;
+    std::fstream out(job.tmp_file, std::ios::binary | std::ios::in | std::ios::out);
+    std::ifstream in(data_file, std::ios::binary);
+    out.seekp(static_cast<std::streamoff>(job.end));
+
+    // Records that moved in the background keep their new offsets; newer versions are copied now
+    std::map<unsigned long long, std::pair<unsigned long long, unsigned long long>> moved;
+    for (size_t i = 0; i < job.live.size(); i++) {
+        moved[job.live[i].name_hash] = std::make_pair(job.live[i].offset, job.new_offsets[i]);
+    }
+    std::map<unsigned long long, unsigned long long> new_offset;
+    unsigned long long end = job.end;
+    std::string buffer;
+    std::string index;
     for (auto& data : mp) {
         dataNode& dn = data.second;
-        out << data.first << ' ' << dn.data_hash << ' ' << dn.len;
-        for (auto& pr : dn.data) {
-            out << ' ' << pr.first << ' ' << pr.second;
+        if (dn.file_size == 0) continue;
+        auto it = moved.find(data.first);
+        if (it != moved.end() && it->second.first == dn.file_offset) {
+            new_offset[data.first] = it->second.second;
+        } else {
+            buffer.resize(dn.file_size);
+            in.seekg(static_cast<std::streamoff>(dn.file_offset));
+            in.read(&buffer[0], static_cast<std::streamsize>(buffer.size()));
+            out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            new_offset[data.first] = end;
+            end += dn.file_size;
         }
-        out << '\n';
+        encode_index_entry(index, IndexEntry{data.first, new_offset[data.first], dn.file_size});
+    }
+    FileHeader header;
+    header.record_count = new_offset.size();
+    header.index_offset = end;
+    out.write(index.data(), static_cast<std::streamsize>(index.size()));
+    buffer.clear();
+    encode_file_header(buffer, header);
+    out.seekp(0);
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    out.close();
+    in.close();
+    const bool durable = options_.durability != Durability::NONE;
+    if (out.fail() || in.fail() || (durable && !sync_file(job.tmp_file))) {
+        get_logger_ref().log("Compaction of " + data_file + " failed; keeping the current log.", ffvms::LogLevel::WARNING, __LINE__);
+        return false;
+    }
+
+    journal_.close();
+    mapped_file_.close();
+    if (!replace_file(job.tmp_file, data_file)) {
+        get_logger_ref().log("Unable to replace " + data_file + " with its compacted copy.", ffvms::LogLevel::WARNING, __LINE__);
+        mapped_file_.open(data_file);
+        return false;
+    }
+    if (durable) sync_parent_directory(data_file);
+    mapped_file_.open(data_file);
+    for (auto& data : mp) {
+        if (data.second.file_size != 0) data.second.file_offset = new_offset[data.first];
+    }
+    log_end_ = end + index.size();
+    log_dirty_ = false;
+    get_logger_ref().log("Compacted " + data_file + " to " + std::to_string(log_end_) + " bytes.", ffvms::LogLevel::INFO, __LINE__);
+    return true;
+}
+
+void Saver::save_data(unsigned long long name_hash, unsigned long long data_hash, std::string payload,
+                      unsigned int codec, unsigned int cipher, unsigned int checksum) {
+    if (mp.count(name_hash)) {
+        mp.erase(mp.find(name_hash));
+    }
+    mp[name_hash] = dataNode(name_hash, data_hash, std::move(payload), codec, cipher, checksum);
+}
+
+void Saver::init() {
+    load_file();
+    if (options_.mode == SaverOptions::Mode::SNAPSHOT) replay_journal();
+    // Rewriting a text file now leaves every record in the mapped binary file
+    if (dropping_payloads() && !binary_file_ && !mp.empty()) open_log();
+    maybe_start_compaction();
+}
+
+Saver::Saver() : key_(ffvms::storage::derive_key(options_.passphrase)), logger_(nullptr) {
+    init();
+}
+
+Saver::Saver(ffvms::ILogger* logger) : key_(ffvms::storage::derive_key(options_.passphrase)), logger_(logger) {
+    init();
+}
+
+Saver::Saver(ffvms::ILogger* logger, const std::string& data_file, const SaverOptions& options)
+    : data_file(data_file), options_(options), key_(ffvms::storage::derive_key(options.passphrase)), logger_(logger) {
+    init();
+}
+
+Saver::~Saver() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    poll_compaction(true);
+    if (options_.mode == SaverOptions::Mode::APPEND_LOG) {
+        write_log_index();
+        return;
+    }
+    // The journal is only dropped once everything it holds is in the new data file
+    if (write_file() && journal_.close()) {
+        std::remove(journal_file().c_str());
     }
 }
 
 // IStorage interface implementation
+bool Saver::store_table(std::unique_lock<std::mutex>& lock, const std::string& name, const std::string& data) {
+    // An unchanged table keeps its stored record: no compression, encryption or append
+    const unsigned int checksum = static_cast<unsigned int>(ffvms::storage::ChecksumKind::CRC32C_BLOCKS);
+    unsigned long long name_hash = get_hash(name);
+    unsigned long long data_hash = ffvms::storage::xxhash64(data);
+    auto existing = mp.find(name_hash);
+    if (existing != mp.end() && stored_intact(existing->second) && existing->second.data_hash == data_hash &&
+        existing->second.checksum == checksum && existing->second.cipher == static_cast<unsigned int>(options_.cipher)) {
+        return true;
+    }
+    // Compress before encrypting so the FFT only sees the smaller payload
+    unsigned int codec = static_cast<unsigned int>(ffvms::storage::CodecId::NONE);
+    std::string compressed;
+    const ffvms::storage::ICodec* compressor = ffvms::storage::find_codec(options_.codec);
+    if (compressor && compressor->id() != ffvms::storage::CodecId::NONE) {
+        compressor->compress(data, compressed);
+        if (compressed.size() < data.size()) codec = static_cast<unsigned int>(compressor->id());
+    }
+    // The checksums go in front of the data, so the encryption covers them too
+    std::string plain;
+    ffvms::storage::BlockChecksums::compute(data).encode(plain);
+    plain += codec ? compressed : data;
+    std::string().swap(compressed);
+    ffvms::storage::IRecordCipher* encryptor = cipher(static_cast<unsigned int>(options_.cipher));
+    if (!encryptor) {
+        get_logger_ref().log("Failed to save data. Unknown cipher.", ffvms::LogLevel::FATAL, __LINE__);
+        return false;
+    }
+    std::string payload;
+    encryptor->encrypt(plain, payload);
+    std::string().swap(plain);
+    poll_compaction();
+    if (!open_log()) return false;
+    // The node replaces the stored one only once its record is in the journal
+    dataNode node(name_hash, data_hash, std::move(payload), codec, static_cast<unsigned int>(encryptor->id()), checksum);
+    unsigned long long end;
+    if (!append_record(node, end)) return false;
+    if (dropping_payloads()) {
+        // The data file has the record now; a later load reads it back from there. Swapping, unlike
+        // assigning an empty string, also frees the buffer
+        std::string().swap(node.payload);
+        node.mapped = true;
+    }
+    mp[name_hash] = std::move(node);
+    maybe_start_compaction();
+
+    // Waiting for the sync outside the lock lets concurrent saves share one fsync
+    lock.unlock();
+    return journal_.commit(end);
+}
+
 bool Saver::save(const std::string& name, const ffvms::DataTable& content) {
+    std::unique_lock<std::mutex> lock(mutex_);
     std::string data;
-    data += std::to_string(content.size());
-    for (const auto& data_block : content) {
-        data += " " + std::to_string(data_block.size());
-        for (const auto& dt : data_block) {
-            data += " " + std::to_string(dt.size()) + " " + dt;
-        }
-    }
-    std::vector<int> sequence;
-    for (auto& it : data) {
-        sequence.push_back(static_cast<int>(it));
+    ffvms::storage::TextTableWriter writer(data);
+    writer.begin_table(content.size());
+    for (const auto& row : content) {
+        writer.begin_row(row.size());
+        for (const auto& field : row) writer.str(field);
     }
-    std::vector<std::pair<double, double>> res;
-    encrypt_sequence(sequence, res);
-    unsigned long long name_hash = get_hash(name);
-    unsigned long long data_hash = get_hash(data);
-    save_data(name_hash, data_hash, res);
-    return true;
+    return store_table(lock, name, data);
 }
 
-// IStorage interface implementation
-bool Saver::load(const std::string& name, ffvms::DataTable& content, bool mandatory_access) {
+bool Saver::save_records(const std::string& name, const RecordSource& write) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::string data;
+    ffvms::storage::TextTableWriter writer(data);
+    write(writer);
+    return store_table(lock, name, data);
+}
+
+bool Saver::decode_table(const std::string& name, std::string& data, bool mandatory_access) {
+    poll_compaction();
     unsigned long long name_hash = get_hash(name);
-    if (!mp.count(name_hash)) {
+    auto it = mp.find(name_hash);
+    if (it == mp.end()) {
         get_logger_ref().log("Failed to load data. No data named " + name + " exists.", ffvms::LogLevel::WARNING, __LINE__);
         return false;
     }
-    dataNode& data = mp[name_hash];
-    std::vector<int> sequence;
-    decrypt_sequence(data.data, sequence);
-    if (get_hash(sequence) != data.data_hash) {
+    dataNode& node = it->second;
+    cover_record(node);
+    ffvms::storage::IRecordCipher* decryptor = cipher(node.cipher);
+    bool decrypted = decryptor && decryptor->decrypt(record_payload(node), data);
+    if (node.mapped && dropping_payloads()) mapped_file_.release(node.file_offset, node.file_size);
+    if (!decrypted) {
+        node.damaged = true;
+        get_logger_ref().log("Failed to load data. Unable to decrypt " + name + ".", ffvms::LogLevel::WARNING, __LINE__);
+        return false;
+    }
+    const bool block_checksums = node.checksum == static_cast<unsigned int>(ffvms::storage::ChecksumKind::CRC32C_BLOCKS);
+    ffvms::storage::BlockChecksums sums;
+    size_t table_size = 0;
+    if (block_checksums) {
+        ffvms::storage::ByteReader in(data.data(), data.size());
+        if (!sums.decode(in)) {
+            node.damaged = true;
+            get_logger_ref().log("Failed to load data. Checksums of " + name + " are damaged.", ffvms::LogLevel::WARNING, __LINE__);
+            return false;
+        }
+        table_size = data.size() - in.remaining();
+    }
+    if (node.codec != static_cast<unsigned int>(ffvms::storage::CodecId::NONE)) {
+        const ffvms::storage::ICodec* codec = ffvms::storage::find_codec(static_cast<ffvms::storage::CodecId>(node.codec));
+        std::string decompressed;
+        if (!codec || !codec->decompress(std::string_view(data).substr(table_size), decompressed)) {
+            node.damaged = true;
+            get_logger_ref().log("Failed to load data. Unable to decompress " + name + ".", ffvms::LogLevel::WARNING, __LINE__);
+            return false;
+        }
+        data.swap(decompressed);
+    } else {
+        data.erase(0, table_size);
+    }
+    // The checksums cover the serialized table, so they also check the decompression
+    if (!block_checksums) {
+        if (get_hash(data) != node.data_hash) {
+            node.damaged = true;
+            get_logger_ref().log("Data failed to pass integrity verification.", ffvms::LogLevel::WARNING, __LINE__);
+            if (!mandatory_access) return false;
+        }
+        return true;
+    }
+    const size_t block = sums.first_mismatch(data);
+    if (block == ffvms::storage::BlockChecksums::NONE && ffvms::storage::xxhash64(data) != node.data_hash) {
+        node.damaged = true;
         get_logger_ref().log("Data failed to pass integrity verification.", ffvms::LogLevel::WARNING, __LINE__);
         if (!mandatory_access) return false;
+    } else if (block != ffvms::storage::BlockChecksums::NONE) {
+        const unsigned long long begin = block * sums.block_size();
+        const unsigned long long end = std::min<unsigned long long>(begin + sums.block_size(), sums.size());
+        node.damaged = true;
+        get_logger_ref().log("Data failed to pass integrity verification. Block " + std::to_string(block) + " of " + name +
+                             " (bytes " + std::to_string(begin) + "-" + std::to_string(end) + ") is corrupt.",
+                             ffvms::LogLevel::WARNING, __LINE__);
+        if (!mandatory_access) return false;
     }
-    std::string str;
-    for (auto& it : sequence) {
-        str.push_back(static_cast<char>(it));
-    }
-    
-    content.clear();
-    int block_num, data_num, data_len;
-    block_num = read(str);
-    for (int i = 0; i < block_num; i++) {
-        content.push_back(std::vector<std::string>());
-        data_num = read(str);
-        for (int j = 0; j < data_num; j++) {
-            data_len = read(str);
-            if (str.size() < static_cast<size_t>(data_len)) {
-                get_logger_ref().log("Failed to load data. Data corrupted.", ffvms::LogLevel::WARNING, __LINE__);
-                return false;
-            }
-            content.back().push_back(std::string(str.begin(), str.begin() + data_len));
-            str.erase(str.begin(), str.begin() + data_len);
+    return true;
+}
+
+unsigned long long Saver::resident_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    unsigned long long bytes = 0;
+    for (auto& data : mp) bytes += data.second.payload.size();
+    return bytes;
+}
+
+bool Saver::load(const std::string& name, ffvms::DataTable& content, bool mandatory_access) {
+    return load_records(name, [&content](ffvms::IRecordReader& reader) {
+        ffvms::DataTable table;
+        table.reserve(reader.rows());
+        std::size_t fields;
+        std::string_view field;
+        while (reader.next_row(fields)) {
+            table.emplace_back();
+            table.back().reserve(fields);
+            for (std::size_t i = 0; i < fields && reader.str(field); i++) table.back().emplace_back(field);
         }
+        if (!reader.ok()) return false;
+        content = std::move(table);
+        return true;
+    }, mandatory_access);
+}
+
+bool Saver::load_records(const std::string& name, const RecordSink& read, bool mandatory_access) {
+    std::string data;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!decode_table(name, data, mandatory_access)) return false;
+    }
+    // The decoded copy is private, so parsing needs no lock
+    ffvms::storage::TextTableReader reader(data);
+    if (!read(reader) || !reader.ok()) {
+        get_logger_ref().log("Failed to load data. Data corrupted.", ffvms::LogLevel::WARNING, __LINE__);
+        return false;
     }
     return true;
 }
@@ -187,3 +778,16 @@ Saver& Saver::get_saver() {
     static Saver saver;
     return saver;
 }
+
+namespace {
+std::atomic<ffvms::IStorage*> default_storage{nullptr};
+}
+
+ffvms::IStorage& Saver::get_default_storage() {
+    if (ffvms::IStorage* storage = default_storage.load()) return *storage;
+    return get_saver();
+}
+
+void Saver::set_default_storage(ffvms::IStorage* storage) {
+    default_storage.store(storage);
+}
@@ -0,0 +1,478 @@
+/**
+ * @file async_io.cpp
+ * @brief Thread pool and io_uring implementations of IAsyncIo
+ */
+
+#include "storage/async_io.h"
+#include "storage/file_util.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#ifdef FFVMS_HAVE_IO_URING
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace ffvms::storage {
+
+namespace {
+
+class ThreadIo : public IAsyncIo {
+private:
+    ffvms::ThreadPool& pool_;
+
+public:
+    explicit ThreadIo(ffvms::ThreadPool& pool) : pool_(pool) {}
+
+    const char* name() const override { return "threads"; }
+
+    bool read_files(const std::vector<std::string>& paths, const ReadDone& done) override {
+        std::atomic<bool> ok{true};
+        pool_.parallel_for(paths.size(), 1, [&](std::size_t begin, std::size_t end) {
+            std::string bytes;
+            for (std::size_t i = begin; i < end && ok; i++) {
+                if (!read_whole_file(paths[i], bytes) || !done(i, std::move(bytes))) ok = false;
+            }
+        });
+        return ok;
+    }
+
+    bool write_files(const std::vector<FileWrite>& files, bool sync) override {
+        std::atomic<bool> ok{true};
+        pool_.parallel_for(files.size(), 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end && ok; i++) {
+                if (!write_whole_file(files[i].path, files[i].bytes, sync)) ok = false;
+            }
+        });
+        return ok;
+    }
+};
+
+#ifdef FFVMS_HAVE_IO_URING
+
+// liburing is not required: the ring is set up and driven with the raw system calls
+
+int uring_setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int uring_enter(int fd, unsigned submit, unsigned wait, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, submit, wait, flags, nullptr, 0));
+}
+
+int uring_register(int fd, unsigned opcode, void* arg, unsigned count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+/**
+ * @brief Submission and completion queues of one io_uring instance
+ *
+ * Not thread-safe; only one thread may drive a ring at a time.
+ */
+class Ring {
+private:
+    int fd_ = -1;
+    io_uring_params params_{};
+    void* sq_ring_ = MAP_FAILED;
+    void* cq_ring_ = MAP_FAILED;
+    void* sqes_ = MAP_FAILED;
+    std::size_t sq_ring_size_ = 0;
+    std::size_t cq_ring_size_ = 0;
+    std::size_t sqes_size_ = 0;
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+    unsigned unsubmitted_ = 0;
+
+    void reset() {
+        if (sqes_ != MAP_FAILED) munmap(sqes_, sqes_size_);
+        if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) munmap(cq_ring_, cq_ring_size_);
+        if (sq_ring_ != MAP_FAILED) munmap(sq_ring_, sq_ring_size_);
+        if (fd_ >= 0) close(fd_);
+        sqes_ = cq_ring_ = sq_ring_ = MAP_FAILED;
+        fd_ = -1;
+    }
+
+public:
+    explicit Ring(unsigned entries) {
+        fd_ = uring_setup(entries, &params_);
+        if (fd_ < 0) return;
+        sq_ring_size_ = params_.sq_off.array + params_.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = params_.cq_off.cqes + params_.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = params_.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+
+        sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                        IORING_OFF_SQ_RING);
+        if (sq_ring_ == MAP_FAILED) {
+            reset();
+            return;
+        }
+        cq_ring_ = single_mmap ? sq_ring_
+                               : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                      fd_, IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED) {
+            reset();
+            return;
+        }
+        sqes_size_ = params_.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+        if (sqes_ == MAP_FAILED) {
+            reset();
+            return;
+        }
+
+        char* sq = static_cast<char*>(sq_ring_);
+        char* cq = static_cast<char*>(cq_ring_);
+        sq_head_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.tail);
+        sq_mask_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.array);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params_.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params_.cq_off.tail);
+        cq_mask_ = reinterpret_cast<unsigned*>(cq + params_.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params_.cq_off.cqes);
+    }
+
+    ~Ring() { reset(); }
+
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+
+    bool ok() const { return fd_ >= 0; }
+
+    /// @brief Ask the kernel whether it implements every opcode in @p ops
+    bool supports(std::initializer_list<int> ops) {
+        constexpr unsigned MAX_OPS = 256;
+        std::vector<char> buffer(sizeof(io_uring_probe) + MAX_OPS * sizeof(io_uring_probe_op), 0);
+        auto* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+        if (!ok() || uring_register(fd_, IORING_REGISTER_PROBE, probe, MAX_OPS) < 0) return false;
+        for (int op : ops) {
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) return false;
+        }
+        return true;
+    }
+
+    /// @return false if the submission queue is full
+    bool push(const io_uring_sqe& entry) {
+        const unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        const unsigned tail = *sq_tail_;
+        if (tail - head >= params_.sq_entries) return false;
+        const unsigned slot = tail & *sq_mask_;
+        static_cast<io_uring_sqe*>(sqes_)[slot] = entry;
+        sq_array_[slot] = slot;
+        __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+        unsubmitted_++;
+        return true;
+    }
+
+    /**
+     * @brief Hand queued entries to the kernel and wait for @p wait completions
+     * @return 0, or the errno of a failure other than EINTR
+     */
+    int submit(unsigned wait) {
+        while (true) {
+            int consumed = uring_enter(fd_, unsubmitted_, wait, wait ? IORING_ENTER_GETEVENTS : 0);
+            if (consumed >= 0) {
+                unsubmitted_ -= static_cast<unsigned>(consumed);
+                return 0;
+            }
+            if (errno != EINTR) return errno;
+        }
+    }
+
+    /// @brief Wait for a completion without submitting anything; 0 or the errno
+    int wait() {
+        while (true) {
+            if (uring_enter(fd_, 0, 1, IORING_ENTER_GETEVENTS) >= 0) return 0;
+            if (errno != EINTR) return errno;
+        }
+    }
+
+    /// Entries queued that the kernel has not taken yet
+    unsigned unsubmitted() const { return unsubmitted_; }
+
+    bool has_completions() const { return *cq_head_ != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE); }
+
+    template <typename F>
+    void reap(F&& on_completion) {
+        unsigned head = *cq_head_;
+        const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) on_completion(cqes_[head & *cq_mask_]);
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    }
+};
+
+class UringIo : public IAsyncIo {
+private:
+    struct Request {
+        std::size_t index = 0;
+        int fd = -1;
+        std::string buffer;            ///< Destination of a read
+        std::string_view bytes;        ///< Source of a write
+        std::size_t done = 0;
+        bool syncing = false;
+    };
+
+    enum class Start { QUEUED, FINISHED, FAILED };
+    enum class Step { AGAIN, FINISHED, FAILED };
+
+    ffvms::ThreadPool& pool_;
+    const unsigned depth_;
+    Ring ring_;
+    bool usable_ = false;
+    std::mutex mutex_;
+
+    /**
+     * @brief Keep up to depth_ of @p count requests in flight until all finish
+     *
+     * @p start opens request i, @p prepare fills its next submission,
+     * @p step handles a completion and @p finish takes a finished request.
+     */
+    bool run(std::size_t count, const std::atomic<bool>& ok,
+             const std::function<Start(Request&)>& start,
+             const std::function<void(Request&, io_uring_sqe&)>& prepare,
+             const std::function<Step(Request&, int)>& step,
+             const std::function<bool(Request&)>& finish) {
+        std::vector<Request> slots(depth_);
+        std::vector<std::size_t> free_slots;
+        for (std::size_t i = depth_; i-- > 0;) free_slots.push_back(i);
+        bool batch_ok = true;
+        std::size_t next = 0, in_flight = 0;
+
+        auto queue = [&](std::size_t slot) {
+            io_uring_sqe entry;
+            std::memset(&entry, 0, sizeof(entry));
+            prepare(slots[slot], entry);
+            entry.user_data = slot;
+            return ring_.push(entry);
+        };
+        auto release = [&](std::size_t slot, bool finished) {
+            Request& request = slots[slot];
+            if (request.fd >= 0) close(request.fd);
+            request.fd = -1;
+            if (!finished || !finish(request)) batch_ok = false;
+            free_slots.push_back(slot);
+        };
+        // The kernel writes into the buffers of submitted requests until they complete, so
+        // they are waited for before the slots go; the ring is not used again
+        auto abandon = [&] {
+            usable_ = false;
+            while (in_flight > ring_.unsubmitted()) {
+                ring_.reap([&](const io_uring_cqe& cqe) {
+                    in_flight--;
+                    release(static_cast<std::size_t>(cqe.user_data), false);
+                });
+                if (in_flight <= ring_.unsubmitted()) break;
+                const int error = ring_.wait();
+                if (error != 0 && error != EBUSY && error != EAGAIN) break;
+            }
+            for (Request& request : slots) {
+                if (request.fd >= 0) close(request.fd);
+                request.fd = -1;
+            }
+            return false;
+        };
+
+        while (true) {
+            while (batch_ok && ok && next < count && !free_slots.empty()) {
+                std::size_t slot = free_slots.back();
+                free_slots.pop_back();
+                Request& request = slots[slot];
+                request = Request();
+                request.index = next++;
+                Start started = start(request);
+                if (started == Start::QUEUED && queue(slot)) {
+                    in_flight++;
+                } else {
+                    release(slot, started == Start::FINISHED);
+                }
+            }
+            if (in_flight == 0) break;
+            int error = ring_.submit(1);
+            // EBUSY (completion queue full) and EAGAIN (kernel short of memory) clear as completions are reaped
+            if ((error == EBUSY || error == EAGAIN) && !ring_.has_completions()) error = ring_.wait();
+            if (error != 0 && error != EBUSY && error != EAGAIN) {
+                // Only a broken ring gets here; later batches use blocking I/O
+                return abandon();
+            }
+            ring_.reap([&](const io_uring_cqe& cqe) {
+                std::size_t slot = static_cast<std::size_t>(cqe.user_data);
+                Step result = step(slots[slot], cqe.res);
+                if (result == Step::AGAIN && queue(slot)) return;
+                in_flight--;
+                release(slot, result == Step::FINISHED);
+            });
+        }
+        return batch_ok && next == count;
+    }
+
+    /// Longest single read or write; the kernel caps them near 2 GB anyway
+    static constexpr std::size_t MAX_TRANSFER = std::size_t(1) << 30;
+
+    static std::uint32_t transfer_size(std::size_t remaining) {
+        return static_cast<std::uint32_t>(std::min(remaining, MAX_TRANSFER));
+    }
+
+    static Step advance(Request& request, int res, std::size_t size) {
+        if (res == -EINTR || res == -EAGAIN) return Step::AGAIN;
+        if (res <= 0) return Step::FAILED;   // Errors, or a file shrinking under the read
+        request.done += static_cast<std::size_t>(res);
+        return request.done < size ? Step::AGAIN : Step::FINISHED;
+    }
+
+public:
+    UringIo(ffvms::ThreadPool& pool, unsigned depth)
+        : pool_(pool), depth_(depth ? depth : 1), ring_(depth_) {
+        usable_ = ring_.supports({IORING_OP_READ, IORING_OP_WRITE, IORING_OP_FSYNC});
+    }
+
+    bool usable() const { return usable_; }
+
+    const char* name() const override { return "io_uring"; }
+
+    bool read_files(const std::vector<std::string>& paths, const ReadDone& done) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!usable_) return ThreadIo(pool_).read_files(paths, done);
+
+        struct Ready {
+            std::mutex mutex;
+            std::condition_variable cv;
+            std::deque<std::pair<std::size_t, std::string>> files;
+            bool closed = false;
+        } ready;
+        std::atomic<bool> ok{true};
+
+        // Chunk 0 drives the ring; every chunk then parses files as they arrive
+        pool_.parallel_for(pool_.size() + 1, 1, [&](std::size_t chunk, std::size_t) {
+            if (chunk == 0) {
+                bool read_ok = run(
+                    paths.size(), ok,
+                    [&](Request& request) {
+                        request.fd = open(paths[request.index].c_str(), O_RDONLY | O_CLOEXEC);
+                        struct stat st;
+                        if (request.fd < 0 || fstat(request.fd, &st) != 0) return Start::FAILED;
+                        request.buffer.resize(static_cast<std::size_t>(st.st_size));
+                        return request.buffer.empty() ? Start::FINISHED : Start::QUEUED;
+                    },
+                    [](Request& request, io_uring_sqe& entry) {
+                        entry.opcode = IORING_OP_READ;
+                        entry.fd = request.fd;
+                        entry.addr = reinterpret_cast<std::uint64_t>(request.buffer.data() + request.done);
+                        entry.len = transfer_size(request.buffer.size() - request.done);
+                        entry.off = request.done;
+                    },
+                    [](Request& request, int res) { return advance(request, res, request.buffer.size()); },
+                    [&](Request& request) {
+                        {
+                            std::lock_guard<std::mutex> guard(ready.mutex);
+                            ready.files.emplace_back(request.index, std::move(request.buffer));
+                        }
+                        ready.cv.notify_one();
+                        return true;
+                    });
+                if (!read_ok) ok = false;
+                {
+                    std::lock_guard<std::mutex> guard(ready.mutex);
+                    ready.closed = true;
+                }
+                ready.cv.notify_all();
+            }
+            while (true) {
+                std::pair<std::size_t, std::string> file;
+                {
+                    std::unique_lock<std::mutex> guard(ready.mutex);
+                    ready.cv.wait(guard, [&] { return ready.closed || !ready.files.empty(); });
+                    if (ready.files.empty()) return;
+                    file = std::move(ready.files.front());
+                    ready.files.pop_front();
+                }
+                if (ok && !done(file.first, std::move(file.second))) ok = false;
+            }
+        });
+        return ok;
+    }
+
+    bool write_files(const std::vector<FileWrite>& files, bool sync) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!usable_) return ThreadIo(pool_).write_files(files, sync);
+
+        const std::atomic<bool> ok{true};
+        return run(
+            files.size(), ok,
+            [&](Request& request) {
+                request.bytes = files[request.index].bytes;
+                request.fd = open(files[request.index].path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+                if (request.fd < 0) return Start::FAILED;
+                request.syncing = request.bytes.empty();
+                return request.syncing && !sync ? Start::FINISHED : Start::QUEUED;
+            },
+            [](Request& request, io_uring_sqe& entry) {
+                entry.fd = request.fd;
+                if (request.syncing) {
+                    entry.opcode = IORING_OP_FSYNC;
+                    entry.fsync_flags = IORING_FSYNC_DATASYNC;
+                    return;
+                }
+                entry.opcode = IORING_OP_WRITE;
+                entry.addr = reinterpret_cast<std::uint64_t>(request.bytes.data() + request.done);
+                entry.len = transfer_size(request.bytes.size() - request.done);
+                entry.off = request.done;
+            },
+            [sync](Request& request, int res) {
+                if (request.syncing) {
+                    if (res == -EINTR || res == -EAGAIN) return Step::AGAIN;
+                    return res == 0 ? Step::FINISHED : Step::FAILED;
+                }
+                Step result = advance(request, res, request.bytes.size());
+                if (result == Step::FINISHED && sync) {
+                    request.syncing = true;
+                    return Step::AGAIN;
+                }
+                return result;
+            },
+            [](Request&) { return true; });
+    }
+};
+
+#endif  // FFVMS_HAVE_IO_URING
+
+}  // namespace
+
+bool io_uring_available() {
+#ifdef FFVMS_HAVE_IO_URING
+    Ring ring(2);
+    return ring.supports({IORING_OP_READ, IORING_OP_WRITE, IORING_OP_FSYNC});
+#else
+    return false;
+#endif
+}
+
+std::unique_ptr<IAsyncIo> make_async_io(IoBackend backend, ffvms::ThreadPool& pool, unsigned queue_depth) {
+#ifdef FFVMS_HAVE_IO_URING
+    if (backend != IoBackend::THREADS) {
+        auto io = std::make_unique<UringIo>(pool, queue_depth);
+        if (io->usable()) return io;
+    }
+#else
+    (void)backend;
+    (void)queue_depth;
+#endif
+    return std::make_unique<ThreadIo>(pool);
+}
+
+}  // namespace ffvms::storage
@@ -0,0 +1,74 @@
+/**
+ * @file block_checksums.cpp
+ * @brief Implementation of per-block record checksums
+ */
+
+#include "storage/block_checksums.h"
+#include "storage/crc32c.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace ffvms::storage {
+
+namespace {
+
+/// Blocks below which checksumming is not worth splitting across threads
+constexpr std::size_t PARALLEL_MIN_BLOCKS = 16;
+
+/// Largest block size decode() accepts
+constexpr std::uint64_t MAX_BLOCK_SIZE = 1ULL << 30;
+
+std::uint32_t block_crc(std::string_view data, std::uint64_t block_size, std::size_t block) {
+    const std::size_t begin = static_cast<std::size_t>(block * block_size);
+    return crc32c(data.data() + begin, std::min<std::size_t>(static_cast<std::size_t>(block_size), data.size() - begin));
+}
+
+}  // namespace
+
+BlockChecksums BlockChecksums::compute(std::string_view data, ThreadPool* pool, std::size_t block_size) {
+    BlockChecksums sums;
+    sums.size_ = data.size();
+    sums.block_size_ = block_size;
+    sums.crcs_.resize((data.size() + block_size - 1) / block_size);
+    for_blocks(pool, sums.crcs_.size(), PARALLEL_MIN_BLOCKS, [&](std::size_t first, std::size_t last) {
+        for (std::size_t b = first; b < last; b++) sums.crcs_[b] = block_crc(data, block_size, b);
+    });
+    return sums;
+}
+
+void BlockChecksums::encode(std::string& out) const {
+    put_varint(out, size_);
+    put_varint(out, block_size_);
+    const std::size_t at = out.size();
+    out.resize(at + crcs_.size() * 4);
+    for (std::size_t i = 0; i < crcs_.size(); i++) store_u32(&out[at + i * 4], crcs_[i]);
+}
+
+bool BlockChecksums::decode(ByteReader& in) {
+    size_ = in.varint();
+    block_size_ = in.varint();
+    if (!in.ok() || block_size_ == 0 || block_size_ > MAX_BLOCK_SIZE) return false;
+    const std::uint64_t blocks = size_ == 0 ? 0 : (size_ - 1) / block_size_ + 1;
+    if (blocks > in.remaining() / 4) return false;
+    crcs_.resize(static_cast<std::size_t>(blocks));
+    for (auto& crc : crcs_) crc = in.u32();
+    return in.ok();
+}
+
+std::size_t BlockChecksums::first_mismatch(std::string_view data, ThreadPool* pool) const {
+    if (data.size() != size_) return 0;
+    std::atomic<std::size_t> first{NONE};
+    for_blocks(pool, crcs_.size(), PARALLEL_MIN_BLOCKS, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t b = begin; b < end && b < first.load(std::memory_order_relaxed); b++) {
+            if (block_crc(data, block_size_, b) == crcs_[b]) continue;
+            std::size_t seen = first.load();
+            while (b < seen && !first.compare_exchange_weak(seen, b)) {
+            }
+            break;
+        }
+    });
+    return first.load();
+}
+
+}  // namespace ffvms::storage
@@ -0,0 +1,446 @@
+/**
+ * @file btree.cpp
+ * @brief Implementation of the paged B+tree
+ */
+
+#include "storage/btree.h"
+#include "storage/byte_io.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+namespace ffvms::storage {
+
+namespace {
+
+constexpr char TREE_MAGIC[8] = {'F', 'F', 'V', 'M', 'S', 'B', 'P', 'T'};
+constexpr std::uint32_t TREE_VERSION = 1;
+
+enum PageType : unsigned char { FREE_PAGE = 0, LEAF_PAGE = 1, INTERNAL_PAGE = 2, OVERFLOW_PAGE = 3 };
+
+constexpr std::size_t NODE_HEADER = 16;
+constexpr std::size_t LEAF_ENTRY_FIXED = 21;
+constexpr std::size_t INTERNAL_ENTRY = 24;
+constexpr std::size_t OVERFLOW_HEADER = 16;
+constexpr std::size_t OVERFLOW_CAPACITY = PAGE_SIZE - OVERFLOW_HEADER;
+
+/// Deeper paths only come from corrupted files and would otherwise loop forever
+constexpr int MAX_DEPTH = 64;
+
+std::uint64_t digest_of(std::string_view value) {
+    std::uint64_t h = 14695981039346656037ULL;
+    for (unsigned char c : value) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+}  // namespace
+
+BTree::BTree(std::size_t pool_pages) : pool_(pool_pages) {}
+
+BTree::~BTree() {
+    close();
+}
+
+bool BTree::open(const std::string& path) {
+    close();
+    // Only a missing or empty file is initialized; anything else must be a whole tree
+    std::error_code ec;
+    auto bytes = std::filesystem::file_size(path, ec);
+    if (!ec && bytes % PAGE_SIZE != 0) return false;
+    if (!pool_.open(path)) return false;
+    if (pool_.page_count() == 0) {
+        BufferPool::Page header = pool_.allocate();
+        BufferPool::Page root = pool_.allocate();
+        if (!header || !root) return false;
+        root.mutable_data()[0] = static_cast<char>(LEAF_PAGE);
+        root_ = root.id();
+        free_head_ = 0;
+        header.reset();
+        return write_header() && pool_.flush();
+    }
+    BufferPool::Page header = pool_.fetch(0);
+    if (!header || std::memcmp(header.data(), TREE_MAGIC, sizeof(TREE_MAGIC)) != 0) {
+        pool_.close();
+        return false;
+    }
+    ByteReader in(header.data() + sizeof(TREE_MAGIC), PAGE_SIZE - sizeof(TREE_MAGIC));
+    std::uint32_t version = in.u32();
+    std::uint32_t page_size = in.u32();
+    root_ = in.u64();
+    free_head_ = in.u64();
+    if (version != TREE_VERSION || page_size != PAGE_SIZE || root_ == 0 || root_ >= pool_.page_count()) {
+        header.reset();
+        pool_.close();
+        return false;
+    }
+    return true;
+}
+
+bool BTree::close() {
+    if (!pool_.is_open()) return true;
+    bool ok = write_header();
+    return pool_.close() && ok;
+}
+
+bool BTree::flush() {
+    return write_header() && pool_.flush();
+}
+
+bool BTree::write_header() {
+    BufferPool::Page header = pool_.fetch(0);
+    if (!header) return false;
+    std::string bytes(TREE_MAGIC, sizeof(TREE_MAGIC));
+    put_u32(bytes, TREE_VERSION);
+    put_u32(bytes, static_cast<std::uint32_t>(PAGE_SIZE));
+    put_u64(bytes, root_);
+    put_u64(bytes, free_head_);
+    std::memcpy(header.mutable_data(), bytes.data(), bytes.size());
+    return true;
+}
+
+std::size_t BTree::encoded_size(const Node& node) {
+    std::size_t size = NODE_HEADER;
+    if (node.leaf) {
+        for (const auto& e : node.entries) size += LEAF_ENTRY_FIXED + (e.overflow ? 16 : e.bytes.size());
+    } else {
+        size += node.children.size() * INTERNAL_ENTRY;
+    }
+    return size;
+}
+
+void BTree::decode(const char* page, Node& node) {
+    node.entries.clear();
+    node.children.clear();
+    node.leaf = static_cast<unsigned char>(page[0]) == LEAF_PAGE;
+    ByteReader in(page + 4, PAGE_SIZE - 4);
+    std::uint32_t count = in.u32();
+    node.link = in.u64();
+    for (std::uint32_t i = 0; i < count && in.ok(); i++) {
+        BTreeKey key;
+        key.hi = in.u64();
+        key.lo = in.u64();
+        if (node.leaf) {
+            LeafEntry e;
+            e.key = key;
+            e.size = in.u32();
+            const char* flags = in.position();
+            if (!in.skip(1)) break;
+            e.overflow = (*flags & 1) != 0;
+            if (e.overflow) {
+                e.first_page = in.u64();
+                e.digest = in.u64();
+            } else {
+                const char* bytes = in.position();
+                if (!in.skip(e.size)) break;
+                e.bytes.assign(bytes, e.size);
+            }
+            if (in.ok()) node.entries.push_back(std::move(e));
+        } else {
+            PageId child = in.u64();
+            if (in.ok()) node.children.emplace_back(key, child);
+        }
+    }
+}
+
+void BTree::encode(const Node& node, char* page) {
+    std::string out;
+    out.reserve(PAGE_SIZE);
+    out.push_back(static_cast<char>(node.leaf ? LEAF_PAGE : INTERNAL_PAGE));
+    out.append(3, '\0');
+    put_u32(out, static_cast<std::uint32_t>(node.leaf ? node.entries.size() : node.children.size()));
+    put_u64(out, node.link);
+    if (node.leaf) {
+        for (const auto& e : node.entries) {
+            put_u64(out, e.key.hi);
+            put_u64(out, e.key.lo);
+            put_u32(out, e.size);
+            out.push_back(static_cast<char>(e.overflow ? 1 : 0));
+            if (e.overflow) {
+                put_u64(out, e.first_page);
+                put_u64(out, e.digest);
+            } else {
+                out += e.bytes;
+            }
+        }
+    } else {
+        for (const auto& c : node.children) {
+            put_u64(out, c.first.hi);
+            put_u64(out, c.first.lo);
+            put_u64(out, c.second);
+        }
+    }
+    std::memcpy(page, out.data(), out.size());
+    std::memset(page + out.size(), 0, PAGE_SIZE - out.size());
+}
+
+bool BTree::read_node(PageId id, Node& node) {
+    BufferPool::Page page = pool_.fetch(id);
+    if (!page) return false;
+    unsigned char type = static_cast<unsigned char>(page.data()[0]);
+    if (type != LEAF_PAGE && type != INTERNAL_PAGE) return false;
+    decode(page.data(), node);
+    return true;
+}
+
+bool BTree::write_node(PageId id, const Node& node) {
+    BufferPool::Page page = pool_.fetch(id);
+    if (!page) return false;
+    encode(node, page.mutable_data());
+    return true;
+}
+
+BufferPool::Page BTree::new_page() {
+    if (free_head_ != 0) {
+        BufferPool::Page page = pool_.fetch(free_head_);
+        if (page) {
+            free_head_ = load_u64(page.data() + 8);
+            std::memset(page.mutable_data(), 0, PAGE_SIZE);
+            return page;
+        }
+        free_head_ = 0;  // unreadable free list: stop using it
+    }
+    return pool_.allocate();
+}
+
+void BTree::free_page(PageId id) {
+    BufferPool::Page page = pool_.fetch(id);
+    if (!page) return;
+    char* data = page.mutable_data();
+    std::memset(data, 0, PAGE_SIZE);
+    data[0] = static_cast<char>(FREE_PAGE);
+    store_u64(data + 8, free_head_);
+    free_head_ = id;
+}
+
+bool BTree::make_entry(const BTreeKey& key, std::string_view value, LeafEntry& entry) {
+    entry.key = key;
+    entry.size = static_cast<std::uint32_t>(value.size());
+    entry.overflow = value.size() > INLINE_MAX;
+    if (!entry.overflow) {
+        entry.bytes.assign(value.data(), value.size());
+        return true;
+    }
+    entry.digest = digest_of(value);
+    BufferPool::Page prev;
+    for (std::size_t at = 0; at < value.size(); at += OVERFLOW_CAPACITY) {
+        BufferPool::Page page = new_page();
+        if (!page) return false;
+        std::size_t n = std::min(OVERFLOW_CAPACITY, value.size() - at);
+        char* data = page.mutable_data();
+        data[0] = static_cast<char>(OVERFLOW_PAGE);
+        store_u32(data + 4, static_cast<std::uint32_t>(n));
+        std::memcpy(data + OVERFLOW_HEADER, value.data() + at, n);
+        if (prev) {
+            store_u64(prev.mutable_data() + 8, page.id());
+        } else {
+            entry.first_page = page.id();
+        }
+        prev = std::move(page);
+    }
+    return true;
+}
+
+bool BTree::read_value(const LeafEntry& entry, std::string& value) {
+    if (!entry.overflow) {
+        value = entry.bytes;
+        return true;
+    }
+    value.clear();
+    value.reserve(entry.size);
+    PageId id = entry.first_page;
+    while (value.size() < entry.size) {
+        BufferPool::Page page = pool_.fetch(id);
+        if (!page || static_cast<unsigned char>(page.data()[0]) != OVERFLOW_PAGE) return false;
+        std::uint32_t used = load_u32(page.data() + 4);
+        if (used > OVERFLOW_CAPACITY || used > entry.size - value.size()) return false;
+        value.append(page.data() + OVERFLOW_HEADER, used);
+        id = load_u64(page.data() + 8);
+    }
+    return true;
+}
+
+void BTree::free_chain(PageId first) {
+    for (PageId id = first; id != 0;) {
+        BufferPool::Page page = pool_.fetch(id);
+        if (!page || static_cast<unsigned char>(page.data()[0]) != OVERFLOW_PAGE) return;
+        PageId next = load_u64(page.data() + 8);
+        page.reset();
+        free_page(id);
+        id = next;
+    }
+}
+
+namespace {
+
+template <class Children>
+PageId child_for(PageId link, const Children& children, const BTreeKey& key, std::size_t& slot) {
+    auto it = std::upper_bound(children.begin(), children.end(), key,
+                               [](const BTreeKey& k, const auto& c) { return k < c.first; });
+    slot = static_cast<std::size_t>(it - children.begin());
+    return it == children.begin() ? link : std::prev(it)->second;
+}
+
+template <class Entries>
+auto entry_for(Entries& entries, const BTreeKey& key) {
+    return std::lower_bound(entries.begin(), entries.end(), key,
+                            [](const auto& e, const BTreeKey& k) { return e.key < k; });
+}
+
+}  // namespace
+
+bool BTree::find_leaf(const BTreeKey& key, PageId& leaf) {
+    PageId id = root_;
+    Node node;
+    for (int depth = 0; depth < MAX_DEPTH; depth++) {
+        if (!read_node(id, node)) return false;
+        if (node.leaf) {
+            leaf = id;
+            return true;
+        }
+        std::size_t slot;
+        id = child_for(node.link, node.children, key, slot);
+    }
+    return false;
+}
+
+bool BTree::get(const BTreeKey& key, std::string& value) {
+    PageId leaf;
+    Node node;
+    if (!find_leaf(key, leaf) || !read_node(leaf, node)) return false;
+    auto it = entry_for(node.entries, key);
+    if (it == node.entries.end() || !(it->key == key)) return false;
+    return read_value(*it, value);
+}
+
+bool BTree::holds(const BTreeKey& key, std::string_view value) {
+    PageId leaf;
+    Node node;
+    if (!find_leaf(key, leaf) || !read_node(leaf, node)) return false;
+    auto it = entry_for(node.entries, key);
+    if (it == node.entries.end() || !(it->key == key) || it->size != value.size()) return false;
+    return it->overflow ? it->digest == digest_of(value) : it->bytes == value;
+}
+
+bool BTree::put(const BTreeKey& key, std::string_view value) {
+    // Rewriting an identical value would only dirty pages
+    if (holds(key, value)) return true;
+
+    LeafEntry entry;
+    if (!make_entry(key, value, entry)) return false;
+    Split split;
+    if (!insert(root_, entry, split)) return false;
+    if (split.happened) {
+        BufferPool::Page page = new_page();
+        if (!page) return false;
+        Node root;
+        root.leaf = false;
+        root.link = root_;
+        root.children.emplace_back(split.key, split.right);
+        encode(root, page.mutable_data());
+        root_ = page.id();
+    }
+    return true;
+}
+
+bool BTree::insert(PageId id, LeafEntry& entry, Split& split) {
+    Node node;
+    if (!read_node(id, node)) return false;
+    if (node.leaf) {
+        auto it = entry_for(node.entries, entry.key);
+        if (it != node.entries.end() && it->key == entry.key) {
+            if (it->overflow) free_chain(it->first_page);
+            *it = std::move(entry);
+        } else {
+            node.entries.insert(it, std::move(entry));
+        }
+        if (encoded_size(node) <= PAGE_SIZE) return write_node(id, node);
+        return split_leaf(node, id, split);
+    }
+
+    std::size_t slot;
+    PageId child = child_for(node.link, node.children, entry.key, slot);
+    Split below;
+    if (!insert(child, entry, below)) return false;
+    if (!below.happened) return true;
+    node.children.insert(node.children.begin() + static_cast<std::ptrdiff_t>(slot), {below.key, below.right});
+    if (encoded_size(node) <= PAGE_SIZE) return write_node(id, node);
+    return split_internal(node, id, split);
+}
+
+bool BTree::split_leaf(Node& node, PageId id, Split& split) {
+    // Split by bytes rather than entry count, since inline values vary in size
+    std::size_t total = encoded_size(node) - NODE_HEADER, left_bytes = 0, mid = 0;
+    while (mid + 1 < node.entries.size() && left_bytes * 2 < total) {
+        const auto& e = node.entries[mid++];
+        left_bytes += LEAF_ENTRY_FIXED + (e.overflow ? 16 : e.bytes.size());
+    }
+    if (mid == 0) mid = 1;
+
+    BufferPool::Page page = new_page();
+    if (!page) return false;
+    Node right;
+    right.leaf = true;
+    right.link = node.link;
+    right.entries.assign(std::make_move_iterator(node.entries.begin() + static_cast<std::ptrdiff_t>(mid)),
+                         std::make_move_iterator(node.entries.end()));
+    node.entries.resize(mid);
+    node.link = page.id();
+    encode(right, page.mutable_data());
+
+    split.happened = true;
+    split.key = right.entries.front().key;
+    split.right = page.id();
+    return write_node(id, node);
+}
+
+bool BTree::split_internal(Node& node, PageId id, Split& split) {
+    std::size_t mid = node.children.size() / 2;
+    BufferPool::Page page = new_page();
+    if (!page) return false;
+    Node right;
+    right.leaf = false;
+    right.link = node.children[mid].second;
+    right.children.assign(node.children.begin() + static_cast<std::ptrdiff_t>(mid) + 1, node.children.end());
+    split.happened = true;
+    split.key = node.children[mid].first;
+    split.right = page.id();
+    node.children.resize(mid);
+    encode(right, page.mutable_data());
+    return write_node(id, node);
+}
+
+bool BTree::erase(const BTreeKey& key) {
+    PageId leaf;
+    Node node;
+    if (!find_leaf(key, leaf) || !read_node(leaf, node)) return false;
+    auto it = entry_for(node.entries, key);
+    if (it == node.entries.end() || !(it->key == key)) return false;
+    if (it->overflow) free_chain(it->first_page);
+    node.entries.erase(it);
+    return write_node(leaf, node);
+}
+
+bool BTree::scan(const BTreeKey& from, const BTreeKey& to,
+                 const std::function<bool(const BTreeKey&, std::string&&)>& visit) {
+    PageId id;
+    if (!find_leaf(from, id)) return false;
+    Node node;
+    std::string value;
+    // Bounded by the page count so a corrupted leaf chain cannot loop
+    for (PageId visited = 0; id != 0 && visited < pool_.page_count(); visited++) {
+        if (!read_node(id, node) || !node.leaf) return false;
+        for (auto it = entry_for(node.entries, from); it != node.entries.end(); ++it) {
+            if (to < it->key) return true;
+            if (!read_value(*it, value)) return false;
+            if (!visit(it->key, std::move(value))) return true;
+        }
+        id = node.link;
+    }
+    return true;
+}
+
+}  // namespace ffvms::storage
@@ -0,0 +1,130 @@
+/**
+ * @file btree_storage.cpp
+ * @brief Table-per-key-range storage on the paged B+tree
+ */
+
+#include "storage/btree_storage.h"
+#include "logger.h"
+#include "storage/byte_io.h"
+#include "storage/file_util.h"
+#include "storage/table_rows.h"
+
+namespace ffvms::storage {
+
+namespace {
+
+constexpr std::uint64_t META_ROW = ~0ULL;
+
+std::uint64_t table_hash(const std::string& name) {
+    std::uint64_t h = 14695981039346656037ULL;
+    for (unsigned char c : name) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+}  // namespace
+
+BTreeStorage::BTreeStorage(ffvms::ILogger* logger, const std::string& path, const BTreeStorageOptions& options)
+    : path_(path), options_(options), tree_(options.pool_pages), logger_(logger) {
+    open_ = tree_.open(path_);
+    if (!open_) {
+        get_logger_ref().log("Failed to open B+tree storage " + path_ + ".", ffvms::LogLevel::FATAL, __LINE__);
+    }
+}
+
+BTreeStorage::~BTreeStorage() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (open_ && !tree_.close()) {
+        get_logger_ref().log("Failed to write back B+tree storage " + path_ + ".", ffvms::LogLevel::FATAL, __LINE__);
+    }
+}
+
+ffvms::ILogger& BTreeStorage::get_logger_ref() {
+    if (logger_) return *logger_;
+    return Logger::get_logger();
+}
+
+bool BTreeStorage::read_meta(const std::string& name, std::uint64_t table, std::uint64_t& rows, bool& exists) {
+    std::string meta;
+    exists = tree_.get({table, META_ROW}, meta);
+    rows = 0;
+    if (!exists) return true;
+    if (meta.size() < 8 || meta.compare(8, std::string::npos, name) != 0) {
+        get_logger_ref().log("B+tree storage: table " + name + " collides with another table name.",
+                             ffvms::LogLevel::FATAL, __LINE__);
+        return false;
+    }
+    rows = load_u64(meta.data());
+    return true;
+}
+
+bool BTreeStorage::save(const std::string& name, const ffvms::DataTable& content) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!open_) return false;
+    std::uint64_t table = table_hash(name), old_rows;
+    bool exists;
+    if (!read_meta(name, table, old_rows, exists)) return false;
+
+    std::string bytes;
+    for (std::uint64_t i = 0; i < content.size(); i++) {
+        bytes.clear();
+        append_row(bytes, content[i]);
+        if (!tree_.put({table, i}, bytes)) {
+            get_logger_ref().log("Failed to save data. B+tree write failed for " + name + ".", ffvms::LogLevel::FATAL, __LINE__);
+            return false;
+        }
+    }
+    for (std::uint64_t i = content.size(); i < old_rows; i++) tree_.erase({table, i});
+
+    std::string meta;
+    put_u64(meta, content.size());
+    meta += name;
+    if (!tree_.put({table, META_ROW}, meta) || !tree_.flush()) {
+        get_logger_ref().log("Failed to save data. B+tree write failed for " + name + ".", ffvms::LogLevel::FATAL, __LINE__);
+        return false;
+    }
+    if (options_.sync && !sync_file(path_)) {
+        get_logger_ref().log("Failed to sync " + path_ + ".", ffvms::LogLevel::WARNING, __LINE__);
+        return false;
+    }
+    return true;
+}
+
+bool BTreeStorage::load(const std::string& name, ffvms::DataTable& content, bool) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!open_) return false;
+    std::uint64_t table = table_hash(name), rows;
+    bool exists;
+    if (!read_meta(name, table, rows, exists)) return false;
+    if (!exists) {
+        get_logger_ref().log("Failed to load data. No data named " + name + " exists.", ffvms::LogLevel::WARNING, __LINE__);
+        return false;
+    }
+    ffvms::DataTable loaded;
+    loaded.reserve(rows);
+    bool ok = rows == 0 || tree_.scan({table, 0}, {table, rows - 1}, [&](const BTreeKey& key, std::string&& bytes) {
+        loaded.emplace_back();
+        ByteReader in(bytes.data(), bytes.size());
+        return key.lo == loaded.size() - 1 && read_row(in, loaded.back()) && in.remaining() == 0;
+    });
+    if (!ok || loaded.size() != rows) {
+        get_logger_ref().log("Failed to load data. " + name + " is damaged.", ffvms::LogLevel::WARNING, __LINE__);
+        return false;
+    }
+    content = std::move(loaded);
+    return true;
+}
+
+BufferPool::Stats BTreeStorage::pool_stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tree_.pool_stats();
+}
+
+PageId BTreeStorage::page_count() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tree_.page_count();
+}
+
+}  // namespace ffvms::storage
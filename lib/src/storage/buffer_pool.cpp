@@ -0,0 +1,166 @@
+/**
+ * @file buffer_pool.cpp
+ * @brief Implementation of the clock-evicting page cache
+ */
+
+#include "storage/buffer_pool.h"
+#include <cstring>
+
+namespace ffvms::storage {
+
+BufferPool::Page& BufferPool::Page::operator=(Page&& other) noexcept {
+    if (this != &other) {
+        reset();
+        pool_ = other.pool_;
+        frame_ = other.frame_;
+        data_ = other.data_;
+        id_ = other.id_;
+        other.pool_ = nullptr;
+        other.data_ = nullptr;
+    }
+    return *this;
+}
+
+char* BufferPool::Page::mutable_data() {
+    pool_->frames_[frame_].dirty = true;
+    return data_;
+}
+
+void BufferPool::Page::reset() {
+    if (pool_) pool_->frames_[frame_].pins--;
+    pool_ = nullptr;
+    data_ = nullptr;
+}
+
+BufferPool::BufferPool(std::size_t frames) : frames_(frames < 8 ? 8 : frames) {
+    for (auto& frame : frames_) frame.data.reset(new char[PAGE_SIZE]);
+}
+
+BufferPool::~BufferPool() {
+    close();
+}
+
+bool BufferPool::open(const std::string& path) {
+    close();
+    file_.open(path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!file_.is_open()) {
+        // fstream only creates files when opened for output alone
+        std::ofstream create(path, std::ios::binary);
+        if (!create) return false;
+        create.close();
+        file_.open(path, std::ios::in | std::ios::out | std::ios::binary);
+        if (!file_.is_open()) return false;
+    }
+    file_.seekg(0, std::ios::end);
+    page_count_ = static_cast<PageId>(file_.tellg()) / PAGE_SIZE;
+    return true;
+}
+
+bool BufferPool::close() {
+    if (!file_.is_open()) return true;
+    bool ok = flush();
+    file_.close();
+    table_.clear();
+    for (auto& frame : frames_) {
+        frame.used = frame.dirty = frame.referenced = false;
+        frame.pins = 0;
+    }
+    page_count_ = 0;
+    return ok;
+}
+
+bool BufferPool::write_frame(Frame& frame) {
+    file_.clear();
+    file_.seekp(static_cast<std::streamoff>(frame.id * PAGE_SIZE));
+    file_.write(frame.data.get(), static_cast<std::streamsize>(PAGE_SIZE));
+    if (!file_) return false;
+    frame.dirty = false;
+    stats_.writes++;
+    return true;
+}
+
+bool BufferPool::claim_frame(std::size_t& index) {
+    // Two sweeps clear every reference bit, so a third finds a victim unless all are pinned
+    for (std::size_t step = 0; step < 3 * frames_.size(); step++) {
+        Frame& frame = frames_[hand_];
+        std::size_t current = hand_;
+        hand_ = (hand_ + 1) % frames_.size();
+        if (!frame.used) {
+            index = current;
+            return true;
+        }
+        if (frame.pins > 0) continue;
+        if (frame.referenced) {
+            frame.referenced = false;
+            continue;
+        }
+        if (frame.dirty && !write_frame(frame)) return false;
+        table_.erase(frame.id);
+        frame.used = false;
+        stats_.evictions++;
+        index = current;
+        return true;
+    }
+    // Every frame is pinned: grow rather than fail the caller
+    frames_.emplace_back();
+    frames_.back().data.reset(new char[PAGE_SIZE]);
+    index = frames_.size() - 1;
+    return true;
+}
+
+BufferPool::Page BufferPool::pin(std::size_t index) {
+    Frame& frame = frames_[index];
+    frame.pins++;
+    frame.referenced = true;
+    return Page(this, index, frame.data.get(), frame.id);
+}
+
+BufferPool::Page BufferPool::fetch(PageId id) {
+    auto it = table_.find(id);
+    if (it != table_.end()) {
+        stats_.hits++;
+        return pin(it->second);
+    }
+    if (id >= page_count_) return Page();
+    std::size_t index;
+    if (!claim_frame(index)) return Page();
+    Frame& frame = frames_[index];
+    file_.clear();
+    file_.seekg(static_cast<std::streamoff>(id * PAGE_SIZE));
+    file_.read(frame.data.get(), static_cast<std::streamsize>(PAGE_SIZE));
+    std::streamsize got = file_.gcount();
+    // Pages allocated but evicted before a lower one was written may read short; they hold zeros
+    if (got < static_cast<std::streamsize>(PAGE_SIZE)) {
+        std::memset(frame.data.get() + got, 0, PAGE_SIZE - static_cast<std::size_t>(got));
+    }
+    stats_.misses++;
+    frame.id = id;
+    frame.used = true;
+    frame.dirty = false;
+    table_[id] = index;
+    return pin(index);
+}
+
+BufferPool::Page BufferPool::allocate() {
+    std::size_t index;
+    if (!claim_frame(index)) return Page();
+    Frame& frame = frames_[index];
+    std::memset(frame.data.get(), 0, PAGE_SIZE);
+    frame.id = page_count_++;
+    frame.used = true;
+    frame.dirty = true;
+    table_[frame.id] = index;
+    return pin(index);
+}
+
+bool BufferPool::flush() {
+    if (!file_.is_open()) return false;
+    bool ok = true;
+    for (auto& frame : frames_) {
+        if (frame.used && frame.dirty && !write_frame(frame)) ok = false;
+    }
+    file_.flush();
+    return ok && static_cast<bool>(file_);
+}
+
+}  // namespace ffvms::storage
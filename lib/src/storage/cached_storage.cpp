@@ -0,0 +1,132 @@
+/**
+ * @file cached_storage.cpp
+ * @brief Implementation of the decoded-table LRU cache
+ */
+
+#include "storage/cached_storage.h"
+
+namespace ffvms::storage {
+
+CachedStorage::CachedStorage(ffvms::IStorage* backend, const CachedStorageOptions& options)
+    : backend_(backend), capacity_(options.capacity_bytes) {}
+
+std::size_t CachedStorage::table_bytes(const ffvms::DataTable& table) {
+    std::size_t bytes = sizeof(ffvms::DataTable) + table.capacity() * sizeof(ffvms::DataTable::value_type);
+    for (const auto& row : table) {
+        bytes += row.capacity() * sizeof(std::string);
+        // Strings short enough for the small-string buffer allocate nothing
+        for (const auto& field : row) {
+            if (field.capacity() >= sizeof(std::string)) bytes += field.capacity() + 1;
+        }
+    }
+    return bytes;
+}
+
+CachedStorage::Table CachedStorage::find(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(name);
+    if (it == index_.end()) {
+        stats_.misses++;
+        return nullptr;
+    }
+    stats_.hits++;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->table;
+}
+
+CachedStorage::Table CachedStorage::fetch(const std::string& name, bool mandatory_access) {
+    if (Table table = find(name)) return table;
+
+    unsigned long long generation;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        generation = generation_;
+    }
+    auto table = std::make_shared<ffvms::DataTable>();
+    if (!backend_->load(name, *table, mandatory_access)) return nullptr;
+    if (mandatory_access) return table;
+
+    const std::size_t bytes = table_bytes(*table);
+    std::lock_guard<std::mutex> lock(mutex_);
+    // A save since the load started may have replaced what the backend returned
+    if (generation != generation_ || bytes > capacity_ || index_.count(name)) return table;
+    lru_.push_front(Entry{name, table, bytes});
+    index_[name] = lru_.begin();
+    bytes_ += bytes;
+    evict_to(capacity_);
+    return table;
+}
+
+void CachedStorage::invalidate(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    generation_++;
+    auto it = index_.find(name);
+    if (it == index_.end()) return;
+    bytes_ -= it->second->bytes;
+    lru_.erase(it->second);
+    index_.erase(it);
+    stats_.invalidations++;
+}
+
+void CachedStorage::evict_to(std::size_t capacity) {
+    while (bytes_ > capacity && !lru_.empty()) {
+        bytes_ -= lru_.back().bytes;
+        index_.erase(lru_.back().name);
+        lru_.pop_back();
+        stats_.evictions++;
+    }
+}
+
+bool CachedStorage::save(const std::string& name, const ffvms::DataTable& content) {
+    invalidate(name);
+    bool ok = backend_->save(name, content);
+    invalidate(name);
+    return ok;
+}
+
+bool CachedStorage::save_records(const std::string& name, const RecordSource& write) {
+    invalidate(name);
+    bool ok = backend_->save_records(name, write);
+    invalidate(name);
+    return ok;
+}
+
+bool CachedStorage::load(const std::string& name, ffvms::DataTable& content, bool mandatory_access) {
+    Table table = fetch(name, mandatory_access);
+    if (!table) return false;
+    content = *table;
+    return true;
+}
+
+bool CachedStorage::load_records(const std::string& name, const RecordSink& read, bool mandatory_access) {
+    // The table stays alive while it is read even if it is evicted meanwhile
+    Table table = fetch(name, mandatory_access);
+    if (!table) return false;
+    ffvms::DataTableReader reader(*table);
+    return read(reader);
+}
+
+void CachedStorage::set_capacity(std::size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = bytes;
+    evict_to(capacity_);
+}
+
+void CachedStorage::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    lru_.clear();
+    index_.clear();
+    bytes_ = 0;
+}
+
+std::size_t CachedStorage::cached_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+}
+
+CachedStorage::Stats CachedStorage::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+}  // namespace ffvms::storage
@@ -0,0 +1,164 @@
+/**
+ * @file chacha20.cpp
+ * @brief Scalar and SSE2 ChaCha20 keystream generation
+ */
+
+#include "storage/chacha20.h"
+
+#include <cstring>
+#include <random>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FFVMS_CHACHA20_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace ffvms::storage {
+
+namespace {
+
+constexpr std::size_t BLOCK_SIZE = 64;
+
+inline std::uint32_t load32_le(const std::uint8_t* p) {
+    return std::uint32_t(p[0]) | (std::uint32_t(p[1]) << 8) | (std::uint32_t(p[2]) << 16) |
+           (std::uint32_t(p[3]) << 24);
+}
+
+inline std::uint32_t rotl(std::uint32_t v, int n) { return (v << n) | (v >> (32 - n)); }
+
+inline void quarter_round(std::uint32_t& a, std::uint32_t& b, std::uint32_t& c, std::uint32_t& d) {
+    a += b; d ^= a; d = rotl(d, 16);
+    c += d; b ^= c; b = rotl(b, 12);
+    a += b; d ^= a; d = rotl(d, 8);
+    c += d; b ^= c; b = rotl(b, 7);
+}
+
+void init_state(std::uint32_t state[16], const CipherKey& key, const std::uint8_t nonce[CHACHA20_NONCE_SIZE],
+                std::uint32_t counter) {
+    state[0] = 0x61707865;  // "expand 32-byte k"
+    state[1] = 0x3320646e;
+    state[2] = 0x79622d32;
+    state[3] = 0x6b206574;
+    for (int i = 0; i < 8; i++) state[4 + i] = load32_le(key.data() + 4 * i);
+    state[12] = counter;
+    for (int i = 0; i < 3; i++) state[13 + i] = load32_le(nonce + 4 * i);
+}
+
+void block_scalar(const std::uint32_t state[16], std::uint8_t out[BLOCK_SIZE]) {
+    std::uint32_t x[16];
+    std::memcpy(x, state, sizeof(x));
+    for (int i = 0; i < 10; i++) {
+        quarter_round(x[0], x[4], x[8], x[12]);
+        quarter_round(x[1], x[5], x[9], x[13]);
+        quarter_round(x[2], x[6], x[10], x[14]);
+        quarter_round(x[3], x[7], x[11], x[15]);
+        quarter_round(x[0], x[5], x[10], x[15]);
+        quarter_round(x[1], x[6], x[11], x[12]);
+        quarter_round(x[2], x[7], x[8], x[13]);
+        quarter_round(x[3], x[4], x[9], x[14]);
+    }
+    for (int i = 0; i < 16; i++) {
+        std::uint32_t v = x[i] + state[i];
+        out[4 * i] = static_cast<std::uint8_t>(v);
+        out[4 * i + 1] = static_cast<std::uint8_t>(v >> 8);
+        out[4 * i + 2] = static_cast<std::uint8_t>(v >> 16);
+        out[4 * i + 3] = static_cast<std::uint8_t>(v >> 24);
+    }
+}
+
+#ifdef FFVMS_CHACHA20_SSE2
+
+inline __m128i rotl_epi32(__m128i v, int n) {
+    return _mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, 32 - n));
+}
+
+inline void quarter_round(__m128i& a, __m128i& b, __m128i& c, __m128i& d) {
+    a = _mm_add_epi32(a, b); d = rotl_epi32(_mm_xor_si128(d, a), 16);
+    c = _mm_add_epi32(c, d); b = rotl_epi32(_mm_xor_si128(b, c), 12);
+    a = _mm_add_epi32(a, b); d = rotl_epi32(_mm_xor_si128(d, a), 8);
+    c = _mm_add_epi32(c, d); b = rotl_epi32(_mm_xor_si128(b, c), 7);
+}
+
+/**
+ * Four consecutive blocks at once: lane j of x[i] is word i of block j.
+ * XORs 256 bytes of @p in into @p out.
+ */
+void xor_4blocks_sse2(const std::uint32_t state[16], const char* in, char* out) {
+    __m128i s[16], x[16];
+    for (int i = 0; i < 16; i++) s[i] = _mm_set1_epi32(static_cast<int>(state[i]));
+    s[12] = _mm_add_epi32(s[12], _mm_set_epi32(3, 2, 1, 0));
+    for (int i = 0; i < 16; i++) x[i] = s[i];
+    for (int i = 0; i < 10; i++) {
+        quarter_round(x[0], x[4], x[8], x[12]);
+        quarter_round(x[1], x[5], x[9], x[13]);
+        quarter_round(x[2], x[6], x[10], x[14]);
+        quarter_round(x[3], x[7], x[11], x[15]);
+        quarter_round(x[0], x[5], x[10], x[15]);
+        quarter_round(x[1], x[6], x[11], x[12]);
+        quarter_round(x[2], x[7], x[8], x[13]);
+        quarter_round(x[3], x[4], x[9], x[14]);
+    }
+    for (int i = 0; i < 16; i++) x[i] = _mm_add_epi32(x[i], s[i]);
+
+    // Transpose each group of four words so every register holds 16 bytes of one block
+    for (int g = 0; g < 4; g++) {
+        __m128i t0 = _mm_unpacklo_epi32(x[4 * g], x[4 * g + 1]);
+        __m128i t1 = _mm_unpacklo_epi32(x[4 * g + 2], x[4 * g + 3]);
+        __m128i t2 = _mm_unpackhi_epi32(x[4 * g], x[4 * g + 1]);
+        __m128i t3 = _mm_unpackhi_epi32(x[4 * g + 2], x[4 * g + 3]);
+        __m128i blocks[4] = {_mm_unpacklo_epi64(t0, t1), _mm_unpackhi_epi64(t0, t1),
+                             _mm_unpacklo_epi64(t2, t3), _mm_unpackhi_epi64(t2, t3)};
+        for (int b = 0; b < 4; b++) {
+            std::size_t offset = b * BLOCK_SIZE + g * 16;
+            __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + offset));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + offset), _mm_xor_si128(data, blocks[b]));
+        }
+    }
+}
+
+#endif
+
+}  // namespace
+
+void chacha20_xor(const CipherKey& key, const std::uint8_t nonce[CHACHA20_NONCE_SIZE], std::uint32_t counter,
+                  const char* in, char* out, std::size_t size) {
+    std::uint32_t state[16];
+    init_state(state, key, nonce, counter);
+    std::size_t pos = 0;
+#ifdef FFVMS_CHACHA20_SSE2
+    for (; size - pos >= 4 * BLOCK_SIZE; pos += 4 * BLOCK_SIZE) {
+        xor_4blocks_sse2(state, in + pos, out + pos);
+        state[12] += 4;
+    }
+#endif
+    std::uint8_t keystream[BLOCK_SIZE];
+    for (; pos < size; pos += BLOCK_SIZE) {
+        block_scalar(state, keystream);
+        state[12]++;
+        std::size_t n = size - pos < BLOCK_SIZE ? size - pos : BLOCK_SIZE;
+        for (std::size_t i = 0; i < n; i++) out[pos + i] = static_cast<char>(in[pos + i] ^ keystream[i]);
+    }
+}
+
+void ChaCha20Cipher::encrypt(std::string_view plain, std::string& payload) {
+    static thread_local std::mt19937_64 gen(std::random_device{}());
+    std::uint8_t nonce[CHACHA20_NONCE_SIZE];
+    for (std::size_t i = 0; i < CHACHA20_NONCE_SIZE; i += 4) {
+        std::uint32_t r = static_cast<std::uint32_t>(gen());
+        std::memcpy(nonce + i, &r, 4);
+    }
+    payload.resize(CHACHA20_NONCE_SIZE + plain.size());
+    std::memcpy(&payload[0], nonce, CHACHA20_NONCE_SIZE);
+    chacha20_xor(key_, nonce, 0, plain.data(), &payload[CHACHA20_NONCE_SIZE], plain.size());
+}
+
+bool ChaCha20Cipher::decrypt(std::string_view payload, std::string& plain) {
+    if (payload.size() < CHACHA20_NONCE_SIZE) return false;
+    std::uint8_t nonce[CHACHA20_NONCE_SIZE];
+    std::memcpy(nonce, payload.data(), CHACHA20_NONCE_SIZE);
+    plain.resize(payload.size() - CHACHA20_NONCE_SIZE);
+    chacha20_xor(key_, nonce, 0, payload.data() + CHACHA20_NONCE_SIZE, &plain[0], plain.size());
+    return true;
+}
+
+}  // namespace ffvms::storage
@@ -0,0 +1,87 @@
+/**
+ * @file chunk_store.cpp
+ * @brief Implementation of the deduplicating chunk store
+ */
+
+#include "storage/chunk_store.h"
+
+namespace ffvms::storage {
+
+std::vector<ChunkId> ChunkStore::put(std::string_view content) {
+    std::vector<ChunkId> ids;
+    for (std::string_view piece : split_chunks(content, params_)) {
+        ChunkId id = Sha256::hash(piece.data(), piece.size());
+        if (!chunks_.get().count(id)) {
+            chunks_.edit().emplace(id, std::make_shared<const std::string>(piece));
+            generation_++;
+        }
+        refs_[id]++;
+        ids.push_back(id);
+    }
+    return ids;
+}
+
+bool ChunkStore::add_ref(const std::vector<ChunkId>& chunks) {
+    for (const auto& id : chunks) {
+        if (!chunks_.get().count(id)) return false;
+    }
+    for (const auto& id : chunks) refs_[id]++;
+    return true;
+}
+
+void ChunkStore::release(const std::vector<ChunkId>& chunks) {
+    for (const auto& id : chunks) {
+        auto it = refs_.find(id);
+        if (it == refs_.end()) continue;
+        if (it->second <= 1) {
+            refs_.erase(it);
+            chunks_.edit().erase(id);
+            generation_++;
+        } else {
+            it->second--;
+        }
+    }
+}
+
+bool ChunkStore::assemble(const std::vector<ChunkId>& chunks, std::string& content) const {
+    const auto& stored = chunks_.get();
+    std::size_t total = 0;
+    for (const auto& id : chunks) {
+        auto it = stored.find(id);
+        if (it == stored.end()) return false;
+        total += it->second->size();
+    }
+    content.clear();
+    content.reserve(total);
+    for (const auto& id : chunks) content += *stored.find(id)->second;
+    return true;
+}
+
+bool ChunkStore::insert(const ChunkId& id, std::string data) {
+    if (Sha256::hash(data.data(), data.size()) != id) return false;
+    chunks_.edit()[id] = std::make_shared<const std::string>(std::move(data));
+    generation_++;
+    return true;
+}
+
+void ChunkStore::drop_unreferenced() {
+    if (refs_.size() == chunks_.get().size()) return;
+    auto& stored = chunks_.edit();
+    for (auto it = stored.begin(); it != stored.end();) {
+        if (!refs_.count(it->first)) {
+            it = stored.erase(it);
+            generation_++;
+        } else {
+            ++it;
+        }
+    }
+}
+
+ChunkStore::Stats ChunkStore::stats() const {
+    Stats stats;
+    stats.chunk_count = chunks_.get().size();
+    for (const auto& it : chunks_.get()) stats.stored_bytes += it.second->size();
+    return stats;
+}
+
+}  // namespace ffvms::storage
@@ -0,0 +1,76 @@
+/**
+ * @file chunker.cpp
+ * @brief FastCDC chunk boundary detection
+ */
+
+#include "storage/chunker.h"
+
+#include <array>
+#include <cstdint>
+
+namespace ffvms::storage {
+
+namespace {
+
+// One random 64-bit value per byte value, fixed so boundaries are stable across builds
+constexpr std::array<std::uint64_t, 256> make_gear_table() {
+    std::array<std::uint64_t, 256> table{};
+    std::uint64_t x = 0x9e3779b97f4a7c15ULL;
+    for (auto& v : table) {
+        x += 0x9e3779b97f4a7c15ULL;
+        std::uint64_t z = x;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        v = z ^ (z >> 31);
+    }
+    return table;
+}
+
+constexpr std::array<std::uint64_t, 256> GEAR = make_gear_table();
+
+// The gear hash shifts left, so its top bits depend on the most bytes
+std::uint64_t top_bits_mask(int bits) {
+    return bits <= 0 ? 0 : ~0ULL << (64 - bits);
+}
+
+int log2_floor(std::size_t v) {
+    int bits = 0;
+    while (v >>= 1) bits++;
+    return bits;
+}
+
+}  // namespace
+
+std::size_t next_chunk_size(const char* data, std::size_t size, const ChunkerParams& params) {
+    if (size <= params.min_size) return size;
+    const std::size_t limit = size < params.max_size ? size : params.max_size;
+    const std::size_t normal = limit < params.avg_size ? limit : params.avg_size;
+    const int bits = log2_floor(params.avg_size);
+    const std::uint64_t mask_small = top_bits_mask(bits + 2);
+    const std::uint64_t mask_large = top_bits_mask(bits - 2);
+
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    std::uint64_t fp = 0;
+    std::size_t i = params.min_size;
+    for (; i < normal; i++) {
+        fp = (fp << 1) + GEAR[p[i]];
+        if ((fp & mask_small) == 0) return i + 1;
+    }
+    for (; i < limit; i++) {
+        fp = (fp << 1) + GEAR[p[i]];
+        if ((fp & mask_large) == 0) return i + 1;
+    }
+    return limit;
+}
+
+std::vector<std::string_view> split_chunks(std::string_view data, const ChunkerParams& params) {
+    std::vector<std::string_view> chunks;
+    for (std::size_t pos = 0; pos < data.size();) {
+        std::size_t n = next_chunk_size(data.data() + pos, data.size() - pos, params);
+        chunks.push_back(data.substr(pos, n));
+        pos += n;
+    }
+    return chunks;
+}
+
+}  // namespace ffvms::storage
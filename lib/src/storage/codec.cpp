@@ -0,0 +1,41 @@
+/**
+ * @file codec.cpp
+ * @brief Codec registry
+ */
+
+#include "storage/codec.h"
+#include "storage/lz4_codec.h"
+
+namespace ffvms::storage {
+
+namespace {
+
+class NullCodec : public ICodec {
+public:
+    CodecId id() const override { return CodecId::NONE; }
+    const char* name() const override { return "none"; }
+
+    void compress(std::string_view in, std::string& out) const override { out.assign(in); }
+
+    bool decompress(std::string_view in, std::string& out) const override {
+        out.assign(in);
+        return true;
+    }
+};
+
+// Namespace scope, not function-local: the singleton managers save from their
+// destructors, which run after every function-local static created later
+const NullCodec NONE_CODEC;
+const Lz4Codec LZ4_CODEC;
+
+}  // namespace
+
+const ICodec* find_codec(CodecId id) {
+    switch (id) {
+        case CodecId::NONE: return &NONE_CODEC;
+        case CodecId::LZ4: return &LZ4_CODEC;
+    }
+    return nullptr;
+}
+
+}  // namespace ffvms::storage
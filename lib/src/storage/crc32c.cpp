@@ -0,0 +1,112 @@
+/**
+ * @file crc32c.cpp
+ * @brief Table-driven and SSE4.2 CRC-32C
+ */
+
+#include "storage/crc32c.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define FFVMS_CRC32C_SSE42 1
+#include <nmmintrin.h>
+#define FFVMS_TARGET_SSE42 __attribute__((target("sse4.2")))
+#elif defined(_M_X64) && defined(_MSC_VER)
+#define FFVMS_CRC32C_SSE42 1
+#include <intrin.h>
+#include <nmmintrin.h>
+#define FFVMS_TARGET_SSE42
+#endif
+
+namespace ffvms::storage {
+
+namespace {
+
+constexpr std::uint32_t POLYNOMIAL = 0x82f63b78;   // Castagnoli, reflected
+
+using Tables = std::array<std::array<std::uint32_t, 256>, 8>;
+
+// tables[k][b] is the CRC of byte b followed by k zero bytes
+Tables make_tables() {
+    Tables tables{};
+    for (std::uint32_t b = 0; b < 256; b++) {
+        std::uint32_t crc = b;
+        for (int i = 0; i < 8; i++) crc = (crc >> 1) ^ (POLYNOMIAL & (0 - (crc & 1)));
+        tables[0][b] = crc;
+    }
+    for (std::uint32_t b = 0; b < 256; b++) {
+        for (int k = 1; k < 8; k++) tables[k][b] = (tables[k - 1][b] >> 8) ^ tables[0][tables[k - 1][b] & 0xff];
+    }
+    return tables;
+}
+
+const Tables& tables() {
+    static const Tables instance = make_tables();
+    return instance;
+}
+
+std::uint64_t load64_le(const unsigned char* p) {
+    std::uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+#ifdef FFVMS_CRC32C_SSE42
+FFVMS_TARGET_SSE42 std::uint32_t crc32c_sse42(const char* data, std::size_t size, std::uint32_t crc) {
+    std::uint64_t state = ~crc;
+    const char* end = data + size;
+    for (; data + 8 <= end; data += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, data, sizeof(word));   // The instruction takes host order, which is little-endian here
+        state = _mm_crc32_u64(state, word);
+    }
+    std::uint32_t tail = static_cast<std::uint32_t>(state);
+    for (; data != end; data++) tail = _mm_crc32_u8(tail, static_cast<unsigned char>(*data));
+    return ~tail;
+}
+
+bool detect_sse42() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#else
+    return __builtin_cpu_supports("sse4.2");
+#endif
+}
+#endif
+
+}  // namespace
+
+std::uint32_t crc32c_portable(const char* data, std::size_t size, std::uint32_t crc) {
+    const Tables& t = tables();
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    std::uint32_t state = ~crc;
+    for (; size >= 8; size -= 8, p += 8) {
+        std::uint64_t word = load64_le(p) ^ state;
+        state = t[7][word & 0xff] ^ t[6][(word >> 8) & 0xff] ^ t[5][(word >> 16) & 0xff] ^
+                t[4][(word >> 24) & 0xff] ^ t[3][(word >> 32) & 0xff] ^ t[2][(word >> 40) & 0xff] ^
+                t[1][(word >> 48) & 0xff] ^ t[0][word >> 56];
+    }
+    for (; size > 0; size--, p++) state = (state >> 8) ^ t[0][(state ^ *p) & 0xff];
+    return ~state;
+}
+
+bool crc32c_hardware() {
+#ifdef FFVMS_CRC32C_SSE42
+    static const bool supported = detect_sse42();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+std::uint32_t crc32c(const char* data, std::size_t size, std::uint32_t crc) {
+#ifdef FFVMS_CRC32C_SSE42
+    if (crc32c_hardware()) return crc32c_sse42(data, size, crc);
+#endif
+    return crc32c_portable(data, size, crc);
+}
+
+}  // namespace ffvms::storage
@@ -0,0 +1,66 @@
+/**
+ * @file data_file_format.cpp
+ * @brief Encoding and decoding of the data.chm container structures
+ */
+
+#include "storage/data_file_format.h"
+#include "storage/byte_io.h"
+
+namespace ffvms::storage {
+
+void encode_file_header(std::string& out, const FileHeader& header) {
+    out.append(FILE_MAGIC, sizeof(FILE_MAGIC));
+    put_u32(out, header.version);
+    put_u32(out, static_cast<std::uint32_t>(FILE_HEADER_SIZE));
+    put_u64(out, header.record_count);
+    put_u64(out, header.index_offset);
+}
+
+bool decode_file_header(const char* data, std::size_t size, FileHeader& header) {
+    if (!has_file_magic(data, size)) return false;
+    ByteReader in(data + sizeof(FILE_MAGIC), size - sizeof(FILE_MAGIC));
+    header.version = in.u32();
+    std::uint32_t header_size = in.u32();
+    header.record_count = in.u64();
+    header.index_offset = in.u64();
+    if (!in.ok()) return false;
+    return header_size == FILE_HEADER_SIZE && header.version >= 1 && header.version <= FORMAT_VERSION;
+}
+
+void encode_record_header(std::string& out, const RecordHeader& header) {
+    put_u64(out, header.body_size);
+    put_u64(out, header.name_hash);
+    put_u64(out, header.data_hash);
+    put_u32(out, header.block_count);
+    put_u32(out, header.codec | (static_cast<std::uint32_t>(header.checksum) << 8) |
+                     (static_cast<std::uint32_t>(header.cipher) << 16));
+}
+
+bool decode_record_header(const char* data, std::size_t size, RecordHeader& header) {
+    ByteReader in(data, size);
+    header.body_size = in.u64();
+    header.name_hash = in.u64();
+    header.data_hash = in.u64();
+    header.block_count = in.u32();
+    std::uint32_t transform = in.u32();
+    header.codec = static_cast<std::uint8_t>(transform & 0xff);
+    header.checksum = static_cast<std::uint8_t>((transform >> 8) & 0xff);
+    header.cipher = static_cast<std::uint16_t>(transform >> 16);
+    return in.ok() && header.body_size >= RECORD_HEADER_SIZE - 8;
+}
+
+void encode_index_entry(std::string& out, const IndexEntry& entry) {
+    put_u64(out, entry.name_hash);
+    put_u64(out, entry.offset);
+    put_u64(out, entry.size);
+}
+
+bool decode_index_entry(const char* data, std::size_t size, IndexEntry& entry) {
+    ByteReader in(data, size);
+    entry.name_hash = in.u64();
+    entry.offset = in.u64();
+    entry.size = in.u64();
+    return in.ok();
+}
+
+}  // namespace ffvms::storage
@@ -0,0 +1,75 @@
+/**
+ * @file fft_cipher.cpp
+ * @brief Byte-level wrappers around the FFT Encryptor
+ */
+
+#include "storage/fft_cipher.h"
+#include "storage/byte_io.h"
+
+#include <vector>
+
+namespace ffvms::storage {
+
+namespace {
+
+void put_points(const std::vector<std::pair<double, double>>& points, std::string& payload) {
+    payload.clear();
+    payload.reserve(points.size() * 16);
+    for (auto& pr : points) {
+        put_f64(payload, pr.first);
+        put_f64(payload, pr.second);
+    }
+}
+
+bool load_points(std::string_view payload, std::vector<std::pair<double, double>>& points) {
+    // Block sizes are checked by the Encryptor
+    if (payload.empty() || payload.size() % 16 != 0) return false;
+    points.resize(payload.size() / 16);
+    const char* p = payload.data();
+    for (auto& pr : points) {
+        pr.first = load_f64(p);
+        pr.second = load_f64(p + 8);
+        p += 16;
+    }
+    return true;
+}
+
+}  // namespace
+
+void FftCipher::encrypt(std::string_view plain, std::string& payload) {
+    std::vector<int> sequence(plain.begin(), plain.end());
+    std::vector<std::pair<double, double>> encrypted;
+    encrypt_sequence(sequence, encrypted);
+    put_points(encrypted, payload);
+}
+
+bool FftCipher::decrypt(std::string_view payload, std::string& plain) {
+    std::vector<std::pair<double, double>> encrypted;
+    std::vector<int> sequence;
+    if (!load_points(payload, encrypted) || !decrypt_sequence(encrypted, sequence)) return false;
+    plain.assign(sequence.begin(), sequence.end());
+    return true;
+}
+
+void PackedFftCipher::encrypt(std::string_view plain, std::string& payload) {
+    std::vector<int> sequence(plain.begin(), plain.end());
+    std::vector<std::pair<double, double>> encrypted;
+    encrypt_sequence_packed(sequence, encrypted);
+    put_points(encrypted, payload);
+}
+
+bool PackedFftCipher::decrypt(std::string_view payload, std::string& plain) {
+    std::vector<std::pair<double, double>> encrypted;
+    std::vector<int> sequence;
+    if (!load_points(payload, encrypted) || !decrypt_sequence_packed(encrypted, sequence)) return false;
+    plain.assign(sequence.begin(), sequence.end());
+    return true;
+}
+
+bool PackedFftCipher::valid_payload_size(unsigned long long size) {
+    if (size >= BLOCK_BYTES) return size % BLOCK_BYTES == 0;
+    unsigned long long points = size / 16;
+    return size % 16 == 0 && points >= static_cast<unsigned long long>(MIN_N) && (points & (points - 1)) == 0;
+}
+
+}  // namespace ffvms::storage
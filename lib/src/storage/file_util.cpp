@@ -0,0 +1,87 @@
+/**
+ * @file file_util.cpp
+ * @brief Implementation of the storage filesystem helpers
+ */
+
+#include "storage/file_util.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace ffvms::storage {
+
+bool replace_file(const std::string& from, const std::string& to) {
+#ifdef _WIN32
+    // rename() refuses to overwrite an existing file on Windows
+    std::remove(to.c_str());
+#endif
+    return std::rename(from.c_str(), to.c_str()) == 0;
+}
+
+bool sync_fd(int fd) {
+#if defined(_WIN32)
+    return _commit(fd) == 0;
+#elif defined(__APPLE__)
+    // fsync on macOS does not flush the drive cache
+    return fcntl(fd, F_FULLFSYNC) == 0 || fsync(fd) == 0;
+#elif defined(__linux__)
+    return fdatasync(fd) == 0;
+#else
+    return fsync(fd) == 0;
+#endif
+}
+
+bool sync_file(const std::string& path) {
+#ifdef _WIN32
+    int fd = _open(path.c_str(), _O_RDWR | _O_BINARY);
+    if (fd < 0) return false;
+    bool ok = sync_fd(fd);
+    return _close(fd) == 0 && ok;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    return ::close(fd) == 0 && ok;
+#endif
+}
+
+bool sync_parent_directory(const std::string& path) {
+#ifdef _WIN32
+    (void)path;
+    return true;
+#else
+    std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    int fd = ::open(parent.empty() ? "." : parent.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    return ::close(fd) == 0 && ok;
+#endif
+}
+
+bool read_whole_file(const std::string& path, std::string& bytes) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) return false;
+    bytes.resize(static_cast<std::size_t>(in.tellg()));
+    in.seekg(0);
+    return static_cast<bool>(in.read(bytes.data(), static_cast<std::streamsize>(bytes.size())));
+}
+
+bool write_whole_file(const std::string& path, std::string_view bytes, bool sync) {
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()))) return false;
+        out.close();
+        if (!out) return false;
+    }
+    return !sync || sync_file(path);
+}
+
+}  // namespace ffvms::storage
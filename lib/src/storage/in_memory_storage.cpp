@@ -0,0 +1,80 @@
+/**
+ * @file in_memory_storage.cpp
+ * @brief Implementation of the in-memory IStorage backend
+ */
+
+#include "storage/in_memory_storage.h"
+#include "logger.h"
+#include "saver.h"
+
+namespace ffvms::storage {
+
+InMemoryStorage::InMemoryStorage(ffvms::ILogger* logger, const InMemoryStorageOptions& options)
+    : options_(options), logger_(logger) {}
+
+InMemoryStorage::~InMemoryStorage() {
+    if (options_.dump_path.empty()) return;
+    Saver saver(logger_, options_.dump_path, SaverOptions());
+    if (!dump(saver)) {
+        get_logger_ref().log("Failed to dump tables to " + options_.dump_path + ".", ffvms::LogLevel::WARNING, __LINE__);
+    }
+}
+
+ffvms::ILogger& InMemoryStorage::get_logger_ref() {
+    if (logger_) return *logger_;
+    return Logger::get_logger();
+}
+
+InMemoryStorage::Table InMemoryStorage::find(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = tables_.find(name);
+    return it == tables_.end() ? nullptr : it->second;
+}
+
+bool InMemoryStorage::save(const std::string& name, const ffvms::DataTable& content) {
+    // Copy outside the lock; readers still holding the old table keep it alive
+    auto table = std::make_shared<const ffvms::DataTable>(content);
+    std::lock_guard<std::mutex> lock(mutex_);
+    tables_[name] = std::move(table);
+    return true;
+}
+
+bool InMemoryStorage::load(const std::string& name, ffvms::DataTable& content, bool) {
+    Table table = find(name);
+    if (!table) {
+        get_logger_ref().log("Failed to load data. No data named " + name + " exists.", ffvms::LogLevel::WARNING, __LINE__);
+        return false;
+    }
+    content = *table;
+    return true;
+}
+
+bool InMemoryStorage::load_records(const std::string& name, const RecordSink& read, bool) {
+    Table table = find(name);
+    if (!table) {
+        get_logger_ref().log("Failed to load data. No data named " + name + " exists.", ffvms::LogLevel::WARNING, __LINE__);
+        return false;
+    }
+    ffvms::DataTableReader reader(*table);
+    return read(reader);
+}
+
+std::vector<std::string> InMemoryStorage::names() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> names;
+    for (const auto& it : tables_) names.push_back(it.first);
+    return names;
+}
+
+bool InMemoryStorage::dump(ffvms::IStorage& target) const {
+    std::map<std::string, Table> tables;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tables = tables_;
+    }
+    bool ok = true;
+    for (const auto& it : tables) ok = target.save(it.first, *it.second) && ok;
+    return ok;
+}
+
+}  // namespace ffvms::storage
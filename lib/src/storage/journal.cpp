@@ -0,0 +1,172 @@
+/**
+ * @file journal.cpp
+ * @brief Implementation of the group-commit journal
+ */
+
+#include "storage/journal.h"
+#include "storage/file_util.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ffvms::storage {
+
+namespace {
+
+#ifdef _WIN32
+int open_append(const std::string& path) {
+    return _open(path.c_str(), _O_WRONLY | _O_APPEND | _O_CREAT | _O_BINARY, _S_IREAD | _S_IWRITE);
+}
+long long write_some(int fd, const char* data, std::size_t size) {
+    unsigned int chunk = size > (1u << 30) ? (1u << 30) : static_cast<unsigned int>(size);
+    return _write(fd, data, chunk);
+}
+long long file_size(int fd) { return _lseeki64(fd, 0, SEEK_END); }
+int close_fd(int fd) { return _close(fd); }
+#else
+int open_append(const std::string& path) {
+    return ::open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+}
+long long write_some(int fd, const char* data, std::size_t size) {
+    return ::write(fd, data, size);
+}
+long long file_size(int fd) {
+    struct stat st;
+    return fstat(fd, &st) == 0 ? static_cast<long long>(st.st_size) : -1;
+}
+int close_fd(int fd) { return ::close(fd); }
+#endif
+
+}  // namespace
+
+Journal::~Journal() {
+    close();
+}
+
+bool Journal::open(const std::string& path, Durability durability, std::chrono::milliseconds interval) {
+    close();
+    int fd = open_append(path);
+    if (fd < 0) return false;
+    long long size = file_size(fd);
+    if (size < 0) {
+        close_fd(fd);
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    fd_ = fd;
+    durability_ = durability;
+    interval_ = interval;
+    written_ = synced_ = static_cast<unsigned long long>(size);
+    failed_ = false;
+    stop_ = false;
+    if (durability_ == Durability::BATCHED) {
+        flusher_ = std::thread(&Journal::flusher_loop, this);
+    }
+    return true;
+}
+
+bool Journal::close() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (fd_ < 0) return true;
+    stop_ = true;
+    flusher_cv_.notify_all();
+    if (flusher_.joinable()) {
+        lock.unlock();
+        flusher_.join();
+        lock.lock();
+    }
+    bool ok = !failed_;
+    if (durability_ != Durability::NONE) ok = sync_locked(lock, written_) && ok;
+    ok = close_fd(fd_) == 0 && ok;
+    fd_ = -1;
+    return ok;
+}
+
+bool Journal::is_open() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return fd_ >= 0;
+}
+
+unsigned long long Journal::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return written_;
+}
+
+unsigned long long Journal::sync_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sync_count_;
+}
+
+bool Journal::append(const char* data, std::size_t size, unsigned long long& end) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fd_ < 0 || failed_) return false;
+    for (std::size_t done = 0; done < size;) {
+        long long n = write_some(fd_, data + done, size - done);
+        if (n <= 0) {
+            // A partial record may be on disk now; readers stop at the first incomplete record
+            failed_ = true;
+            return false;
+        }
+        done += static_cast<std::size_t>(n);
+    }
+    written_ += size;
+    end = written_;
+    return true;
+}
+
+bool Journal::commit(unsigned long long end) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (failed_) return false;
+    if (durability_ != Durability::ALWAYS) return true;
+    return sync_locked(lock, end);
+}
+
+bool Journal::sync() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return sync_locked(lock, written_);
+}
+
+bool Journal::sync_locked(std::unique_lock<std::mutex>& lock, unsigned long long end) {
+    // Positions past written_ belong to a file this journal had open before; close() synced those
+    while (synced_ < std::min(end, written_) && fd_ >= 0 && !failed_) {
+        if (syncing_) {
+            // Another caller is syncing; its fsync may already cover our bytes
+            synced_cv_.wait(lock);
+            continue;
+        }
+        syncing_ = true;
+        unsigned long long target = written_;
+        int fd = fd_;
+        lock.unlock();
+        bool ok = sync_fd(fd);
+        lock.lock();
+        syncing_ = false;
+        sync_count_++;
+        if (ok) {
+            if (target > synced_) synced_ = target;
+        } else {
+            failed_ = true;
+        }
+        synced_cv_.notify_all();
+    }
+    return !failed_;
+}
+
+void Journal::flusher_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+        flusher_cv_.wait_for(lock, interval_, [this] { return stop_; });
+        if (written_ > synced_) sync_locked(lock, written_);
+    }
+}
+
+}  // namespace ffvms::storage
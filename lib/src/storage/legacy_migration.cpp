@@ -0,0 +1,148 @@
+/**
+ * @file legacy_migration.cpp
+ * @brief Implementation of the legacy text to binary data file migration
+ */
+
+#include "storage/legacy_migration.h"
+#include "storage/data_file_format.h"
+#include "storage/fft_cipher.h"
+#include "storage/file_util.h"
+#include "storage/legacy_text_file.h"
+#include "storage/mapped_file.h"
+#include <cstdio>
+#include <fstream>
+#include <map>
+
+namespace ffvms::storage {
+
+namespace {
+
+/// Parsed text is dropped from memory in steps of this size
+constexpr std::uint64_t RELEASE_BYTES = 16ULL << 20;
+
+std::uint64_t write_record(std::ostream& out, std::uint64_t name_hash, std::uint64_t data_hash,
+                           const std::string& payload, CodecId codec, CipherId cipher) {
+    RecordHeader record;
+    record.body_size = RECORD_HEADER_SIZE - 8 + payload.size();
+    record.name_hash = name_hash;
+    record.data_hash = data_hash;
+    if (cipher == CipherId::FFT || cipher == CipherId::FFT_PACKED) {
+        record.block_count = static_cast<std::uint32_t>((payload.size() + FftCipher::BLOCK_BYTES - 1) /
+                                                        FftCipher::BLOCK_BYTES);
+    }
+    record.codec = static_cast<std::uint8_t>(codec);
+    record.cipher = static_cast<std::uint16_t>(cipher);
+    std::string header;
+    encode_record_header(header, record);
+    out.write(header.data(), static_cast<std::streamsize>(header.size()));
+    out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    return record.body_size + 8;
+}
+
+}  // namespace
+
+bool migrate_legacy_text(ffvms::ILogger& logger, const std::string& source, const std::string& target,
+                         const MigrationOptions& options, MigrationStats& stats,
+                         const std::function<void(const MigrationStats&)>& progress) {
+    stats = MigrationStats();
+    MappedFile file;
+    if (!file.open(source)) {
+        logger.log("Unable to open " + source + ".", ffvms::LogLevel::WARNING, __LINE__);
+        return false;
+    }
+    if (has_file_magic(file.data(), file.size())) {
+        logger.log(source + " is already a binary data file.", ffvms::LogLevel::WARNING, __LINE__);
+        return false;
+    }
+    const CipherKey key = derive_key(options.passphrase);
+    std::unique_ptr<IRecordCipher> legacy = make_cipher(CipherId::FFT, key);
+    std::unique_ptr<IRecordCipher> cipher = make_cipher(options.cipher, key);
+    const ICodec* codec = find_codec(options.codec);
+    if (!cipher || !codec) {
+        logger.log("Unknown cipher or codec for the migrated file.", ffvms::LogLevel::WARNING, __LINE__);
+        return false;
+    }
+
+    const std::string tmp_file = target + ".tmp";
+    std::ofstream out(tmp_file, std::ios::binary | std::ios::trunc);
+    if (!out.good()) {
+        logger.log("Unable to open " + tmp_file + " for writing.", ffvms::LogLevel::WARNING, __LINE__);
+        return false;
+    }
+    std::string buffer;
+    FileHeader header;
+    encode_file_header(buffer, header);
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    std::uint64_t offset = FILE_HEADER_SIZE;
+
+    // A later record of the same name replaces the earlier one, as it does when Saver loads the file
+    std::map<std::uint64_t, IndexEntry> index;
+    LegacyTextReader reader(file.data(), file.size());
+    LegacyTextRecord record;
+    std::string plain, compressed, payload;
+    std::uint64_t released = 0;
+    while (out.good() && reader.next(record)) {
+        CodecId record_codec = CodecId::NONE;
+        CipherId record_cipher = CipherId::FFT;
+        const std::string* stored = &record.payload;
+        if (cipher->id() != CipherId::FFT) {
+            if (legacy->decrypt(record.payload, plain) && polynomial_hash(plain) == record.data_hash) {
+                const std::string* data = &plain;
+                if (codec->id() != CodecId::NONE) {
+                    codec->compress(plain, compressed);
+                    if (compressed.size() < plain.size()) {
+                        record_codec = codec->id();
+                        data = &compressed;
+                    }
+                }
+                cipher->encrypt(*data, payload);
+                record_cipher = cipher->id();
+                stored = &payload;
+            } else {
+                stats.kept++;
+            }
+        }
+        std::uint64_t size = write_record(out, record.name_hash, record.data_hash, *stored, record_codec, record_cipher);
+        index[record.name_hash] = IndexEntry{record.name_hash, offset, size};
+        offset += size;
+        stats.records++;
+        stats.bytes_read = reader.position();
+        stats.bytes_written = offset;
+        if (stats.bytes_read - released >= RELEASE_BYTES) {
+            file.release(released, stats.bytes_read - released);
+            released = stats.bytes_read;
+        }
+        if (progress) progress(stats);
+    }
+    if (!reader.ok()) {
+        out.close();
+        std::remove(tmp_file.c_str());
+        logger.log("Read interrupted at byte " + std::to_string(reader.position()) + " of " + source +
+                   ", please check data integrity.", ffvms::LogLevel::WARNING, __LINE__);
+        return false;
+    }
+
+    buffer.clear();
+    for (auto& entry : index) encode_index_entry(buffer, entry.second);
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    header.record_count = index.size();
+    header.index_offset = offset;
+    buffer.clear();
+    encode_file_header(buffer, header);
+    out.seekp(0);
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    out.close();
+    stats.bytes_read = file.size();
+    stats.bytes_written = offset + index.size() * INDEX_ENTRY_SIZE;
+    file.close();
+
+    if (out.fail() || !sync_file(tmp_file) || !replace_file(tmp_file, target)) {
+        std::remove(tmp_file.c_str());
+        logger.log("Failed to write " + target + ".", ffvms::LogLevel::WARNING, __LINE__);
+        return false;
+    }
+    sync_parent_directory(target);
+    return true;
+}
+
+}  // namespace ffvms::storage
@@ -0,0 +1,66 @@
+/**
+ * @file legacy_text_file.cpp
+ * @brief Implementation of the legacy text data file reader
+ */
+
+#include "storage/legacy_text_file.h"
+#include "storage/byte_io.h"
+#include "storage/fft_cipher.h"
+#include <charconv>
+
+namespace ffvms::storage {
+
+namespace {
+
+bool is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+}
+
+}  // namespace
+
+LegacyTextReader::LegacyTextReader(const char* data, std::size_t size)
+    : begin_(data), pos_(data), end_(data + size) {}
+
+void LegacyTextReader::skip_space() {
+    while (pos_ != end_ && is_space(*pos_)) pos_++;
+}
+
+bool LegacyTextReader::read_u64(std::uint64_t& value) {
+    skip_space();
+    auto result = std::from_chars(pos_, end_, value);
+    if (result.ec != std::errc()) return false;
+    pos_ = result.ptr;
+    return true;
+}
+
+bool LegacyTextReader::read_f64(double& value) {
+    skip_space();
+    auto result = std::from_chars(pos_, end_, value);
+    if (result.ec != std::errc()) return false;
+    pos_ = result.ptr;
+    return true;
+}
+
+bool LegacyTextReader::next(LegacyTextRecord& record) {
+    skip_space();
+    if (!ok_ || pos_ == end_) return false;
+    std::uint64_t blocks = 0;
+    ok_ = false;
+    if (!read_u64(record.name_hash) || !read_u64(record.data_hash) || !read_u64(blocks)) return false;
+
+    // Every double takes at least two bytes of text, which bounds the allocation on damaged input
+    const std::uint64_t doubles = 2 * static_cast<std::uint64_t>(Encryptor::N);
+    if (blocks > static_cast<std::uint64_t>(end_ - pos_) / (2 * doubles)) return false;
+    record.payload.resize(blocks * FftCipher::BLOCK_BYTES);
+    char* out = &record.payload[0];
+    for (std::uint64_t i = 0; i < blocks * doubles; i++) {
+        double value;
+        if (!read_f64(value)) return false;
+        store_f64(out, value);
+        out += 8;
+    }
+    ok_ = true;
+    return true;
+}
+
+}  // namespace ffvms::storage
@@ -0,0 +1,159 @@
+/**
+ * @file lz4_codec.cpp
+ * @brief LZ4 block compression and bounds-checked decompression
+ */
+
+#include "storage/lz4_codec.h"
+#include "storage/byte_io.h"
+
+#include <cstring>
+#include <vector>
+
+namespace ffvms::storage {
+
+namespace {
+
+constexpr std::size_t MIN_MATCH = 4;
+constexpr std::size_t LAST_LITERALS = 5;    // The last 5 bytes are always literals
+constexpr std::size_t MF_LIMIT = 12;        // A match must start at least 12 bytes before the end
+constexpr std::size_t MAX_OFFSET = 65535;
+constexpr int HASH_LOG = 16;
+constexpr std::size_t SIZE_PREFIX = 8;
+
+inline std::uint32_t read32(const unsigned char* p) {
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline std::uint32_t hash4(std::uint32_t v) {
+    return (v * 2654435761u) >> (32 - HASH_LOG);
+}
+
+// Output cursor over a buffer sized for the worst case up front
+struct Writer {
+    unsigned char* p;
+
+    void length(std::size_t len) {
+        for (; len >= 255; len -= 255) *p++ = 255;
+        *p++ = static_cast<unsigned char>(len);
+    }
+
+    void literals(const unsigned char* src, std::size_t len) {
+        *p++ = static_cast<unsigned char>((len < 15 ? len : 15) << 4);
+        if (len >= 15) length(len - 15);
+        std::memcpy(p, src, len);
+        p += len;
+    }
+
+    void sequence(const unsigned char* src, std::size_t literal_len, std::size_t offset, std::size_t match_len) {
+        unsigned char* token = p;
+        literals(src, literal_len);
+        std::size_t ml = match_len - MIN_MATCH;
+        *token |= static_cast<unsigned char>(ml < 15 ? ml : 15);
+        *p++ = static_cast<unsigned char>(offset & 0xff);
+        *p++ = static_cast<unsigned char>(offset >> 8);
+        if (ml >= 15) length(ml - 15);
+    }
+};
+
+// Reads the 255-terminated extension of a length field
+bool get_length(const unsigned char*& ip, const unsigned char* end, std::size_t& len) {
+    unsigned char b;
+    do {
+        if (ip >= end) return false;
+        b = *ip++;
+        len += b;
+    } while (b == 255);
+    return true;
+}
+
+}  // namespace
+
+void Lz4Codec::compress(std::string_view in, std::string& out) const {
+    out.clear();
+    put_u64(out, in.size());
+    out.resize(SIZE_PREFIX + in.size() + in.size() / 255 + 16);
+    Writer w{reinterpret_cast<unsigned char*>(&out[SIZE_PREFIX])};
+
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(in.data());
+    const std::size_t n = in.size();
+    std::size_t anchor = 0;
+    if (n > MF_LIMIT) {
+        std::vector<std::uint32_t> table(std::size_t(1) << HASH_LOG, 0);
+        const std::size_t match_start_limit = n - MF_LIMIT;
+        const std::size_t match_end_limit = n - LAST_LITERALS;
+        std::size_t ip = 1;
+        unsigned misses = 0;
+        table[hash4(read32(src))] = 0;
+        while (ip < match_start_limit) {
+            std::uint32_t h = hash4(read32(src + ip));
+            std::size_t ref = table[h];
+            table[h] = static_cast<std::uint32_t>(ip);
+            if (ref >= ip || ip - ref > MAX_OFFSET || read32(src + ref) != read32(src + ip)) {
+                // Skip faster through data that does not compress
+                ip += 1 + (misses++ >> 6);
+                continue;
+            }
+            misses = 0;
+            while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1]) {
+                ip--;
+                ref--;
+            }
+            std::size_t len = MIN_MATCH;
+            while (ip + len < match_end_limit && src[ref + len] == src[ip + len]) len++;
+            w.sequence(src + anchor, ip - anchor, ip - ref, len);
+            ip += len;
+            anchor = ip;
+            if (ip - 2 < match_start_limit) table[hash4(read32(src + ip - 2))] = static_cast<std::uint32_t>(ip - 2);
+        }
+    }
+    w.literals(src + anchor, n - anchor);
+    out.resize(static_cast<std::size_t>(w.p - reinterpret_cast<unsigned char*>(&out[0])));
+}
+
+bool Lz4Codec::decompress(std::string_view in, std::string& out) const {
+    if (in.size() < SIZE_PREFIX + 1) return false;
+    const std::uint64_t expected = load_u64(in.data());
+    if (expected > (in.size() - SIZE_PREFIX) * 255 + 16) return false;  // Beyond the best possible ratio
+    out.assign(static_cast<std::size_t>(expected), '\0');
+    unsigned char* dst = reinterpret_cast<unsigned char*>(&out[0]);
+    std::size_t op = 0;
+
+    const unsigned char* ip = reinterpret_cast<const unsigned char*>(in.data()) + SIZE_PREFIX;
+    const unsigned char* end = reinterpret_cast<const unsigned char*>(in.data()) + in.size();
+    while (true) {
+        if (ip >= end) return false;
+        unsigned char token = *ip++;
+        std::size_t literal_len = token >> 4;
+        if (literal_len == 15 && !get_length(ip, end, literal_len)) return false;
+        if (literal_len > static_cast<std::size_t>(end - ip) || literal_len > expected - op) return false;
+        std::memcpy(dst + op, ip, literal_len);
+        ip += literal_len;
+        op += literal_len;
+        if (ip == end) break;
+
+        if (end - ip < 2) return false;
+        std::size_t offset = ip[0] | (std::size_t(ip[1]) << 8);
+        ip += 2;
+        std::size_t match_len = token & 15;
+        if (match_len == 15 && !get_length(ip, end, match_len)) return false;
+        match_len += MIN_MATCH;
+        if (offset == 0 || offset > op || match_len > expected - op) return false;
+        const unsigned char* match = dst + op - offset;
+        if (offset >= match_len) {
+            std::memcpy(dst + op, match, match_len);
+        } else if (offset >= 8) {
+            // Overlapping but 8 bytes apart: every 8-byte step reads bytes already written
+            std::size_t i = 0;
+            for (; i + 8 <= match_len; i += 8) std::memcpy(dst + op + i, match + i, 8);
+            for (; i < match_len; i++) dst[op + i] = match[i];
+        } else {
+            for (std::size_t i = 0; i < match_len; i++) dst[op + i] = match[i];
+        }
+        op += match_len;
+    }
+    return op == expected;
+}
+
+}  // namespace ffvms::storage
@@ -0,0 +1,147 @@
+/**
+ * @file node_columns.cpp
+ * @brief Implementation of the columnar node table encoding
+ */
+
+#include "storage/node_columns.h"
+
+namespace ffvms::storage {
+
+namespace {
+
+constexpr char NODE_COLUMNS_MAGIC[8] = {'F', 'F', 'V', 'M', 'T', 'R', 'E', 'E'};
+constexpr std::uint32_t NODE_COLUMNS_VERSION = 2;
+
+std::uint64_t zigzag(std::uint64_t delta) {
+    return (delta << 1) ^ (0 - (delta >> 63));
+}
+
+std::uint64_t unzigzag(std::uint64_t value) {
+    return (value >> 1) ^ (0 - (value & 1));
+}
+
+void put_reference(std::string& column, std::uint64_t label, std::uint64_t target) {
+    put_varint(column, target == NodeColumn::NONE ? 0 : zigzag(label - target));
+}
+
+void put_column(std::string& out, const std::string& column) {
+    put_varint(out, column.size());
+    out += column;
+}
+
+}  // namespace
+
+void NodeColumnsWriter::reserve(std::size_t nodes) {
+    types_.reserve(nodes);
+    counts_.reserve(nodes);
+    links_.reserve(nodes * 9);
+    brothers_.reserve(nodes);
+    sons_.reserve(nodes);
+}
+
+void NodeColumnsWriter::add(const NodeColumn& node) {
+    types_.push_back(static_cast<char>(node.type));
+    put_varint(counts_, node.cnt);
+    // A free label repeats the previous link, which costs one byte
+    const std::uint64_t link = node.type == NodeColumn::FREE ? last_link_ : node.link;
+    put_varint(links_, zigzag(link - last_link_));
+    last_link_ = link;
+    put_reference(brothers_, nodes_, node.next_brother);
+    put_reference(sons_, nodes_, node.first_son);
+    nodes_++;
+}
+
+void NodeColumnsWriter::finish(std::string& out) const {
+    out.reserve(out.size() + 64 + types_.size() + counts_.size() + links_.size() + brothers_.size() + sons_.size());
+    out.append(NODE_COLUMNS_MAGIC, sizeof(NODE_COLUMNS_MAGIC));
+    put_u32(out, NODE_COLUMNS_VERSION);
+    put_varint(out, nodes_);
+    put_column(out, types_);
+    put_column(out, counts_);
+    put_column(out, links_);
+    put_column(out, brothers_);
+    put_column(out, sons_);
+}
+
+bool NodeColumnsReader::is_node_columns(std::string_view bytes) {
+    return bytes.size() >= sizeof(NODE_COLUMNS_MAGIC) &&
+           bytes.compare(0, sizeof(NODE_COLUMNS_MAGIC), std::string_view(NODE_COLUMNS_MAGIC, sizeof(NODE_COLUMNS_MAGIC))) == 0;
+}
+
+bool NodeColumnsReader::open(std::string_view bytes) {
+    if (!is_node_columns(bytes)) return false;
+    ByteReader in(bytes.data() + sizeof(NODE_COLUMNS_MAGIC), bytes.size() - sizeof(NODE_COLUMNS_MAGIC));
+    version_ = in.u32();
+    if (version_ != 1 && version_ != NODE_COLUMNS_VERSION) return false;
+    nodes_ = in.varint();
+    label_ = 0;
+    last_link_ = 0;
+
+    // Every column holds at least one byte per node
+    ByteReader* columns[] = {nullptr, &counts_, &links_, &brothers_, &sons_};
+    for (ByteReader* column : columns) {
+        std::uint64_t size = in.varint();
+        const char* data = in.position();
+        if (!in.ok() || size < nodes_ || !in.skip(size)) return false;
+        if (!column) {
+            if (size != nodes_) return false;
+            types_ = data;
+        } else {
+            *column = ByteReader(data, size);
+        }
+    }
+    return in.remaining() == 0;
+}
+
+bool NodeColumnsReader::reference(ByteReader& column, std::uint64_t& label) {
+    std::uint64_t value = column.varint();
+    if (!column.ok()) return false;
+    if (value == 0) {
+        label = NodeColumn::NONE;
+        return true;
+    }
+    if (version_ == 1) {
+        if (value > label_) return false;
+        label = label_ - value;
+        return true;
+    }
+    label = label_ - unzigzag(value);
+    return label < nodes_;
+}
+
+bool NodeColumnsReader::next(NodeColumn& node) {
+    if (label_ >= nodes_) return false;
+    node.type = static_cast<std::uint8_t>(types_[label_]);
+    std::uint64_t cnt = counts_.varint();
+    if (!counts_.ok() || cnt > UINT32_MAX) return false;
+    node.cnt = static_cast<std::uint32_t>(cnt);
+    std::uint64_t delta = links_.varint();
+    if (!links_.ok()) return false;
+    node.link = last_link_ + unzigzag(delta);
+    last_link_ = node.link;
+    if (!reference(brothers_, node.next_brother) || !reference(sons_, node.first_son)) return false;
+
+    // Leftover bytes after the last node mean the columns do not agree on the count
+    if (++label_ == nodes_) {
+        return counts_.remaining() == 0 && links_.remaining() == 0 && brothers_.remaining() == 0 &&
+               sons_.remaining() == 0;
+    }
+    return true;
+}
+
+void NodeColumnTable::push_back(const NodeColumn& node) {
+    if (size_ % BLOCK == 0) blocks_.emplace_back().edit().reserve(BLOCK);
+    blocks_.back().edit().push_back(node);
+    size_++;
+}
+
+void NodeColumnTable::encode(std::string& out) const {
+    NodeColumnsWriter writer;
+    writer.reserve(static_cast<std::size_t>(size_));
+    for (const auto& block : blocks_) {
+        for (const NodeColumn& node : block.get()) writer.add(node);
+    }
+    writer.finish(out);
+}
+
+}  // namespace ffvms::storage
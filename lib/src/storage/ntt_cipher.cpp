@@ -0,0 +1,100 @@
+/**
+ * @file ntt_cipher.cpp
+ * @brief Byte-level NTT record cipher
+ */
+
+#include "storage/ntt_cipher.h"
+#include "core/ntt.h"
+#include "storage/byte_io.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace ffvms::storage {
+
+namespace {
+
+/// Blocks below which a payload is not worth splitting across threads
+constexpr std::size_t PARALLEL_MIN_BLOCKS = 8;
+
+}  // namespace
+
+std::size_t NttCipher::block_size(std::uint64_t plain_size) {
+    std::size_t n = MIN_BLOCK_SIZE;
+    while (n < BLOCK_SIZE && n < plain_size) n <<= 1;
+    return n;
+}
+
+bool NttCipher::valid_payload_size(unsigned long long size) {
+    if (size < HEADER_BYTES || (size - HEADER_BYTES) % 4 != 0) return false;
+    unsigned long long points = (size - HEADER_BYTES) / 4;
+    if (points % BLOCK_SIZE == 0) return true;
+    return points < BLOCK_SIZE && points >= MIN_BLOCK_SIZE && (points & (points - 1)) == 0;
+}
+
+void NttCipher::encrypt(std::string_view plain, std::string& payload) {
+    const std::size_t n = block_size(plain.size());
+    const std::size_t blocks = (plain.size() + n - 1) / n;
+    payload.clear();
+    put_u64(payload, plain.size());
+    payload.resize(HEADER_BYTES + blocks * n * 4);
+    const NttPlan& plan = NttPlan::get(n);
+    char* out = &payload[HEADER_BYTES];
+    for_blocks(pool_, blocks, PARALLEL_MIN_BLOCKS, [&](std::size_t first, std::size_t last) {
+        std::uint32_t block[BLOCK_SIZE];
+        for (std::size_t b = first; b < last; b++) {
+            std::size_t begin = b * n;
+            for (std::size_t i = 0; i < n; i++) {
+                block[i] = begin + i < plain.size() ? static_cast<unsigned char>(plain[begin + i]) : 0;
+            }
+            plan.transform(block, 1);
+            for (std::size_t i = 0; i < n; i++) store_u32(out + (begin + i) * 4, block[i]);
+        }
+    });
+}
+
+bool NttCipher::decrypt(std::string_view payload, std::string& plain) {
+    if (payload.size() < HEADER_BYTES) return false;
+    const std::uint64_t size = load_u64(payload.data());
+    // The plain size fixes the block size and count, so it must account for every byte
+    const std::size_t n = block_size(size);
+    const std::uint64_t blocks = (size + n - 1) / n;
+    if (size > payload.size() || payload.size() - HEADER_BYTES != blocks * n * 4) return false;
+
+    plain.resize(blocks * n);
+    const NttPlan& plan = NttPlan::get(n);
+    const char* in = payload.data() + HEADER_BYTES;
+    std::atomic<bool> ok{true};
+    for_blocks(pool_, blocks, PARALLEL_MIN_BLOCKS, [&](std::size_t first, std::size_t last) {
+        std::uint32_t block[BLOCK_SIZE];
+        for (std::size_t b = first; b < last; b++) {
+            std::uint32_t bad = 0;
+            for (std::size_t i = 0; i < n; i++) {
+                block[i] = load_u32(in + (b * n + i) * 4);
+                bad |= block[i] >= NttPlan::MODULUS;
+            }
+            if (bad) {
+                ok = false;
+                return;
+            }
+            plan.transform(block, -1);
+            for (std::size_t i = 0; i < n; i++) {
+                bad |= block[i] >> 8;
+                plain[b * n + i] = static_cast<char>(block[i]);
+            }
+            if (bad) {
+                ok = false;
+                return;
+            }
+        }
+    });
+    if (!ok) return false;
+    // Padding past the plain size must have come back as zeros
+    for (std::size_t i = size; i < plain.size(); i++) {
+        if (plain[i] != 0) return false;
+    }
+    plain.resize(size);
+    return true;
+}
+
+}  // namespace ffvms::storage
@@ -0,0 +1,299 @@
+/**
+ * @file object_storage.cpp
+ * @brief Content-addressed object directory storage
+ */
+
+#include "storage/object_storage.h"
+#include "logger.h"
+#include "storage/byte_io.h"
+#include "storage/file_util.h"
+#include "storage/table_rows.h"
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace ffvms::storage {
+
+namespace {
+
+constexpr char MANIFEST_MAGIC[8] = {'F', 'F', 'V', 'M', 'S', 'O', 'B', 'J'};
+constexpr std::uint32_t MANIFEST_VERSION = 1;
+
+// Past a quarter of object_bytes, an object ends after any row whose hash
+// has these bits clear: about every 16 rows, at the same rows whatever
+// came before them.
+constexpr std::uint64_t CUT_MASK = 15;
+
+std::uint64_t row_hash(const char* data, std::size_t size) {
+    std::uint64_t h = 14695981039346656037ULL;
+    for (std::size_t i = 0; i < size; i++) {
+        h ^= static_cast<unsigned char>(data[i]);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/// @brief Group the rows into objects; each entry is (id, bytes), ids still unset
+void cut_objects(const ffvms::DataTable& content, std::size_t object_bytes,
+                 std::vector<std::pair<Sha256::Digest, std::string>>& objects) {
+    std::string object, row;
+    std::uint32_t rows = 0;
+    auto finish = [&] {
+        store_u32(object.data(), rows);
+        objects.emplace_back(Sha256::Digest{}, std::move(object));
+        object.clear();
+        rows = 0;
+    };
+    for (const auto& cells : content) {
+        if (rows == 0) put_u32(object, 0);
+        row.clear();
+        append_row(row, cells);
+        object += row;
+        rows++;
+        if (object.size() >= object_bytes ||
+            (object.size() >= object_bytes / 4 && (row_hash(row.data(), row.size()) & CUT_MASK) == 0)) {
+            finish();
+        }
+    }
+    if (rows > 0) finish();
+}
+
+bool decode_object(const std::string& bytes, ffvms::DataTable& rows) {
+    ByteReader in(bytes.data(), bytes.size());
+    std::uint32_t count = in.u32();
+    if (!in.ok() || count > in.remaining() / 4) return false;
+    rows.resize(count);
+    for (auto& row : rows) {
+        if (!read_row(in, row)) return false;
+    }
+    return in.remaining() == 0;
+}
+
+}  // namespace
+
+ObjectStorage::ObjectStorage(ffvms::ILogger* logger, const std::string& directory, const ObjectStorageOptions& options)
+    : directory_(directory), options_(options), io_(make_async_io(options.io, pool())), logger_(logger) {
+    std::error_code ec;
+    fs::create_directories(fs::path(directory_) / "objects", ec);
+    open_ = !ec && read_manifest();
+    if (!open_) {
+        get_logger_ref().log("Failed to open object storage " + directory_ + ".", ffvms::LogLevel::FATAL, __LINE__);
+    }
+}
+
+ffvms::ILogger& ObjectStorage::get_logger_ref() {
+    if (logger_) return *logger_;
+    return Logger::get_logger();
+}
+
+ffvms::ThreadPool& ObjectStorage::pool() {
+    return options_.pool ? *options_.pool : ffvms::ThreadPool::shared();
+}
+
+std::string ObjectStorage::object_path(const Sha256::Digest& id) const {
+    std::string hex = to_hex(id);
+    return (fs::path(directory_) / "objects" / hex.substr(0, 2) / hex.substr(2)).string();
+}
+
+std::string ObjectStorage::manifest_path() const {
+    return (fs::path(directory_) / "MANIFEST").string();
+}
+
+bool ObjectStorage::read_manifest() {
+    std::string bytes;
+    if (!fs::exists(manifest_path())) return true;
+    if (!read_whole_file(manifest_path(), bytes) || bytes.size() < sizeof(MANIFEST_MAGIC) + 8 + 32 ||
+        bytes.compare(0, sizeof(MANIFEST_MAGIC), MANIFEST_MAGIC, sizeof(MANIFEST_MAGIC)) != 0) {
+        return false;
+    }
+    const std::size_t body = bytes.size() - 32;
+    Sha256::Digest sum = Sha256::hash(bytes.data(), body);
+    if (bytes.compare(body, 32, reinterpret_cast<const char*>(sum.data()), 32) != 0) return false;
+
+    ByteReader in(bytes.data() + sizeof(MANIFEST_MAGIC), body - sizeof(MANIFEST_MAGIC));
+    if (in.u32() != MANIFEST_VERSION) return false;
+    std::uint32_t count = in.u32();
+    for (std::uint32_t t = 0; t < count && in.ok(); t++) {
+        std::uint32_t name_size = in.u32();
+        const char* name = in.position();
+        if (!in.skip(name_size)) return false;
+        Table& table = tables_[std::string(name, name_size)];
+        table.rows = in.u64();
+        std::uint32_t objects = in.u32();
+        if (!in.ok() || objects > in.remaining() / 32) return false;
+        table.objects.resize(objects);
+        for (auto& id : table.objects) {
+            std::memcpy(id.data(), in.position(), id.size());
+            in.skip(id.size());
+            present_.insert(id);
+        }
+    }
+    return in.ok() && in.remaining() == 0;
+}
+
+bool ObjectStorage::write_manifest() {
+    std::string bytes(MANIFEST_MAGIC, sizeof(MANIFEST_MAGIC));
+    put_u32(bytes, MANIFEST_VERSION);
+    put_u32(bytes, static_cast<std::uint32_t>(tables_.size()));
+    for (const auto& it : tables_) {
+        put_u32(bytes, static_cast<std::uint32_t>(it.first.size()));
+        bytes += it.first;
+        put_u64(bytes, it.second.rows);
+        put_u32(bytes, static_cast<std::uint32_t>(it.second.objects.size()));
+        for (const auto& id : it.second.objects) bytes.append(reinterpret_cast<const char*>(id.data()), id.size());
+    }
+    Sha256::Digest sum = Sha256::hash(bytes.data(), bytes.size());
+    bytes.append(reinterpret_cast<const char*>(sum.data()), sum.size());
+
+    const std::string tmp = manifest_path() + ".tmp";
+    if (!write_whole_file(tmp, bytes, options_.sync) || !replace_file(tmp, manifest_path())) return false;
+    return !options_.sync || sync_parent_directory(manifest_path());
+}
+
+bool ObjectStorage::write_objects(const std::vector<std::pair<Sha256::Digest, std::string>>& objects) {
+    // Fan-out directories first, so the writers never race to create one
+    std::set<std::string> shards;
+    for (const auto& object : objects) shards.insert(fs::path(object_path(object.first)).parent_path().string());
+    std::error_code ec;
+    for (const auto& shard : shards) {
+        fs::create_directories(shard, ec);
+        if (ec) return false;
+    }
+
+    std::vector<FileWrite> writes;
+    writes.reserve(objects.size());
+    for (const auto& object : objects) writes.push_back({object_path(object.first) + ".tmp", object.second});
+    if (!io_->write_files(writes, options_.sync)) return false;
+    for (std::size_t i = 0; i < objects.size(); i++) {
+        if (!replace_file(writes[i].path, object_path(objects[i].first))) return false;
+    }
+    if (options_.sync) {
+        // The new entries in each fan-out directory, and any new fan-out directory
+        for (const auto& shard : shards) {
+            if (!sync_parent_directory((fs::path(shard) / "x").string()) || !sync_parent_directory(shard)) return false;
+        }
+    }
+    return true;
+}
+
+bool ObjectStorage::save(const std::string& name, const ffvms::DataTable& content) {
+    std::vector<std::pair<Sha256::Digest, std::string>> objects;
+    cut_objects(content, options_.object_bytes, objects);
+    pool().parallel_for(objects.size(), 16, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            objects[i].first = Sha256::hash(objects[i].second.data(), objects[i].second.size());
+        }
+    });
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!open_) return false;
+    Table table;
+    table.rows = content.size();
+    std::vector<std::pair<Sha256::Digest, std::string>> fresh;
+    std::set<Sha256::Digest> queued;
+    for (auto& object : objects) {
+        table.objects.push_back(object.first);
+        if (present_.count(object.first) || !queued.insert(object.first).second) {
+            stats_.objects_reused++;
+            continue;
+        }
+        // Left behind by a save whose manifest never landed, or by another copy
+        if (fs::exists(object_path(object.first))) {
+            present_.insert(object.first);
+            stats_.objects_reused++;
+            continue;
+        }
+        fresh.push_back(std::move(object));
+    }
+
+    if (!write_objects(fresh)) {
+        get_logger_ref().log("Failed to save data. Could not write the objects of " + name + ".",
+                             ffvms::LogLevel::FATAL, __LINE__);
+        return false;
+    }
+    for (const auto& object : fresh) {
+        present_.insert(object.first);
+        stats_.objects_written++;
+        stats_.bytes_written += object.second.size();
+    }
+
+    Table previous;
+    auto it = tables_.find(name);
+    bool existed = it != tables_.end();
+    if (existed) previous = std::move(it->second);
+    tables_[name] = std::move(table);
+    if (!write_manifest()) {
+        if (existed) tables_[name] = std::move(previous);
+        else tables_.erase(name);
+        get_logger_ref().log("Failed to save data. Could not replace the manifest in " + directory_ + ".",
+                             ffvms::LogLevel::FATAL, __LINE__);
+        return false;
+    }
+    return true;
+}
+
+bool ObjectStorage::load(const std::string& name, ffvms::DataTable& content, bool) {
+    Table table;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!open_) return false;
+        auto it = tables_.find(name);
+        if (it == tables_.end()) {
+            get_logger_ref().log("Failed to load data. No data named " + name + " exists.", ffvms::LogLevel::WARNING, __LINE__);
+            return false;
+        }
+        table = it->second;
+    }
+
+    // Objects are immutable, so they can be read without holding the lock
+    std::vector<std::string> paths;
+    paths.reserve(table.objects.size());
+    for (const auto& id : table.objects) paths.push_back(object_path(id));
+    std::vector<ffvms::DataTable> parts(table.objects.size());
+    bool ok = io_->read_files(paths, [&](std::size_t i, std::string&& bytes) {
+        return Sha256::hash(bytes.data(), bytes.size()) == table.objects[i] && decode_object(bytes, parts[i]);
+    });
+
+    ffvms::DataTable loaded;
+    loaded.reserve(table.rows);
+    for (auto& part : parts) {
+        for (auto& row : part) loaded.push_back(std::move(row));
+    }
+    if (!ok || loaded.size() != table.rows) {
+        get_logger_ref().log("Failed to load data. " + name + " is damaged.", ffvms::LogLevel::WARNING, __LINE__);
+        return false;
+    }
+    content = std::move(loaded);
+    return true;
+}
+
+std::size_t ObjectStorage::remove_unreferenced() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!open_) return 0;
+    std::set<Sha256::Digest> referenced;
+    for (const auto& it : tables_) referenced.insert(it.second.objects.begin(), it.second.objects.end());
+
+    std::size_t removed = 0;
+    std::error_code ec;
+    for (const auto& shard : fs::directory_iterator(fs::path(directory_) / "objects", ec)) {
+        if (!shard.is_directory()) continue;
+        for (const auto& file : fs::directory_iterator(shard.path(), ec)) {
+            Sha256::Digest id;
+            const std::string hex = shard.path().filename().string() + file.path().filename().string();
+            const bool named = from_hex(hex, id);
+            if (named && referenced.count(id)) continue;
+            if (fs::remove(file.path(), ec)) {
+                if (named) present_.erase(id);
+                removed++;
+            }
+        }
+    }
+    return removed;
+}
+
+ObjectStorage::Stats ObjectStorage::stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+}  // namespace ffvms::storage
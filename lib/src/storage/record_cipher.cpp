@@ -0,0 +1,61 @@
+/**
+ * @file record_cipher.cpp
+ * @brief Cipher registry, identity cipher and key derivation
+ */
+
+#include "storage/record_cipher.h"
+#include "storage/chacha20.h"
+#include "storage/fft_cipher.h"
+#include "storage/ntt_cipher.h"
+#include "storage/sha256.h"
+
+namespace ffvms::storage {
+
+namespace {
+
+class IdentityCipher : public IRecordCipher {
+public:
+    CipherId id() const override { return CipherId::IDENTITY; }
+    const char* name() const override { return "identity"; }
+
+    void encrypt(std::string_view plain, std::string& payload) override { payload.assign(plain); }
+
+    bool decrypt(std::string_view payload, std::string& plain) override {
+        plain.assign(payload);
+        return true;
+    }
+};
+
+}  // namespace
+
+std::unique_ptr<IRecordCipher> make_cipher(CipherId id, const CipherKey& key) {
+    switch (id) {
+        case CipherId::FFT: return std::make_unique<FftCipher>();
+        case CipherId::IDENTITY: return std::make_unique<IdentityCipher>();
+        case CipherId::CHACHA20: return std::make_unique<ChaCha20Cipher>(key);
+        case CipherId::FFT_PACKED: return std::make_unique<PackedFftCipher>();
+        case CipherId::NTT: return std::make_unique<NttCipher>();
+    }
+    return nullptr;
+}
+
+bool is_valid_payload_size(CipherId id, unsigned long long size) {
+    switch (id) {
+        case CipherId::FFT: return size % FftCipher::BLOCK_BYTES == 0;
+        case CipherId::IDENTITY: return true;
+        case CipherId::CHACHA20: return size >= CHACHA20_NONCE_SIZE;
+        case CipherId::FFT_PACKED: return PackedFftCipher::valid_payload_size(size);
+        case CipherId::NTT: return NttCipher::valid_payload_size(size);
+    }
+    return false;
+}
+
+CipherKey derive_key(const std::string& passphrase) {
+    static const char DOMAIN[] = "ffvms record key";
+    Sha256 sha;
+    sha.update(DOMAIN, sizeof(DOMAIN));
+    sha.update(passphrase.data(), passphrase.size());
+    return sha.finish();
+}
+
+}  // namespace ffvms::storage
@@ -0,0 +1,32 @@
+/**
+ * @file table_rows.cpp
+ * @brief Implementation of the shared row encoding
+ */
+
+#include "storage/table_rows.h"
+
+namespace ffvms::storage {
+
+void append_row(std::string& out, const std::vector<std::string>& row) {
+    put_u32(out, static_cast<std::uint32_t>(row.size()));
+    for (const auto& cell : row) {
+        put_u32(out, static_cast<std::uint32_t>(cell.size()));
+        out += cell;
+    }
+}
+
+bool read_row(ByteReader& in, std::vector<std::string>& row) {
+    std::uint32_t cells = in.u32();
+    if (!in.ok() || cells > in.remaining() / 4) return false;
+    row.clear();
+    row.reserve(cells);
+    for (std::uint32_t i = 0; i < cells; i++) {
+        std::uint32_t size = in.u32();
+        const char* data = in.position();
+        if (!in.skip(size)) return false;
+        row.emplace_back(data, size);
+    }
+    return in.ok();
+}
+
+}  // namespace ffvms::storage
@@ -0,0 +1,88 @@
+/**
+ * @file table_text.cpp
+ * @brief Implementation of the Saver table serialization
+ */
+
+#include "storage/table_text.h"
+#include <charconv>
+
+namespace ffvms::storage {
+
+void TextTableWriter::number(std::uint64_t value) {
+    char digits[20];
+    auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+    out_.append(digits, end);
+}
+
+void TextTableWriter::field(const char* data, std::size_t size) {
+    out_ += ' ';
+    number(size);
+    out_ += ' ';
+    out_.append(data, size);
+}
+
+void TextTableWriter::begin_table(std::size_t rows) {
+    number(rows);
+}
+
+void TextTableWriter::begin_row(std::size_t fields) {
+    out_ += ' ';
+    number(fields);
+}
+
+void TextTableWriter::u64(std::uint64_t value) {
+    char digits[20];
+    auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+    field(digits, static_cast<std::size_t>(end - digits));
+}
+
+TextTableReader::TextTableReader(std::string_view text) : text_(text) {
+    // An empty record is an empty table
+    std::uint64_t rows = 0;
+    if (!text_.empty() && !number(rows)) return;
+    rows_ = rows_left_ = static_cast<std::size_t>(rows);
+}
+
+bool TextTableReader::number(std::uint64_t& value) {
+    if (pos_ < text_.size() && text_[pos_] == ' ') pos_++;
+    std::size_t begin = pos_;
+    while (pos_ < text_.size() && text_[pos_] >= '0' && text_[pos_] <= '9') pos_++;
+    if (!parse_u64(text_.substr(begin, pos_ - begin), value)) {
+        ok_ = false;
+        return false;
+    }
+    return true;
+}
+
+bool TextTableReader::field(std::string_view& value) {
+    std::uint64_t size;
+    if (!ok_ || fields_left_ == 0 || !number(size) || pos_ >= text_.size() || text_[pos_] != ' ' ||
+        size > text_.size() - pos_ - 1) {
+        ok_ = false;
+        return false;
+    }
+    value = text_.substr(pos_ + 1, static_cast<std::size_t>(size));
+    pos_ += 1 + static_cast<std::size_t>(size);
+    fields_left_--;
+    return true;
+}
+
+bool TextTableReader::next_row(std::size_t& fields) {
+    std::string_view skipped;
+    while (ok_ && fields_left_ > 0) field(skipped);
+    if (!ok_ || rows_left_ == 0) return false;
+    std::uint64_t count;
+    if (!number(count)) return false;
+    rows_left_--;
+    fields = fields_left_ = static_cast<std::size_t>(count);
+    return true;
+}
+
+bool TextTableReader::u64(std::uint64_t& value) {
+    std::string_view text;
+    if (field(text) && parse_u64(text, value)) return true;
+    ok_ = false;
+    return false;
+}
+
+}  // namespace ffvms::storage
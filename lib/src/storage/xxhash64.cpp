@@ -0,0 +1,91 @@
+/**
+ * @file xxhash64.cpp
+ * @brief Implementation of xxHash64
+ */
+
+#include "storage/xxhash64.h"
+#include "storage/byte_io.h"
+#include <cstring>
+
+namespace ffvms::storage {
+
+namespace {
+
+constexpr std::uint64_t PRIME1 = 11400714785074694791ULL;
+constexpr std::uint64_t PRIME2 = 14029467366897019727ULL;
+constexpr std::uint64_t PRIME3 = 1609587929392839161ULL;
+constexpr std::uint64_t PRIME4 = 9650029242287828579ULL;
+constexpr std::uint64_t PRIME5 = 2870177450012600261ULL;
+
+// The hash is stored, so lanes are read little-endian; memcpy is a single load where that is the host order
+std::uint64_t read64(const char* p) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return read64(p);
+#else
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+#endif
+}
+
+std::uint64_t rotl(std::uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+std::uint64_t accumulate(std::uint64_t acc, std::uint64_t input) {
+    acc += input * PRIME2;
+    return rotl(acc, 31) * PRIME1;
+}
+
+std::uint64_t merge(std::uint64_t acc, std::uint64_t lane) {
+    acc ^= accumulate(0, lane);
+    return acc * PRIME1 + PRIME4;
+}
+
+}  // namespace
+
+std::uint64_t xxhash64(std::string_view data, std::uint64_t seed) {
+    const char* p = data.data();
+    const char* const end = p + data.size();
+    std::uint64_t h;
+    if (data.size() >= 32) {
+        std::uint64_t v1 = seed + PRIME1 + PRIME2;
+        std::uint64_t v2 = seed + PRIME2;
+        std::uint64_t v3 = seed;
+        std::uint64_t v4 = seed - PRIME1;
+        for (; end - p >= 32; p += 32) {
+            v1 = accumulate(v1, read64(p));
+            v2 = accumulate(v2, read64(p + 8));
+            v3 = accumulate(v3, read64(p + 16));
+            v4 = accumulate(v4, read64(p + 24));
+        }
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge(merge(merge(merge(h, v1), v2), v3), v4);
+    } else {
+        h = seed + PRIME5;
+    }
+    h += data.size();
+
+    for (; end - p >= 8; p += 8) {
+        h ^= accumulate(0, read64(p));
+        h = rotl(h, 27) * PRIME1 + PRIME4;
+    }
+    if (end - p >= 4) {
+        h ^= load_u32(p) * PRIME1;
+        h = rotl(h, 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h ^= static_cast<std::uint8_t>(*p) * PRIME5;
+        h = rotl(h, 11) * PRIME1;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+}  // namespace ffvms::storage
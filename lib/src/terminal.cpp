@@ -30,14 +30,24 @@
 #include "commands/version_command.h"
 #include "commands/vim_command.h"
 #include "core/types.h" // For LogLevel
+#include "file_manager.h"
 #include "logger.h"
+#include "node_manager.h"
+#include "saver.h"
 #include <iostream>
 #include <memory>
 
 using namespace ffvms;
 
-Terminal::Terminal() : session_(file_system), logger_(nullptr) {
+Terminal::Terminal(const ffvms::CheckpointOptions &checkpoint)
+    : session_(file_system), logger_(nullptr),
+      checkpointer_(&Saver::get_default_storage(), nullptr, checkpoint) {
   register_commands();
+  // Contents first, then nodes, then the trees that refer to them
+  checkpointer_.add_source(&FileManager::get_file_manager());
+  checkpointer_.add_source(&NodeManager::get_node_manager());
+  checkpointer_.add_source(&file_system.checkpoint_source());
+  checkpointer_.start();
 }
 
 ffvms::ILogger &Terminal::get_logger_ref() {
@@ -96,7 +106,13 @@ int Terminal::run() {
 
     auto cmd = registry_.get_command(name);
     if (cmd) {
-      CommandResult result = cmd->execute(session_, params);
+      CommandResult result;
+      {
+        // Checkpoints capture between commands, never in the middle of one
+        auto state = checkpointer_.lock_state();
+        result = cmd->execute(session_, params);
+      }
+      checkpointer_.poke();
       if (result.success) {
         if (!result.output.empty()) {
           std::cout << result.output << "\n";
@@ -12,6 +12,44 @@
 #include "node_manager.h"
 #include "logger.h"
 #include "saver.h"
+#include "storage/node_columns.h"
+#include "storage/record_schema.h"
+#include <string_view>
+
+namespace {
+
+// One row of a tree node table from before the columnar encoding; type is 0 file, 1 directory, 2 version head
+struct TreeNodeRow {
+    std::uint64_t label = 0;
+    std::uint64_t type = 0;
+    std::uint64_t cnt = 0;
+    std::uint64_t link = 0;
+    std::uint64_t next_brother = 0;
+    std::uint64_t first_son = 0;
+};
+
+struct VersionRow {
+    std::uint64_t id = 0;
+    std::string_view info;
+    std::uint64_t head = 0;   ///< Label of the version's head node
+};
+
+constexpr auto TREE_NODE_SCHEMA = ffvms::storage::make_schema(
+    ffvms::storage::field("label", &TreeNodeRow::label),
+    ffvms::storage::field("type", &TreeNodeRow::type),
+    ffvms::storage::field("cnt", &TreeNodeRow::cnt),
+    ffvms::storage::field("link", &TreeNodeRow::link),
+    ffvms::storage::field("next_brother", &TreeNodeRow::next_brother),
+    ffvms::storage::field("first_son", &TreeNodeRow::first_son));
+static_assert(TREE_NODE_SCHEMA.valid(), "Tree node fields must be listed in the order they were added");
+
+constexpr auto VERSION_SCHEMA = ffvms::storage::make_schema(
+    ffvms::storage::field("id", &VersionRow::id),
+    ffvms::storage::field("info", &VersionRow::info),
+    ffvms::storage::field("head", &VersionRow::head));
+static_assert(VERSION_SCHEMA.valid(), "Version fields must be listed in the order they were added");
+
+}  // namespace
 
 // Helpers to get dependencies (injected or singleton)
 ffvms::ILogger& VersionManager::get_logger_ref() {
@@ -26,7 +64,7 @@ ffvms::INodeManager& VersionManager::get_node_manager_ref() {
 
 ffvms::IStorage& VersionManager::get_storage_ref() {
     if (storage_) return *storage_;
-    return Saver::get_saver();
+    return Saver::get_default_storage();
 }
 
 // Constructors
@@ -45,41 +83,175 @@ VersionManager::~VersionManager() {
 }
 
 bool VersionManager::load() {
-    ffvms::DataTable node_information;
-    if (!get_storage_ref().load(DATA_TREENODE_INFO, node_information)) return false;
-    ffvms::DataTable version_information;
-    if (!get_storage_ref().load(DATA_VERSION_INFO, version_information)) return false;
-
+    auto corrupted = [this]() {
+        get_logger_ref().log("VersionManager: File is corrupted and cannot be read.", ffvms::LogLevel::WARNING, __LINE__);
+        return false;
+    };
+    // A columnar table is a single field and labels its nodes 0..n-1; older tables hold one row per node
+    std::vector<treeNode*> by_label;
     std::map<unsigned long long, treeNode*> label_to_ptr;
-    std::string s_label, s_type, s_cnt, s_link, s_next_brother, s_first_son;
-    for (auto& node : node_information) {
-        if (node.size() != 6) {
-            get_logger_ref().log("VersionManager: File is corrupted and cannot be read.", ffvms::LogLevel::WARNING, __LINE__);
-            return false;
+    bool legacy = false;
+    bool loaded = get_storage_ref().load_records(DATA_TREENODE_INFO, [&](ffvms::IRecordReader& in) {
+        std::size_t fields;
+        if (!in.next_row(fields)) return in.ok() || corrupted();
+        if (fields == 1) {
+            std::string_view bytes;
+            return (in.bytes(bytes) && !in.next_row(fields) && in.ok() &&
+                    read_node_columns(bytes, by_label, columns_)) ||
+                   corrupted();
         }
-        s_label = node[0];
-        s_type = node[1];
-        s_cnt = node[2];
-        s_link = node[3];
-        s_next_brother = node[4];
-        s_first_son = node[5];
-        if (!get_storage_ref().is_all_digits(s_label) || !get_storage_ref().is_all_digits(s_type) || 
-            !get_storage_ref().is_all_digits(s_cnt) || !get_storage_ref().is_all_digits(s_link) || 
-            !get_storage_ref().is_all_digits(s_next_brother) || !get_storage_ref().is_all_digits(s_first_son)) {
-            get_logger_ref().log("VersionManager: File is corrupted and cannot be read.", ffvms::LogLevel::WARNING, __LINE__);
-            return false;
+        legacy = true;
+        return read_legacy_nodes(in, fields, label_to_ptr) || corrupted();
+    });
+    if (!loaded) return false;
+
+    auto node_of = [&](unsigned long long label) -> treeNode* {
+        if (!legacy) return label < by_label.size() ? by_label[label] : nullptr;
+        auto it = label_to_ptr.find(label);
+        return it == label_to_ptr.end() ? nullptr : it->second;
+    };
+    loaded = get_storage_ref().load_records(DATA_VERSION_INFO, [&](ffvms::IRecordReader& in) {
+        return VERSION_SCHEMA.read_table(in, [&](const VersionRow& row) {
+            treeNode* head = node_of(row.head);
+            if (head == nullptr) {
+                version.clear();
+                return false;
+            }
+            auto t = versionNode();
+            t.info = row.info;
+            t.p = head;
+            version[row.id] = t;
+            return true;
+        }) || corrupted();
+    });
+    // Nodes that no version row reaches, all of them if the rows did not load, are freed here
+    if (!legacy && !adopt_nodes(by_label)) {
+        version.clear();
+        return corrupted();
+    }
+    if (!loaded) return false;
+
+    dirty_ = false;
+    return true;
+}
+
+bool VersionManager::read_node_columns(std::string_view bytes, std::vector<treeNode*>& nodes,
+                                       ffvms::storage::NodeColumnTable& columns) {
+    ffvms::storage::NodeColumnsReader reader;
+    if (!reader.open(bytes)) return false;
+    columns.clear();
+    nodes.reserve(reader.size());
+    auto fail = [&]() {
+        for (treeNode* t : nodes) delete t;
+        nodes.clear();
+        columns.clear();
+        return false;
+    };
+    // Links may point at later labels, so every node exists before any is linked
+    ffvms::storage::NodeColumn column;
+    while (nodes.size() < reader.size()) {
+        if (!reader.next(column) || (column.type >= 3 && column.type != column.FREE)) return fail();
+        columns.push_back(column);
+        if (column.type == column.FREE) {
+            nodes.push_back(nullptr);
+            continue;
         }
+        treeNode* t = new treeNode();
+        t->type = static_cast<treeNode::TYPE>(column.type);
+        t->cnt = static_cast<int>(column.cnt);
+        t->link = column.link;
+        t->save_label = static_cast<std::uint32_t>(nodes.size() + 1);
+        nodes.push_back(t);
+    }
+    auto node_of = [&](std::uint64_t label, treeNode*& p) {
+        p = label == column.NONE ? nullptr : nodes[label];
+        return label == column.NONE || p != nullptr;
+    };
+    for (std::size_t label = 0; label < nodes.size(); label++) {
+        if (nodes[label] == nullptr) continue;
+        const ffvms::storage::NodeColumn& c = columns[label];
+        if (!node_of(c.next_brother, nodes[label]->next_brother) || !node_of(c.first_son, nodes[label]->first_son)) {
+            return fail();
+        }
+    }
+    return true;
+}
 
-        unsigned long long label, type, cnt, link;
-        label = get_storage_ref().str_to_ull(s_label);
-        type = get_storage_ref().str_to_ull(s_type);
-        cnt = get_storage_ref().str_to_ull(s_cnt);
-        link = get_storage_ref().str_to_ull(s_link);
-        
-        if (type >= 3) {
-            get_logger_ref().log("VersionManager: File is corrupted and cannot be read.", ffvms::LogLevel::WARNING, __LINE__);
-            return false;
+bool VersionManager::adopt_nodes(std::vector<treeNode*>& nodes) {
+    // Walk from the version heads; reaching a node that is still on the walk's path means a cycle.
+    // An explicit stack keeps long sibling chains off the call stack
+    enum : std::uint8_t { UNSEEN, OPEN, DONE };
+    std::vector<std::uint8_t> state(nodes.size(), UNSEEN);
+    struct Frame {
+        treeNode* node;
+        int step;
+    };
+    std::vector<Frame> stack;
+    bool acyclic = true;
+    for (auto& ver : version) {
+        stack.push_back({ver.second.p, 0});
+        while (acyclic && !stack.empty()) {
+            Frame& frame = stack.back();
+            treeNode* cur = frame.node;
+            const std::size_t label = cur->save_label - 1;
+            const int step = frame.step++;
+            if (step == 0 && state[label] != UNSEEN) {
+                acyclic = state[label] == DONE;
+                stack.pop_back();
+                continue;
+            }
+            if (step == 0) state[label] = OPEN;
+            if (step == 2) {
+                state[label] = DONE;
+                stack.pop_back();
+                continue;
+            }
+            treeNode* next = step == 0 ? cur->next_brother : cur->first_son;
+            if (next != nullptr) stack.push_back({next, 0});
         }
+    }
+    if (!acyclic) {
+        for (treeNode* t : nodes) delete t;
+        nodes.clear();
+        columns_.clear();
+        return false;
+    }
+    // Nodes no version reaches would otherwise be kept, and saved, forever
+    ffvms::storage::NodeColumn free_column;
+    free_column.type = free_column.FREE;
+    free_labels_.clear();
+    for (std::size_t label = 0; label < nodes.size(); label++) {
+        if (state[label] == DONE) continue;
+        if (nodes[label] != nullptr) {
+            delete nodes[label];
+            columns_.set(label, free_column);
+        }
+        free_labels_.push_back(label);
+    }
+    return true;
+}
+
+bool VersionManager::read_legacy_nodes(ffvms::IRecordReader& in, std::size_t fields,
+                                       std::map<unsigned long long, treeNode*>& label_to_ptr) {
+    std::vector<TreeNodeRow> node_information;
+    node_information.reserve(in.rows());
+    node_information.emplace_back();
+    if (!TREE_NODE_SCHEMA.read(in, fields, node_information.back()) ||
+        !TREE_NODE_SCHEMA.read_table(in, [&](const TreeNodeRow& row) {
+            node_information.push_back(row);
+            return true;
+        })) {
+        return false;
+    }
+
+    auto fail = [&]() {
+        for (auto& it : label_to_ptr) delete it.second;
+        label_to_ptr.clear();
+        return false;
+    };
+    for (auto& node : node_information) {
+        unsigned long long label = node.label, type = node.type, cnt = node.cnt, link = node.link;
+        if (type >= 3 || label_to_ptr.count(label)) return fail();
 
         treeNode* t = new treeNode();
         if (type == 0) t->type = treeNode::FILE;
@@ -92,115 +264,114 @@ bool VersionManager::load() {
     }
 
     for (auto& node : node_information) {
-        s_label = node[0];
-        s_next_brother = node[4];
-        s_first_son = node[5];
-
-        unsigned long long label, next_brother, first_son;
-        label = get_storage_ref().str_to_ull(s_label);
-        next_brother = get_storage_ref().str_to_ull(s_next_brother);
-        first_son = get_storage_ref().str_to_ull(s_first_son);
-        
-        if (next_brother != NULL_NODE && !label_to_ptr.count(next_brother)) {
-            get_logger_ref().log("VersionManager: File is corrupted and cannot be read.", ffvms::LogLevel::WARNING, __LINE__);
-            return false;
-        }
-        if (first_son != NULL_NODE && !label_to_ptr.count(first_son)) {
-            get_logger_ref().log("VersionManager: File is corrupted and cannot be read.", ffvms::LogLevel::WARNING, __LINE__);
-            return false;
-        }
+        unsigned long long label = node.label, next_brother = node.next_brother, first_son = node.first_son;
+        if (next_brother != NULL_NODE && !label_to_ptr.count(next_brother)) return fail();
+        if (first_son != NULL_NODE && !label_to_ptr.count(first_son)) return fail();
 
         treeNode* t = label_to_ptr[label];
         t->next_brother = next_brother == NULL_NODE ? nullptr : label_to_ptr[next_brother];
         t->first_son = first_son == NULL_NODE ? nullptr : label_to_ptr[first_son];
     }
+    return true;
+}
 
-    std::string s_version_id, version_info, s_version_head_label;
-    for (auto& ver : version_information) {
-        if (ver.size() != 3) {
-            get_logger_ref().log("VersionManager: File is corrupted and cannot be read.", ffvms::LogLevel::WARNING, __LINE__);
-            return false;
-        }
-        s_version_id = ver[0];
-        version_info = ver[1];
-        s_version_head_label = ver[2];
-        if (!get_storage_ref().is_all_digits(s_version_id) || !get_storage_ref().is_all_digits(s_version_head_label)) {
-            get_logger_ref().log("VersionManager: File is corrupted and cannot be read.", ffvms::LogLevel::WARNING, __LINE__);
-            return false;
-        }
-        unsigned long long version_id, version_head_label;
-        version_id = get_storage_ref().str_to_ull(s_version_id);
-        version_head_label = get_storage_ref().str_to_ull(s_version_head_label);
-
-        if (!label_to_ptr.count(version_head_label)) {
-            version.clear();
-            get_logger_ref().log("VersionManager: File is corrupted and cannot be read.", ffvms::LogLevel::WARNING, __LINE__);
+bool VersionManager::save() {
+    std::vector<ffvms::TableWrite> writes;
+    capture(writes);
+    for (auto& write : writes) {
+        if (!write.write_to(get_storage_ref())) {
+            capture_failed();
             return false;
         }
+    }
+    return true;
+}
 
-        auto t = versionNode();
-        t.info = version_info;
-        t.p = label_to_ptr[version_head_label];
-        
-        version[version_id] = t;
+std::uint64_t VersionManager::take_label() {
+    if (!free_labels_.empty()) {
+        std::uint64_t label = free_labels_.back();
+        free_labels_.pop_back();
+        return label;
     }
+    columns_.push_back(ffvms::storage::NodeColumn());
+    return columns_.size() - 1;
+}
 
-    return true;
+void VersionManager::mark_node_changed(treeNode* p) {
+    if (p != nullptr && p->save_label != 0) changed_.insert(p);
+    mark_tree_dirty();
 }
 
-void VersionManager::dfs(treeNode* cur, std::map<treeNode*, unsigned long long>& label) {
-    if (cur == nullptr || label.count(cur)) return;
-    dfs(cur->next_brother, label);
-    dfs(cur->first_son, label);
-    label[cur] = label.size();
+void VersionManager::mark_node_deleted(treeNode* p) {
+    mark_tree_dirty();
+    if (p == nullptr || p->save_label == 0) return;
+    ffvms::storage::NodeColumn free_column;
+    free_column.type = free_column.FREE;
+    columns_.set(p->save_label - 1, free_column);
+    free_labels_.push_back(p->save_label - 1);
+    changed_.erase(p);
+    p->save_label = 0;
 }
 
-bool VersionManager::save() {
-    std::map<treeNode*, unsigned long long> label;
-    for (auto& ver : version) {
-        dfs(ver.second.p, label);
-    }
-    ffvms::DataTable node_information;
-    for (auto& node : label) {
-        node_information.push_back(std::vector<std::string>());
-        std::vector<std::string>& noif = node_information.back();
-        noif.push_back(std::to_string(node.second));
-        treeNode* tn = node.first;
-        if (tn->type == treeNode::FILE) {
-            noif.push_back("0");
-        } else if (tn->type == treeNode::DIR) {
-            noif.push_back("1");
-        } else if (tn->type == treeNode::HEAD_NODE) {
-            noif.push_back("2");
-        }
-        noif.push_back(std::to_string(tn->cnt));
-        noif.push_back(std::to_string(tn->link));
-        if (tn->next_brother == nullptr) {
-            noif.push_back(std::to_string(NULL_NODE));
-        } else {
-            noif.push_back(std::to_string(label[tn->next_brother]));
-        }
-        if (tn->first_son == nullptr) {
-            noif.push_back(std::to_string(NULL_NODE));
-        } else {
-            noif.push_back(std::to_string(label[tn->first_son]));
-        }
+void VersionManager::capture(std::vector<ffvms::TableWrite>& writes) {
+    changed_bytes_ = 0;
+    // Node labels come from walking the trees, so the two tables are always written together
+    if (!dirty_) return;
+
+    // Label the nodes that have none: new version heads, and new nodes hanging off those or off
+    // nodes changed in place. Everything else kept its label and column from the last capture,
+    // so the lock is held for what changed rather than for every node of every version
+    std::vector<treeNode*> fresh;
+    auto label = [&](treeNode* p) {
+        if (p == nullptr || p->save_label != 0) return;
+        p->save_label = static_cast<std::uint32_t>(take_label() + 1);
+        fresh.push_back(p);
+    };
+    for (auto& ver : version) label(ver.second.p);
+    for (treeNode* p : changed_) {
+        label(p->next_brother);
+        label(p->first_son);
     }
-    if (!get_storage_ref().save(DATA_TREENODE_INFO, node_information)) {
-        return false;
+    for (std::size_t i = 0; i < fresh.size(); i++) {
+        label(fresh[i]->next_brother);
+        label(fresh[i]->first_son);
     }
-    ffvms::DataTable version_information;
+    auto update = [&](const treeNode* p) {
+        ffvms::storage::NodeColumn column;
+        column.type = static_cast<std::uint8_t>(p->type);
+        column.cnt = static_cast<std::uint32_t>(p->cnt);
+        column.link = p->link;
+        if (p->next_brother) column.next_brother = p->next_brother->save_label - 1;
+        if (p->first_son) column.first_son = p->first_son->save_label - 1;
+        columns_.set(p->save_label - 1, column);
+    };
+    for (treeNode* p : fresh) update(p);
+    for (treeNode* p : changed_) update(p);
+    changed_.clear();
+
+    // Copying the table shares its blocks; encoding it happens on the writing thread
+    writes.push_back({DATA_TREENODE_INFO, [columns = columns_](ffvms::IRecordWriter& out) {
+        std::string bytes;
+        columns.encode(bytes);
+        out.begin_table(1);
+        out.begin_row(1);
+        out.bytes(bytes.data(), bytes.size());
+    }});
+    std::vector<std::pair<std::string, VersionRow>> versions;
+    versions.reserve(version.size());
     for (auto& it : version) {
-        version_information.push_back(std::vector<std::string>());
-        std::vector<std::string>& veif = version_information.back();
-        veif.push_back(std::to_string(it.first));
-        veif.push_back(it.second.info);
-        veif.push_back(std::to_string(label[it.second.p]));
+        treeNode* head = it.second.p;
+        versions.push_back({it.second.info, {it.first, {}, head ? head->save_label - 1ULL : 0}});
     }
-    if (!get_storage_ref().save(DATA_VERSION_INFO, version_information)) {
-        return false;
-    }
-    return true;
+    writes.push_back({DATA_VERSION_INFO, [versions = std::move(versions)](ffvms::IRecordWriter& out) {
+        out.begin_table(versions.size());
+        for (auto& it : versions) {
+            VersionRow row = it.second;
+            row.info = it.first;
+            VERSION_SCHEMA.write(out, row);
+        }
+    }});
+    dirty_ = false;
 }
 
 bool VersionManager::recursive_increase_counter(treeNode* p, bool modify_brother) {
@@ -211,6 +382,7 @@ bool VersionManager::recursive_increase_counter(treeNode* p, bool modify_brother
     recursive_increase_counter(p->first_son, true);
     if (modify_brother) recursive_increase_counter(p->next_brother, true);
     p->cnt++;
+    mark_node_changed(p);
     get_node_manager_ref().increase_counter(p->link);
     get_logger_ref().log("The counter for node " + get_node_manager_ref().get_name(p->link) + " has been incremented by one.", ffvms::LogLevel::INFO, __LINE__);
     return true;
@@ -222,6 +394,7 @@ bool VersionManager::init_version(treeNode* p, treeNode* vp) {
         return false;
     }
     p->first_son = vp->first_son;
+    mark_tree_dirty();
     if (!recursive_increase_counter(p, true)) return false;
     return true;
 }
@@ -9,9 +9,33 @@
 @ Description: File & Folder Version Management System
 */
 
+#include "logger.h"
+#include "saver.h"
+#include "storage/in_memory_storage.h"
 #include "terminal.h"
+#include <cstring>
+#include <iostream>
 
-int main() {
+int main(int argc, char** argv) {
+    // --memory keeps the repository in memory for this session; --dump FILE also writes it to FILE at exit
+    ffvms::storage::InMemoryStorageOptions memory_options;
+    bool memory = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--memory") == 0) {
+            memory = true;
+        } else if (std::strcmp(argv[i], "--dump") == 0 && i + 1 < argc) {
+            memory = true;
+            memory_options.dump_path = argv[++i];
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--memory] [--dump FILE]" << std::endl;
+            return 2;
+        }
+    }
+    if (memory) {
+        // Constructed after the logger and before the managers, so it is destroyed after their final saves
+        static ffvms::storage::InMemoryStorage storage(&Logger::get_logger(), memory_options);
+        Saver::set_default_storage(&storage);
+    }
     Terminal terminal;
     return terminal.run();
 }
\ No newline at end of file
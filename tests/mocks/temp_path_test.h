@@ -0,0 +1,41 @@
+#ifndef TEMP_PATH_TEST_H
+#define TEMP_PATH_TEST_H
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+namespace ffvms {
+namespace test {
+
+/**
+ * @brief Fixture giving each test its own file or directory path under the temp directory
+ *
+ * temp_path is named after the test and removed, with anything under it,
+ * before and after the test. Fixtures overriding SetUp() call this one's.
+ */
+template <typename Base = ::testing::Test>
+class TempPathTest : public Base {
+protected:
+    std::filesystem::path temp_path;
+
+    void SetUp() override {
+        const ::testing::TestInfo* info = ::testing::UnitTest::GetInstance()->current_test_info();
+        // Parameterized tests have '/' in their names
+        std::string name = std::string("ffvms_") + info->test_suite_name() + "_" + info->name();
+        for (char& c : name) if (c == '/') c = '_';
+        temp_path = std::filesystem::temp_directory_path() / name;
+        std::error_code ec;
+        std::filesystem::remove_all(temp_path, ec);
+    }
+
+    void TearDown() override {
+        std::error_code ec;
+        if (!temp_path.empty()) std::filesystem::remove_all(temp_path, ec);
+    }
+};
+
+} // namespace test
+} // namespace ffvms
+#endif // TEMP_PATH_TEST_H
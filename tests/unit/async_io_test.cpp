@@ -0,0 +1,82 @@
+/**
+ * @file async_io_test.cpp
+ * @brief Unit tests for the batched file I/O backends
+ */
+
+#include <gtest/gtest.h>
+#include "storage/async_io.h"
+#include "temp_path_test.h"
+#include <filesystem>
+#include <mutex>
+#include <string>
+
+using namespace ffvms;
+using namespace ffvms::storage;
+using namespace ffvms::test;
+namespace fs = std::filesystem;
+
+class AsyncIoTest : public TempPathTest<::testing::TestWithParam<IoBackend>> {
+protected:
+    ThreadPool pool{3};
+
+    void SetUp() override {
+        if (GetParam() == IoBackend::IO_URING && !io_uring_available()) {
+            GTEST_SKIP() << "io_uring is not available here";
+        }
+        TempPathTest::SetUp();
+        fs::create_directories(temp_path);
+    }
+};
+
+TEST_P(AsyncIoTest, WritesAndReadsBatches) {
+    auto io = make_async_io(GetParam(), pool, 4);
+    EXPECT_STREQ(GetParam() == IoBackend::IO_URING ? "io_uring" : "threads", io->name());
+
+    std::vector<std::string> contents = {"", "small", std::string(5 * 1024 * 1024 + 3, 'x')};
+    for (int i = 0; i < 20; i++) contents.push_back(std::string(1000 + i * 4096, static_cast<char>('a' + i)));
+    std::vector<FileWrite> writes;
+    std::vector<std::string> paths;
+    for (std::size_t i = 0; i < contents.size(); i++) {
+        paths.push_back((temp_path / std::to_string(i)).string());
+        writes.push_back({paths.back(), contents[i]});
+    }
+    ASSERT_TRUE(io->write_files(writes, true));
+
+    std::mutex mutex;
+    std::vector<std::string> read(contents.size());
+    std::vector<int> calls(contents.size(), 0);
+    ASSERT_TRUE(io->read_files(paths, [&](std::size_t i, std::string&& bytes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        calls[i]++;
+        read[i] = std::move(bytes);
+        return true;
+    }));
+    EXPECT_EQ(contents, read);
+    EXPECT_EQ(std::vector<int>(contents.size(), 1), calls);
+}
+
+TEST_P(AsyncIoTest, FailuresFailTheBatch) {
+    auto io = make_async_io(GetParam(), pool, 4);
+    std::vector<FileWrite> writes;
+    std::vector<std::string> paths;
+    for (int i = 0; i < 10; i++) {
+        paths.push_back((temp_path / std::to_string(i)).string());
+        writes.push_back({paths.back(), "data"});
+    }
+    ASSERT_TRUE(io->write_files(writes, false));
+
+    EXPECT_FALSE(io->read_files(paths, [](std::size_t i, std::string&&) { return i != 7; }));
+
+    paths.push_back((temp_path / "missing").string());
+    EXPECT_FALSE(io->read_files(paths, [](std::size_t, std::string&&) { return true; }));
+    EXPECT_FALSE(io->write_files({{(temp_path / "no" / "such" / "dir").string(), "x"}}, false));
+
+    // The backend is still usable afterwards
+    paths.pop_back();
+    EXPECT_TRUE(io->read_files(paths, [](std::size_t, std::string&& bytes) { return bytes == "data"; }));
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, AsyncIoTest, ::testing::Values(IoBackend::THREADS, IoBackend::IO_URING),
+                         [](const ::testing::TestParamInfo<IoBackend>& info) {
+                             return std::string(info.param == IoBackend::THREADS ? "Threads" : "IoUring");
+                         });
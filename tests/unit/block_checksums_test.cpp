@@ -0,0 +1,103 @@
+/**
+ * @file block_checksums_test.cpp
+ * @brief Unit tests for CRC-32C, xxHash64 and per-block record checksums
+ */
+
+#include <gtest/gtest.h>
+#include "storage/block_checksums.h"
+#include "storage/crc32c.h"
+#include "storage/xxhash64.h"
+#include <random>
+#include <string>
+
+using namespace ffvms;
+using namespace ffvms::storage;
+
+namespace {
+
+std::string random_bytes(std::size_t n, unsigned int seed) {
+    std::mt19937 gen(seed);
+    std::string out(n, '\0');
+    for (auto& c : out) c = static_cast<char>(gen() & 0xff);
+    return out;
+}
+
+std::string encode(const BlockChecksums& sums) {
+    std::string out;
+    sums.encode(out);
+    return out;
+}
+
+}  // namespace
+
+TEST(Crc32cTest, MatchesKnownValues) {
+    EXPECT_EQ(0u, crc32c("", 0));
+    EXPECT_EQ(0xe3069283u, crc32c("123456789", 9));
+    EXPECT_EQ(0xe3069283u, crc32c_portable("123456789", 9));
+    const std::string zeros(32, '\0');
+    EXPECT_EQ(0x8a9136aau, crc32c(zeros.data(), zeros.size()));
+}
+
+TEST(Crc32cTest, HardwareAndTableAgree) {
+    const std::string data = random_bytes(4096, 1);
+    for (std::size_t offset = 0; offset < 8; offset++) {
+        for (std::size_t size : {0u, 1u, 7u, 8u, 9u, 63u, 1000u, 4000u}) {
+            EXPECT_EQ(crc32c_portable(data.data() + offset, size), crc32c(data.data() + offset, size))
+                << "offset " << offset << " size " << size;
+        }
+    }
+}
+
+TEST(Crc32cTest, ContinuesAcrossCalls) {
+    const std::string data = random_bytes(1000, 2);
+    const std::uint32_t head = crc32c(data.data(), 333);
+    EXPECT_EQ(crc32c(data.data(), data.size()), crc32c(data.data() + 333, data.size() - 333, head));
+}
+
+TEST(XxHash64Test, MatchesKnownValues) {
+    EXPECT_EQ(0xef46db3751d8e999ULL, xxhash64(""));
+    EXPECT_EQ(0xd24ec4f1a98c6e5bULL, xxhash64("a"));
+    EXPECT_EQ(0x44bc2cf5ad770999ULL, xxhash64("abc"));
+    EXPECT_EQ(0xfbcea83c8a378bf1ULL, xxhash64("Nobody inspects the spammish repetition"));
+}
+
+TEST(BlockChecksumsTest, EncodeRoundTrip) {
+    const std::string data = random_bytes(10000, 3);
+    const BlockChecksums sums = BlockChecksums::compute(data, nullptr, 1024);
+    EXPECT_EQ(10u, sums.blocks());
+
+    std::string encoded = "prefix";
+    sums.encode(encoded);
+    ByteReader in(encoded.data() + 6, encoded.size() - 6);
+    BlockChecksums decoded;
+    ASSERT_TRUE(decoded.decode(in));
+    EXPECT_EQ(0u, in.remaining());
+    EXPECT_EQ(10000u, decoded.size());
+    EXPECT_EQ(1024u, decoded.block_size());
+    EXPECT_EQ(encode(sums), encode(decoded));
+    EXPECT_EQ(BlockChecksums::NONE, decoded.first_mismatch(data));
+
+    ByteReader truncated(encoded.data() + 6, encoded.size() - 7);
+    EXPECT_FALSE(decoded.decode(truncated));
+}
+
+TEST(BlockChecksumsTest, FindsTheCorruptBlock) {
+    std::string data = random_bytes(200000, 4);
+    ThreadPool pool(4);
+    const BlockChecksums sums = BlockChecksums::compute(data, &pool, 4096);
+    EXPECT_EQ(encode(sums), encode(BlockChecksums::compute(data, nullptr, 4096)));
+
+    data[30 * 4096 + 17] ^= 1;
+    data[41 * 4096] ^= 1;
+    EXPECT_EQ(30u, sums.first_mismatch(data, &pool));
+    EXPECT_EQ(30u, sums.first_mismatch(data, nullptr));
+    EXPECT_NE(encode(sums), encode(BlockChecksums::compute(data, &pool, 4096)));
+    EXPECT_EQ(0u, sums.first_mismatch(std::string_view(data).substr(1), &pool));
+}
+
+TEST(BlockChecksumsTest, EmptyDataHasNoBlocks) {
+    const BlockChecksums sums = BlockChecksums::compute("");
+    EXPECT_EQ(0u, sums.blocks());
+    EXPECT_EQ(BlockChecksums::NONE, sums.first_mismatch(""));
+    EXPECT_NE(encode(sums), encode(BlockChecksums::compute("x")));
+}
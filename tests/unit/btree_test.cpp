@@ -0,0 +1,133 @@
+/**
+ * @file btree_test.cpp
+ * @brief Unit tests for the buffer pool, the paged B+tree and BTreeStorage
+ */
+
+#include <gtest/gtest.h>
+#include "gmock/gmock.h"
+#include "mock_logger.h"
+#include "storage/btree.h"
+#include "storage/btree_storage.h"
+#include "temp_path_test.h"
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+
+using namespace ffvms;
+using namespace ffvms::storage;
+using namespace ffvms::test;
+using ::testing::NiceMock;
+
+namespace {
+
+std::string value_for(std::uint64_t i, std::size_t size) {
+    std::string v(size, '\0');
+    for (std::size_t j = 0; j < size; j++) v[j] = static_cast<char>('a' + (i * 31 + j) % 26);
+    return v;
+}
+
+}  // namespace
+
+class BTreeTest : public TempPathTest<> {
+protected:
+    NiceMock<MockLogger> logger;
+};
+
+TEST_F(BTreeTest, ManyKeysThroughSmallPool) {
+    std::map<std::uint64_t, std::string> expected;
+    std::mt19937_64 gen(5);
+    {
+        BTree tree(16);
+        ASSERT_TRUE(tree.open(temp_path));
+        for (int i = 0; i < 5000; i++) {
+            std::uint64_t k = gen() % 100000;
+            expected[k] = value_for(k, 20 + k % 200);
+            ASSERT_TRUE(tree.put({1, k}, expected[k]));
+        }
+        EXPECT_GT(tree.pool_stats().evictions, 0u);
+        EXPECT_GT(tree.page_count(), 16u);
+    }
+    BTree tree(16);
+    ASSERT_TRUE(tree.open(temp_path));
+    std::string value;
+    for (auto& it : expected) {
+        ASSERT_TRUE(tree.get({1, it.first}, value));
+        EXPECT_EQ(it.second, value);
+    }
+    EXPECT_FALSE(tree.get({2, expected.begin()->first}, value));
+
+    auto next = expected.begin();
+    ASSERT_TRUE(tree.scan({1, 0}, {1, ~0ULL}, [&](const BTreeKey& key, std::string&& v) {
+        EXPECT_EQ(next->first, key.lo);
+        EXPECT_EQ(next->second, v);
+        ++next;
+        return true;
+    }));
+    EXPECT_EQ(expected.end(), next);
+}
+
+TEST_F(BTreeTest, OverflowValuesAndPageReuse) {
+    BTree tree(16);
+    ASSERT_TRUE(tree.open(temp_path));
+    std::string big = value_for(7, 50000);
+    ASSERT_TRUE(tree.put({1, 1}, big));
+    const auto pages = tree.page_count();
+    std::string value;
+    ASSERT_TRUE(tree.get({1, 1}, value));
+    EXPECT_EQ(big, value);
+
+    // Replacing and erasing frees the chain, and its pages are reused
+    ASSERT_TRUE(tree.put({1, 1}, "small"));
+    ASSERT_TRUE(tree.erase({1, 1}));
+    EXPECT_FALSE(tree.get({1, 1}, value));
+    ASSERT_TRUE(tree.put({1, 2}, big));
+    EXPECT_EQ(pages, tree.page_count());
+}
+
+TEST_F(BTreeTest, RejectsForeignFile) {
+    {
+        std::FILE* f = std::fopen(temp_path.c_str(), "wb");
+        std::fputs("not a tree", f);
+        std::fclose(f);
+    }
+    BTree tree;
+    EXPECT_FALSE(tree.open(temp_path));
+}
+
+TEST_F(BTreeTest, StorageRoundTripsTables) {
+    DataTable table;
+    for (int i = 0; i < 3000; i++) table.push_back({std::to_string(i), value_for(i, i % 3 == 0 ? 3000 : 40), ""});
+    {
+        BTreeStorage storage(&logger, temp_path, BTreeStorageOptions{32, false});
+        ASSERT_TRUE(storage.is_open());
+        ASSERT_TRUE(storage.save("big", table));
+        ASSERT_TRUE(storage.save("empty", DataTable{}));
+    }
+    BTreeStorage storage(&logger, temp_path, BTreeStorageOptions{32, false});
+    DataTable loaded;
+    ASSERT_TRUE(storage.load("big", loaded));
+    EXPECT_EQ(table, loaded);
+    ASSERT_TRUE(storage.load("empty", loaded));
+    EXPECT_TRUE(loaded.empty());
+    EXPECT_FALSE(storage.load("missing", loaded));
+}
+
+TEST_F(BTreeTest, StorageShrinksAndRewritesOnlyChangedRows) {
+    BTreeStorage storage(&logger, temp_path, BTreeStorageOptions{64, false});
+    DataTable table;
+    for (int i = 0; i < 2000; i++) table.push_back({std::to_string(i), value_for(i, 100)});
+    ASSERT_TRUE(storage.save("t", table));
+
+    const auto before = storage.pool_stats().writes;
+    table[10][1] = "changed";
+    ASSERT_TRUE(storage.save("t", table));
+    // One leaf plus the header and meta leaf, not the whole table
+    EXPECT_LE(storage.pool_stats().writes - before, 4u);
+
+    table.resize(5);
+    ASSERT_TRUE(storage.save("t", table));
+    DataTable loaded;
+    ASSERT_TRUE(storage.load("t", loaded));
+    EXPECT_EQ(table, loaded);
+}
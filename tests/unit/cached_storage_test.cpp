@@ -0,0 +1,124 @@
+/**
+ * @file cached_storage_test.cpp
+ * @brief Unit tests for the decoded-table LRU cache
+ */
+
+#include <gtest/gtest.h>
+#include "gmock/gmock.h"
+#include "mock_storage.h"
+#include "storage/cached_storage.h"
+#include <string>
+
+using namespace ffvms;
+using namespace ffvms::storage;
+using namespace ffvms::test;
+using ::testing::_;
+using ::testing::DoAll;
+using ::testing::Return;
+using ::testing::SetArgReferee;
+using ::testing::StrictMock;
+
+namespace {
+
+DataTable table_of(const std::string& value) {
+    return {{"1", value}, {"2", value + value}};
+}
+
+}  // namespace
+
+TEST(CachedStorageTest, SecondLoadIsAHit) {
+    StrictMock<MockStorage> backend;
+    CachedStorage cache(&backend);
+    const DataTable table = table_of(std::string(100, 'a'));
+    EXPECT_CALL(backend, load("t", _, false)).WillOnce(DoAll(SetArgReferee<1>(table), Return(true)));
+
+    DataTable loaded;
+    ASSERT_TRUE(cache.load("t", loaded));
+    EXPECT_EQ(table, loaded);
+    loaded.clear();
+    ASSERT_TRUE(cache.load("t", loaded));
+    EXPECT_EQ(table, loaded);
+
+    std::size_t rows = 0, fields = 0;
+    ASSERT_TRUE(cache.load_records("t", [&](IRecordReader& reader) {
+        std::size_t n;
+        while (reader.next_row(n)) {
+            rows++;
+            fields += n;
+        }
+        return reader.ok();
+    }));
+    EXPECT_EQ(2u, rows);
+    EXPECT_EQ(4u, fields);
+
+    EXPECT_EQ(2u, cache.stats().hits);
+    EXPECT_EQ(1u, cache.stats().misses);
+    EXPECT_EQ(CachedStorage::table_bytes(table), cache.cached_bytes());
+}
+
+TEST(CachedStorageTest, FailedLoadIsNotCached) {
+    StrictMock<MockStorage> backend;
+    CachedStorage cache(&backend);
+    EXPECT_CALL(backend, load("missing", _, false)).Times(2).WillRepeatedly(Return(false));
+    DataTable loaded;
+    EXPECT_FALSE(cache.load("missing", loaded));
+    EXPECT_FALSE(cache.load("missing", loaded));
+    EXPECT_EQ(0u, cache.cached_bytes());
+}
+
+TEST(CachedStorageTest, SaveInvalidates) {
+    StrictMock<MockStorage> backend;
+    CachedStorage cache(&backend);
+    const DataTable before = table_of("old"), after = table_of("new");
+    EXPECT_CALL(backend, load("t", _, false))
+        .WillOnce(DoAll(SetArgReferee<1>(before), Return(true)))
+        .WillOnce(DoAll(SetArgReferee<1>(after), Return(true)));
+    EXPECT_CALL(backend, save("t", after)).WillOnce(Return(true));
+
+    DataTable loaded;
+    ASSERT_TRUE(cache.load("t", loaded));
+    ASSERT_TRUE(cache.save("t", after));
+    EXPECT_EQ(0u, cache.cached_bytes());
+    ASSERT_TRUE(cache.load("t", loaded));
+    EXPECT_EQ(after, loaded);
+    EXPECT_EQ(1u, cache.stats().invalidations);
+    EXPECT_EQ(2u, cache.stats().misses);
+}
+
+TEST(CachedStorageTest, LeastRecentlyUsedIsEvicted) {
+    StrictMock<MockStorage> backend;
+    const DataTable table = table_of(std::string(1000, 'x'));
+    const std::size_t bytes = CachedStorage::table_bytes(table);
+    CachedStorageOptions options;
+    options.capacity_bytes = bytes * 2;
+    CachedStorage cache(&backend, options);
+    EXPECT_CALL(backend, load("a", _, false)).WillOnce(DoAll(SetArgReferee<1>(table), Return(true)));
+    EXPECT_CALL(backend, load("b", _, false)).WillOnce(DoAll(SetArgReferee<1>(table), Return(true)));
+    EXPECT_CALL(backend, load("c", _, false)).Times(2).WillRepeatedly(DoAll(SetArgReferee<1>(table), Return(true)));
+
+    DataTable loaded;
+    ASSERT_TRUE(cache.load("a", loaded));
+    ASSERT_TRUE(cache.load("c", loaded));
+    ASSERT_TRUE(cache.load("a", loaded));   // c is now the least recently used
+    ASSERT_TRUE(cache.load("b", loaded));
+    EXPECT_EQ(1u, cache.stats().evictions);
+    ASSERT_TRUE(cache.load("a", loaded));
+    ASSERT_TRUE(cache.load("b", loaded));
+    ASSERT_TRUE(cache.load("c", loaded));
+    EXPECT_LE(cache.cached_bytes(), options.capacity_bytes);
+
+    cache.set_capacity(0);
+    EXPECT_EQ(0u, cache.cached_bytes());
+}
+
+TEST(CachedStorageTest, MandatoryLoadsDoNotFillTheCache) {
+    StrictMock<MockStorage> backend;
+    CachedStorage cache(&backend);
+    const DataTable table = table_of("damaged");
+    EXPECT_CALL(backend, load("t", _, true)).Times(2).WillRepeatedly(DoAll(SetArgReferee<1>(table), Return(true)));
+    DataTable loaded;
+    ASSERT_TRUE(cache.load("t", loaded, true));
+    ASSERT_TRUE(cache.load("t", loaded, true));
+    EXPECT_EQ(table, loaded);
+    EXPECT_EQ(0u, cache.cached_bytes());
+}
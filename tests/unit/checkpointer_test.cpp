@@ -0,0 +1,212 @@
+/**
+ * @file checkpointer_test.cpp
+ * @brief Unit tests for background checkpoints
+ */
+
+#include <gtest/gtest.h>
+#include "gmock/gmock.h"
+#include "mock_logger.h"
+#include "checkpointer.h"
+#include "file_manager.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using namespace ffvms;
+using namespace ffvms::test;
+using ::testing::NiceMock;
+
+namespace {
+
+// Stores tables in memory; save() can be held until release() to model a slow disk
+class GatedStorage : public IStorage {
+public:
+    std::map<std::string, DataTable> tables;
+    bool fail = false;
+    bool gated = false;
+    std::atomic<int> waiting{0};
+
+    bool save(const std::string& name, const DataTable& content) override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        waiting++;
+        cv_.wait(lock, [this]() { return !gated; });
+        waiting--;
+        if (fail) return false;
+        tables[name] = content;
+        return true;
+    }
+
+    bool load(const std::string& name, DataTable& content, bool) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = tables.find(name);
+        if (it == tables.end()) return false;
+        content = it->second;
+        return true;
+    }
+
+    void release() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            gated = false;
+        }
+        cv_.notify_all();
+    }
+
+    std::size_t size() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return tables.size();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+// One table whose rows are appended by the test
+class CountingSource : public ICheckpointable {
+public:
+    std::vector<std::string> rows;
+    unsigned long long changed = 0;
+    int failures = 0;
+
+    void add(const std::string& row) {
+        rows.push_back(row);
+        changed += row.size();
+    }
+
+    unsigned long long changed_bytes() const override { return changed; }
+
+    void capture(std::vector<TableWrite>& writes) override {
+        if (!changed) return;
+        writes.push_back({"rows", [rows = rows](IRecordWriter& out) {
+            out.begin_table(rows.size());
+            for (auto& row : rows) {
+                out.begin_row(1);
+                out.str(row);
+            }
+        }});
+        changed = 0;
+    }
+
+    void capture_failed() override {
+        failures++;
+        changed = 1;
+    }
+};
+
+template <class F>
+bool wait_until(F&& done) {
+    for (int i = 0; i < 500; i++) {
+        if (done()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+}  // namespace
+
+class CheckpointerTest : public ::testing::Test {
+protected:
+    NiceMock<MockLogger> logger;
+    GatedStorage storage;
+    CountingSource source;
+};
+
+TEST_F(CheckpointerTest, CheckpointNowWritesCapturedTables) {
+    Checkpointer checkpointer(&storage, &logger);
+    checkpointer.add_source(&source);
+    source.add("first");
+    ASSERT_TRUE(checkpointer.checkpoint_now());
+    EXPECT_EQ((DataTable{{"first"}}), storage.tables["rows"]);
+    EXPECT_EQ(0u, source.changed_bytes());
+    EXPECT_EQ(1u, checkpointer.stats().checkpoints);
+    EXPECT_EQ(5u, checkpointer.stats().last_bytes);
+}
+
+TEST_F(CheckpointerTest, ThresholdStartsCheckpointBeforeInterval) {
+    CheckpointOptions options;
+    options.interval = std::chrono::hours(1);
+    options.bytes_threshold = 10;
+    Checkpointer checkpointer(&storage, &logger, options);
+    checkpointer.add_source(&source);
+    checkpointer.start();
+
+    {
+        auto state = checkpointer.lock_state();
+        source.add("short");
+    }
+    checkpointer.poke();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(0u, storage.size());
+
+    {
+        auto state = checkpointer.lock_state();
+        source.add("long enough");
+    }
+    checkpointer.poke();
+    EXPECT_TRUE(wait_until([&]() { return storage.size() == 1; }));
+}
+
+TEST_F(CheckpointerTest, IntervalFlushesSmallChanges) {
+    CheckpointOptions options;
+    options.interval = std::chrono::milliseconds(20);
+    Checkpointer checkpointer(&storage, &logger, options);
+    checkpointer.add_source(&source);
+    {
+        auto state = checkpointer.lock_state();
+        source.add("x");
+    }
+    checkpointer.start();
+    EXPECT_TRUE(wait_until([&]() { return storage.size() == 1; }));
+}
+
+TEST_F(CheckpointerTest, WritingDoesNotHoldStateLock) {
+    Checkpointer checkpointer(&storage, &logger);
+    checkpointer.add_source(&source);
+    source.add("row");
+    storage.gated = true;
+    std::thread writer([&]() { checkpointer.checkpoint_now(); });
+    ASSERT_TRUE(wait_until([&]() { return storage.waiting == 1; }));
+
+    // The save is stuck, yet the state can still be changed
+    {
+        auto state = checkpointer.lock_state();
+        source.add("while saving");
+    }
+    storage.release();
+    writer.join();
+    EXPECT_EQ((DataTable{{"row"}}), storage.tables["rows"]);
+    EXPECT_GT(source.changed_bytes(), 0u);
+}
+
+TEST_F(CheckpointerTest, FailedWriteMarksSourcesDirty) {
+    Checkpointer checkpointer(&storage, &logger);
+    checkpointer.add_source(&source);
+    source.add("row");
+    storage.fail = true;
+    EXPECT_FALSE(checkpointer.checkpoint_now());
+    EXPECT_EQ(1, source.failures);
+    EXPECT_GT(source.changed_bytes(), 0u);
+    EXPECT_EQ(1u, checkpointer.stats().failures);
+}
+
+TEST_F(CheckpointerTest, CapturedFileManagerSkipsSaveOnShutdown) {
+    {
+        FileManager fm(&storage, &logger);
+        Checkpointer checkpointer(&storage, &logger);
+        checkpointer.add_source(&fm);
+        unsigned long long id = fm.create_file("checkpointed content");
+        ASSERT_TRUE(checkpointer.checkpoint_now());
+        EXPECT_FALSE(fm.dirty());
+        storage.fail = true;  // the destructor must not need to save again
+        std::string out;
+        ASSERT_TRUE(fm.get_content(id, out));
+    }
+    storage.fail = false;
+    FileManager fm(&storage, &logger);
+    EXPECT_EQ(std::string("checkpointed content").size(), fm.chunk_stats().stored_bytes);
+}
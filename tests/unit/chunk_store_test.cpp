@@ -0,0 +1,115 @@
+/**
+ * @file chunk_store_test.cpp
+ * @brief Unit tests for SHA-256, content-defined chunking and the chunk store
+ */
+
+#include <gtest/gtest.h>
+#include "storage/chunk_store.h"
+#include <random>
+#include <string>
+
+using namespace ffvms::storage;
+
+namespace {
+
+std::string random_bytes(std::size_t n, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::string out(n, '\0');
+    for (auto& c : out) c = static_cast<char>(gen() & 0xff);
+    return out;
+}
+
+}  // namespace
+
+TEST(Sha256Test, KnownVectors) {
+    EXPECT_EQ("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+              to_hex(Sha256::hash("", 0)));
+    EXPECT_EQ("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+              to_hex(Sha256::hash("abc", 3)));
+    std::string million(1000000, 'a');
+    EXPECT_EQ("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0",
+              to_hex(Sha256::hash(million.data(), million.size())));
+}
+
+TEST(Sha256Test, IncrementalMatchesOneShot) {
+    std::string data = random_bytes(1000, 1);
+    Sha256 sha;
+    for (std::size_t pos = 0; pos < data.size(); pos += 37) {
+        sha.update(data.data() + pos, std::min<std::size_t>(37, data.size() - pos));
+    }
+    EXPECT_EQ(Sha256::hash(data.data(), data.size()), sha.finish());
+}
+
+TEST(Sha256Test, HexRoundTrip) {
+    Sha256::Digest digest = Sha256::hash("abc", 3), parsed;
+    ASSERT_TRUE(from_hex(to_hex(digest), parsed));
+    EXPECT_EQ(digest, parsed);
+    EXPECT_FALSE(from_hex("xyz", parsed));
+}
+
+TEST(ChunkerTest, ChunksRespectBoundsAndCoverInput) {
+    ChunkerParams params;
+    std::string data = random_bytes(1 << 20, 2);
+    auto chunks = split_chunks(data, params);
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < chunks.size(); i++) {
+        EXPECT_LE(chunks[i].size(), params.max_size);
+        if (i + 1 < chunks.size()) EXPECT_GE(chunks[i].size(), params.min_size);
+        EXPECT_EQ(data.data() + total, chunks[i].data());
+        total += chunks[i].size();
+    }
+    EXPECT_EQ(data.size(), total);
+    EXPECT_TRUE(split_chunks("", params).empty());
+}
+
+TEST(ChunkerTest, InsertionOnlyChangesNearbyChunks) {
+    std::string data = random_bytes(1 << 20, 3);
+    std::string edited = data;
+    edited.insert(data.size() / 2, "inserted line\n");
+
+    ChunkStore store;
+    auto before = store.put(data);
+    auto after = store.put(edited);
+    std::size_t shared = 0;
+    for (auto& id : after) {
+        for (auto& old : before) {
+            if (id == old) {
+                shared++;
+                break;
+            }
+        }
+    }
+    EXPECT_GE(shared + 3, after.size());
+    EXPECT_LT(store.stats().stored_bytes, data.size() + 3 * ChunkerParams().max_size);
+}
+
+TEST(ChunkStoreTest, ReferenceCounting) {
+    ChunkStore store;
+    std::string data = random_bytes(100000, 4);
+    auto first = store.put(data);
+    auto second = store.put(data);
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(data.size(), store.stats().stored_bytes);
+
+    store.release(first);
+    std::string out;
+    ASSERT_TRUE(store.assemble(second, out));
+    EXPECT_EQ(data, out);
+
+    store.release(second);
+    EXPECT_EQ(0u, store.stats().chunk_count);
+    EXPECT_FALSE(store.assemble(second, out));
+}
+
+TEST(ChunkStoreTest, InsertVerifiesDigest) {
+    ChunkStore store;
+    ChunkId id = Sha256::hash("abc", 3);
+    EXPECT_FALSE(store.insert(id, "abd"));
+    ASSERT_TRUE(store.insert(id, "abc"));
+    std::vector<ChunkId> chunks = {id};
+    ASSERT_TRUE(store.add_ref(chunks));
+    store.drop_unreferenced();
+    std::string out;
+    ASSERT_TRUE(store.assemble(chunks, out));
+    EXPECT_EQ("abc", out);
+}
@@ -0,0 +1,77 @@
+/**
+ * @file codec_test.cpp
+ * @brief Unit tests for the record compression codecs
+ */
+
+#include <gtest/gtest.h>
+#include "storage/codec.h"
+#include <random>
+#include <string>
+
+using namespace ffvms::storage;
+
+namespace {
+
+std::string source_like(std::size_t n) {
+    static const char* words[] = {"int ", "return ", "node->", "content", "(", ");\n", "{\n", "}\n", "    "};
+    std::mt19937 gen(5);
+    std::string out;
+    while (out.size() < n) out += words[gen() % 9];
+    out.resize(n);
+    return out;
+}
+
+std::string random_bytes(std::size_t n) {
+    std::mt19937 gen(6);
+    std::string out(n, '\0');
+    for (auto& c : out) c = static_cast<char>(gen() & 0xff);
+    return out;
+}
+
+void expect_round_trip(const ICodec& codec, const std::string& input) {
+    std::string compressed, restored;
+    codec.compress(input, compressed);
+    ASSERT_TRUE(codec.decompress(compressed, restored)) << "size " << input.size();
+    EXPECT_EQ(input, restored);
+}
+
+}  // namespace
+
+TEST(CodecTest, RegistryKnowsBuiltInCodecs) {
+    ASSERT_NE(nullptr, find_codec(CodecId::NONE));
+    ASSERT_NE(nullptr, find_codec(CodecId::LZ4));
+    EXPECT_EQ(CodecId::LZ4, find_codec(CodecId::LZ4)->id());
+    EXPECT_EQ(nullptr, find_codec(static_cast<CodecId>(99)));
+}
+
+TEST(CodecTest, Lz4RoundTrips) {
+    const ICodec& lz4 = *find_codec(CodecId::LZ4);
+    for (std::size_t n : {0, 1, 5, 12, 13, 64, 1000, 70000, 1 << 20}) {
+        expect_round_trip(lz4, source_like(n));
+        expect_round_trip(lz4, random_bytes(n));
+        expect_round_trip(lz4, std::string(n, 'a'));
+    }
+}
+
+TEST(CodecTest, Lz4ShrinksText) {
+    const ICodec& lz4 = *find_codec(CodecId::LZ4);
+    std::string input = source_like(1 << 20), compressed;
+    lz4.compress(input, compressed);
+    EXPECT_LT(compressed.size() * 2, input.size());
+}
+
+TEST(CodecTest, Lz4RejectsDamagedInput) {
+    const ICodec& lz4 = *find_codec(CodecId::LZ4);
+    std::string input = source_like(10000), compressed, out;
+    lz4.compress(input, compressed);
+    for (std::size_t cut = 0; cut < compressed.size(); cut += 97) {
+        EXPECT_FALSE(lz4.decompress(compressed.substr(0, cut), out));
+    }
+    // Flipped bytes must never crash; they either fail or decode to something else
+    std::mt19937 gen(7);
+    for (int i = 0; i < 200; i++) {
+        std::string damaged = compressed;
+        damaged[8 + gen() % (damaged.size() - 8)] ^= static_cast<char>(1 + gen() % 255);
+        if (lz4.decompress(damaged, out)) EXPECT_EQ(input.size(), out.size());
+    }
+}
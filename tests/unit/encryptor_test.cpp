@@ -5,6 +5,8 @@
 
 #include <gtest/gtest.h>
 #include "encryptor.h"
+#include "core/thread_pool.h"
+#include <thread>
 #include <vector>
 #include <string>
 
@@ -138,3 +140,52 @@ TEST_F(EncryptorTest, BlockBoundaryHandling) {
         EXPECT_EQ(original_copy[i], decrypted[i]);
     }
 }
+
+// Blocks transformed on a pool must match the single-threaded result exactly
+TEST_F(EncryptorTest, ParallelMatchesSequential) {
+    std::vector<int> original(N * 20 + 37);
+    for (size_t i = 0; i < original.size(); ++i) original[i] = static_cast<int>(i * 31 % 256);
+    std::vector<int> copy = original;
+
+    std::vector<std::pair<double, double>> sequential, parallel;
+    ASSERT_TRUE(encrypt_sequence(copy, sequential));
+
+    ffvms::ThreadPool pool(4);
+    set_thread_pool(&pool);
+    copy = original;
+    ASSERT_TRUE(encrypt_sequence(copy, parallel));
+    ASSERT_EQ(sequential.size(), parallel.size());
+    for (size_t i = 0; i < sequential.size(); ++i) {
+        ASSERT_EQ(sequential[i], parallel[i]) << "Mismatch at index " << i;
+    }
+
+    std::vector<int> decrypted;
+    ASSERT_TRUE(decrypt_sequence(parallel, decrypted));
+    EXPECT_EQ(original, decrypted);
+    set_thread_pool(nullptr);
+}
+
+// One instance used from several threads at once
+TEST_F(EncryptorTest, ConcurrentUseIsSafe) {
+    std::vector<std::thread> threads;
+    std::vector<bool> ok(4, false);
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([this, t, &ok] {
+            std::vector<int> original(N * 3, t + 1);
+            std::vector<int> copy = original;
+            std::vector<std::pair<double, double>> encrypted;
+            std::vector<int> decrypted;
+            ok[t] = encrypt_sequence(copy, encrypted) && decrypt_sequence(encrypted, decrypted) &&
+                    decrypted == original;
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    for (int t = 0; t < 4; ++t) EXPECT_TRUE(ok[t]) << "Thread " << t;
+}
+
+// A payload that is not a whole number of blocks is rejected
+TEST_F(EncryptorTest, RejectsPartialBlock) {
+    std::vector<std::pair<double, double>> encrypted(N + 1);
+    std::vector<int> decrypted;
+    EXPECT_FALSE(decrypt_sequence(encrypted, decrypted));
+}
@@ -0,0 +1,59 @@
+/**
+ * @file fft_test.cpp
+ * @brief Unit tests for the iterative FFT kernel
+ */
+
+#include <gtest/gtest.h>
+#include "core/fft.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+using ffvms::FftPlan;
+
+namespace {
+
+std::vector<double> random_symbols(std::size_t n, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<double> data(2 * n, 0.0);
+    for (std::size_t i = 0; i < n; i++) data[2 * i] = byte(gen);
+    return data;
+}
+
+}  // namespace
+
+// The iterative kernel must agree with the recursive one it replaced
+TEST(FftTest, MatchesRecursiveKernel) {
+    for (std::size_t n = 1; n <= 4096; n <<= 1) {
+        for (int sign : {1, -1}) {
+            std::vector<double> expected = random_symbols(n, static_cast<unsigned>(n));
+            std::vector<double> actual = expected;
+            std::vector<double> scratch(2 * n);
+            ffvms::fft_recursive(expected.data(), scratch.data(), n, sign);
+            FftPlan::get(n).transform(actual.data(), sign);
+            for (std::size_t i = 0; i < 2 * n; i++) {
+                ASSERT_NEAR(expected[i], actual[i], 1e-6 * n) << "n=" << n << " sign=" << sign << " i=" << i;
+            }
+        }
+    }
+}
+
+TEST(FftTest, InverseRestoresInput) {
+    const std::size_t n = 1024;
+    std::vector<double> original = random_symbols(n, 7);
+    std::vector<double> data = original;
+    const FftPlan& plan = FftPlan::get(n);
+    plan.transform(data.data(), 1);
+    plan.transform(data.data(), -1);
+    for (std::size_t i = 0; i < 2 * n; i++) {
+        EXPECT_NEAR(original[i], data[i] / n, 1e-9) << "i=" << i;
+    }
+}
+
+TEST(FftTest, PlansAreShared) {
+    EXPECT_EQ(&FftPlan::get(256), &FftPlan::get(256));
+    EXPECT_EQ(256u, FftPlan::get(256).size());
+    EXPECT_NE(nullptr, FftPlan::kernel_name());
+}
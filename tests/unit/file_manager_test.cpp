@@ -0,0 +1,205 @@
+/**
+ * @file file_manager_test.cpp
+ * @brief Unit tests for FileManager content storage and chunk dedup
+ */
+
+#include <gtest/gtest.h>
+#include "gmock/gmock.h"
+#include "mock_logger.h"
+#include "file_manager.h"
+#include <map>
+#include <random>
+#include <string>
+
+using namespace ffvms;
+using namespace ffvms::test;
+using ::testing::NiceMock;
+
+namespace {
+
+// Keeps saved tables in memory so FileManager instances can be reloaded
+class TableStorage : public IStorage {
+public:
+    std::map<std::string, DataTable> tables;
+    std::map<std::string, int> saves;
+    std::string unreadable;   ///< Table whose loads fail, as an undecryptable record does
+
+    bool save(const std::string& name, const DataTable& content) override {
+        tables[name] = content;
+        saves[name]++;
+        return true;
+    }
+
+    bool load(const std::string& name, DataTable& content, bool) override {
+        auto it = tables.find(name);
+        if (it == tables.end() || name == unreadable) return false;
+        content = it->second;
+        return true;
+    }
+};
+
+std::string make_lines(std::size_t lines) {
+    std::mt19937 gen(7);
+    std::string out;
+    for (std::size_t i = 0; i < lines; i++) {
+        out += "line " + std::to_string(i) + " value " + std::to_string(gen() % 100000) + "\n";
+    }
+    return out;
+}
+
+}  // namespace
+
+class FileManagerTest : public ::testing::Test {
+protected:
+    NiceMock<MockLogger> logger;
+    TableStorage storage;
+};
+
+TEST_F(FileManagerTest, EditedVersionsShareChunks) {
+    FileManager fm(&storage, &logger);
+    std::string content = make_lines(20000);
+    unsigned long long first = fm.create_file(content);
+    fm.increase_counter(first);  // keep the first version alive, as an older version node would
+    const auto one_copy = fm.chunk_stats().stored_bytes;
+    EXPECT_EQ(content.size(), one_copy);
+
+    std::string edited = content;
+    edited.insert(edited.size() / 2, "an edited line\n");
+    unsigned long long second;
+    ASSERT_TRUE(fm.update_content(first, second, edited));
+    EXPECT_LT(fm.chunk_stats().stored_bytes, one_copy + 3 * storage::ChunkerParams().max_size);
+
+    std::string out;
+    ASSERT_TRUE(fm.get_content(first, out));
+    EXPECT_EQ(content, out);
+    ASSERT_TRUE(fm.get_content(second, out));
+    EXPECT_EQ(edited, out);
+}
+
+TEST_F(FileManagerTest, ReleasingLastReferenceFreesChunks) {
+    FileManager fm(&storage, &logger);
+    unsigned long long id = fm.create_file(make_lines(1000));
+    unsigned long long same = fm.create_file(make_lines(1000));
+    ASSERT_TRUE(fm.decrease_counter(id));
+    EXPECT_GT(fm.chunk_stats().chunk_count, 0u);
+    ASSERT_TRUE(fm.decrease_counter(same));
+    EXPECT_EQ(0u, fm.chunk_stats().chunk_count);
+}
+
+TEST_F(FileManagerTest, ChunksPersistAcrossReload) {
+    unsigned long long id, empty;
+    std::string content = make_lines(5000);
+    {
+        FileManager fm(&storage, &logger);
+        id = fm.create_file(content);
+        empty = fm.create_file("");
+    }
+    FileManager fm(&storage, &logger);
+    std::string out;
+    ASSERT_TRUE(fm.get_content(id, out));
+    EXPECT_EQ(content, out);
+    ASSERT_TRUE(fm.get_content(empty, out));
+    EXPECT_EQ("", out);
+    EXPECT_EQ(content.size(), fm.chunk_stats().stored_bytes);
+}
+
+TEST_F(FileManagerTest, LoadsLegacyWholeContentRows) {
+    storage.tables["FileManager::map_relation"] = {{"17", "hello world", "2"}};
+    FileManager fm(&storage, &logger);
+    std::string out;
+    ASSERT_TRUE(fm.get_content(17, out));
+    EXPECT_EQ("hello world", out);
+    ASSERT_TRUE(fm.decrease_counter(17));
+    ASSERT_TRUE(fm.get_content(17, out));
+}
+
+TEST_F(FileManagerTest, CorruptedChunkIsRejected) {
+    {
+        FileManager fm(&storage, &logger);
+        fm.create_file("some content");
+    }
+    storage.tables["FileManager::chunks"][0][1] = "tampered";
+    FileManager fm(&storage, &logger);
+    EXPECT_EQ(0u, fm.chunk_stats().chunk_count);
+}
+
+TEST_F(FileManagerTest, UnreadableChunkTableFailsTheLoad) {
+    const std::string content = make_lines(10);
+    unsigned long long id, empty;
+    {
+        FileManager fm(&storage, &logger);
+        id = fm.create_file(content);
+        empty = fm.create_file("");
+    }
+    const auto tables = storage.tables;
+    storage.saves.clear();
+    storage.unreadable = "FileManager::chunks";
+    {
+        FileManager fm(&storage, &logger);
+        std::string out;
+        EXPECT_FALSE(fm.get_content(id, out));
+        EXPECT_FALSE(fm.get_content(empty, out));
+        EXPECT_EQ(0u, fm.chunk_stats().chunk_count);
+    }
+    // Nothing changed, so the stored tables survive for a later session that can read them
+    EXPECT_TRUE(storage.saves.empty());
+    EXPECT_EQ(tables, storage.tables);
+
+    storage.unreadable.clear();
+    FileManager fm(&storage, &logger);
+    std::string out;
+    ASSERT_TRUE(fm.get_content(id, out));
+    EXPECT_EQ(content, out);
+}
+
+TEST_F(FileManagerTest, ReadOnlySessionSavesNothing) {
+    unsigned long long id;
+    {
+        FileManager fm(&storage, &logger);
+        id = fm.create_file(make_lines(1000));
+    }
+    storage.saves.clear();
+    {
+        FileManager fm(&storage, &logger);
+        std::string out;
+        ASSERT_TRUE(fm.get_content(id, out));
+        EXPECT_FALSE(fm.dirty());
+    }
+    EXPECT_TRUE(storage.saves.empty());
+}
+
+TEST_F(FileManagerTest, SharingContentOnlyRewritesRelation) {
+    unsigned long long id;
+    {
+        FileManager fm(&storage, &logger);
+        id = fm.create_file(make_lines(1000));
+    }
+    storage.saves.clear();
+    {
+        FileManager fm(&storage, &logger);
+        ASSERT_TRUE(fm.increase_counter(id));
+        fm.create_file(make_lines(1000));  // every chunk is already stored
+    }
+    EXPECT_EQ(0, storage.saves["FileManager::chunks"]);
+    EXPECT_EQ(1, storage.saves["FileManager::map_relation"]);
+}
+
+TEST_F(FileManagerTest, CapturedTablesIgnoreLaterChanges) {
+    TableStorage captured;
+    unsigned long long kept;
+    {
+        FileManager fm(&storage, &logger);
+        kept = fm.create_file("captured");
+        std::vector<TableWrite> writes;
+        fm.capture(writes);
+        // The writes share the maps; these changes must copy them instead of reaching the writes
+        fm.create_file("after the capture");
+        ASSERT_TRUE(fm.decrease_counter(kept));
+        for (auto& write : writes) ASSERT_TRUE(write.write_to(captured));
+    }
+    FileManager fm(&captured, &logger);
+    std::string out;
+    ASSERT_TRUE(fm.get_content(kept, out));
+    EXPECT_EQ("captured", out);
+    EXPECT_EQ(std::string("captured").size(), fm.chunk_stats().stored_bytes);
+}
@@ -0,0 +1,76 @@
+/**
+ * @file in_memory_storage_test.cpp
+ * @brief Unit tests for InMemoryStorage
+ */
+
+#include <gtest/gtest.h>
+#include "gmock/gmock.h"
+#include "mock_logger.h"
+#include "saver.h"
+#include "storage/in_memory_storage.h"
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+using namespace ffvms;
+using namespace ffvms::storage;
+using namespace ffvms::test;
+using ::testing::NiceMock;
+
+TEST(InMemoryStorageTest, RoundTrip) {
+    NiceMock<MockLogger> logger;
+    InMemoryStorage storage(&logger);
+    const DataTable table = {{"1", "hello"}, {}, {"2", std::string(1000, 'x'), ""}};
+    ASSERT_TRUE(storage.save("table", table));
+    ASSERT_TRUE(storage.save("empty", DataTable()));
+
+    DataTable loaded;
+    ASSERT_TRUE(storage.load("table", loaded));
+    EXPECT_EQ(table, loaded);
+    ASSERT_TRUE(storage.load("empty", loaded));
+    EXPECT_TRUE(loaded.empty());
+    EXPECT_FALSE(storage.load("missing", loaded));
+    EXPECT_EQ((std::vector<std::string>{"empty", "table"}), storage.names());
+
+    ASSERT_TRUE(storage.save("table", DataTable{{"3"}}));
+    std::size_t rows = 0;
+    ASSERT_TRUE(storage.load_records("table", [&](IRecordReader& in) {
+        std::size_t fields;
+        std::string_view value;
+        while (in.next_row(fields)) {
+            rows++;
+            EXPECT_TRUE(in.str(value));
+            EXPECT_EQ("3", value);
+        }
+        return in.ok();
+    }));
+    EXPECT_EQ(1u, rows);
+}
+
+TEST(InMemoryStorageTest, DumpsToADataFileOnDestruction) {
+    NiceMock<MockLogger> logger;
+    const std::string path = (std::filesystem::temp_directory_path() / "ffvms_in_memory_dump.chm").string();
+    std::remove(path.c_str());
+    const DataTable table = {{"1", "kept"}};
+    {
+        InMemoryStorageOptions options;
+        options.dump_path = path;
+        InMemoryStorage storage(&logger, options);
+        ASSERT_TRUE(storage.save("table", table));
+        EXPECT_FALSE(std::filesystem::exists(path));
+    }
+    {
+        Saver saver(&logger, path);
+        DataTable loaded;
+        ASSERT_TRUE(saver.load("table", loaded));
+        EXPECT_EQ(table, loaded);
+    }
+    std::remove(path.c_str());
+}
+
+TEST(InMemoryStorageTest, SelectedAsDefaultStorage) {
+    InMemoryStorage storage;
+    Saver::set_default_storage(&storage);
+    EXPECT_EQ(&storage, &Saver::get_default_storage());
+    Saver::set_default_storage(nullptr);
+}
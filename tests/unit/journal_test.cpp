@@ -0,0 +1,88 @@
+/**
+ * @file journal_test.cpp
+ * @brief Unit tests for the group-commit journal
+ */
+
+#include <gtest/gtest.h>
+#include "storage/journal.h"
+#include "temp_path_test.h"
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ffvms::storage;
+
+class JournalTest : public ffvms::test::TempPathTest<> {
+protected:
+    std::string contents() {
+        std::ifstream in(temp_path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+};
+
+TEST_F(JournalTest, AppendReturnsEndPosition) {
+    Journal journal;
+    ASSERT_TRUE(journal.open(temp_path, Durability::NONE));
+    unsigned long long end = 0;
+    ASSERT_TRUE(journal.append("abc", end));
+    EXPECT_EQ(3u, end);
+    ASSERT_TRUE(journal.append("defg", end));
+    EXPECT_EQ(7u, end);
+    EXPECT_TRUE(journal.commit(end));
+    EXPECT_EQ(0u, journal.sync_count());
+    EXPECT_EQ("abcdefg", contents());
+}
+
+TEST_F(JournalTest, ReopenContinuesAtEnd) {
+    unsigned long long end = 0;
+    {
+        Journal journal;
+        ASSERT_TRUE(journal.open(temp_path, Durability::ALWAYS));
+        ASSERT_TRUE(journal.append("first", end));
+        ASSERT_TRUE(journal.commit(end));
+        EXPECT_EQ(1u, journal.sync_count());
+    }
+    Journal journal;
+    ASSERT_TRUE(journal.open(temp_path, Durability::ALWAYS));
+    EXPECT_EQ(5u, journal.size());
+    ASSERT_TRUE(journal.append("second", end));
+    EXPECT_EQ(11u, end);
+    EXPECT_EQ("firstsecond", contents());
+}
+
+TEST_F(JournalTest, ConcurrentCommitsShareSyncs) {
+    Journal journal;
+    ASSERT_TRUE(journal.open(temp_path, Durability::ALWAYS));
+    const int threads = 8, per_thread = 50;
+    std::vector<std::thread> writers;
+    for (int t = 0; t < threads; t++) {
+        writers.emplace_back([&journal] {
+            for (int i = 0; i < per_thread; i++) {
+                unsigned long long end = 0;
+                EXPECT_TRUE(journal.append(std::string(64, 'x'), end));
+                EXPECT_TRUE(journal.commit(end));
+            }
+        });
+    }
+    for (auto& writer : writers) writer.join();
+    EXPECT_EQ(static_cast<unsigned long long>(threads * per_thread * 64), journal.size());
+    EXPECT_LE(journal.sync_count(), static_cast<unsigned long long>(threads * per_thread));
+    EXPECT_GE(journal.sync_count(), 1u);
+}
+
+TEST_F(JournalTest, BatchedSyncsInBackground) {
+    Journal journal;
+    ASSERT_TRUE(journal.open(temp_path, Durability::BATCHED, std::chrono::milliseconds(5)));
+    unsigned long long end = 0;
+    ASSERT_TRUE(journal.append("batched", end));
+    EXPECT_TRUE(journal.commit(end));
+    for (int i = 0; i < 200 && journal.sync_count() == 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_GE(journal.sync_count(), 1u);
+    EXPECT_TRUE(journal.close());
+    EXPECT_FALSE(journal.is_open());
+    EXPECT_EQ("batched", contents());
+}
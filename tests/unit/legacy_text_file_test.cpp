@@ -0,0 +1,178 @@
+/**
+ * @file legacy_text_file_test.cpp
+ * @brief Unit tests for the legacy text data file reader and its migration
+ */
+
+#include <gtest/gtest.h>
+#include "gmock/gmock.h"
+#include "mock_logger.h"
+#include "encryptor.h"
+#include "saver.h"
+#include "storage/byte_io.h"
+#include "storage/data_file_format.h"
+#include "storage/legacy_migration.h"
+#include "storage/legacy_text_file.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace ffvms;
+using namespace ffvms::test;
+using ::testing::NiceMock;
+
+namespace {
+
+// Writes records the way Saver did before the binary container existed
+class LegacyTextWriter : protected Encryptor {
+public:
+    static unsigned long long hash(const std::string& s) {
+        unsigned long long h = 0;
+        for (auto& ch : s) h = h * 13331 + ch;
+        return h;
+    }
+
+    void write(std::ostream& out, const std::string& name, const std::string& serialized) {
+        std::vector<int> sequence(serialized.begin(), serialized.end());
+        std::vector<std::pair<double, double>> res;
+        encrypt_sequence(sequence, res);
+        out << hash(name) << ' ' << hash(serialized) << ' ' << res.size() / N;
+        for (auto& pr : res) {
+            out << ' ' << pr.first << ' ' << pr.second;
+        }
+        out << '\n';
+    }
+};
+
+std::string legacy_text(const std::string& name, const std::string& serialized) {
+    std::ostringstream out;
+    LegacyTextWriter().write(out, name, serialized);
+    return out.str();
+}
+
+}  // namespace
+
+TEST(LegacyTextReaderTest, ParsesRecordsAsFftPayloads) {
+    std::string text = "7 9 1";
+    std::vector<double> values;
+    for (int i = 0; i < 2 * Encryptor::N; i++) {
+        values.push_back(i * 0.5 - 3e-7);
+        text += " " + std::to_string(values.back());
+    }
+    text += "\n\n11 13 0\n";
+
+    storage::LegacyTextReader reader(text.data(), text.size());
+    storage::LegacyTextRecord record;
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(7u, record.name_hash);
+    EXPECT_EQ(9u, record.data_hash);
+    ASSERT_EQ(values.size() * 8, record.payload.size());
+    for (std::size_t i = 0; i < values.size(); i++) {
+        EXPECT_DOUBLE_EQ(std::stod(std::to_string(values[i])), storage::load_f64(record.payload.data() + i * 8)) << i;
+    }
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(11u, record.name_hash);
+    EXPECT_TRUE(record.payload.empty());
+    EXPECT_FALSE(reader.next(record));
+    EXPECT_TRUE(reader.ok());
+    EXPECT_EQ(text.size(), reader.position());
+}
+
+TEST(LegacyTextReaderTest, RejectsDamagedRecords) {
+    std::string text = legacy_text("table", "1 1 2 ab");
+    for (const std::string& damaged : {text.substr(0, text.size() / 2), std::string("1 2"),
+                                       std::string("1 2 x"), text.substr(0, text.size() - 3) + " junk\n",
+                                       std::string("1 2 99999999999")}) {
+        storage::LegacyTextReader reader(damaged.data(), damaged.size());
+        storage::LegacyTextRecord record;
+        while (reader.next(record)) {
+        }
+        EXPECT_FALSE(reader.ok()) << damaged.substr(0, 40);
+    }
+
+    storage::LegacyTextReader empty(nullptr, 0);
+    storage::LegacyTextRecord record;
+    EXPECT_FALSE(empty.next(record));
+    EXPECT_TRUE(empty.ok());
+}
+
+class LegacyMigrationTest : public ::testing::Test {
+protected:
+    NiceMock<MockLogger> logger;
+    std::string source, target;
+
+    void SetUp() override {
+        auto dir = std::filesystem::temp_directory_path();
+        const std::string name = ::testing::UnitTest::GetInstance()->current_test_info()->name();
+        source = (dir / ("ffvms_migrate_" + name + "_old.chm")).string();
+        target = (dir / ("ffvms_migrate_" + name + "_new.chm")).string();
+    }
+
+    void TearDown() override {
+        for (const std::string& file : {source, target, source + ".wal", target + ".wal"}) {
+            std::remove(file.c_str());
+        }
+    }
+
+    void write_source(const std::string& text) {
+        std::ofstream out(source, std::ios::binary);
+        out << text;
+    }
+
+    DataTable load(const std::string& path, const std::string& name) {
+        Saver saver(&logger, path);
+        DataTable table;
+        EXPECT_TRUE(saver.load(name, table)) << name;
+        return table;
+    }
+};
+
+TEST_F(LegacyMigrationTest, MigratedFileLoadsLikeTheOriginal) {
+    write_source(legacy_text("FileManager::map_relation", "1 3 2 17 11 hello world 1 2") +
+                 legacy_text("other", "1 1 1 x") +
+                 legacy_text("other", "2 1 1 y 1 1 z"));
+    const DataTable relation = {{"17", "hello world", "2"}};
+    const DataTable other = {{"y"}, {"z"}};
+
+    storage::MigrationStats stats;
+    std::size_t calls = 0;
+    ASSERT_TRUE(storage::migrate_legacy_text(logger, source, target, storage::MigrationOptions(), stats,
+                                             [&](const storage::MigrationStats&) { calls++; }));
+    EXPECT_EQ(3u, stats.records);
+    EXPECT_EQ(3u, calls);
+    EXPECT_EQ(0u, stats.kept);
+    EXPECT_EQ(std::filesystem::file_size(source), stats.bytes_read);
+    EXPECT_EQ(std::filesystem::file_size(target), stats.bytes_written);
+
+    std::ifstream in(target, std::ios::binary);
+    char magic[8] = {};
+    in.read(magic, sizeof(magic));
+    EXPECT_TRUE(storage::has_file_magic(magic, static_cast<size_t>(in.gcount())));
+    in.close();
+    EXPECT_EQ(relation, load(target, "FileManager::map_relation"));
+    EXPECT_EQ(other, load(target, "other"));
+}
+
+TEST_F(LegacyMigrationTest, MigratesInPlaceAndKeepsFftPayloadsOnRequest) {
+    write_source(legacy_text("table", "1 2 5 hello 3 abc"));
+    storage::MigrationOptions options;
+    options.cipher = storage::CipherId::FFT;
+    storage::MigrationStats stats;
+    ASSERT_TRUE(storage::migrate_legacy_text(logger, source, source, options, stats));
+    DataTable expected = {{"hello", "abc"}};
+    EXPECT_EQ(expected, load(source, "table"));
+
+    // The file is binary now and is not migrated twice
+    EXPECT_FALSE(storage::migrate_legacy_text(logger, source, target, options, stats));
+    EXPECT_FALSE(std::filesystem::exists(target));
+}
+
+TEST_F(LegacyMigrationTest, DamagedSourceLeavesNoTarget) {
+    std::string text = legacy_text("table", "1 1 2 ab");
+    write_source(text + text.substr(0, text.size() / 2));
+    storage::MigrationStats stats;
+    EXPECT_FALSE(storage::migrate_legacy_text(logger, source, target, storage::MigrationOptions(), stats));
+    EXPECT_FALSE(std::filesystem::exists(target));
+    EXPECT_FALSE(std::filesystem::exists(target + ".tmp"));
+}
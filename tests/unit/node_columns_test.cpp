@@ -0,0 +1,149 @@
+/**
+ * @file node_columns_test.cpp
+ * @brief Unit tests for the columnar version tree node encoding
+ */
+
+#include <gtest/gtest.h>
+#include "storage/byte_io.h"
+#include "storage/node_columns.h"
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ffvms::storage;
+
+namespace {
+
+std::vector<NodeColumn> make_nodes(std::size_t count) {
+    std::mt19937_64 gen(3);
+    std::vector<NodeColumn> nodes(count);
+    for (std::size_t i = 0; i < count; i++) {
+        nodes[i].type = static_cast<std::uint8_t>(gen() % 3);
+        nodes[i].cnt = static_cast<std::uint32_t>(gen() % 5);
+        nodes[i].link = gen();
+        if (i > 0 && gen() % 2) nodes[i].next_brother = gen() % i;
+        if (i > 0 && gen() % 2) nodes[i].first_son = i - 1;
+    }
+    return nodes;
+}
+
+std::string encode(const std::vector<NodeColumn>& nodes) {
+    NodeColumnsWriter writer;
+    writer.reserve(nodes.size());
+    for (auto& node : nodes) writer.add(node);
+    std::string out;
+    writer.finish(out);
+    return out;
+}
+
+bool decode(const std::string& bytes, std::vector<NodeColumn>& nodes) {
+    NodeColumnsReader reader;
+    if (!reader.open(bytes)) return false;
+    nodes.assign(reader.size(), NodeColumn());
+    for (auto& node : nodes) {
+        if (!reader.next(node)) return false;
+    }
+    NodeColumn extra;
+    return !reader.next(extra);
+}
+
+bool same(const NodeColumn& a, const NodeColumn& b) {
+    return a.type == b.type && a.cnt == b.cnt && a.link == b.link && a.next_brother == b.next_brother &&
+           a.first_son == b.first_son;
+}
+
+}  // namespace
+
+TEST(NodeColumnsTest, RoundTrip) {
+    for (std::size_t count : {0u, 1u, 1000u}) {
+        std::vector<NodeColumn> nodes = make_nodes(count);
+        std::string bytes = encode(nodes);
+        EXPECT_TRUE(NodeColumnsReader::is_node_columns(bytes));
+        std::vector<NodeColumn> decoded;
+        ASSERT_TRUE(decode(bytes, decoded)) << count;
+        ASSERT_EQ(nodes.size(), decoded.size());
+        for (std::size_t i = 0; i < count; i++) EXPECT_TRUE(same(nodes[i], decoded[i])) << i;
+    }
+}
+
+TEST(NodeColumnsTest, NearbyLabelsAndLinksEncodeSmall) {
+    // A chain of siblings with consecutive links costs five bytes per node
+    NodeColumnsWriter writer;
+    for (std::uint64_t i = 0; i < 1000; i++) {
+        NodeColumn node;
+        node.cnt = 1;
+        node.link = 1000000 + i;
+        if (i > 0) node.next_brother = i - 1;
+        writer.add(node);
+    }
+    std::string bytes;
+    writer.finish(bytes);
+    EXPECT_LT(bytes.size(), 5 * 1000u + 64);
+}
+
+TEST(NodeColumnsTest, ForwardReferencesAndFreeLabelsRoundTrip) {
+    // Labels are kept across saves, so a node can point at a later label and deleted nodes leave gaps
+    std::vector<NodeColumn> nodes(4);
+    nodes[0].type = 2;
+    nodes[0].link = 7;
+    nodes[0].first_son = 3;
+    nodes[1].type = NodeColumn::FREE;
+    nodes[2].cnt = 2;
+    nodes[2].link = 9;
+    nodes[3].type = 1;
+    nodes[3].cnt = 1;
+    nodes[3].link = 8;
+    nodes[3].next_brother = 2;
+    std::vector<NodeColumn> decoded;
+    ASSERT_TRUE(decode(encode(nodes), decoded));
+    ASSERT_EQ(nodes.size(), decoded.size());
+    EXPECT_EQ(NodeColumn::FREE, decoded[1].type);
+    nodes[1].link = nodes[0].link;
+    for (std::size_t i = 0; i < nodes.size(); i++) EXPECT_TRUE(same(nodes[i], decoded[i])) << i;
+}
+
+TEST(NodeColumnsTest, ReadsVersionOneTables) {
+    // Version 1 stored plain backward distances: node 1 is node 0's brother and has no links
+    std::string bytes = "FFVMTREE";
+    put_u32(bytes, 1);
+    put_varint(bytes, 2);
+    for (const char* column : {"\0\0", "\1\1", "\x14\x02", "\0\1", "\0\0"}) {
+        put_varint(bytes, 2);
+        bytes.append(column, 2);
+    }
+    std::vector<NodeColumn> decoded;
+    ASSERT_TRUE(decode(bytes, decoded));
+    ASSERT_EQ(2u, decoded.size());
+    EXPECT_EQ(10u, decoded[0].link);
+    EXPECT_EQ(11u, decoded[1].link);
+    EXPECT_EQ(NodeColumn::NONE, decoded[0].next_brother);
+    EXPECT_EQ(0u, decoded[1].next_brother);
+    EXPECT_EQ(NodeColumn::NONE, decoded[1].first_son);
+
+    // A distance reaching below label 0 is damage
+    bytes[bytes.size() - 5] = '\x01';
+    EXPECT_FALSE(decode(bytes, decoded));
+}
+
+TEST(NodeColumnsTest, RejectsOutOfRangeReferencesAndDamage) {
+    std::string bytes = encode(make_nodes(100));
+    std::vector<NodeColumn> decoded;
+
+    // A label past the end of the table
+    NodeColumnsWriter writer;
+    NodeColumn node;
+    node.first_son = 1;
+    writer.add(node);
+    std::string dangling;
+    writer.finish(dangling);
+    EXPECT_FALSE(decode(dangling, decoded));
+
+    for (std::size_t cut : {std::size_t(4), std::size_t(12), bytes.size() / 2, bytes.size() - 1}) {
+        EXPECT_FALSE(decode(bytes.substr(0, cut), decoded)) << cut;
+    }
+    EXPECT_FALSE(decode(bytes + "x", decoded));
+    std::string wrong_magic = bytes;
+    wrong_magic[0] = 'X';
+    EXPECT_FALSE(NodeColumnsReader::is_node_columns(wrong_magic));
+    EXPECT_FALSE(decode(wrong_magic, decoded));
+}
@@ -0,0 +1,59 @@
+/**
+ * @file ntt_test.cpp
+ * @brief Unit tests for the number-theoretic transform
+ */
+
+#include <gtest/gtest.h>
+#include "core/ntt.h"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using ffvms::NttPlan;
+
+namespace {
+
+constexpr std::uint64_t P = NttPlan::MODULUS;
+
+std::uint64_t pow_mod(std::uint64_t base, std::uint64_t exp) {
+    std::uint64_t result = 1;
+    for (base %= P; exp; exp >>= 1, base = base * base % P) {
+        if (exp & 1) result = result * base % P;
+    }
+    return result;
+}
+
+}  // namespace
+
+// Compare against the O(n^2) definition: X_k = sum x_j * g^(jk), g a primitive n-th root
+TEST(NttTest, MatchesDirectEvaluation) {
+    for (std::size_t n : {1, 2, 8, 64}) {
+        std::vector<std::uint32_t> data(n);
+        for (std::size_t i = 0; i < n; i++) data[i] = static_cast<std::uint32_t>((i * 97 + 5) % 256);
+        const std::uint64_t g = pow_mod(NttPlan::ROOT, (P - 1) / n);
+        std::vector<std::uint32_t> expected(n);
+        for (std::size_t k = 0; k < n; k++) {
+            std::uint64_t sum = 0;
+            for (std::size_t j = 0; j < n; j++) sum = (sum + data[j] * pow_mod(g, j * k)) % P;
+            expected[k] = static_cast<std::uint32_t>(sum);
+        }
+        NttPlan::get(n).transform(data.data(), 1);
+        EXPECT_EQ(expected, data) << "n=" << n;
+    }
+}
+
+TEST(NttTest, InverseIsExact) {
+    std::mt19937 gen(3);
+    std::uniform_int_distribution<std::uint32_t> residue(0, NttPlan::MODULUS - 1);
+    for (std::size_t n : {2, 1024, 8192}) {
+        std::vector<std::uint32_t> original(n);
+        for (auto& v : original) v = residue(gen);
+        std::vector<std::uint32_t> data = original;
+        const NttPlan& plan = NttPlan::get(n);
+        plan.transform(data.data(), 1);
+        for (auto v : data) ASSERT_LT(v, NttPlan::MODULUS);
+        plan.transform(data.data(), -1);
+        EXPECT_EQ(original, data) << "n=" << n;
+    }
+}
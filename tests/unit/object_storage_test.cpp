@@ -0,0 +1,161 @@
+/**
+ * @file object_storage_test.cpp
+ * @brief Unit tests for ObjectStorage
+ */
+
+#include <gtest/gtest.h>
+#include "gmock/gmock.h"
+#include "mock_logger.h"
+#include "storage/object_storage.h"
+#include "temp_path_test.h"
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace ffvms;
+using namespace ffvms::storage;
+using namespace ffvms::test;
+using ::testing::NiceMock;
+namespace fs = std::filesystem;
+
+namespace {
+
+DataTable make_rows(int count, std::size_t size) {
+    DataTable table;
+    for (int i = 0; i < count; i++) {
+        std::string v(size, '\0');
+        for (std::size_t j = 0; j < size; j++) v[j] = static_cast<char>('a' + (i * 31 + j) % 26);
+        table.push_back({std::to_string(i), v, ""});
+    }
+    return table;
+}
+
+std::size_t count_objects(const fs::path& dir) {
+    std::size_t n = 0;
+    for (const auto& entry : fs::recursive_directory_iterator(dir / "objects")) n += entry.is_regular_file();
+    return n;
+}
+
+}  // namespace
+
+class ObjectStorageTest : public TempPathTest<> {
+protected:
+    NiceMock<MockLogger> logger;
+    ObjectStorageOptions options;
+
+    void SetUp() override {
+        TempPathTest::SetUp();
+        options.object_bytes = 4096;
+        options.sync = false;
+    }
+};
+
+TEST_F(ObjectStorageTest, RoundTripsTablesAcrossReopen) {
+    DataTable table = make_rows(2000, 100);
+    table.push_back({std::string(20000, 'x')});   // Larger than an object
+    {
+        ObjectStorage storage(&logger, temp_path.string(), options);
+        ASSERT_TRUE(storage.is_open());
+        ASSERT_TRUE(storage.save("big", table));
+        ASSERT_TRUE(storage.save("empty", DataTable{}));
+    }
+    ObjectStorage storage(&logger, temp_path.string(), options);
+    DataTable loaded;
+    ASSERT_TRUE(storage.load("big", loaded));
+    EXPECT_EQ(table, loaded);
+    ASSERT_TRUE(storage.load("empty", loaded));
+    EXPECT_TRUE(loaded.empty());
+    EXPECT_FALSE(storage.load("missing", loaded));
+
+    // Objects are sharded by the first two hex digits of their id
+    for (const auto& shard : fs::directory_iterator(temp_path / "objects")) {
+        EXPECT_EQ(2u, shard.path().filename().string().size());
+    }
+}
+
+TEST_F(ObjectStorageTest, SaveWritesOnlyNewObjects) {
+    ObjectStorage storage(&logger, temp_path.string(), options);
+    DataTable table = make_rows(3000, 100);
+    ASSERT_TRUE(storage.save("t", table));
+    const auto first = storage.stats();
+    EXPECT_GT(first.objects_written, 20u);
+
+    ASSERT_TRUE(storage.save("t", table));
+    EXPECT_EQ(first.objects_written, storage.stats().objects_written);
+
+    // An inserted row disturbs only the objects next to it
+    table.insert(table.begin() + 1500, {"inserted"});
+    table[10][1] = "changed";
+    ASSERT_TRUE(storage.save("t", table));
+    EXPECT_LE(storage.stats().objects_written - first.objects_written, 4u);
+
+    DataTable loaded;
+    ASSERT_TRUE(storage.load("t", loaded));
+    EXPECT_EQ(table, loaded);
+}
+
+TEST_F(ObjectStorageTest, RemoveUnreferencedKeepsLiveObjects) {
+    ObjectStorage storage(&logger, temp_path.string(), options);
+    DataTable table = make_rows(500, 100);
+    ASSERT_TRUE(storage.save("t", table));
+    const std::size_t live = count_objects(temp_path);
+    table[0][1] = "changed";
+    ASSERT_TRUE(storage.save("t", table));
+    EXPECT_GT(count_objects(temp_path), live);
+
+    EXPECT_GT(storage.remove_unreferenced(), 0u);
+    EXPECT_EQ(live, count_objects(temp_path));
+    DataTable loaded;
+    ASSERT_TRUE(storage.load("t", loaded));
+    EXPECT_EQ(table, loaded);
+}
+
+TEST_F(ObjectStorageTest, IoBackendsShareTheLayout) {
+    DataTable table = make_rows(1000, 300);
+    options.io = IoBackend::THREADS;
+    {
+        ObjectStorage storage(&logger, temp_path.string(), options);
+        EXPECT_STREQ("threads", storage.io_backend());
+        ASSERT_TRUE(storage.save("t", table));
+    }
+    options.io = IoBackend::AUTO;
+    ObjectStorage storage(&logger, temp_path.string(), options);
+    DataTable loaded;
+    ASSERT_TRUE(storage.load("t", loaded));
+    EXPECT_EQ(table, loaded);
+    table[3][0] = "changed";
+    ASSERT_TRUE(storage.save("t", table));
+    ASSERT_TRUE(storage.load("t", loaded));
+    EXPECT_EQ(table, loaded);
+}
+
+TEST_F(ObjectStorageTest, DamagedObjectFailsLoad) {
+    {
+        ObjectStorage storage(&logger, temp_path.string(), options);
+        ASSERT_TRUE(storage.save("t", make_rows(50, 100)));
+    }
+    for (const auto& entry : fs::recursive_directory_iterator(temp_path / "objects")) {
+        if (!entry.is_regular_file()) continue;
+        std::fstream f(entry.path(), std::ios::binary | std::ios::in | std::ios::out);
+        f.seekp(10);
+        f.put('!');
+        break;
+    }
+    ObjectStorage storage(&logger, temp_path.string(), options);
+    DataTable loaded;
+    EXPECT_FALSE(storage.load("t", loaded));
+}
+
+TEST_F(ObjectStorageTest, DamagedManifestFailsOpen) {
+    {
+        ObjectStorage storage(&logger, temp_path.string(), options);
+        ASSERT_TRUE(storage.save("t", make_rows(10, 10)));
+    }
+    {
+        std::fstream f(temp_path / "MANIFEST", std::ios::binary | std::ios::in | std::ios::out);
+        f.seekp(12);
+        f.put('!');
+    }
+    ObjectStorage storage(&logger, temp_path.string(), options);
+    EXPECT_FALSE(storage.is_open());
+}
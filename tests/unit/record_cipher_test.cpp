@@ -0,0 +1,176 @@
+/**
+ * @file record_cipher_test.cpp
+ * @brief Unit tests for the record ciphers
+ */
+
+#include <gtest/gtest.h>
+#include "storage/chacha20.h"
+#include "storage/fft_cipher.h"
+#include "storage/ntt_cipher.h"
+#include "storage/record_cipher.h"
+#include "storage/sha256.h"
+#include <string>
+
+using namespace ffvms::storage;
+
+namespace {
+
+CipherKey counting_key() {
+    CipherKey key;
+    for (int i = 0; i < 32; i++) key[i] = static_cast<std::uint8_t>(i);
+    return key;
+}
+
+std::string to_hex(const std::string& bytes) {
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    for (unsigned char c : bytes) {
+        out.push_back(digits[c >> 4]);
+        out.push_back(digits[c & 0xf]);
+    }
+    return out;
+}
+
+std::string sample(std::size_t n) {
+    std::string out(n, '\0');
+    for (std::size_t i = 0; i < n; i++) out[i] = static_cast<char>((i * 7 + 3) & 0xff);
+    return out;
+}
+
+}  // namespace
+
+// RFC 8439, section 2.4.2
+TEST(ChaCha20Test, RfcEncryptionVector) {
+    const std::uint8_t nonce[12] = {0, 0, 0, 0, 0, 0, 0, 0x4a, 0, 0, 0, 0};
+    std::string plain = "Ladies and Gentlemen of the class of '99: If I could offer you only one tip for "
+                        "the future, sunscreen would be it.";
+    std::string cipher(plain.size(), '\0');
+    chacha20_xor(counting_key(), nonce, 1, plain.data(), &cipher[0], plain.size());
+    EXPECT_EQ("6e2e359a2568f98041ba0728dd0d6981e97e7aec1d4360c20a27afccfd9fae0bf91b65c5524733ab"
+              "8f593dabcd62b3571639d624e65152ab8f530c359f0861d807ca0dbf500d6a6156a38e088a22b65e"
+              "52bc514d16ccf806818ce91ab77937365af90bbf74a35be6b40b8eedf2785e42874d",
+              to_hex(cipher));
+}
+
+// Long enough for the four-block path; checked against a reference implementation
+TEST(ChaCha20Test, WideAndScalarPathsAgree) {
+    const std::uint8_t nonce[12] = {0, 0, 0, 0, 0, 0, 0, 0x4a, 0, 0, 0, 0};
+    std::string plain = sample(1000), whole(1000, '\0'), pieces(1000, '\0');
+    chacha20_xor(counting_key(), nonce, 5, plain.data(), &whole[0], plain.size());
+    EXPECT_EQ("518a1e2062ea2716bc413fb523c75a39b6d6104d870d901fb47a288b6bc9cc54", to_hex(whole.substr(968)));
+    for (std::size_t pos = 0; pos < plain.size(); pos += 64) {
+        std::size_t n = std::min<std::size_t>(64, plain.size() - pos);
+        chacha20_xor(counting_key(), nonce, static_cast<std::uint32_t>(5 + pos / 64), plain.data() + pos,
+                     &pieces[pos], n);
+    }
+    EXPECT_EQ(whole, pieces);
+}
+
+TEST(RecordCipherTest, AllCiphersRoundTrip) {
+    for (CipherId id : {CipherId::FFT, CipherId::IDENTITY, CipherId::CHACHA20, CipherId::FFT_PACKED,
+                        CipherId::NTT}) {
+        auto cipher = make_cipher(id, derive_key("secret"));
+        ASSERT_NE(nullptr, cipher);
+        EXPECT_EQ(id, cipher->id());
+        for (std::size_t n : {0, 1, 1023, 1024, 5000}) {
+            std::string plain = sample(n), payload, restored;
+            cipher->encrypt(plain, payload);
+            EXPECT_TRUE(is_valid_payload_size(id, payload.size())) << cipher->name() << " " << n;
+            ASSERT_TRUE(cipher->decrypt(payload, restored)) << cipher->name() << " " << n;
+            EXPECT_EQ(plain, restored) << cipher->name() << " " << n;
+        }
+    }
+}
+
+TEST(RecordCipherTest, PayloadSizes) {
+    std::string plain = sample(3000), payload;
+    make_cipher(CipherId::CHACHA20, derive_key(""))->encrypt(plain, payload);
+    EXPECT_EQ(plain.size() + CHACHA20_NONCE_SIZE, payload.size());
+    make_cipher(CipherId::FFT, derive_key(""))->encrypt(plain, payload);
+    EXPECT_EQ(3 * FftCipher::BLOCK_BYTES, payload.size());
+    EXPECT_FALSE(is_valid_payload_size(CipherId::FFT, FftCipher::BLOCK_BYTES + 1));
+    // Two bytes per point: 3001 symbols fit in two blocks of 2048
+    make_cipher(CipherId::FFT_PACKED, derive_key(""))->encrypt(plain, payload);
+    EXPECT_EQ(2 * PackedFftCipher::BLOCK_BYTES, payload.size());
+    EXPECT_FALSE(is_valid_payload_size(CipherId::FFT_PACKED, PackedFftCipher::BLOCK_BYTES * 3 / 2));
+    EXPECT_FALSE(is_valid_payload_size(CipherId::FFT_PACKED, 48 * 16));
+    EXPECT_FALSE(is_valid_payload_size(static_cast<CipherId>(42), 0));
+    EXPECT_EQ(nullptr, make_cipher(static_cast<CipherId>(42), derive_key("")));
+}
+
+TEST(RecordCipherTest, PackedFftHalvesLargePayloads) {
+    std::string plain = sample(100000), legacy, packed, restored;
+    make_cipher(CipherId::FFT, derive_key(""))->encrypt(plain, legacy);
+    auto cipher = make_cipher(CipherId::FFT_PACKED, derive_key(""));
+    cipher->encrypt(plain, packed);
+    EXPECT_LE(packed.size() * 2, legacy.size() + PackedFftCipher::BLOCK_BYTES);
+    ASSERT_TRUE(cipher->decrypt(packed, restored));
+    EXPECT_EQ(plain, restored);
+    // The layouts are not interchangeable
+    EXPECT_TRUE(!make_cipher(CipherId::FFT, derive_key(""))->decrypt(packed, restored) || restored != plain);
+}
+
+TEST(RecordCipherTest, NttIsQuarterOfFft) {
+    std::string plain = sample(100000), fft, ntt, restored;
+    make_cipher(CipherId::FFT, derive_key(""))->encrypt(plain, fft);
+    auto cipher = make_cipher(CipherId::NTT, derive_key(""));
+    cipher->encrypt(plain, ntt);
+    EXPECT_EQ(NttCipher::HEADER_BYTES + 98 * NttCipher::BLOCK_BYTES, ntt.size());
+    EXPECT_EQ(fft.size(), (ntt.size() - NttCipher::HEADER_BYTES) * 4);
+    ASSERT_TRUE(cipher->decrypt(ntt, restored));
+    EXPECT_EQ(plain, restored);
+}
+
+TEST(RecordCipherTest, NttRejectsDamagedPayloads) {
+    auto cipher = make_cipher(CipherId::NTT, derive_key(""));
+    std::string plain = sample(3000), payload, restored;
+    cipher->encrypt(plain, payload);
+
+    std::string damaged = payload;
+    damaged[NttCipher::HEADER_BYTES + 100] ^= 0x01;
+    EXPECT_FALSE(cipher->decrypt(damaged, restored));
+
+    damaged = payload;
+    damaged[0] = 0x7f;  // Plain size no longer matches the block count
+    EXPECT_FALSE(cipher->decrypt(damaged, restored));
+
+    EXPECT_FALSE(is_valid_payload_size(CipherId::NTT, 4));
+    EXPECT_FALSE(is_valid_payload_size(CipherId::NTT, NttCipher::HEADER_BYTES + 12));
+    EXPECT_FALSE(is_valid_payload_size(CipherId::NTT, NttCipher::HEADER_BYTES + 48 * 4));
+    EXPECT_TRUE(is_valid_payload_size(CipherId::NTT, NttCipher::HEADER_BYTES));
+    EXPECT_TRUE(is_valid_payload_size(CipherId::NTT, NttCipher::HEADER_BYTES + 64 * 4));
+}
+
+TEST(RecordCipherTest, SmallRecordsUseSmallBlocks) {
+    const CipherKey key = derive_key("");
+    std::string payload, restored;
+    // Five bytes plus the length symbol fit in the smallest packed block
+    make_cipher(CipherId::FFT_PACKED, key)->encrypt("tiny!", payload);
+    EXPECT_EQ(16u * 16, payload.size());
+    make_cipher(CipherId::NTT, key)->encrypt("tiny!", payload);
+    EXPECT_EQ(NttCipher::HEADER_BYTES + 16 * 4, payload.size());
+
+    for (CipherId id : {CipherId::FFT_PACKED, CipherId::NTT}) {
+        auto cipher = make_cipher(id, key);
+        for (std::size_t n : {2, 15, 16, 17, 31, 32, 33, 100, 511, 512, 513, 1000, 2045, 2046, 2047, 2048}) {
+            std::string plain = sample(n);
+            cipher->encrypt(plain, payload);
+            EXPECT_TRUE(is_valid_payload_size(id, payload.size())) << cipher->name() << " " << n;
+            ASSERT_TRUE(cipher->decrypt(payload, restored)) << cipher->name() << " " << n;
+            EXPECT_EQ(plain, restored) << cipher->name() << " " << n;
+        }
+    }
+}
+
+TEST(RecordCipherTest, ChaCha20UsesFreshNonceAndKey) {
+    std::string plain = sample(100), first, second, restored;
+    auto cipher = make_cipher(CipherId::CHACHA20, derive_key("one"));
+    cipher->encrypt(plain, first);
+    cipher->encrypt(plain, second);
+    EXPECT_NE(first, second);
+
+    auto other = make_cipher(CipherId::CHACHA20, derive_key("two"));
+    ASSERT_TRUE(other->decrypt(first, restored));
+    EXPECT_NE(plain, restored);
+    EXPECT_NE(derive_key(""), derive_key("one"));
+}
@@ -0,0 +1,176 @@
+/**
+ * @file record_schema_test.cpp
+ * @brief Unit tests for the compile-time record schemas
+ */
+
+#include <gtest/gtest.h>
+#include "storage/record_schema.h"
+#include "storage/table_text.h"
+#include <string>
+#include <vector>
+
+using namespace ffvms;
+using namespace ffvms::storage;
+
+namespace {
+
+struct Row {
+    std::uint64_t id = 0;
+    std::string_view name;
+    std::uint32_t size = 0;
+};
+
+struct RowV2 {
+    std::uint64_t id = 0;
+    std::string_view name;
+    std::uint32_t size = 0;
+    std::string owner = "nobody";
+    std::uint64_t flags = 7;
+};
+
+constexpr auto ROW_SCHEMA = make_schema(field("id", &Row::id), field("name", &Row::name),
+                                        field("size", &Row::size));
+
+constexpr auto ROW_V2_SCHEMA = make_schema(field("id", &RowV2::id), field("name", &RowV2::name),
+                                           field("size", &RowV2::size), field("owner", &RowV2::owner, 2),
+                                           field("flags", &RowV2::flags, 2));
+
+static_assert(ROW_SCHEMA.size == 3 && ROW_SCHEMA.required() == 3 && ROW_SCHEMA.version() == 1);
+static_assert(ROW_V2_SCHEMA.required() == 3 && ROW_V2_SCHEMA.version() == 2);
+static_assert(ROW_V2_SCHEMA.valid());
+static_assert(!make_schema(field("owner", &RowV2::owner, 2), field("id", &RowV2::id)).valid());
+
+}  // namespace
+
+TEST(RecordSchemaTest, WritesTheDataTableLayout) {
+    DataTable table;
+    DataTableWriter writer(table);
+    writer.begin_table(2);
+    ROW_SCHEMA.write(writer, {42, "readme", 100});
+    ROW_SCHEMA.write(writer, {0, "", 0});
+    DataTable expected = {{"42", "readme", "100"}, {"0", "", "0"}};
+    EXPECT_EQ(expected, table);
+    EXPECT_STREQ("name", ROW_SCHEMA.name<1>());
+}
+
+TEST(RecordSchemaTest, ReadsRowsAsViews) {
+    std::string text;
+    TextTableWriter writer(text);
+    writer.begin_table(2);
+    ROW_SCHEMA.write(writer, {1, "a", 10});
+    ROW_SCHEMA.write(writer, {2, "bb", 20});
+
+    TextTableReader reader(text);
+    std::vector<Row> rows;
+    ASSERT_TRUE(ROW_SCHEMA.read_table(reader, [&](const Row& row) {
+        rows.push_back(row);
+        return true;
+    }));
+    ASSERT_EQ(2u, rows.size());
+    EXPECT_EQ(2u, rows[1].id);
+    EXPECT_EQ("bb", rows[1].name);
+    EXPECT_EQ(20u, rows[1].size);
+    EXPECT_GE(rows[1].name.data(), text.data());
+    EXPECT_LT(rows[1].name.data(), text.data() + text.size());
+}
+
+TEST(RecordSchemaTest, RejectsBadRows) {
+    auto read = [](const DataTable& table) {
+        DataTableReader reader(table);
+        return ROW_SCHEMA.read_table(reader, [](const Row&) { return true; });
+    };
+    EXPECT_TRUE(read({{"1", "x", "2"}}));
+    EXPECT_FALSE(read({{"1", "x"}}));                    // Missing a required field
+    EXPECT_FALSE(read({{"1", "x", "y"}}));               // Not a number
+    EXPECT_FALSE(read({{"1", "x", "4294967296"}}));      // Does not fit the member
+    DataTable table = {{"1", "x", "2"}};
+    DataTableReader reader(table);
+    EXPECT_FALSE(ROW_SCHEMA.read_table(reader, [](const Row&) { return false; }));
+}
+
+TEST(RecordSchemaTest, AddedFieldsReadBothWays) {
+    // An old row reads with the new fields' defaults
+    DataTable old_table = {{"5", "old", "50"}};
+    DataTableReader old_reader(old_table);
+    RowV2 upgraded;
+    ASSERT_TRUE(ROW_V2_SCHEMA.read_table(old_reader, [&](const RowV2& row) {
+        upgraded = row;
+        return true;
+    }));
+    EXPECT_EQ(5u, upgraded.id);
+    EXPECT_EQ("nobody", upgraded.owner);
+    EXPECT_EQ(7u, upgraded.flags);
+
+    // An old reader skips the new fields, also when rows follow
+    DataTable new_table;
+    DataTableWriter writer(new_table);
+    writer.begin_table(2);
+    ROW_V2_SCHEMA.write(writer, {1, "new", 10, "root", 3});
+    ROW_V2_SCHEMA.write(writer, {2, "next", 20, "root", 3});
+    std::string text;
+    TextTableWriter text_writer(text);
+    text_writer.begin_table(new_table.size());
+    for (auto& row : new_table) {
+        text_writer.begin_row(row.size());
+        for (auto& cell : row) text_writer.str(cell);
+    }
+    TextTableReader reader(text);
+    std::vector<std::uint64_t> ids;
+    ASSERT_TRUE(ROW_SCHEMA.read_table(reader, [&](const Row& row) {
+        ids.push_back(row.id);
+        return true;
+    }));
+    EXPECT_EQ((std::vector<std::uint64_t>{1, 2}), ids);
+}
+
+TEST(RecordSchemaTest, BinaryRoundTripAndEvolution) {
+    std::string bytes;
+    ROW_SCHEMA.write_binary(bytes, {300, "name", 4000000000u});
+    ROW_V2_SCHEMA.write_binary(bytes, {1, "", 0, "root", ~0ULL});
+
+    // Old reader: the second record's extra fields are skipped
+    ByteReader in(bytes.data(), bytes.size());
+    Row first, second;
+    ASSERT_TRUE(ROW_SCHEMA.read_binary(in, first));
+    ASSERT_TRUE(ROW_SCHEMA.read_binary(in, second));
+    EXPECT_EQ(0u, in.remaining());
+    EXPECT_EQ(300u, first.id);
+    EXPECT_EQ("name", first.name);
+    EXPECT_EQ(4000000000u, first.size);
+    EXPECT_EQ(1u, second.id);
+
+    // New reader: the first record's missing fields keep their defaults
+    ByteReader in2(bytes.data(), bytes.size());
+    RowV2 a, b;
+    ASSERT_TRUE(ROW_V2_SCHEMA.read_binary(in2, a));
+    ASSERT_TRUE(ROW_V2_SCHEMA.read_binary(in2, b));
+    EXPECT_EQ("nobody", a.owner);
+    EXPECT_EQ(7u, a.flags);
+    EXPECT_EQ("root", b.owner);
+    EXPECT_EQ(~0ULL, b.flags);
+
+    // Truncated records fail
+    for (std::size_t cut = 0; cut < 8; cut++) {
+        ByteReader truncated(bytes.data(), cut);
+        Row row;
+        EXPECT_FALSE(ROW_SCHEMA.read_binary(truncated, row)) << cut;
+    }
+}
+
+TEST(RecordSchemaTest, Varints) {
+    const std::vector<std::uint64_t> values = {0, 1, 127, 128, 16383, 16384, 1ULL << 35, ~0ULL};
+    std::string bytes;
+    for (auto v : values) {
+        std::size_t before = bytes.size();
+        put_varint(bytes, v);
+        EXPECT_EQ(varint_size(v), bytes.size() - before);
+    }
+    ByteReader in(bytes.data(), bytes.size());
+    for (auto v : values) EXPECT_EQ(v, in.varint());
+    EXPECT_TRUE(in.ok());
+
+    std::string overlong(11, '\xff');
+    ByteReader bad(overlong.data(), overlong.size());
+    bad.varint();
+    EXPECT_FALSE(bad.ok());
+}
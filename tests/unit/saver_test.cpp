@@ -0,0 +1,631 @@
+/**
+ * @file saver_test.cpp
+ * @brief Unit tests for Saver persistence and the data.chm container format
+ */
+
+#include <gtest/gtest.h>
+#include "gmock/gmock.h"
+#include "mock_logger.h"
+#include "saver.h"
+#include "encryptor.h"
+#include "storage/data_file_format.h"
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+using namespace ffvms;
+using namespace ffvms::test;
+using ::testing::_;
+using ::testing::HasSubstr;
+using ::testing::NiceMock;
+
+namespace {
+
+// Writes records the way Saver did before the binary container existed
+class LegacyTextWriter : protected Encryptor {
+public:
+    static unsigned long long hash(const std::string& s) {
+        unsigned long long h = 0;
+        for (auto& ch : s) h = h * 13331 + ch;
+        return h;
+    }
+
+    void write(std::ostream& out, const std::string& name, const std::string& serialized) {
+        std::vector<int> sequence(serialized.begin(), serialized.end());
+        std::vector<std::pair<double, double>> res;
+        encrypt_sequence(sequence, res);
+        out << hash(name) << ' ' << hash(serialized) << ' ' << res.size() / N;
+        for (auto& pr : res) {
+            out << ' ' << pr.first << ' ' << pr.second;
+        }
+        out << '\n';
+    }
+};
+
+}  // namespace
+
+class SaverTest : public ::testing::Test {
+protected:
+    NiceMock<MockLogger> logger;
+    std::string path;
+
+    void SetUp() override {
+        path = (std::filesystem::temp_directory_path() /
+                (std::string("ffvms_saver_test_") +
+                 ::testing::UnitTest::GetInstance()->current_test_info()->name() + ".chm")).string();
+        std::remove(path.c_str());
+    }
+
+    void TearDown() override {
+        for (const std::string& file : {path, path + ".wal", path + ".copy", path + ".copy.wal"}) {
+            std::remove(file.c_str());
+        }
+    }
+
+    // Copies the data file while a Saver still has it open, as a crash would leave it
+    std::string snapshot_of_file() {
+        std::string copy = path + ".copy";
+        std::filesystem::copy_file(path, copy, std::filesystem::copy_options::overwrite_existing);
+        return copy;
+    }
+};
+
+TEST_F(SaverTest, BinaryRoundTrip) {
+    DataTable table = {{"1", "hello world", "2"}, {"42", std::string(3000, 'x'), "1"}, {}};
+    {
+        Saver saver(&logger, path);
+        ASSERT_TRUE(saver.save("table", table));
+        ASSERT_TRUE(saver.save("empty", DataTable()));
+    }
+
+    std::ifstream in(path, std::ios::binary);
+    char magic[8] = {};
+    in.read(magic, sizeof(magic));
+    EXPECT_TRUE(storage::has_file_magic(magic, static_cast<size_t>(in.gcount())));
+    in.close();
+
+    Saver saver(&logger, path);
+    DataTable loaded;
+    ASSERT_TRUE(saver.load("table", loaded));
+    EXPECT_EQ(table, loaded);
+    ASSERT_TRUE(saver.load("empty", loaded));
+    EXPECT_TRUE(loaded.empty());
+    EXPECT_FALSE(saver.load("missing", loaded));
+}
+
+TEST_F(SaverTest, LegacyTextFileStillLoads) {
+    {
+        std::ofstream out(path);
+        LegacyTextWriter writer;
+        writer.write(out, "FileManager::map_relation", "1 3 2 17 11 hello world 1 2");
+    }
+    {
+        Saver saver(&logger, path);
+        DataTable loaded;
+        ASSERT_TRUE(saver.load("FileManager::map_relation", loaded));
+        DataTable expected = {{"17", "hello world", "2"}};
+        EXPECT_EQ(expected, loaded);
+    }
+
+    // The first save migrates the file to the binary container
+    {
+        Saver saver(&logger, path);
+        ASSERT_TRUE(saver.save("other", DataTable{{"1"}}));
+        DataTable loaded;
+        ASSERT_TRUE(saver.load("FileManager::map_relation", loaded));
+    }
+    std::ifstream in(path, std::ios::binary);
+    char magic[8] = {};
+    in.read(magic, sizeof(magic));
+    EXPECT_TRUE(storage::has_file_magic(magic, static_cast<size_t>(in.gcount())));
+}
+
+TEST_F(SaverTest, TruncatedBinaryFileIsRejected) {
+    {
+        Saver saver(&logger, path);
+        ASSERT_TRUE(saver.save("table", DataTable{{"a", "b"}}));
+    }
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 10);
+
+    Saver saver(&logger, path);
+    DataTable loaded;
+    EXPECT_FALSE(saver.load("table", loaded));
+}
+
+TEST_F(SaverTest, UntouchedRecordsSurviveRewrite) {
+    DataTable first = {{"1", "first table"}};
+    DataTable second = {{"2", "second table"}};
+    {
+        Saver saver(&logger, path);
+        ASSERT_TRUE(saver.save("first", first));
+        ASSERT_TRUE(saver.save("second", second));
+    }
+    {
+        // Only "second" is decoded and replaced; "first" stays mapped
+        Saver saver(&logger, path);
+        DataTable loaded;
+        ASSERT_TRUE(saver.load("second", loaded));
+        second.push_back({"3", "appended row"});
+        ASSERT_TRUE(saver.save("second", second));
+    }
+
+    Saver saver(&logger, path);
+    DataTable loaded;
+    ASSERT_TRUE(saver.load("first", loaded));
+    EXPECT_EQ(first, loaded);
+    ASSERT_TRUE(saver.load("second", loaded));
+    EXPECT_EQ(second, loaded);
+}
+
+TEST_F(SaverTest, AppendLogSurvivesCrash) {
+    Saver saver(&logger, path);
+    ASSERT_TRUE(saver.save("first", DataTable{{"1", "one"}}));
+    ASSERT_TRUE(saver.save("second", DataTable{{"2", "two"}}));
+    ASSERT_TRUE(saver.save("first", DataTable{{"1", "uno"}}));
+
+    Saver recovered(&logger, snapshot_of_file());
+    DataTable loaded;
+    ASSERT_TRUE(recovered.load("first", loaded));
+    EXPECT_EQ((DataTable{{"1", "uno"}}), loaded);
+    ASSERT_TRUE(recovered.load("second", loaded));
+    EXPECT_EQ((DataTable{{"2", "two"}}), loaded);
+}
+
+TEST_F(SaverTest, TornLogTailIsDiscarded) {
+    std::string copy;
+    {
+        Saver saver(&logger, path);
+        ASSERT_TRUE(saver.save("first", DataTable{{"1", "one"}}));
+        ASSERT_TRUE(saver.save("second", DataTable{{"2", "two"}}));
+        copy = snapshot_of_file();
+    }
+    std::filesystem::resize_file(copy, std::filesystem::file_size(copy) - 10);
+    {
+        Saver saver(&logger, copy);
+        DataTable loaded;
+        ASSERT_TRUE(saver.load("first", loaded));
+        EXPECT_FALSE(saver.load("second", loaded));
+        ASSERT_TRUE(saver.save("third", DataTable{{"3", "three"}}));
+    }
+    Saver saver(&logger, copy);
+    DataTable loaded;
+    EXPECT_TRUE(saver.load("first", loaded));
+    ASSERT_TRUE(saver.load("third", loaded));
+    EXPECT_EQ((DataTable{{"3", "three"}}), loaded);
+}
+
+TEST_F(SaverTest, TailWithWrappingBodySizeIsDiscarded) {
+    std::string copy;
+    {
+        Saver saver(&logger, path);
+        ASSERT_TRUE(saver.save("first", DataTable{{"1", "one"}}));
+        copy = snapshot_of_file();
+    }
+    const auto size = std::filesystem::file_size(copy);
+    // body_size + 8 wraps to 0 and to 7
+    for (unsigned long long body_size : {~0ULL - 7, ~0ULL}) {
+        std::filesystem::resize_file(copy, size);
+        storage::RecordHeader record;
+        record.body_size = body_size;
+        record.name_hash = 1;
+        record.cipher = static_cast<std::uint16_t>(storage::CipherId::IDENTITY);
+        std::string tail;
+        storage::encode_record_header(tail, record);
+        tail += std::string(64, 'x');
+        {
+            std::ofstream out(copy, std::ios::binary | std::ios::app);
+            out.write(tail.data(), static_cast<std::streamsize>(tail.size()));
+        }
+        Saver saver(&logger, copy);
+        DataTable loaded;
+        ASSERT_TRUE(saver.load("first", loaded));
+        EXPECT_EQ((DataTable{{"1", "one"}}), loaded);
+    }
+}
+
+TEST_F(SaverTest, CompactionDropsSupersededVersions) {
+    SaverOptions options;
+    options.compaction_min_bytes = 0;
+    options.compaction_threshold = 0.5;
+    DataTable table = {{"1", std::string(5000, 'a')}};
+    {
+        Saver saver(&logger, path, options);
+        ASSERT_TRUE(saver.save("table", table));
+        const auto one_version = std::filesystem::file_size(path);
+        for (int i = 1; i < 20; i++) {
+            table[0][1][0] = static_cast<char>('a' + i);
+            ASSERT_TRUE(saver.save("table", table));
+        }
+        DataTable loaded;
+        for (int i = 0; i < 500 && std::filesystem::file_size(path) > 3 * one_version; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            ASSERT_TRUE(saver.load("table", loaded));
+        }
+        EXPECT_LE(std::filesystem::file_size(path), 3 * one_version);
+        ASSERT_TRUE(saver.save("other", DataTable{{"2", "after compaction"}}));
+    }
+    Saver saver(&logger, path, options);
+    DataTable loaded;
+    ASSERT_TRUE(saver.load("table", loaded));
+    EXPECT_EQ(table, loaded);
+    ASSERT_TRUE(saver.load("other", loaded));
+    EXPECT_EQ((DataTable{{"2", "after compaction"}}), loaded);
+}
+
+TEST_F(SaverTest, SnapshotModeWritesOnShutdown) {
+    SaverOptions options;
+    options.mode = SaverOptions::Mode::SNAPSHOT;
+    {
+        Saver saver(&logger, path, options);
+        ASSERT_TRUE(saver.save("table", DataTable{{"1", "one"}}));
+        EXPECT_FALSE(std::filesystem::exists(path));
+    }
+    Saver saver(&logger, path, options);
+    DataTable loaded;
+    ASSERT_TRUE(saver.load("table", loaded));
+    EXPECT_EQ((DataTable{{"1", "one"}}), loaded);
+}
+
+TEST_F(SaverTest, SnapshotModeReplaysJournalAfterCrash) {
+    SaverOptions options;
+    options.mode = SaverOptions::Mode::SNAPSHOT;
+    options.durability = storage::Durability::ALWAYS;
+    std::string copy = path + ".copy";
+    {
+        Saver saver(&logger, path, options);
+        ASSERT_TRUE(saver.save("first", DataTable{{"1", "one"}}));
+        ASSERT_TRUE(saver.save("second", DataTable{{"2", "two"}}));
+        ASSERT_TRUE(saver.save("first", DataTable{{"1", "uno"}}));
+        std::filesystem::copy_file(path + ".wal", copy + ".wal");
+    }
+    EXPECT_FALSE(std::filesystem::exists(path + ".wal"));
+
+    {
+        Saver recovered(&logger, copy, options);
+        DataTable loaded;
+        ASSERT_TRUE(recovered.load("first", loaded));
+        EXPECT_EQ((DataTable{{"1", "uno"}}), loaded);
+        ASSERT_TRUE(recovered.load("second", loaded));
+        EXPECT_EQ((DataTable{{"2", "two"}}), loaded);
+    }
+    EXPECT_TRUE(std::filesystem::exists(copy));
+    EXPECT_FALSE(std::filesystem::exists(copy + ".wal"));
+}
+
+TEST_F(SaverTest, ConcurrentSavesAreAllDurable) {
+    SaverOptions options;
+    options.durability = storage::Durability::ALWAYS;
+    {
+        Saver saver(&logger, path, options);
+        std::vector<std::thread> writers;
+        for (int t = 0; t < 4; t++) {
+            writers.emplace_back([&saver, t] {
+                for (int i = 0; i < 10; i++) {
+                    std::string key = std::to_string(t * 10 + i);
+                    EXPECT_TRUE(saver.save("table" + key, DataTable{{key}}));
+                }
+            });
+        }
+        for (auto& writer : writers) writer.join();
+
+        Saver recovered(&logger, snapshot_of_file(), options);
+        DataTable loaded;
+        for (int i = 0; i < 40; i++) {
+            ASSERT_TRUE(recovered.load("table" + std::to_string(i), loaded));
+            EXPECT_EQ((DataTable{{std::to_string(i)}}), loaded);
+        }
+    }
+}
+
+TEST_F(SaverTest, CompressedAndPlainRecordsCoexist) {
+    DataTable text = {{"1", std::string(20000, 'x') + "tail"}};
+    SaverOptions plain;
+    plain.codec = storage::CodecId::NONE;
+    {
+        Saver saver(&logger, path, plain);
+        ASSERT_TRUE(saver.save("plain", text));
+    }
+    const auto plain_size = std::filesystem::file_size(path);
+    {
+        Saver saver(&logger, path);
+        ASSERT_TRUE(saver.save("compressed", text));
+    }
+    EXPECT_LT(std::filesystem::file_size(path), plain_size * 3 / 2);
+
+    Saver saver(&logger, path);
+    DataTable loaded;
+    ASSERT_TRUE(saver.load("plain", loaded));
+    EXPECT_EQ(text, loaded);
+    ASSERT_TRUE(saver.load("compressed", loaded));
+    EXPECT_EQ(text, loaded);
+}
+
+TEST_F(SaverTest, UnchangedTableIsNotRewritten) {
+    DataTable table = {{"1", "same content"}};
+    Saver saver(&logger, path);
+    ASSERT_TRUE(saver.save("table", table));
+    const auto size = std::filesystem::file_size(path);
+    ASSERT_TRUE(saver.save("table", table));
+    EXPECT_EQ(size, std::filesystem::file_size(path));
+
+    table.push_back({"2", "changed"});
+    ASSERT_TRUE(saver.save("table", table));
+    EXPECT_GT(std::filesystem::file_size(path), size);
+    DataTable loaded;
+    ASSERT_TRUE(saver.load("table", loaded));
+    EXPECT_EQ(table, loaded);
+}
+
+TEST_F(SaverTest, StreamedRecordsMatchDataTableRecords) {
+    DataTable table = {{"7", "streamed", "1 2"}, {}};
+    Saver saver(&logger, path);
+    ASSERT_TRUE(saver.save_records("table", [](IRecordWriter& out) {
+        out.begin_table(2);
+        out.begin_row(3);
+        out.u64(7);
+        out.str("streamed");
+        out.bytes("1 2", 3);
+        out.begin_row(0);
+    }));
+    DataTable loaded;
+    ASSERT_TRUE(saver.load("table", loaded));
+    EXPECT_EQ(table, loaded);
+
+    // The same table saved as a DataTable serializes to the same bytes, so it is skipped
+    const auto size = std::filesystem::file_size(path);
+    ASSERT_TRUE(saver.save("table", table));
+    EXPECT_EQ(size, std::filesystem::file_size(path));
+
+    std::uint64_t number = 0;
+    std::string word;
+    ASSERT_TRUE(saver.load_records("table", [&](IRecordReader& in) {
+        std::size_t fields = 0;
+        std::string_view view;
+        if (in.rows() != 2 || !in.next_row(fields) || fields != 3) return false;
+        if (!in.u64(number) || !in.str(view)) return false;
+        word = std::string(view);
+        return in.next_row(fields) && fields == 0 && !in.next_row(fields);
+    }));
+    EXPECT_EQ(7u, number);
+    EXPECT_EQ("streamed", word);
+
+    // A sink rejecting the table fails the load
+    EXPECT_FALSE(saver.load_records("table", [](IRecordReader&) { return false; }));
+    EXPECT_FALSE(saver.load_records("missing", [](IRecordReader&) { return true; }));
+}
+
+TEST_F(SaverTest, RecordsFromDifferentCiphersCoexist) {
+    DataTable table = {{"1", "cipher migration"}};
+    SaverOptions legacy;
+    legacy.cipher = storage::CipherId::FFT;
+    {
+        Saver saver(&logger, path, legacy);
+        ASSERT_TRUE(saver.save("old", table));
+    }
+    legacy.cipher = storage::CipherId::FFT_PACKED;
+    {
+        Saver saver(&logger, path, legacy);
+        ASSERT_TRUE(saver.save("packed", table));
+    }
+    legacy.cipher = storage::CipherId::NTT;
+    {
+        Saver saver(&logger, path, legacy);
+        ASSERT_TRUE(saver.save("ntt", table));
+    }
+    {
+        Saver saver(&logger, path);
+        ASSERT_TRUE(saver.save("new", table));
+    }
+    Saver saver(&logger, path);
+    DataTable loaded;
+    ASSERT_TRUE(saver.load("old", loaded));
+    EXPECT_EQ(table, loaded);
+    ASSERT_TRUE(saver.load("packed", loaded));
+    EXPECT_EQ(table, loaded);
+    ASSERT_TRUE(saver.load("ntt", loaded));
+    EXPECT_EQ(table, loaded);
+    ASSERT_TRUE(saver.load("new", loaded));
+    EXPECT_EQ(table, loaded);
+}
+
+TEST_F(SaverTest, WrongPassphraseFailsIntegrityCheck) {
+    SaverOptions options;
+    options.passphrase = "right";
+    {
+        Saver saver(&logger, path, options);
+        ASSERT_TRUE(saver.save("table", DataTable{{"1", "secret"}}));
+    }
+    options.passphrase = "wrong";
+    Saver saver(&logger, path, options);
+    DataTable loaded;
+    EXPECT_FALSE(saver.load("table", loaded));
+}
+
+TEST_F(SaverTest, SavedPayloadsAreReadBackFromTheFile) {
+    DataTable first = {{"1", std::string(5000, 'a')}};
+    DataTable second = {{"2", std::string(7000, 'b')}};
+    {
+        Saver saver(&logger, path);
+        ASSERT_TRUE(saver.save("first", first));
+        ASSERT_TRUE(saver.save("second", DataTable{{"old"}}));
+        ASSERT_TRUE(saver.save("second", second));
+        EXPECT_EQ(0u, saver.resident_bytes());
+
+        // Both records lie past the end of the file as it was mapped on open
+        DataTable loaded;
+        ASSERT_TRUE(saver.load("first", loaded));
+        EXPECT_EQ(first, loaded);
+        ASSERT_TRUE(saver.load("second", loaded));
+        EXPECT_EQ(second, loaded);
+        ASSERT_TRUE(saver.load("second", loaded));
+        EXPECT_EQ(second, loaded);
+    }
+    Saver saver(&logger, path);
+    DataTable loaded;
+    ASSERT_TRUE(saver.load("second", loaded));
+    EXPECT_EQ(second, loaded);
+    EXPECT_EQ(0u, saver.resident_bytes());
+
+    SaverOptions keep;
+    keep.drop_payloads = false;
+    Saver keeping(&logger, path + ".copy", keep);
+    ASSERT_TRUE(keeping.save("first", first));
+    EXPECT_GT(keeping.resident_bytes(), 0u);
+}
+
+TEST_F(SaverTest, LegacyTextFileIsConvertedOnOpen) {
+    {
+        std::ofstream out(path);
+        LegacyTextWriter writer;
+        writer.write(out, "table", "1 2 1 a 1 b");
+    }
+    Saver saver(&logger, path);
+    EXPECT_EQ(0u, saver.resident_bytes());
+    std::ifstream in(path, std::ios::binary);
+    char magic[8] = {};
+    in.read(magic, sizeof(magic));
+    EXPECT_TRUE(storage::has_file_magic(magic, static_cast<size_t>(in.gcount())));
+    DataTable loaded;
+    ASSERT_TRUE(saver.load("table", loaded));
+    DataTable expected = {{"a", "b"}};
+    EXPECT_EQ(expected, loaded);
+}
+
+TEST_F(SaverTest, CorruptBlockIsNamed) {
+    std::string content(200000, 'x');
+    content.replace(150000, 9, "CORRUPTME");
+    const DataTable table = {{"1", content}};
+    SaverOptions options;
+    options.cipher = storage::CipherId::IDENTITY;
+    options.codec = storage::CodecId::NONE;
+    {
+        Saver saver(&logger, path, options);
+        ASSERT_TRUE(saver.save("table", table));
+    }
+    std::string file;
+    {
+        std::ifstream in(path, std::ios::binary);
+        file.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    const size_t at = file.find("CORRUPTME");
+    ASSERT_NE(std::string::npos, at);
+    file[at] = 'c';
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(file.data(), static_cast<std::streamsize>(file.size()));
+    }
+
+    // 150000 bytes into the field is in the third 64 KiB block of the table
+    EXPECT_CALL(logger, log(HasSubstr("Block 2 of table (bytes 131072-"), _, _)).Times(2);
+    Saver saver(&logger, path, options);
+    DataTable loaded;
+    EXPECT_FALSE(saver.load("table", loaded));
+    ASSERT_TRUE(saver.load("table", loaded, true));
+    EXPECT_EQ("cORRUPTME", loaded[0][1].substr(150000, 9));
+}
+
+TEST_F(SaverTest, FailedAppendIsWrittenOnRetry) {
+#ifdef _WIN32
+    GTEST_SKIP() << "needs a file size limit";
+#else
+    const DataTable small = {{"1", "small"}};
+    std::string big(100000, '\0');
+    for (size_t i = 0; i < big.size(); i++) big[i] = static_cast<char>('a' + (i * 7919) % 26);
+    const DataTable table = {{"1", big}};
+    SaverOptions options;
+    options.codec = storage::CodecId::NONE;
+    {
+        Saver saver(&logger, path, options);
+        ASSERT_TRUE(saver.save("small", small));
+        ASSERT_TRUE(saver.save("table", DataTable{{"old"}}));
+
+        // Let the record header through, then fail the payload
+        rlimit saved;
+        ASSERT_EQ(0, getrlimit(RLIMIT_FSIZE, &saved));
+        auto handler = std::signal(SIGXFSZ, SIG_IGN);
+        rlimit limit = saved;
+        limit.rlim_cur = std::filesystem::file_size(path) + 1000;
+        ASSERT_EQ(0, setrlimit(RLIMIT_FSIZE, &limit));
+        const bool saved_over_limit = saver.save("table", table);
+        setrlimit(RLIMIT_FSIZE, &saved);
+        std::signal(SIGXFSZ, handler);
+        ASSERT_FALSE(saved_over_limit);
+
+        DataTable loaded;
+        ASSERT_TRUE(saver.load("table", loaded));
+        EXPECT_EQ(DataTable{{"old"}}, loaded);
+        ASSERT_TRUE(saver.save("table", table));
+    }
+    Saver saver(&logger, path, options);
+    DataTable loaded;
+    ASSERT_TRUE(saver.load("table", loaded));
+    EXPECT_EQ(table, loaded);
+    ASSERT_TRUE(saver.load("small", loaded));
+    EXPECT_EQ(small, loaded);
+#endif
+}
+
+TEST_F(SaverTest, DamagedRecordIsRewrittenBySameContent) {
+    const DataTable table = {{"1", std::string(5000, 'x') + "MARKER"}};
+    SaverOptions options;
+    options.cipher = storage::CipherId::IDENTITY;
+    options.codec = storage::CodecId::NONE;
+    {
+        Saver saver(&logger, path, options);
+        ASSERT_TRUE(saver.save("table", table));
+    }
+    std::string file;
+    {
+        std::ifstream in(path, std::ios::binary);
+        file.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    const size_t at = file.find("MARKER");
+    ASSERT_NE(std::string::npos, at);
+    file[at] = 'm';
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(file.data(), static_cast<std::streamsize>(file.size()));
+    }
+    {
+        Saver saver(&logger, path, options);
+        DataTable loaded;
+        EXPECT_FALSE(saver.load("table", loaded));
+        const auto size = std::filesystem::file_size(path);
+        ASSERT_TRUE(saver.save("table", table));
+        EXPECT_GT(std::filesystem::file_size(path), size);
+    }
+    Saver saver(&logger, path, options);
+    DataTable loaded;
+    ASSERT_TRUE(saver.load("table", loaded));
+    EXPECT_EQ(table, loaded);
+}
+
+TEST_F(SaverTest, EveryConstructorConvertsLegacyTextFiles) {
+    // Saver(ILogger*) opens data.chm in the working directory
+    const auto previous = std::filesystem::current_path();
+    const auto directory = std::filesystem::temp_directory_path() / "ffvms_saver_test_default_file";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    std::filesystem::current_path(directory);
+    {
+        std::ofstream out("data.chm");
+        LegacyTextWriter writer;
+        writer.write(out, "table", "1 2 1 a 1 b");
+    }
+    {
+        Saver saver(&logger);
+        EXPECT_EQ(0u, saver.resident_bytes());
+        DataTable loaded;
+        ASSERT_TRUE(saver.load("table", loaded));
+        EXPECT_EQ((DataTable{{"a", "b"}}), loaded);
+    }
+    std::filesystem::current_path(previous);
+    std::filesystem::remove_all(directory);
+}
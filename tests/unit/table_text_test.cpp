@@ -0,0 +1,128 @@
+/**
+ * @file table_text_test.cpp
+ * @brief Unit tests for the TextTableWriter/TextTableReader table encoding
+ */
+
+#include <gtest/gtest.h>
+#include "storage/table_text.h"
+#include <string>
+#include <string_view>
+
+using namespace ffvms;
+using namespace ffvms::storage;
+
+namespace {
+
+std::string write_table(const DataTable& table) {
+    std::string out;
+    TextTableWriter writer(out);
+    writer.begin_table(table.size());
+    for (const auto& row : table) {
+        writer.begin_row(row.size());
+        for (const auto& field : row) writer.str(field);
+    }
+    return out;
+}
+
+bool read_table(std::string_view text, DataTable& table) {
+    TextTableReader reader(text);
+    table.clear();
+    std::size_t fields = 0;
+    while (reader.next_row(fields)) {
+        table.emplace_back();
+        for (std::size_t i = 0; i < fields; i++) {
+            std::string_view field;
+            if (!reader.str(field)) return false;
+            table.back().emplace_back(field);
+        }
+    }
+    return reader.ok();
+}
+
+}  // namespace
+
+TEST(TableTextTest, WriterProducesTheSaverTextFormat) {
+    EXPECT_EQ("2 2 2 12 2 ab 1 0 ", write_table({{"12", "ab"}, {""}}));
+    EXPECT_EQ("0", write_table({}));
+
+    std::string out;
+    TextTableWriter writer(out);
+    writer.begin_table(1);
+    writer.begin_row(2);
+    writer.u64(18446744073709551615ULL);
+    writer.bytes("\0x", 2);
+    EXPECT_EQ(std::string("1 2 20 18446744073709551615 2 \0x", 32), out);
+}
+
+TEST(TableTextTest, RoundTripsBinaryFields) {
+    std::string binary;
+    for (int c = 0; c < 256; c++) binary.push_back(static_cast<char>(c));
+    DataTable table = {{"1 2 3", " ", binary}, {}, {"", "99"}};
+
+    DataTable loaded;
+    ASSERT_TRUE(read_table(write_table(table), loaded));
+    EXPECT_EQ(table, loaded);
+}
+
+TEST(TableTextTest, ViewsPointIntoTheText) {
+    const std::string text = write_table({{"hello", "7"}});
+    TextTableReader reader(text);
+    EXPECT_EQ(1u, reader.rows());
+
+    std::size_t fields = 0;
+    ASSERT_TRUE(reader.next_row(fields));
+    EXPECT_EQ(2u, fields);
+    std::string_view word;
+    std::uint64_t number = 0;
+    ASSERT_TRUE(reader.str(word));
+    ASSERT_TRUE(reader.u64(number));
+    EXPECT_EQ("hello", word);
+    EXPECT_GE(word.data(), text.data());
+    EXPECT_LT(word.data(), text.data() + text.size());
+    EXPECT_EQ(7u, number);
+    EXPECT_FALSE(reader.next_row(fields));
+    EXPECT_TRUE(reader.ok());
+}
+
+TEST(TableTextTest, NextRowSkipsUnreadFields) {
+    const std::string text = write_table({{"a", "b", "c"}, {"d"}});
+    TextTableReader reader(text);
+    std::size_t fields = 0;
+    std::string_view field;
+    ASSERT_TRUE(reader.next_row(fields));
+    ASSERT_TRUE(reader.str(field));
+    EXPECT_EQ("a", field);
+    ASSERT_TRUE(reader.next_row(fields));
+    ASSERT_TRUE(reader.str(field));
+    EXPECT_EQ("d", field);
+    EXPECT_FALSE(reader.next_row(fields));
+    EXPECT_TRUE(reader.ok());
+}
+
+TEST(TableTextTest, MalformedTextFailsTheReader) {
+    DataTable loaded = {{"stale"}};
+    EXPECT_TRUE(read_table("", loaded));                      // An empty record is an empty table
+    EXPECT_TRUE(loaded.empty());
+    EXPECT_FALSE(read_table("x", loaded));
+    EXPECT_FALSE(read_table("1 1 5 abc", loaded));            // Field runs past the end
+    EXPECT_FALSE(read_table("2 1 1 a", loaded));              // Missing row
+    EXPECT_FALSE(read_table("1 1 99999999999999999999 a", loaded));
+
+    // Reading past the last field of a row fails rather than running into the next row
+    const std::string text = write_table({{"a"}, {"b"}});
+    TextTableReader reader(text);
+    std::size_t fields = 0;
+    std::string_view field;
+    ASSERT_TRUE(reader.next_row(fields));
+    ASSERT_TRUE(reader.str(field));
+    EXPECT_FALSE(reader.str(field));
+    EXPECT_FALSE(reader.ok());
+
+    // A u64 read of a non-numeric field fails
+    const std::string words = write_table({{"12a"}});
+    TextTableReader numbers(words);
+    std::uint64_t value = 0;
+    ASSERT_TRUE(numbers.next_row(fields));
+    EXPECT_FALSE(numbers.u64(value));
+    EXPECT_FALSE(numbers.ok());
+}
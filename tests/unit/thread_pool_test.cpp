@@ -0,0 +1,64 @@
+/**
+ * @file thread_pool_test.cpp
+ * @brief Unit tests for the worker pool
+ */
+
+#include <gtest/gtest.h>
+#include "core/thread_pool.h"
+
+#include <atomic>
+#include <future>
+#include <vector>
+
+using ffvms::ThreadPool;
+
+TEST(ThreadPoolTest, ParallelForVisitsEveryIndexOnce) {
+    ThreadPool pool(4);
+    std::vector<std::atomic<int>> hits(1000);
+    pool.parallel_for(hits.size(), 7, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) hits[i]++;
+    });
+    for (std::size_t i = 0; i < hits.size(); i++) EXPECT_EQ(1, hits[i].load()) << "Index " << i;
+}
+
+TEST(ThreadPoolTest, NestedParallelForCompletes) {
+    ThreadPool pool(2);
+    std::atomic<int> total{0};
+    pool.parallel_for(8, 1, [&](std::size_t, std::size_t) {
+        pool.parallel_for(8, 1, [&](std::size_t begin, std::size_t end) {
+            total += static_cast<int>(end - begin);
+        });
+    });
+    EXPECT_EQ(64, total.load());
+}
+
+TEST(ThreadPoolTest, EmptyRangeDoesNothing) {
+    ThreadPool pool(2);
+    bool called = false;
+    pool.parallel_for(0, 4, [&](std::size_t, std::size_t) { called = true; });
+    EXPECT_FALSE(called);
+}
+
+TEST(ThreadPoolTest, ForBlocksSplitsOnlyLargeRanges) {
+    ThreadPool pool(4);
+    std::atomic<int> calls{0};
+    std::vector<std::atomic<int>> hits(64);
+    auto body = [&](std::size_t begin, std::size_t end) {
+        calls++;
+        for (std::size_t i = begin; i < end; i++) hits[i]++;
+    };
+    ffvms::for_blocks(&pool, 7, 8, body);
+    EXPECT_EQ(1, calls.load());
+    ffvms::for_blocks(nullptr, hits.size(), 8, body);
+    EXPECT_EQ(2, calls.load());
+    ffvms::for_blocks(&pool, hits.size(), 8, body);
+    EXPECT_GT(calls.load(), 3);
+    for (std::size_t i = 0; i < hits.size(); i++) EXPECT_EQ(i < 7 ? 3 : 2, hits[i].load()) << "Index " << i;
+}
+
+TEST(ThreadPoolTest, SubmitRunsTask) {
+    ThreadPool pool(1);
+    std::promise<int> done;
+    pool.submit([&done] { done.set_value(42); });
+    EXPECT_EQ(42, done.get_future().get());
+}
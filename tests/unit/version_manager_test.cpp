@@ -0,0 +1,238 @@
+/**
+ * @file version_manager_test.cpp
+ * @brief Unit tests for VersionManager persistence of version trees
+ */
+
+#include <gtest/gtest.h>
+#include "gmock/gmock.h"
+#include "mock_logger.h"
+#include "mock_node_manager.h"
+#include "file_manager.h"
+#include "file_system.h"
+#include "node_manager.h"
+#include "version_manager.h"
+#include "storage/node_columns.h"
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+using namespace ffvms;
+using namespace ffvms::test;
+using ::testing::NiceMock;
+
+namespace {
+
+// Keeps saved tables in memory so VersionManager instances can be reloaded
+class TableStorage : public IStorage {
+public:
+    std::map<std::string, DataTable> tables;
+
+    bool save(const std::string& name, const DataTable& content) override {
+        tables[name] = content;
+        return true;
+    }
+
+    bool load(const std::string& name, DataTable& content, bool) override {
+        auto it = tables.find(name);
+        if (it == tables.end()) return false;
+        content = it->second;
+        return true;
+    }
+};
+
+const std::string TREE = "VersionManager::DATA_TREENODE_INFO";
+const std::string VERSIONS = "VersionManager::DATA_VERSION_INFO";
+const std::string NONE = std::to_string(0x3f3f3f3f3f3fULL);
+
+// Every version's tree written out, with shared nodes shown as references to their first appearance
+std::string shape(VersionManager& vm) {
+    std::vector<std::pair<unsigned long long, versionNode>> log;
+    vm.get_version_log(log);
+    std::map<const treeNode*, std::size_t> seen;
+    std::string out;
+    std::function<void(const treeNode*)> walk = [&](const treeNode* p) {
+        if (p == nullptr) {
+            out += "-";
+            return;
+        }
+        auto it = seen.find(p);
+        if (it != seen.end()) {
+            out += "@" + std::to_string(it->second);
+            return;
+        }
+        seen.emplace(p, seen.size());
+        out += "(" + std::to_string(p->type) + "," + std::to_string(p->cnt) + "," + std::to_string(p->link);
+        walk(p->next_brother);
+        walk(p->first_son);
+        out += ")";
+    };
+    for (auto& it : log) {
+        treeNode* head = nullptr;
+        vm.get_version_pointer(it.first, head);
+        out += std::to_string(it.first) + ":";
+        walk(head);
+    }
+    return out;
+}
+
+}  // namespace
+
+class VersionManagerTest : public ::testing::Test {
+protected:
+    NiceMock<MockLogger> logger;
+    NiceMock<MockNodeManager> node_manager;
+    TableStorage storage;
+
+    std::unique_ptr<VersionManager> open() {
+        return std::make_unique<VersionManager>(&logger, &node_manager, &storage);
+    }
+
+    // Two versions sharing one directory: head -> dir -> (file 300, brother file 400)
+    void store_legacy_tree() {
+        storage.tables[TREE] = {{"10", "2", "1", "100", NONE, "20"},
+                                {"50", "2", "1", "500", NONE, "20"},
+                                {"20", "1", "2", "200", NONE, "30"},
+                                {"30", "0", "1", "300", "40", NONE},
+                                {"40", "0", "1", "400", NONE, NONE}};
+        storage.tables[VERSIONS] = {{"1", "first", "10"}, {"2", "second", "50"}};
+    }
+
+    void expect_tree(VersionManager& vm) {
+        treeNode* first = nullptr;
+        treeNode* second = nullptr;
+        ASSERT_TRUE(vm.get_version_pointer(1, first));
+        ASSERT_TRUE(vm.get_version_pointer(2, second));
+        EXPECT_EQ(treeNode::HEAD_NODE, first->type);
+        EXPECT_EQ(100u, first->link);
+        EXPECT_EQ(500u, second->link);
+        ASSERT_NE(nullptr, first->first_son);
+        EXPECT_EQ(first->first_son, second->first_son);   // Still shared after the round trip
+        treeNode* dir = first->first_son;
+        EXPECT_EQ(treeNode::DIR, dir->type);
+        EXPECT_EQ(2, dir->cnt);
+        EXPECT_EQ(nullptr, dir->next_brother);
+        ASSERT_NE(nullptr, dir->first_son);
+        EXPECT_EQ(300u, dir->first_son->link);
+        ASSERT_NE(nullptr, dir->first_son->next_brother);
+        EXPECT_EQ(400u, dir->first_son->next_brother->link);
+        EXPECT_EQ(treeNode::FILE, dir->first_son->next_brother->type);
+        EXPECT_EQ(nullptr, dir->first_son->next_brother->next_brother);
+    }
+};
+
+TEST_F(VersionManagerTest, LegacyTreeIsRewrittenAsColumns) {
+    store_legacy_tree();
+    {
+        auto vm = open();
+        expect_tree(*vm);
+        vm->mark_tree_dirty();
+    }
+    const DataTable& tree = storage.tables[TREE];
+    ASSERT_EQ(1u, tree.size());
+    ASSERT_EQ(1u, tree[0].size());
+    EXPECT_TRUE(storage::NodeColumnsReader::is_node_columns(tree[0][0]));
+
+    auto vm = open();
+    expect_tree(*vm);
+    std::vector<std::pair<unsigned long long, versionNode>> log;
+    ASSERT_TRUE(vm->get_version_log(log));
+    ASSERT_EQ(2u, log.size());
+    EXPECT_EQ("second", log[1].second.info);
+}
+
+TEST_F(VersionManagerTest, LongSiblingChainRoundTrips) {
+    // One directory with many files; saving must not recurse once per sibling
+    const std::size_t files = 100000;
+    DataTable tree = {{"0", "2", "1", "1", NONE, "1"}};
+    for (std::size_t i = 1; i <= files; i++) {
+        tree.push_back({std::to_string(i), "0", "1", std::to_string(1000 + i),
+                        i == files ? NONE : std::to_string(i + 1), NONE});
+    }
+    storage.tables[TREE] = tree;
+    storage.tables[VERSIONS] = {{"1", "", "0"}};
+    {
+        auto vm = open();
+        vm->mark_tree_dirty();
+    }
+    auto vm = open();
+    treeNode* p = nullptr;
+    ASSERT_TRUE(vm->get_version_pointer(1, p));
+    std::size_t count = 0;
+    for (treeNode* file = p->first_son; file != nullptr; file = file->next_brother) {
+        EXPECT_EQ(1000 + count + 1, file->link);
+        count++;
+    }
+    EXPECT_EQ(files, count);
+}
+
+TEST_F(VersionManagerTest, DamagedColumnsLeaveNoVersions) {
+    store_legacy_tree();
+    {
+        auto vm = open();
+        vm->mark_tree_dirty();
+    }
+    std::string& bytes = storage.tables[TREE][0][0];
+    bytes.resize(bytes.size() - 3);
+    auto vm = open();
+    EXPECT_FALSE(vm->version_exist(1));
+    EXPECT_TRUE(vm->empty());
+}
+
+TEST_F(VersionManagerTest, IncrementalCapturesMatchTheTrees) {
+    FileManager files(&storage, &logger);
+    NodeManager nodes(&files, &storage, &logger);
+    FileSystem fs(&logger, &nodes, &storage);
+    auto& vm = dynamic_cast<VersionManager&>(fs.checkpoint_source());
+    // Each capture only encodes what changed since the last; the stored table must still be the whole tree
+    auto checkpoint = [&]() {
+        std::vector<TableWrite> writes;
+        vm.capture(writes);
+        for (auto& write : writes) ASSERT_TRUE(write.write_to(storage));
+        VersionManager reloaded(&logger, &node_manager, &storage);
+        EXPECT_EQ(shape(vm), shape(reloaded));
+    };
+
+    ASSERT_TRUE(fs.make_dir("a"));
+    ASSERT_TRUE(fs.make_file("f1"));
+    ASSERT_TRUE(fs.make_file("f2"));
+    checkpoint();
+    ASSERT_TRUE(fs.update_content("f1", "x"));
+    checkpoint();
+    ASSERT_TRUE(fs.create_version(1001, "second"));
+    checkpoint();
+    ASSERT_TRUE(fs.change_directory("a"));
+    ASSERT_TRUE(fs.make_file("g"));
+    ASSERT_TRUE(fs.goto_last_dir());
+    ASSERT_TRUE(fs.remove_file("f2"));
+    checkpoint();
+    ASSERT_TRUE(fs.switch_version(1001));
+    ASSERT_TRUE(fs.update_name("f1", "renamed"));
+    ASSERT_TRUE(fs.remove_dir("a"));
+    checkpoint();
+    // Labels freed by the removals are taken again
+    ASSERT_TRUE(fs.make_file("h"));
+    ASSERT_TRUE(fs.make_dir("d"));
+    checkpoint();
+}
+
+TEST_F(VersionManagerTest, CyclicColumnsLeaveNoVersions) {
+    storage::NodeColumnsWriter writer;
+    storage::NodeColumn head;
+    head.type = treeNode::HEAD_NODE;
+    head.first_son = 1;
+    writer.add(head);
+    storage::NodeColumn dir;
+    dir.type = treeNode::DIR;
+    dir.first_son = 2;
+    writer.add(dir);
+    storage::NodeColumn file;
+    file.next_brother = 1;   // back to its own parent
+    writer.add(file);
+    std::string bytes;
+    writer.finish(bytes);
+    storage.tables[TREE] = {{bytes}};
+    storage.tables[VERSIONS] = {{"1", "", "0"}};
+    auto vm = open();
+    EXPECT_TRUE(vm->empty());
+}
@@ -0,0 +1,124 @@
+/**
+ * @file migrate.cpp
+ * @brief ffvms-migrate: convert a legacy text data.chm to the binary format
+ *
+ * Usage: ffvms-migrate [--cipher NAME] [--codec NAME] [--passphrase TEXT] OLD [NEW]
+ *
+ * Streams the records of OLD into a binary data file at NEW (default: OLD
+ * itself, replaced once the new file is complete) and reports the
+ * throughput. Ciphers: chacha20 (default), ntt, fft-packed, fft, identity;
+ * fft keeps the old payloads as they are. Codecs: lz4 (default), none.
+ */
+
+#include "storage/legacy_migration.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+using namespace ffvms;
+
+namespace {
+
+class ConsoleLogger : public ILogger {
+private:
+    std::string last_;
+    std::string information_;
+
+public:
+    void log(const std::string& content, LogLevel, int) override {
+        last_ = content;
+        std::cerr << content << '\n';
+    }
+    const std::string& get_last_message() const override { return last_; }
+    void set_information(const std::string& info) override { information_ = info; }
+    const std::string& get_information() const override { return information_; }
+};
+
+bool find_cipher(const std::string& name, storage::CipherId& id) {
+    const storage::CipherKey key{};
+    for (unsigned int i = 0; i <= static_cast<unsigned int>(storage::CipherId::NTT); i++) {
+        auto cipher = storage::make_cipher(static_cast<storage::CipherId>(i), key);
+        if (cipher && name == cipher->name()) {
+            id = cipher->id();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool find_codec(const std::string& name, storage::CodecId& id) {
+    for (storage::CodecId candidate : {storage::CodecId::NONE, storage::CodecId::LZ4}) {
+        const storage::ICodec* codec = storage::find_codec(candidate);
+        if (codec && name == codec->name()) {
+            id = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+int usage() {
+    std::cerr << "usage: ffvms-migrate [--cipher chacha20|ntt|fft-packed|fft|identity] [--codec lz4|none]\n"
+                 "                     [--passphrase TEXT] OLD [NEW]\n";
+    return 2;
+}
+
+double mb(std::uint64_t bytes) {
+    return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    storage::MigrationOptions options;
+    std::string source, target;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--cipher" && has_value) {
+            if (!find_cipher(argv[++i], options.cipher)) return usage();
+        } else if (arg == "--codec" && has_value) {
+            if (!find_codec(argv[++i], options.codec)) return usage();
+        } else if (arg == "--passphrase" && has_value) {
+            options.passphrase = argv[++i];
+        } else if (arg.compare(0, 2, "--") == 0) {
+            return usage();
+        } else if (source.empty()) {
+            source = arg;
+        } else if (target.empty()) {
+            target = arg;
+        } else {
+            return usage();
+        }
+    }
+    if (source.empty()) return usage();
+    if (target.empty()) target = source;
+
+    ConsoleLogger logger;
+    storage::MigrationStats stats;
+    const auto start = std::chrono::steady_clock::now();
+    auto seconds = [&] {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    double last_report = 0;
+    auto progress = [&](const storage::MigrationStats& so_far) {
+        const double now = seconds();
+        if (now - last_report < 1) return;
+        last_report = now;
+        std::fprintf(stderr, "\r%10.1f MB read  %8.1f MB/s", mb(so_far.bytes_read), mb(so_far.bytes_read) / now);
+    };
+    const bool ok = storage::migrate_legacy_text(logger, source, target, options, stats, progress);
+    if (last_report > 0) std::fprintf(stderr, "\n");
+    if (!ok) return 1;
+
+    const double elapsed = seconds();
+    std::printf("%llu records, %.1f MB text -> %.1f MB in %.2f s (%.1f MB/s)\n",
+                static_cast<unsigned long long>(stats.records), mb(stats.bytes_read), mb(stats.bytes_written),
+                elapsed, elapsed > 0 ? mb(stats.bytes_read) / elapsed : 0.0);
+    if (stats.kept > 0) {
+        std::printf("%llu records failed their integrity check and were copied unchanged\n",
+                    static_cast<unsigned long long>(stats.kept));
+    }
+    return 0;
+}